@@ -19,6 +19,8 @@ extern div_info_t arena_binind_div_info[SC_NBINS];
 extern const uint64_t h_steps[SMOOTHSTEP_NSTEPS];
 extern malloc_mutex_t arenas_lock;
 extern emap_t arena_emap_global;
+extern hpa_central_t arena_hpa_central_global;
+extern pa_cpu_hpa_t arena_hpa_cpu_global;
 
 extern size_t opt_oversize_threshold;
 extern size_t oversize_threshold;
@@ -36,7 +38,8 @@ void arena_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
     const char **dss, ssize_t *dirty_decay_ms, ssize_t *muzzy_decay_ms,
     size_t *nactive, size_t *ndirty, size_t *nmuzzy, arena_stats_t *astats,
     bin_stats_data_t *bstats, arena_stats_large_t *lstats,
-    pac_estats_t *estats, hpa_shard_stats_t *hpastats, sec_stats_t *secstats);
+    pac_estats_t *estats, hpa_shard_stats_t *hpastats, sec_stats_t *secstats,
+    sec_stats_t *pac_secstats);
 void arena_handle_new_dirty_pages(tsdn_t *tsdn, arena_t *arena);
 edata_t *arena_extent_alloc_large(tsdn_t *tsdn, arena_t *arena,
     size_t usize, size_t alignment, bool zero);
@@ -49,6 +52,9 @@ void arena_extent_ralloc_large_expand(tsdn_t *tsdn, arena_t *arena,
 bool arena_decay_ms_set(tsdn_t *tsdn, arena_t *arena, extent_state_t state,
     ssize_t decay_ms);
 ssize_t arena_decay_ms_get(arena_t *arena, extent_state_t state);
+bool arena_hpa_dirty_decay_ms_set(tsdn_t *tsdn, arena_t *arena,
+    ssize_t decay_ms);
+ssize_t arena_hpa_dirty_decay_ms_get(arena_t *arena);
 void arena_decay(tsdn_t *tsdn, arena_t *arena, bool is_background_thread,
     bool all);
 void arena_reset(tsd_t *tsd, arena_t *arena);
@@ -82,6 +82,12 @@ struct arena_s {
 	 */
 	unsigned ind;
 
+	/*
+	 * The NUMA node this arena's memory is meant to come from (see
+	 * opt_numa_bind).  Read-only after initialization.
+	 */
+	unsigned numa_node;
+
 	/*
 	 * Base allocator, from which arena metadata are allocated.
 	 *
@@ -21,15 +21,17 @@ typedef enum {
 	 */
 	percpu_arena_uninit            = 0,
 	per_phycpu_arena_uninit        = 1,
+	per_node_arena_uninit          = 2,
 
 	/* All non-disabled modes must come after percpu_arena_disabled. */
-	percpu_arena_disabled          = 2,
+	percpu_arena_disabled          = 3,
 
-	percpu_arena_mode_names_limit  = 3, /* Used for options processing. */
-	percpu_arena_mode_enabled_base = 3,
+	percpu_arena_mode_names_limit  = 4, /* Used for options processing. */
+	percpu_arena_mode_enabled_base = 4,
 
-	percpu_arena                   = 3,
-	per_phycpu_arena               = 4  /* Hyper threads share arena. */
+	percpu_arena                   = 4,
+	per_phycpu_arena               = 5, /* Hyper threads share arena. */
+	per_node_arena                 = 6  /* CPUs on a NUMA node share arena. */
 } percpu_arena_mode_t;
 
 #define PERCPU_ARENA_ENABLED(m)	((m) >= percpu_arena_mode_enabled_base)
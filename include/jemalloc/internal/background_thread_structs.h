@@ -10,6 +10,7 @@
 #define BACKGROUND_THREAD_INDEFINITE_SLEEP UINT64_MAX
 #define MAX_BACKGROUND_THREAD_LIMIT MALLOCX_ARENA_LIMIT
 #define DEFAULT_NUM_BACKGROUND_THREAD 4
+#define BACKGROUND_THREAD_HPA_INTERVAL_MAX_DEFAULT_MS 5000
 
 typedef enum {
 	background_thread_stopped,
@@ -1,6 +1,7 @@
 #ifndef JEMALLOC_INTERNAL_CTL_H
 #define JEMALLOC_INTERNAL_CTL_H
 
+#include "jemalloc/internal/hpa_central.h"
 #include "jemalloc/internal/jemalloc_internal_types.h"
 #include "jemalloc/internal/malloc_io.h"
 #include "jemalloc/internal/mutex_prof.h"
@@ -47,6 +48,7 @@ typedef struct ctl_arena_stats_s {
 	pac_estats_t estats[SC_NPSIZES];
 	hpa_shard_stats_t hpastats;
 	sec_stats_t secstats;
+	sec_stats_t pac_secstats;
 } ctl_arena_stats_t;
 
 typedef struct ctl_stats_s {
@@ -57,8 +59,11 @@ typedef struct ctl_stats_s {
 	size_t resident;
 	size_t mapped;
 	size_t retained;
+	/* resident, split up by the NUMA node of each arena. */
+	size_t numa_resident[PAGES_NUMA_NODES_MAX];
 
 	background_thread_stats_t background_thread;
+	hpa_central_stats_t hpa_central;
 	mutex_prof_data_t mutex_prof_data[mutex_prof_num_global_mutexes];
 } ctl_stats_t;
 
@@ -1,9 +1,16 @@
 #ifndef JEMALLOC_INTERNAL_ECACHE_H
 #define JEMALLOC_INTERNAL_ECACHE_H
 
+#include "jemalloc/internal/atomic.h"
 #include "jemalloc/internal/eset.h"
 #include "jemalloc/internal/mutex.h"
 
+/*
+ * The number of freed extents an ecache holds onto for a batched coalesce (see
+ * opt_extent_coalesce_deferred) before the freeing thread does it itself.
+ */
+#define ECACHE_COALESCE_PENDING_MAX 64
+
 typedef struct ecache_s ecache_t;
 struct ecache_s {
 	malloc_mutex_t mtx;
@@ -17,6 +24,15 @@ struct ecache_s {
 	 * deallocation.
 	 */
 	bool delay_coalesce;
+	/*
+	 * With opt_extent_coalesce_deferred, the base addresses of large
+	 * extents that went into the eset without being coalesced.  We keep
+	 * addresses rather than edata_ts since the extents can be reused (or
+	 * merged away) before we get to them.  Guarded by mtx, though the count
+	 * may be read without it.
+	 */
+	void *coalesce_pending[ECACHE_COALESCE_PENDING_MAX];
+	atomic_u_t ncoalesce_pending;
 };
 
 static inline size_t
@@ -34,6 +50,11 @@ ecache_nbytes_get(ecache_t *ecache, pszind_t ind) {
 	return eset_nbytes_get(&ecache->eset, ind);
 }
 
+static inline unsigned
+ecache_ncoalesce_pending_get(ecache_t *ecache) {
+	return atomic_load_u(&ecache->ncoalesce_pending, ATOMIC_RELAXED);
+}
+
 static inline unsigned
 ecache_ind_get(ecache_t *ecache) {
 	return ecache->ind;
@@ -53,6 +53,14 @@ struct e_prof_info_s {
 };
 typedef struct e_prof_info_s e_prof_info_t;
 
+struct e_sec_info_s {
+	/* Linkage for the owning SEC shard's LRU list. */
+	ql_elm(struct edata_s)	e_sec_link;
+	/* Time when this was cached. */
+	nstime_t	e_sec_cached_time;
+};
+typedef struct e_sec_info_s e_sec_info_t;
+
 /*
  * The information about a particular edata that lives in an emap.  Space is
  * more previous there (the information, plus the edata pointer, has to live in
@@ -231,11 +239,18 @@ struct edata_s {
 
 		/* Profiling data, used for large objects. */
 		e_prof_info_t	e_prof_info;
+
+		/*
+		 * Used while the extent sits in a small extent cache; the slab
+		 * and profiling data get reinitialized once it's reallocated.
+		 */
+		e_sec_info_t	e_sec_info;
 	};
 };
 
 TYPED_LIST(edata_list_active, edata_t, ql_link_active)
 TYPED_LIST(edata_list_inactive, edata_t, ql_link_inactive)
+TYPED_LIST(edata_list_sec, edata_t, e_sec_info.e_sec_link)
 
 static inline unsigned
 edata_arena_ind_get(const edata_t *edata) {
@@ -392,6 +407,11 @@ edata_prof_alloc_time_get(const edata_t *edata) {
 	return &edata->e_prof_info.e_prof_alloc_time;
 }
 
+static inline const nstime_t *
+edata_sec_cached_time_get(const edata_t *edata) {
+	return &edata->e_sec_info.e_sec_cached_time;
+}
+
 static inline size_t
 edata_prof_alloc_size_get(const edata_t *edata) {
 	return edata->e_prof_info.e_prof_alloc_size;
@@ -533,6 +553,11 @@ edata_prof_alloc_time_set(edata_t *edata, nstime_t *t) {
 	nstime_copy(&edata->e_prof_info.e_prof_alloc_time, t);
 }
 
+static inline void
+edata_sec_cached_time_set(edata_t *edata, nstime_t *t) {
+	nstime_copy(&edata->e_sec_info.e_sec_cached_time, t);
+}
+
 static inline void
 edata_prof_alloc_size_set(edata_t *edata, size_t size) {
 	edata->e_prof_info.e_prof_alloc_size = size;
@@ -637,19 +662,46 @@ edata_ead_comp(const edata_t *a, const edata_t *b) {
 	return (a_eaddr > b_eaddr) - (a_eaddr < b_eaddr);
 }
 
+/*
+ * The (serial number, address) pair that the snad ordering compares.  Callers
+ * that compare the same extents over and over (the eset caching its heaps'
+ * minimums, say) can keep these around, so as not to touch the edata_t each
+ * time.
+ */
+typedef struct edata_cmp_summary_s edata_cmp_summary_t;
+struct edata_cmp_summary_s {
+	size_t sn;
+	uintptr_t addr;
+};
+
+static inline edata_cmp_summary_t
+edata_cmp_summary_get(const edata_t *edata) {
+	edata_cmp_summary_t summary = {edata_sn_get(edata),
+	    (uintptr_t)edata_addr_get(edata)};
+	return summary;
+}
+
 static inline int
-edata_snad_comp(const edata_t *a, const edata_t *b) {
+edata_cmp_summary_comp(edata_cmp_summary_t a, edata_cmp_summary_t b) {
 	int ret;
 
-	ret = edata_sn_comp(a, b);
+	ret = (a.sn > b.sn) - (a.sn < b.sn);
 	if (ret != 0) {
 		return ret;
 	}
 
-	ret = edata_ad_comp(a, b);
+	ret = (a.addr > b.addr) - (a.addr < b.addr);
 	return ret;
 }
 
+static inline int
+edata_snad_comp(const edata_t *a, const edata_t *b) {
+	edata_cmp_summary_t a_cmp = edata_cmp_summary_get(a);
+	edata_cmp_summary_t b_cmp = edata_cmp_summary_get(b);
+
+	return edata_cmp_summary_comp(a_cmp, b_cmp);
+}
+
 static inline int
 edata_esnead_comp(const edata_t *a, const edata_t *b) {
 	int ret;
@@ -130,6 +130,13 @@ ehooks_dalloc_will_fail(ehooks_t *ehooks) {
 	}
 }
 
+/* Whether destroying an extent leaves its memory mapped. */
+static inline bool
+ehooks_destroy_is_noop(ehooks_t *ehooks) {
+	return !ehooks_are_default(ehooks)
+	    && ehooks_get_extent_hooks_ptr(ehooks)->destroy == NULL;
+}
+
 static inline bool
 ehooks_split_will_fail(ehooks_t *ehooks) {
 	return ehooks_get_extent_hooks_ptr(ehooks)->split == NULL;
@@ -53,6 +53,13 @@ edata_t *emap_lock_edata_from_addr(tsdn_t *tsdn, emap_t *emap, void *addr,
  */
 bool emap_register_boundary(tsdn_t *tsdn, emap_t *emap, edata_t *edata,
     szind_t szind, bool slab);
+/*
+ * Makes sure the rtree has leaves for the first and last page of the given
+ * range, so that registering an extent spanning it can't fail later on.
+ * Returns true on error (i.e. resource exhaustion).
+ */
+bool emap_register_prepare(tsdn_t *tsdn, emap_t *emap, void *addr,
+    size_t size);
 
 /*
  * Does the same thing, but with the interior of the range, for slab
@@ -45,6 +45,23 @@ exp_grow_size_commit(exp_grow_t *exp_grow, pszind_t skip) {
 
 }
 
+/*
+ * Starts the series over once the address space it reserved got released, so
+ * that we don't go straight back to reserving ever larger amounts of it.  The
+ * next step is the largest one that's no larger than size_max (but no smaller
+ * than the first).
+ */
+static inline void
+exp_grow_restart(exp_grow_t *exp_grow, size_t size_max) {
+	pszind_t next = sz_psz2ind(HUGEPAGE);
+	while (next + 1 < exp_grow->next && sz_pind2sz(next + 1) <= size_max) {
+		next++;
+	}
+	if (next < exp_grow->next) {
+		exp_grow->next = next;
+	}
+}
+
 void exp_grow_init(exp_grow_t *exp_grow);
 
 #endif /* JEMALLOC_INTERNAL_EXP_GROW_H */
@@ -19,6 +19,13 @@
 #define LG_EXTENT_MAX_ACTIVE_FIT_DEFAULT 6
 extern size_t opt_lg_extent_max_active_fit;
 
+/*
+ * If true, large extents freed into the dirty ecache are queued up to be
+ * coalesced in batches (ideally by a background thread), rather than on the
+ * spot.
+ */
+extern bool opt_extent_coalesce_deferred;
+
 edata_t *ecache_alloc(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
     ecache_t *ecache, void *new_addr, size_t size, size_t alignment, bool zero);
 edata_t *ecache_alloc_grow(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
@@ -27,6 +34,12 @@ void ecache_dalloc(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
     ecache_t *ecache, edata_t *edata);
 edata_t *ecache_evict(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
     ecache_t *ecache, size_t npages_min);
+/*
+ * Coalesces the extents that opt_extent_coalesce_deferred left queued up in
+ * the ecache.
+ */
+void ecache_coalesce_deferred(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
+    ecache_t *ecache);
 
 edata_t *extent_alloc_wrapper(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
     void *new_addr, size_t size, size_t alignment, bool zero, bool *commit);
@@ -48,6 +61,15 @@ edata_t *extent_split_wrapper(tsdn_t *tsdn, pac_t *pac,
     ehooks_t *ehooks, edata_t *edata, size_t size_a, size_t size_b);
 bool extent_merge_wrapper(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
     edata_t *a, edata_t *b);
+/*
+ * Grows an active (non-slab) extent to new_size bytes by growing its mapping
+ * in place or else moving its pages to a new one, rather than copying them;
+ * the edata moves along with them, and is registered for its new range with
+ * SC_NSIZES (so the caller has to emap_remap it).  Returns true, with the
+ * extent as it was, if its hooks or the OS can't do that, or on OOM.
+ */
+bool extent_move_wrapper(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
+    edata_t *edata, size_t new_size);
 size_t extent_sn_next(pac_t *pac);
 bool extent_boot(void);
 
@@ -1,11 +1,19 @@
 #ifndef JEMALLOC_INTERNAL_HPA_H
 #define JEMALLOC_INTERNAL_HPA_H
 
+#include "jemalloc/internal/decay.h"
 #include "jemalloc/internal/exp_grow.h"
+#include "jemalloc/internal/hpa_central.h"
 #include "jemalloc/internal/hpa_opts.h"
 #include "jemalloc/internal/pai.h"
 #include "jemalloc/internal/psset.h"
 
+/*
+ * Dehugifications this soon after the corresponding hugification count as
+ * "early" in the stats below.
+ */
+#define HPA_DEHUGIFY_EARLY_MS (10 * 1000)
+
 typedef struct hpa_shard_nonderived_stats_s hpa_shard_nonderived_stats_t;
 struct hpa_shard_nonderived_stats_s {
 	/*
@@ -22,6 +30,20 @@ struct hpa_shard_nonderived_stats_s {
 	 * Guarded by mtx.
 	 */
 	uint64_t npurges;
+	/*
+	 * The number of pages purged, across all passes.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t npurged;
+	/*
+	 * The number of system calls made to do those purges.  Dirty ranges
+	 * from several hugepages get batched together where the OS allows it,
+	 * so this can be smaller than npurges.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t npurge_syscalls;
 
 	/*
 	 * The number of times we've hugified a pageslab.
@@ -29,12 +51,57 @@ struct hpa_shard_nonderived_stats_s {
 	 * Guarded by mtx.
 	 */
 	uint64_t nhugifies;
+	/*
+	 * The number of times we tried to hugify a pageslab synchronously (see
+	 * hpa_shard_opts_t.hugify_sync), but the OS couldn't back it with a
+	 * hugepage.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t nhugify_failures;
 	/*
 	 * The number of times we've dehugified a pageslab.
 	 *
 	 * Guarded by mtx.
 	 */
 	uint64_t ndehugifies;
+	/*
+	 * The number of those dehugifications that came less than
+	 * HPA_DEHUGIFY_EARLY_MS after the pageslab was hugified; a high
+	 * fraction suggests we're paying for hugify / dehugify churn.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t ndehugifies_early;
+	/*
+	 * The number of empty pageslabs we've given up because we had more
+	 * than opts.empty_max of them.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t nempty_releases;
+	/*
+	 * Of those, the number we gave to the central pool (for any shard to
+	 * reuse) rather than back to the OS.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t nempty_pooled;
+
+	/*
+	 * The number of purge passes and hugifications performed inline, on
+	 * the allocation or deallocation pathway of an application thread.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t ndeferred_inline;
+	/*
+	 * The same, but for work performed in hpa_shard_do_deferred_work
+	 * calls (i.e. on a background thread).
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t ndeferred_background;
 };
 
 /* Completely derived; only used by CTL. */
@@ -51,6 +118,8 @@ struct hpa_shard_s {
 	 * pointer to the hpa_shard_t.
 	 */
 	pai_t pai;
+	/* Where we get new pageslabs from, and give up empty ones to. */
+	hpa_central_t *central;
 	malloc_mutex_t grow_mtx;
 	malloc_mutex_t mtx;
 	/* The base metadata allocator. */
@@ -71,28 +140,34 @@ struct hpa_shard_s {
 	 */
 	uint64_t age_counter;
 
-	/*
-	 * Either NULL (if empty), or some integer multiple of a
-	 * hugepage-aligned number of hugepages.  We carve them off one at a
-	 * time to satisfy new pageslab requests.
-	 *
-	 * Guarded by grow_mtx.
-	 */
-	void *eden;
-	size_t eden_len;
-
 	/* The arena ind we're associated with. */
 	unsigned ind;
+	/* The NUMA node new pageslabs get bound to, or -1 for no binding. */
+	int numa_node;
 	emap_t *emap;
 
 	/* The configuration choices for this hpa shard. */
 	hpa_shard_opts_t opts;
 
 	/*
-	 * How many pages have we started but not yet finished purging in this
-	 * hpa shard.
+	 * How many dirty (respectively muzzy) pages have we started but not yet
+	 * finished purging in this hpa shard.
 	 */
 	size_t npending_purge;
+	size_t npending_purge_muzzy;
+
+	/*
+	 * Time-based purging state, used when opts.dirty_decay_ms > 0.  Note
+	 * that this is guarded by mtx; we never acquire decay.mtx (which ranks
+	 * below mtx).  The current decay time is the one in here, rather than
+	 * the one in opts, which is only the initial setting.
+	 */
+	decay_t decay;
+	/*
+	 * The same, but for forcibly purging muzzy pages; only used when
+	 * opts.muzzy_decay_ms > 0.
+	 */
+	decay_t muzzy_decay;
 
 	/*
 	 * Those stats which are copied directly into the CTL-centric hpa shard
@@ -107,8 +182,9 @@ struct hpa_shard_s {
  * just that it can function properly given the system it's running on.
  */
 bool hpa_supported();
-bool hpa_shard_init(hpa_shard_t *shard, emap_t *emap, base_t *base,
-    edata_cache_t *edata_cache, unsigned ind, const hpa_shard_opts_t *opts);
+bool hpa_shard_init(hpa_shard_t *shard, hpa_central_t *central, emap_t *emap,
+    base_t *base, edata_cache_t *edata_cache, unsigned ind,
+    const hpa_shard_opts_t *opts);
 
 void hpa_shard_stats_accum(hpa_shard_stats_t *dst, hpa_shard_stats_t *src);
 void hpa_shard_stats_merge(tsdn_t *tsdn, hpa_shard_t *shard,
@@ -122,6 +198,31 @@ void hpa_shard_stats_merge(tsdn_t *tsdn, hpa_shard_t *shard,
 void hpa_shard_disable(tsdn_t *tsdn, hpa_shard_t *shard);
 void hpa_shard_destroy(tsdn_t *tsdn, hpa_shard_t *shard);
 
+/*
+ * Get and set the shard's dirty decay time; the setter returns true on error
+ * (an invalid decay time).
+ */
+ssize_t hpa_shard_dirty_decay_ms_get(hpa_shard_t *shard);
+bool hpa_shard_dirty_decay_ms_set(tsdn_t *tsdn, hpa_shard_t *shard,
+    ssize_t decay_ms);
+
+/*
+ * Toggles whether or not purging and hugification may be deferred to a later
+ * hpa_shard_do_deferred_work call.  When deferral is not allowed, that work is
+ * done inline (with a bounded number of operations) on the allocation and
+ * deallocation pathways.
+ */
+void hpa_shard_set_deferral_allowed(tsdn_t *tsdn, hpa_shard_t *shard,
+    bool deferral_allowed);
+/* Does all the pending purging and hugification work in the shard. */
+void hpa_shard_do_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard);
+/*
+ * Returns the number of nanoseconds until the shard will next want
+ * hpa_shard_do_deferred_work called on it; 0 if there's work to do right now,
+ * and BACKGROUND_THREAD_INDEFINITE_SLEEP if there's nothing pending.
+ */
+uint64_t hpa_shard_time_until_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard);
+
 /*
  * We share the fork ordering with the PA and arena prefork handling; that's why
  * these are 3 and 4 rather than 0 and 1.
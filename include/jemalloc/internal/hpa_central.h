@@ -1,47 +1,146 @@
 #ifndef JEMALLOC_INTERNAL_HPA_CENTRAL_H
 #define JEMALLOC_INTERNAL_HPA_CENTRAL_H
 
+#include "jemalloc/internal/atomic.h"
 #include "jemalloc/internal/base.h"
-#include "jemalloc/internal/emap.h"
+#include "jemalloc/internal/hpdata.h"
+#include "jemalloc/internal/mutex.h"
 
+/* How much address space eden reserves at a time, by default. */
+#define HPA_CENTRAL_EDEN_SIZE_DEFAULT (128 * HUGEPAGE)
+
+/*
+ * The process-wide source of pageslabs for the HPA shards.  It owns the
+ * address space the shards grow into, and pools the empty pageslabs they give
+ * up, so that one arena's idle address space can serve another arena's demand
+ * (rather than the total mapped hugepage count growing with the number of
+ * arenas).
+ *
+ * Nothing in here is on a per-allocation path; shards only come to the central
+ * when they have to grow, or when they have more empty pageslabs than they're
+ * allowed to keep.
+ */
 typedef struct hpa_central_s hpa_central_t;
 struct hpa_central_s {
-	/* The emap we use for metadata operations. */
-	emap_t *emap;
+	/*
+	 * Guards eden.  Growing can mean mapping more address space, so this
+	 * is separate from mtx; shards giving pageslabs back needn't wait on
+	 * it.
+	 */
+	malloc_mutex_t grow_mtx;
+	/*
+	 * Either NULL (if empty), or some integer multiple of a
+	 * hugepage-aligned number of hugepages.  We carve them off one at a
+	 * time to satisfy new pageslab requests.
+	 */
+	void *eden;
+	size_t eden_len;
+	/*
+	 * How much address space to reserve each time eden runs out.  The
+	 * reservation is only committed a hugepage at a time, as it gets
+	 * carved up, on systems that don't overcommit.
+	 */
+	size_t eden_size;
+	bool eden_committed;
+	/*
+	 * Whether the background threads fault in eden's next hugepage ahead
+	 * of time (see hpa_central_pretouch), and whether that's happened for
+	 * the current one.
+	 */
+	bool pretouch;
+	bool eden_pretouched;
+	/*
+	 * Whether there's a next hugepage to fault in.  Read without grow_mtx,
+	 * so that the background threads can check cheaply.
+	 */
+	atomic_b_t pretouch_pending;
+	/* The base metadata allocator, for the hpdatas. */
+	base_t *base;
 
-	edata_cache_small_t ecs;
-	eset_t eset;
+	/* Guards everything below. */
+	malloc_mutex_t mtx;
+	/*
+	 * Empty pageslabs given back by the shards, most recently pooled first.
+	 * They're purged (and dehugified) on the way in, so that nothing sits
+	 * here dirty for however long it takes somebody to want it back.  We
+	 * hold at most empty_max of them; nempty also counts those still being
+	 * purged on their way in.
+	 */
+	hpdata_empty_list_t empty;
+	size_t nempty;
+	size_t empty_max;
+	/*
+	 * Pageslabs whose memory has been purged, but whose address space we've
+	 * kept.  These get reused before eden.
+	 */
+	hpdata_empty_list_t retained;
+	size_t nretained;
+	/*
+	 * The hpdatas of pageslabs that have been unmapped (the metadata comes
+	 * from the base allocator, and so is never freed).
+	 */
+	hpdata_empty_list_t unused;
+};
 
-	size_t sn_next;
+typedef struct hpa_central_stats_s hpa_central_stats_t;
+struct hpa_central_stats_s {
+	/* The number of pooled empty pageslabs. */
+	size_t nempty;
+	/* The number of pageslabs retained as address space only. */
+	size_t nretained;
+	/* The bytes of eden not yet carved up into pageslabs. */
+	size_t eden_bytes;
 };
 
-void hpa_central_init(hpa_central_t *central, edata_cache_t *edata_cache,
-    emap_t *emap);
+/* eden_size must be a nonzero multiple of HUGEPAGE. */
+bool hpa_central_init(hpa_central_t *central, base_t *base, size_t empty_max,
+    size_t eden_size, bool pretouch);
+
 /*
- * Tries to satisfy the given allocation request with an extent already given to
- * central.
+ * Gets a pageslab for a shard to grow into, with the given age: a pooled empty
+ * one if there are any, otherwise one carved out of retained address space or
+ * eden.  Returns NULL on OOM.
  */
-edata_t *hpa_central_alloc_reuse(tsdn_t *tsdn, hpa_central_t *central,
-    size_t size_min, size_t size_goal);
+hpdata_t *hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central,
+    uint64_t age);
 /*
- * Adds the given edata to the central allocator as a new allocation.  The
- * intent is that after a reuse attempt fails, the caller can allocate a new
- * extent using whatever growth policy it prefers and allocate from that, giving
- * the excess to the hpa_central_t (this is analogous to the
- * extent_grow_retained functionality; we can allocate address space in
- * exponentially growing chunks).
- *
- * The edata_t should come from the same base that this hpa was initialized
- * with.  Only complete extents should be added (i.e. those for which the head
- * bit is true, and for which their successor is either not owned by jemalloc
- * or also has a head bit of true).  It should be active, large enough to
- * satisfy the requested allocation, and not already in the emap.
- *
- * If this returns true, then we did not accept the extent, and took no action.
- * Otherwise, modifies *edata to satisfy the allocation.
+ * Gets an hpdata not associated with any memory, for callers that map their
+ * own (e.g. hugetlb pageslabs).  Returns NULL on OOM.
+ */
+hpdata_t *hpa_central_hpdata_alloc(tsdn_t *tsdn, hpa_central_t *central);
+/*
+ * Offers the central an empty pageslab (out of any psset) for other shards to
+ * reuse.  If there's room, it gets purged and pooled; this makes syscalls, so
+ * the caller shouldn't hold its shard's lock.  If this returns true, the pool
+ * was full (or the pageslab couldn't be purged), and the caller still owns the
+ * pageslab, in whatever state it was.
+ */
+bool hpa_central_insert(tsdn_t *tsdn, hpa_central_t *central, hpdata_t *ps);
+/*
+ * Takes back a pageslab whose memory the caller has handed back to the OS,
+ * either by unmapping it (if unmapped is set), or by purging it.
  */
-bool hpa_central_alloc_grow(tsdn_t *tsdn, hpa_central_t *central,
-    size_t size, edata_t *to_add);
-void hpa_central_dalloc(tsdn_t *tsdn, hpa_central_t *central, edata_t *edata);
+void hpa_central_release(tsdn_t *tsdn, hpa_central_t *central, hpdata_t *ps,
+    bool unmapped);
+
+/*
+ * Faults in the hugepage that the next pageslab carved out of eden will use,
+ * so that the first allocations out of it don't have to.  Meant for the
+ * background threads; it doesn't wait for grow_mtx, and does nothing unless
+ * hpa_central_pretouch_pending.
+ */
+void hpa_central_pretouch(tsdn_t *tsdn, hpa_central_t *central);
+
+static inline bool
+hpa_central_pretouch_pending(hpa_central_t *central) {
+	return atomic_load_b(&central->pretouch_pending, ATOMIC_RELAXED);
+}
+
+void hpa_central_stats_read(tsdn_t *tsdn, hpa_central_t *central,
+    hpa_central_stats_t *stats);
+
+void hpa_central_prefork(tsdn_t *tsdn, hpa_central_t *central);
+void hpa_central_postfork_parent(tsdn_t *tsdn, hpa_central_t *central);
+void hpa_central_postfork_child(tsdn_t *tsdn, hpa_central_t *central);
 
 #endif /* JEMALLOC_INTERNAL_HPA_CENTRAL_H */
@@ -8,6 +8,25 @@
  * reasons.
  */
 
+/*
+ * How the psset picks among the pageslabs able to serve an allocation (i.e.
+ * within a size bucket of their longest free range).
+ */
+enum hpa_alloc_policy_e {
+	/* The oldest pageslab first. */
+	hpa_alloc_policy_oldest = 0,
+	/*
+	 * The one with the most active pages first, letting the emptier ones
+	 * drain (and so become purgeable as a whole).
+	 */
+	hpa_alloc_policy_fullest = 1,
+	/* The one at the lowest address first. */
+	hpa_alloc_policy_lowest_address = 2,
+	hpa_alloc_policy_limit = 3
+};
+typedef enum hpa_alloc_policy_e hpa_alloc_policy_t;
+extern const char *hpa_alloc_policy_names[];
+
 typedef struct hpa_shard_opts_s hpa_shard_opts_t;
 struct hpa_shard_opts_s {
 	/*
@@ -32,6 +51,76 @@ struct hpa_shard_opts_s {
 	 * active_pages.  This may be set to (fxp_t)-1 to disable purging.
 	 */
 	fxp_t dirty_mult;
+	/*
+	 * Time-based purging, on top of the dirty_mult cap.  Dirty pages that
+	 * go unreused are purged along a smoothstep curve, as with the PAC's
+	 * dirty_decay_ms.  -1 disables time-based purging (leaving only
+	 * dirty_mult in effect), and 0 purges dirty pages as soon as possible.
+	 * Setting dirty_mult to -1 makes this the only purging policy.
+	 */
+	ssize_t dirty_decay_ms;
+	/*
+	 * Lazy purging.  When nonzero, dirty pages are purged lazily (with
+	 * MADV_FREE or the like, so that reusing them before the OS reclaims
+	 * them is cheap), leaving them muzzy; the muzzy pages are then
+	 * forcibly purged along this (typically slower) decay curve, as with
+	 * the PAC's muzzy_decay_ms.  -1 never forcibly purges muzzy pages.  0
+	 * (or a system without lazy purging) purges dirty pages forcibly right
+	 * away, skipping the muzzy state.
+	 */
+	ssize_t muzzy_decay_ms;
+	/*
+	 * The most empty pageslabs we'll keep around for reuse.  Beyond that,
+	 * we hand empty pageslabs back to the OS right away (ignoring the
+	 * purging policies above): we unmap them, or, if opt_retain is set,
+	 * dehugify and purge them, keeping only their address space.
+	 * SIZE_MAX means no limit.
+	 */
+	size_t empty_max;
+
+	/*
+	 * How long a pageslab has to stay hugification-eligible before we
+	 * hugify it, and how long a hugified one has to stay above the
+	 * dehugification threshold before we purge (and so dehugify) it.
+	 * These keep short-lived usage spikes from making us pay for both the
+	 * hugification and the dehugification.
+	 */
+	uint64_t hugify_delay_ms;
+	uint64_t dehugify_delay_ms;
+
+	/*
+	 * Whether hugifying a pageslab should make the OS back it with a
+	 * hugepage right away (with MADV_COLLAPSE), rather than just advising
+	 * it to do so eventually.  That way, a pageslab we consider huge really
+	 * is; if the collapse fails, the pageslab stays nonhuge, and we only
+	 * try again once its allocations have changed (and hugify_delay_ms has
+	 * passed again).  Collapsing copies the whole hugepage, so we only do
+	 * it in hpa_shard_do_deferred_work calls (i.e. on a background thread);
+	 * hugification done inline, or on systems that can't collapse, stays
+	 * advisory.
+	 */
+	bool hugify_sync;
+
+	/*
+	 * Whether to back pageslabs with the OS's explicit hugepages (hugetlbfs
+	 * pages, on Linux) rather than relying on it to back them
+	 * transparently.  Those are guaranteed to be huge, but can't be purged
+	 * piecemeal; a pageslab's hugepage only goes back to the pool once the
+	 * pageslab is empty and the purging policy gets to it.  When the pool
+	 * can't supply a hugepage, we fall back to ordinary pageslabs.
+	 */
+	bool hugetlb;
+
+	/* See hpa_alloc_policy_t above. */
+	hpa_alloc_policy_t alloc_policy;
+
+	/*
+	 * Whether or not the PAI methods are allowed to defer work to a
+	 * subsequent hpa_shard_do_deferred_work() call.  Practically, this
+	 * corresponds to background threads being enabled.  We track this
+	 * ourselves for encapsulation purposes.
+	 */
+	bool deferral_allowed;
 };
 
 #define HPA_SHARD_OPTS_DEFAULT {					\
@@ -42,7 +131,31 @@ struct hpa_shard_opts_s {
 	/* dehugification_threshold */					\
 	HUGEPAGE * 20 / 100,						\
 	/* dirty_mult */						\
-	FXP_INIT_PERCENT(25)						\
+	FXP_INIT_PERCENT(25),						\
+	/* dirty_decay_ms */						\
+	-1,								\
+	/* muzzy_decay_ms */						\
+	0,								\
+	/* empty_max */							\
+	SIZE_MAX,							\
+	/* hugify_delay_ms */						\
+	10 * 1000,							\
+	/* dehugify_delay_ms */						\
+	0,								\
+	/* hugify_sync */						\
+	false,								\
+	/* hugetlb */							\
+	false,								\
+	/* alloc_policy */						\
+	hpa_alloc_policy_oldest,					\
+	/*								\
+	 * deferral_allowed						\
+	 * 								\
+	 * Really, this is always set by the arena during creation	\
+	 * or by an hpa_shard_set_deferral_allowed call, so the value	\
+	 * we put here doesn't matter.					\
+	 */								\
+	false								\
 }
 
 #endif /* JEMALLOC_INTERNAL_HPA_OPTS_H */
@@ -2,6 +2,7 @@
 #define JEMALLOC_INTERNAL_HPDATA_H
 
 #include "jemalloc/internal/flat_bitmap.h"
+#include "jemalloc/internal/nstime.h"
 #include "jemalloc/internal/ph.h"
 #include "jemalloc/internal/ql.h"
 #include "jemalloc/internal/typed_list.h"
@@ -32,8 +33,33 @@ struct hpdata_s {
 	void *h_address;
 	/* Its age (measured in psset operations). */
 	uint64_t h_age;
+	/*
+	 * The HPA shard it was last handed to.  Empty pageslabs can move from
+	 * shard to shard, but one with active extents in it stays put, so this
+	 * tells frees where to go.
+	 */
+	struct hpa_shard_s *h_shard;
+	/*
+	 * The key the psset orders its allocation heaps by (ties being broken
+	 * by age), according to its allocation policy.  Only meaningful while
+	 * the hpdata is in one of those heaps.
+	 */
+	uint64_t h_alloc_key;
 	/* Whether or not we think the hugepage is mapped that way by the OS. */
 	bool h_huge;
+	/*
+	 * Whether the hugepage comes from the OS's pool of explicit hugepages
+	 * (rather than being one that it might back transparently).  Such an
+	 * hpdata is always huge, and can't be purged piecemeal; it can only be
+	 * handed back whole, once empty.
+	 */
+	bool h_hugetlb;
+	/*
+	 * Whether its pages were all faulted in before it was first used (see
+	 * hpa_central_pretouch), and the HPA has yet to decide whether to
+	 * hugify it or to purge the ones that went unused.
+	 */
+	bool h_pretouched;
 
 	/*
 	 * For some properties, we keep parallel sets of bools; h_foo_allowed
@@ -55,6 +81,10 @@ struct hpdata_s {
 	bool h_purge_allowed;
 	bool h_in_psset_purge_container;
 
+	/* And with (forcibly) purging muzzy pages. */
+	bool h_muzzy_purge_allowed;
+	bool h_in_psset_muzzy_purge_container;
+
 	/* And with hugifying. */
 	bool h_hugify_allowed;
 	bool h_in_psset_hugify_container;
@@ -63,6 +93,24 @@ struct hpdata_s {
 	bool h_mid_purge;
 	bool h_mid_hugify;
 
+	/*
+	 * Whether our last attempt to collapse it into a hugepage failed, with
+	 * nothing allocated or freed from it since.  Retrying the collapse
+	 * before then would most likely just fail again, at the same cost.
+	 */
+	bool h_collapse_failed;
+
+	/*
+	 * When the hpdata most recently became eligible for purging and for
+	 * hugification (only meaningful while the corresponding *_allowed flag
+	 * is set), and when it was last hugified (only meaningful while
+	 * h_huge is).  The HPA uses these to delay hugification and
+	 * dehugification.
+	 */
+	nstime_t h_time_purge_allowed;
+	nstime_t h_time_hugify_allowed;
+	nstime_t h_time_hugified;
+
 	/*
 	 * Whether or not the hpdata is being updated in the psset (i.e. if
 	 * there has been a psset_update_begin call issued without a matching
@@ -88,6 +136,7 @@ struct hpdata_s {
 	 * Linkage for the psset to track candidates for purging and hugifying.
 	 */
 	ql_elm(hpdata_t) ql_link_purge;
+	ql_elm(hpdata_t) ql_link_muzzy_purge;
 	ql_elm(hpdata_t) ql_link_hugify;
 
 	/* The length of the largest contiguous sequence of inactive pages. */
@@ -108,14 +157,24 @@ struct hpdata_s {
 
 	/* The dirty pages (using the same definition as above). */
 	fb_group_t touched_pages[FB_NGROUPS(HUGEPAGE_PAGES)];
+
+	/*
+	 * Number of muzzy pages, and a bitmap tracking them.  These are pages
+	 * we've purged lazily (e.g. with MADV_FREE); the OS may or may not have
+	 * reclaimed them yet.  They're never active or touched, and a huge
+	 * hpdata has none (hugifying faults them all back in).
+	 */
+	size_t h_nmuzzy;
+	fb_group_t muzzy_pages[FB_NGROUPS(HUGEPAGE_PAGES)];
 };
 
 TYPED_LIST(hpdata_empty_list, hpdata_t, ql_link_empty)
 TYPED_LIST(hpdata_purge_list, hpdata_t, ql_link_purge)
+TYPED_LIST(hpdata_muzzy_purge_list, hpdata_t, ql_link_muzzy_purge)
 TYPED_LIST(hpdata_hugify_list, hpdata_t, ql_link_hugify)
 
-typedef ph(hpdata_t) hpdata_age_heap_t;
-ph_proto(, hpdata_age_heap_, hpdata_age_heap_t, hpdata_t);
+typedef ph(hpdata_t) hpdata_alloc_heap_t;
+ph_proto(, hpdata_alloc_heap_, hpdata_alloc_heap_t, hpdata_t);
 
 static inline void *
 hpdata_addr_get(const hpdata_t *hpdata) {
@@ -138,11 +197,46 @@ hpdata_age_set(hpdata_t *hpdata, uint64_t age) {
 	hpdata->h_age = age;
 }
 
+static inline struct hpa_shard_s *
+hpdata_shard_get(const hpdata_t *hpdata) {
+	return hpdata->h_shard;
+}
+
+static inline void
+hpdata_shard_set(hpdata_t *hpdata, struct hpa_shard_s *shard) {
+	hpdata->h_shard = shard;
+}
+
+static inline uint64_t
+hpdata_alloc_key_get(const hpdata_t *hpdata) {
+	return hpdata->h_alloc_key;
+}
+
+static inline void
+hpdata_alloc_key_set(hpdata_t *hpdata, uint64_t alloc_key) {
+	hpdata->h_alloc_key = alloc_key;
+}
+
 static inline bool
 hpdata_huge_get(const hpdata_t *hpdata) {
 	return hpdata->h_huge;
 }
 
+static inline bool
+hpdata_hugetlb_get(const hpdata_t *hpdata) {
+	return hpdata->h_hugetlb;
+}
+
+static inline bool
+hpdata_pretouched_get(const hpdata_t *hpdata) {
+	return hpdata->h_pretouched;
+}
+
+static inline void
+hpdata_pretouched_set(hpdata_t *hpdata, bool pretouched) {
+	hpdata->h_pretouched = pretouched;
+}
+
 static inline bool
 hpdata_alloc_allowed_get(const hpdata_t *hpdata) {
 	return hpdata->h_alloc_allowed;
@@ -186,6 +280,29 @@ hpdata_in_psset_purge_container_set(hpdata_t *hpdata, bool in_container) {
 	hpdata->h_in_psset_purge_container = in_container;
 }
 
+static inline bool
+hpdata_muzzy_purge_allowed_get(const hpdata_t *hpdata) {
+	return hpdata->h_muzzy_purge_allowed;
+}
+
+static inline void
+hpdata_muzzy_purge_allowed_set(hpdata_t *hpdata, bool muzzy_purge_allowed) {
+	assert(muzzy_purge_allowed == false || !hpdata->h_mid_purge);
+	hpdata->h_muzzy_purge_allowed = muzzy_purge_allowed;
+}
+
+static inline bool
+hpdata_in_psset_muzzy_purge_container_get(const hpdata_t *hpdata) {
+	return hpdata->h_in_psset_muzzy_purge_container;
+}
+
+static inline void
+hpdata_in_psset_muzzy_purge_container_set(hpdata_t *hpdata,
+    bool in_container) {
+	assert(in_container != hpdata->h_in_psset_muzzy_purge_container);
+	hpdata->h_in_psset_muzzy_purge_container = in_container;
+}
+
 static inline bool
 hpdata_hugify_allowed_get(const hpdata_t *hpdata) {
 	return hpdata->h_hugify_allowed;
@@ -197,6 +314,36 @@ hpdata_hugify_allowed_set(hpdata_t *hpdata, bool hugify_allowed) {
 	hpdata->h_hugify_allowed = hugify_allowed;
 }
 
+static inline nstime_t
+hpdata_time_purge_allowed_get(const hpdata_t *hpdata) {
+	return hpdata->h_time_purge_allowed;
+}
+
+static inline void
+hpdata_time_purge_allowed_set(hpdata_t *hpdata, const nstime_t *time) {
+	nstime_copy(&hpdata->h_time_purge_allowed, time);
+}
+
+static inline nstime_t
+hpdata_time_hugify_allowed_get(const hpdata_t *hpdata) {
+	return hpdata->h_time_hugify_allowed;
+}
+
+static inline void
+hpdata_time_hugify_allowed_set(hpdata_t *hpdata, const nstime_t *time) {
+	nstime_copy(&hpdata->h_time_hugify_allowed, time);
+}
+
+static inline nstime_t
+hpdata_time_hugified_get(const hpdata_t *hpdata) {
+	return hpdata->h_time_hugified;
+}
+
+static inline void
+hpdata_time_hugified_set(hpdata_t *hpdata, const nstime_t *time) {
+	nstime_copy(&hpdata->h_time_hugified, time);
+}
+
 static inline bool
 hpdata_in_psset_hugify_container_get(const hpdata_t *hpdata) {
 	return hpdata->h_in_psset_hugify_container;
@@ -230,6 +377,16 @@ hpdata_mid_hugify_set(hpdata_t *hpdata, bool mid_hugify) {
 	hpdata->h_mid_hugify = mid_hugify;
 }
 
+static inline bool
+hpdata_collapse_failed_get(const hpdata_t *hpdata) {
+	return hpdata->h_collapse_failed;
+}
+
+static inline void
+hpdata_collapse_failed_set(hpdata_t *hpdata, bool collapse_failed) {
+	hpdata->h_collapse_failed = collapse_failed;
+}
+
 static inline bool
 hpdata_changing_state_get(const hpdata_t *hpdata) {
 	return hpdata->h_mid_purge || hpdata->h_mid_hugify;
@@ -284,6 +441,11 @@ hpdata_ndirty_get(hpdata_t *hpdata) {
 	return hpdata->h_ntouched - hpdata->h_nactive;
 }
 
+static inline size_t
+hpdata_nmuzzy_get(hpdata_t *hpdata) {
+	return hpdata->h_nmuzzy;
+}
+
 static inline void
 hpdata_assert_empty(hpdata_t *hpdata) {
 	assert(fb_empty(hpdata->active_pages, HUGEPAGE_PAGES));
@@ -315,14 +477,38 @@ hpdata_consistent(hpdata_t *hpdata) {
 	if (hpdata->h_huge && hpdata->h_ntouched != HUGEPAGE_PAGES) {
 		return false;
 	}
+	if (fb_scount(hpdata->muzzy_pages, HUGEPAGE_PAGES, 0, HUGEPAGE_PAGES)
+	    != hpdata->h_nmuzzy) {
+		return false;
+	}
+	if (hpdata->h_huge && hpdata->h_nmuzzy != 0) {
+		return false;
+	}
+	if (hpdata->h_hugetlb && !hpdata->h_huge) {
+		return false;
+	}
+	if (hpdata->h_ntouched + hpdata->h_nmuzzy > HUGEPAGE_PAGES) {
+		return false;
+	}
+	fb_group_t touched_and_muzzy[FB_NGROUPS(HUGEPAGE_PAGES)];
+	fb_bit_and(touched_and_muzzy, hpdata->touched_pages,
+	    hpdata->muzzy_pages, HUGEPAGE_PAGES);
+	if (!fb_empty(touched_and_muzzy, HUGEPAGE_PAGES)) {
+		return false;
+	}
 	if (hpdata_changing_state_get(hpdata)
-	    && (hpdata->h_purge_allowed || hpdata->h_hugify_allowed)) {
+	    && (hpdata->h_purge_allowed || hpdata->h_muzzy_purge_allowed
+	    || hpdata->h_hugify_allowed)) {
 		return false;
 	}
 	if (hpdata_purge_allowed_get(hpdata)
 	    != hpdata_in_psset_purge_container_get(hpdata)) {
 		return false;
 	}
+	if (hpdata_muzzy_purge_allowed_get(hpdata)
+	    != hpdata_in_psset_muzzy_purge_container_get(hpdata)) {
+		return false;
+	}
 	if (hpdata_hugify_allowed_get(hpdata)
 	    != hpdata_in_psset_hugify_container_get(hpdata)) {
 		return false;
@@ -346,6 +532,8 @@ hpdata_full(hpdata_t *hpdata) {
 }
 
 void hpdata_init(hpdata_t *hpdata, void *addr, uint64_t age);
+/* The same, but for a hugepage from the OS's explicit hugepage pool. */
+void hpdata_init_hugetlb(hpdata_t *hpdata, void *addr, uint64_t age);
 
 /*
  * Given an hpdata which can serve an allocation request, pick and reserve an
@@ -354,6 +542,18 @@ void hpdata_init(hpdata_t *hpdata, void *addr, uint64_t age);
 void *hpdata_reserve_alloc(hpdata_t *hpdata, size_t sz);
 void hpdata_unreserve(hpdata_t *hpdata, void *begin, size_t sz);
 
+/*
+ * What a purge does, and to which pages.  Dirty purges return the inactive
+ * touched pages to the OS; a forced one (e.g. MADV_DONTNEED) leaves them
+ * untouched, while a lazy one (e.g. MADV_FREE) leaves them muzzy.  Muzzy
+ * purges forcibly purge the muzzy pages, leaving them untouched.
+ */
+typedef enum {
+	hpdata_purge_dirty_forced,
+	hpdata_purge_dirty_lazy,
+	hpdata_purge_muzzy
+} hpdata_purge_kind_t;
+
 /*
  * The hpdata_purge_prepare_t allows grabbing the metadata required to purge
  * subranges of a hugepage while holding a lock, drop the lock during the actual
@@ -361,6 +561,7 @@ void hpdata_unreserve(hpdata_t *hpdata, void *begin, size_t sz);
  */
 typedef struct hpdata_purge_state_s hpdata_purge_state_t;
 struct hpdata_purge_state_s {
+	hpdata_purge_kind_t kind;
 	size_t npurged;
 	fb_group_t to_purge[FB_NGROUPS(HUGEPAGE_PAGES)];
 	size_t next_purge_search_begin;
@@ -380,7 +581,8 @@ struct hpdata_purge_state_s {
  *
  * Returns the number of pages that will be purged.
  */
-size_t hpdata_purge_begin(hpdata_t *hpdata, hpdata_purge_state_t *purge_state);
+size_t hpdata_purge_begin(hpdata_t *hpdata, hpdata_purge_state_t *purge_state,
+    hpdata_purge_kind_t kind);
 
 /*
  * If there are more extents to purge, sets *r_purge_addr and *r_purge_size to
@@ -399,6 +601,11 @@ bool hpdata_purge_next(hpdata_t *hpdata, hpdata_purge_state_t *purge_state,
  */
 void hpdata_purge_end(hpdata_t *hpdata, hpdata_purge_state_t *purge_state);
 
+/*
+ * Marks every page as touched, for pageslabs whose memory was faulted in
+ * before we got them.  Needs external synchronization.
+ */
+void hpdata_touch_all(hpdata_t *hpdata);
 void hpdata_hugify(hpdata_t *hpdata);
 void hpdata_dehugify(hpdata_t *hpdata);
 
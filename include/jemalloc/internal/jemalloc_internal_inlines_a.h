@@ -29,8 +29,10 @@ percpu_arena_choose(void) {
 	assert(cpuid >= 0);
 
 	unsigned arena_ind;
-	if ((opt_percpu_arena == percpu_arena) || ((unsigned)cpuid < ncpus /
-	    2)) {
+	if (opt_percpu_arena == per_node_arena) {
+		arena_ind = pages_numa_cpu_node(cpuid);
+	} else if ((opt_percpu_arena == percpu_arena) || ((unsigned)cpuid <
+	    ncpus / 2)) {
 		arena_ind = cpuid;
 	} else {
 		assert(opt_percpu_arena == per_phycpu_arena);
@@ -45,7 +47,9 @@ percpu_arena_choose(void) {
 JEMALLOC_ALWAYS_INLINE unsigned
 percpu_arena_ind_limit(percpu_arena_mode_t mode) {
 	assert(have_percpu_arena && PERCPU_ARENA_ENABLED(mode));
-	if (mode == per_phycpu_arena && ncpus > 1) {
+	if (mode == per_node_arena) {
+		return pages_numa_nnodes;
+	} else if (mode == per_phycpu_arena && ncpus > 1) {
 		if (ncpus % 2) {
 			/* This likely means a misconfig. */
 			return ncpus / 2 + 1;
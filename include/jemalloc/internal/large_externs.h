@@ -3,6 +3,10 @@
 
 #include "jemalloc/internal/hook.h"
 
+#define RALLOC_MREMAP_MIN_DEFAULT 0
+
+extern size_t opt_ralloc_mremap_min;
+
 void *large_malloc(tsdn_t *tsdn, arena_t *arena, size_t usize, bool zero);
 void *large_palloc(tsdn_t *tsdn, arena_t *arena, size_t usize, size_t alignment,
     bool zero);
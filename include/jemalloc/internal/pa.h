@@ -44,6 +44,24 @@ struct pa_shard_stats_s {
 	pac_stats_t pac_stats;
 };
 
+/*
+ * HPA shards that belong to no arena in particular.  Slab allocations from any
+ * arena using the HPA go to the one for the current CPU (or group of CPUs), so
+ * that contention on the HPA scales with the number of CPUs rather than with
+ * the number of threads sharing an arena.  The arena still owns the extents it
+ * gets from them; only the pageslabs are shared.
+ */
+typedef struct pa_cpu_hpa_s pa_cpu_hpa_t;
+struct pa_cpu_hpa_s {
+	/* 0 if there are no such shards (in which case nothing else is set). */
+	unsigned nshards;
+	/* The number of CPUs the shards are spread over. */
+	unsigned ncpus;
+	hpa_shard_t *shards;
+	/* The shards' source of edata_t objects. */
+	edata_cache_t edata_cache;
+};
+
 /*
  * The local allocator handle.  Keeps the state necessary to satisfy page-sized
  * allocations.
@@ -85,6 +103,14 @@ struct pa_shard_s {
 
 	/* Allocates from a PAC. */
 	pac_t pac;
+	/*
+	 * Optionally, a small extent cache in front of the PAC, so that
+	 * page-sized allocations can skip the ecache (and its splitting and
+	 * coalescing).  Whether it's in use is fixed at initialization;
+	 * installing custom extent hooks disables it, though.
+	 */
+	bool use_pac_sec;
+	sec_t pac_sec;
 
 	/*
 	 * We place a small extent cache in front of the HPA, since we intend
@@ -93,6 +119,8 @@ struct pa_shard_s {
 	 */
 	sec_t hpa_sec;
 	hpa_shard_t hpa_shard;
+	/* If non-NULL, where to send slab allocations that go to the HPA. */
+	pa_cpu_hpa_t *cpu_hpa;
 
 	/* The source of edata_t objects. */
 	edata_cache_t edata_cache;
@@ -120,23 +148,54 @@ pa_shard_ehooks_get(pa_shard_t *shard) {
 	return base_ehooks_get(shard->base);
 }
 
-/* Returns true on error. */
+/*
+ * Returns true on error.  pac_sec_opts may be NULL, in which case the PAC is
+ * used without a small extent cache in front of it.
+ */
 bool pa_shard_init(tsdn_t *tsdn, pa_shard_t *shard, emap_t *emap, base_t *base,
     unsigned ind, pa_shard_stats_t *stats, malloc_mutex_t *stats_mtx,
     nstime_t *cur_time, size_t oversize_threshold, ssize_t dirty_decay_ms,
-    ssize_t muzzy_decay_ms);
+    ssize_t muzzy_decay_ms, const sec_opts_t *pac_sec_opts);
 
 /*
  * This isn't exposed to users; we allow late enablement of the HPA shard so
  * that we can boot without worrying about the HPA, then turn it on in a0.
  */
-bool pa_shard_enable_hpa(pa_shard_t *shard, const hpa_shard_opts_t *hpa_opts,
-    size_t sec_nshards, size_t sec_alloc_max, size_t sec_bytes_max);
+bool pa_shard_enable_hpa(tsdn_t *tsdn, pa_shard_t *shard,
+    hpa_central_t *central, pa_cpu_hpa_t *cpu_hpa,
+    const hpa_shard_opts_t *hpa_opts, const sec_opts_t *hpa_sec_opts);
+/*
+ * Sets up nshards per-CPU HPA shards, spread over ncpus CPUs.  Shards that
+ * have already had the HPA enabled with cpu_hpa start using them as soon as
+ * this returns.  Returns true on error.
+ */
+bool pa_cpu_hpa_init(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa, unsigned nshards,
+    unsigned ncpus, hpa_central_t *central, emap_t *emap, base_t *base,
+    const hpa_shard_opts_t *hpa_opts);
+/*
+ * Has the HPA bind the pageslabs it grows into to the given NUMA node (the
+ * PAC's extents get bound by the default extent hooks instead).
+ */
+void pa_shard_set_numa_node(pa_shard_t *shard, unsigned node);
+/* Likewise, for each per-CPU shard, to the node its first CPU is on. */
+void pa_cpu_hpa_set_numa_nodes(pa_cpu_hpa_t *cpu_hpa);
 /*
  * We stop using the HPA when custom extent hooks are installed, but still
  * redirect deallocations to it.
  */
 void pa_shard_disable_hpa(tsdn_t *tsdn, pa_shard_t *shard);
+/* Likewise, the PAC's small extent cache. */
+void pa_shard_disable_pac_sec(tsdn_t *tsdn, pa_shard_t *shard);
+/*
+ * Changes whether or not the HPA may put off purging and hugification until a
+ * later pa_shard_do_deferred_work call (i.e. whether or not background threads
+ * will pick up that work).
+ */
+void pa_shard_set_deferral_allowed(tsdn_t *tsdn, pa_shard_t *shard,
+    bool deferral_allowed);
+/* Likewise, for the per-CPU shards. */
+void pa_cpu_hpa_set_deferral_allowed(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa,
+    bool deferral_allowed);
 
 /*
  * This does the PA-specific parts of arena reset (i.e. freeing all active
@@ -157,6 +216,13 @@ edata_t *pa_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size,
 /* Returns true on error, in which case nothing changed. */
 bool pa_expand(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
     size_t new_size, szind_t szind, bool zero);
+/*
+ * The same, but growing the allocation by moving its pages to a new range of
+ * addresses (without copying them), where it can't grow in place.  Only PAC
+ * extents with the default hooks can be moved.
+ */
+bool pa_move(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
+    size_t new_size, szind_t szind);
 /*
  * The same.  Sets *generated_dirty to true if we produced new dirty pages, and
  * false otherwise.
@@ -176,6 +242,40 @@ void pa_dalloc(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata,
 bool pa_decay_ms_set(tsdn_t *tsdn, pa_shard_t *shard, extent_state_t state,
     ssize_t decay_ms, pac_purge_eagerness_t eagerness);
 ssize_t pa_decay_ms_get(pa_shard_t *shard, extent_state_t state);
+/*
+ * The HPA's time-based purging setting.  Setting it fails on shards that have
+ * never had the HPA enabled; getting it from them returns -1.
+ */
+bool pa_hpa_dirty_decay_ms_set(tsdn_t *tsdn, pa_shard_t *shard,
+    ssize_t decay_ms);
+ssize_t pa_hpa_dirty_decay_ms_get(pa_shard_t *shard);
+
+/*
+ * Do deferred work on this PA shard.  Morally, this should do both PAC decay
+ * and the HPA deferred work.  For now, though, the arena, background thread,
+ * and PAC modules are tightly interwoven in a way that's tricky to extricate,
+ * so we only do the HPA-specific parts (plus aging out of the small extent
+ * caches, and the PAC's deferred coalescing).
+ */
+void pa_shard_do_deferred_work(tsdn_t *tsdn, pa_shard_t *shard);
+/*
+ * The number of nanoseconds until the next pa_shard_do_deferred_work call
+ * should be made; BACKGROUND_THREAD_INDEFINITE_SLEEP if there's none pending.
+ */
+uint64_t pa_shard_time_until_deferred_work(tsdn_t *tsdn, pa_shard_t *shard);
+/*
+ * Whether the shard can generate deferred work without notifying anybody (in
+ * which case background threads should check back periodically even if
+ * there's none pending).
+ */
+bool pa_shard_polls_for_deferred_work(pa_shard_t *shard);
+/*
+ * The same, for the per-CPU shards.  They belong to no arena, so one
+ * background thread (thread 0) looks after them all.  They always poll.
+ */
+void pa_cpu_hpa_do_deferred_work(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa);
+uint64_t pa_cpu_hpa_time_until_deferred_work(tsdn_t *tsdn,
+    pa_cpu_hpa_t *cpu_hpa);
 
 /******************************************************************************/
 /*
@@ -196,13 +296,26 @@ void pa_shard_prefork5(tsdn_t *tsdn, pa_shard_t *shard);
 void pa_shard_postfork_parent(tsdn_t *tsdn, pa_shard_t *shard);
 void pa_shard_postfork_child(tsdn_t *tsdn, pa_shard_t *shard);
 
+/* The same, for the per-CPU HPA shards. */
+void pa_cpu_hpa_prefork3(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa);
+void pa_cpu_hpa_prefork4(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa);
+void pa_cpu_hpa_prefork5(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa);
+void pa_cpu_hpa_postfork_parent(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa);
+void pa_cpu_hpa_postfork_child(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa);
+
 void pa_shard_basic_stats_merge(pa_shard_t *shard, size_t *nactive,
     size_t *ndirty, size_t *nmuzzy);
 
 void pa_shard_stats_merge(tsdn_t *tsdn, pa_shard_t *shard,
     pa_shard_stats_t *pa_shard_stats_out, pac_estats_t *estats_out,
     hpa_shard_stats_t *hpa_stats_out, sec_stats_t *sec_stats_out,
-    size_t *resident);
+    sec_stats_t *pac_sec_stats_out, size_t *resident);
+/*
+ * The per-CPU HPA shards don't belong to any arena, so their stats only show
+ * up in the merged ones.
+ */
+void pa_cpu_hpa_stats_merge(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa,
+    hpa_shard_stats_t *hpa_stats_out);
 
 /*
  * Reads the PA-owned mutex stats into the output stats array, at the
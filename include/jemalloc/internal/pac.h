@@ -71,6 +71,13 @@ struct pac_stats_s {
 
 	/* VM space had to be leaked (undocumented).  Normally 0. */
 	atomic_zu_t abandoned_vm;
+
+	/*
+	 * Retained address space given back to the OS under the retained_limit
+	 * / retained_idle_ms policy.  The fields count the passes that released
+	 * anything, the extents unmapped, and the pages unmapped, respectively.
+	 */
+	pac_decay_stats_t retained_release;
 };
 
 typedef struct pac_s pac_t;
@@ -98,6 +105,23 @@ struct pac_s {
 	exp_grow_t exp_grow;
 	malloc_mutex_t grow_mtx;
 
+	/*
+	 * When to give retained address space back to the OS (which happens as
+	 * deferred work): whenever there's more than retained_limit bytes of it
+	 * (0 for no limit), and all of it once the retained ecache has gone
+	 * unused for retained_idle_ms (-1 for never).
+	 */
+	atomic_zu_t retained_limit;
+	atomic_zd_t retained_idle_ms;
+	/*
+	 * For tracking that idleness; guarded by grow_mtx.  retained_nuse counts
+	 * allocation attempts out of the retained ecache, and the others are
+	 * the count as of the last check, and when it last changed.
+	 */
+	uint64_t retained_nuse;
+	uint64_t retained_nuse_seen;
+	nstime_t retained_use_time;
+
 	/* How large extents should be before getting auto-purged. */
 	atomic_zu_t oversize_threshold;
 
@@ -117,12 +141,20 @@ struct pac_s {
 	atomic_zu_t extent_sn_next;
 };
 
+extern size_t opt_retained_limit;
+extern ssize_t opt_retained_idle_ms;
+
 bool pac_init(tsdn_t *tsdn, pac_t *pac, base_t *base, emap_t *emap,
     edata_cache_t *edata_cache, nstime_t *cur_time, size_t oversize_threshold,
     ssize_t dirty_decay_ms, ssize_t muzzy_decay_ms, pac_stats_t *pac_stats,
     malloc_mutex_t *stats_mtx);
 bool pac_retain_grow_limit_get_set(tsdn_t *tsdn, pac_t *pac, size_t *old_limit,
     size_t *new_limit);
+/*
+ * Grows an active extent by moving its pages elsewhere (see
+ * extent_move_wrapper); returns true on error, in which case nothing changed.
+ */
+bool pac_move(tsdn_t *tsdn, pac_t *pac, edata_t *edata, size_t new_size);
 void pac_stats_merge(tsdn_t *tsdn, pac_t *pac, pac_stats_t *pac_stats_out,
     pac_estats_t *estats_out, size_t *resident);
 
@@ -168,6 +200,22 @@ bool pac_decay_ms_set(tsdn_t *tsdn, pac_t *pac, extent_state_t state,
     ssize_t decay_ms, pac_purge_eagerness_t eagerness);
 ssize_t pac_decay_ms_get(pac_t *pac, extent_state_t state);
 
+size_t pac_retained_limit_get(pac_t *pac);
+void pac_retained_limit_set(pac_t *pac, size_t limit);
+ssize_t pac_retained_idle_ms_get(pac_t *pac);
+/* Returns true on error (if idle_ms is out of range). */
+bool pac_retained_idle_ms_set(pac_t *pac, ssize_t idle_ms);
+
+/*
+ * The PAC's share of pa_shard_do_deferred_work: coalescing what
+ * opt_extent_coalesce_deferred queued up, and releasing retained address space
+ * per the retained_limit / retained_idle_ms policy.
+ */
+void pac_do_deferred_work(tsdn_t *tsdn, pac_t *pac);
+uint64_t pac_ns_until_deferred_work(pac_t *pac);
+/* Whether pac_do_deferred_work needs to be polled for. */
+bool pac_polls_for_deferred_work(pac_t *pac);
+
 void pac_reset(tsdn_t *tsdn, pac_t *pac);
 void pac_destroy(tsdn_t *tsdn, pac_t *pac);
 
@@ -84,6 +84,28 @@ static const bool pages_can_hugify =
 #endif
     ;
 
+/* PAGES_CAN_MOVE is defined if pages_move is supported. */
+#ifdef JEMALLOC_HAVE_MREMAP
+#  define PAGES_CAN_MOVE
+#endif
+
+static const bool pages_can_move =
+#ifdef PAGES_CAN_MOVE
+    true
+#else
+    false
+#endif
+    ;
+
+/* A range of pages, for the batched operations below. */
+typedef struct pages_range_s pages_range_t;
+struct pages_range_s {
+	void *addr;
+	size_t size;
+};
+/* The most ranges we'll hand the kernel in a single call. */
+#define PAGES_PURGE_BATCH_MAX 64
+
 typedef enum {
 	thp_mode_default       = 0, /* Do not change hugepage settings. */
 	thp_mode_always        = 1, /* Always set MADV_HUGEPAGE. */
@@ -97,18 +119,101 @@ typedef enum {
 extern thp_mode_t opt_thp;
 extern thp_mode_t init_system_thp_mode; /* Initial system wide state. */
 extern const char *thp_mode_names[];
+extern bool opt_process_madvise;
+
+/*
+ * The NUMA topology, as found under /sys/devices/system/node at boot.  Where
+ * we can't find it (or there's only the one node), every CPU is on node 0.
+ * Nodes and CPUs beyond these limits are treated as though they were node 0.
+ */
+#define PAGES_NUMA_NODES_MAX 64
+#define PAGES_NUMA_CPUS_MAX 4096
+extern unsigned pages_numa_nnodes;
+extern uint8_t pages_numa_cpu_nodes[PAGES_NUMA_CPUS_MAX];
+/* Whether to bind each arena's (and HPA shard's) fresh memory to its node. */
+extern bool opt_numa_bind;
+
+static inline unsigned
+pages_numa_cpu_node(int cpu) {
+	if (cpu < 0 || cpu >= PAGES_NUMA_CPUS_MAX) {
+		return 0;
+	}
+	return pages_numa_cpu_nodes[cpu];
+}
 
 void *pages_map(void *addr, size_t size, size_t alignment, bool *commit);
+/*
+ * Maps size bytes (a multiple of HUGEPAGE) of memory backed by explicit,
+ * preallocated hugepages (hugetlbfs, on Linux), HUGEPAGE-aligned and
+ * committed.  Returns NULL if the system's hugepage pool can't supply them,
+ * including when it has none configured.  The pages can't be purged
+ * piecemeal; they go back to the pool only when unmapped.
+ */
+void *pages_map_hugetlb(size_t size);
 void pages_unmap(void *addr, size_t size);
+/*
+ * Grows the mapping of the size bytes at addr to new_size bytes where it is,
+ * demand-zeroed.  Returns true, with nothing changed, on failure, including
+ * when !pages_can_move; *r_movable then says whether pages_move might still
+ * manage (i.e. it's just that something else is mapped right after).
+ */
+bool pages_grow(void *addr, size_t size, size_t new_size, bool *r_movable);
+/*
+ * Moves the mapping of the size bytes at addr, pages and all, onto new_addr,
+ * which must be a mapping of new_size bytes of the caller's, to be replaced;
+ * any growth is demand-zeroed.  Returns true on failure, including when
+ * !pages_can_move, in which case addr is left as it was but what's mapped at
+ * new_addr is anyone's guess.
+ */
+bool pages_move(void *addr, size_t size, void *new_addr, size_t new_size);
 bool pages_commit(void *addr, size_t size);
 bool pages_decommit(void *addr, size_t size);
 bool pages_purge_lazy(void *addr, size_t size);
 bool pages_purge_forced(void *addr, size_t size);
+/*
+ * Forcibly purges each of the given ranges, batching them into as few system
+ * calls as we can (via process_madvise(2), where the kernel supports it) and
+ * falling back to one pages_purge_forced call per range otherwise.  Returns
+ * the number of system calls made; like most pages_purge_forced callers, we
+ * ignore failures.
+ */
+size_t pages_purge_forced_batch(const pages_range_t *ranges, size_t nranges);
+/*
+ * Whether pages_purge_forced_batch can (still) batch ranges; it stops being
+ * able to the first time the kernel turns process_madvise down.
+ */
+bool pages_purge_forced_batch_supported(void);
+/*
+ * Faults in the given (committed) range ahead of use.  Where the OS can't do
+ * that for us, we write to each page, so the memory must be freshly mapped and
+ * unused.
+ */
+void pages_prefault(void *addr, size_t size);
 bool pages_huge(void *addr, size_t size);
+/*
+ * Synchronously collapses the given hugepage-aligned range into hugepages
+ * (where pages_huge merely advises the OS to do so at its leisure).  This is
+ * expensive -- it may have to allocate and copy into a fresh hugepage -- and
+ * can fail for transient reasons.  Returns true on failure, including when
+ * !pages_collapse_supported().
+ */
+typedef bool (pages_collapse_t)(void *, size_t);
+extern pages_collapse_t *JET_MUTABLE pages_collapse;
+typedef bool (pages_collapse_supported_t)(void);
+extern pages_collapse_supported_t *JET_MUTABLE pages_collapse_supported;
 bool pages_nohuge(void *addr, size_t size);
+/*
+ * Asks the OS to back the not yet faulted-in pages of the given range from
+ * the given NUMA node where it can (falling back to other nodes rather than
+ * failing allocations).  Pages that are already resident stay where they are.
+ * Returns true on failure, including when !pages_numa_bind_supported().
+ */
+bool pages_numa_bind(void *addr, size_t size, unsigned node);
+bool pages_numa_bind_supported(void);
 bool pages_dontdump(void *addr, size_t size);
 bool pages_dodump(void *addr, size_t size);
 bool pages_boot(void);
+void pages_postfork_child(void);
 void pages_set_thp_state (void *ptr, size_t size);
 
 #endif /* JEMALLOC_INTERNAL_PAGES_EXTERNS_H */
@@ -1,6 +1,7 @@
 #ifndef JEMALLOC_INTERNAL_PSSET_H
 #define JEMALLOC_INTERNAL_PSSET_H
 
+#include "jemalloc/internal/hpa_opts.h"
 #include "jemalloc/internal/hpdata.h"
 
 /*
@@ -20,6 +21,20 @@
  */
 #define PSSET_NPSIZES 64
 
+/*
+ * The number of buckets in the nactive and ndirty histograms.  Bucket i counts
+ * the pageslabs with between i and i + 1 sixteenths of their pages active
+ * (respectively dirty); the last one includes entirely active ones.
+ */
+#define PSSET_NHIST 16
+
+static inline size_t
+psset_hist_ind(size_t npages) {
+	assert(npages <= HUGEPAGE_PAGES);
+	size_t ind = npages * PSSET_NHIST / HUGEPAGE_PAGES;
+	return (ind < PSSET_NHIST ? ind : PSSET_NHIST - 1);
+}
+
 typedef struct psset_bin_stats_s psset_bin_stats_t;
 struct psset_bin_stats_s {
 	/* How many pageslabs are in this bin? */
@@ -28,6 +43,13 @@ struct psset_bin_stats_s {
 	size_t nactive;
 	/* And how many are dirty? */
 	size_t ndirty;
+	/* And muzzy (i.e. lazily purged)? */
+	size_t nmuzzy;
+	/*
+	 * And how many of the pageslabs are explicit (hugetlb) hugepages,
+	 * rather than transparent ones?  Only ever nonzero in huge bins.
+	 */
+	size_t nhugetlb;
 };
 
 typedef struct psset_stats_s psset_stats_t;
@@ -47,15 +69,25 @@ struct psset_stats_s {
 
 	/* Empty slabs are similar. */
 	psset_bin_stats_t empty_slabs[2];
+
+	/*
+	 * How many pageslabs (full, empty, or otherwise) fall into each bucket
+	 * of nactive and ndirty (see psset_hist_ind).  The second index is
+	 * again hugeness.
+	 */
+	size_t nactive_hist[PSSET_NHIST][2];
+	size_t ndirty_hist[PSSET_NHIST][2];
 };
 
 typedef struct psset_s psset_t;
 struct psset_s {
 	/*
 	 * The pageslabs, quantized by the size class of the largest contiguous
-	 * free run of pages in a pageslab.
+	 * free run of pages in a pageslab.  Within a size class, they're
+	 * ordered according to alloc_policy.
 	 */
-	hpdata_age_heap_t pageslabs[PSSET_NPSIZES];
+	hpdata_alloc_heap_t pageslabs[PSSET_NPSIZES];
+	hpa_alloc_policy_t alloc_policy;
 	bitmap_t bitmap[BITMAP_GROUPS(PSSET_NPSIZES)];
 	/*
 	 * The sum of all bin stats in stats.  This lets us quickly answer
@@ -69,13 +101,22 @@ struct psset_s {
 	 * allocations.
 	 */
 	hpdata_empty_list_t empty;
-	/* Slabs which are available to be purged. */
-	hpdata_purge_list_t to_purge;
+	/*
+	 * Slabs which are available to be purged, indexed by whether or not
+	 * they're huge.  Each list is FIFO in the order the slabs became
+	 * eligible.
+	 */
+	hpdata_purge_list_t to_purge[2];
+	/*
+	 * Slabs with muzzy pages which are available to be purged, in the
+	 * order they became eligible.  These are never huge.
+	 */
+	hpdata_muzzy_purge_list_t to_purge_muzzy;
 	/* Slabs which are available to be hugified. */
 	hpdata_hugify_list_t to_hugify;
 };
 
-void psset_init(psset_t *psset);
+void psset_init(psset_t *psset, hpa_alloc_policy_t alloc_policy);
 void psset_stats_accum(psset_stats_t *dst, psset_stats_t *src);
 
 /*
@@ -87,10 +128,20 @@ void psset_update_end(psset_t *psset, hpdata_t *ps);
 
 /* Analogous to the eset_fit; pick a hpdata to serve the request. */
 hpdata_t *psset_pick_alloc(psset_t *psset, size_t size);
-/* Pick one to purge. */
+/*
+ * Pick one to purge.  Non-huge slabs come first, since purging a huge one also
+ * costs us the hugepage.
+ */
 hpdata_t *psset_pick_purge(psset_t *psset);
+/* Pick one to forcibly purge the muzzy pages of. */
+hpdata_t *psset_pick_purge_muzzy(psset_t *psset);
 /* Pick one to hugify. */
 hpdata_t *psset_pick_hugify(psset_t *psset);
+/*
+ * Pick an empty one to hand back to the OS; the one that's been empty the
+ * longest, since psset_pick_alloc reuses the most recently emptied first.
+ */
+hpdata_t *psset_pick_release(psset_t *psset);
 
 void psset_insert(psset_t *psset, hpdata_t *ps);
 void psset_remove(psset_t *psset, hpdata_t *ps);
@@ -100,6 +151,12 @@ psset_npageslabs(psset_t *psset) {
 	return psset->merged_stats.npageslabs;
 }
 
+static inline size_t
+psset_nempty(psset_t *psset) {
+	return psset->stats.empty_slabs[0].npageslabs
+	    + psset->stats.empty_slabs[1].npageslabs;
+}
+
 static inline size_t
 psset_nactive(psset_t *psset) {
 	return psset->merged_stats.nactive;
@@ -110,4 +167,9 @@ psset_ndirty(psset_t *psset) {
 	return psset->merged_stats.ndirty;
 }
 
+static inline size_t
+psset_nmuzzy(psset_t *psset) {
+	return psset->merged_stats.nmuzzy;
+}
+
 #endif /* JEMALLOC_INTERNAL_PSSET_H */
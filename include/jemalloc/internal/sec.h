@@ -2,7 +2,9 @@
 #define JEMALLOC_INTERNAL_SEC_H
 
 #include "jemalloc/internal/atomic.h"
+#include "jemalloc/internal/base.h"
 #include "jemalloc/internal/pai.h"
+#include "jemalloc/internal/sec_opts.h"
 
 /*
  * Small extent cache.
@@ -11,10 +13,11 @@
  * bin with its own lock and edata heap (including only extents of that size).
  * We don't try to do any coalescing of extents (since it would require
  * cross-bin locks).  As a result, we need to be careful about fragmentation.
- * As a gesture in that direction, we limit the size of caches, apply first-fit
- * within the bins, and, when flushing a bin, flush all of its extents rather
- * than just those up to some threshold.  When we allocate again, we'll get a
- * chance to move to better ones.
+ * As a gesture in that direction, we limit the size of caches, and, when a
+ * shard goes over its limit, flush its least recently cached extents down to a
+ * low-water mark, whatever bins they're in.  Cold extents go back to the
+ * fallback, which gets a chance to hand out better ones, while hot ones stay
+ * cached.
  */
 
 /*
@@ -23,29 +26,90 @@
  */
 #define SEC_NPSIZES 16
 /*
- * For now, we put a cap on the number of SECs an arena can have.  There's no
- * reason it can't be dynamic; it's just inconvenient.  This number of shards
- * are embedded in the arenas, so there's a space / configurability tradeoff
- * here.  Eventually, we should probably dynamically allocate only however many
- * we require.
+ * Shards are allocated out of the arena's base at initialization, so there's
+ * no real limit on their number other than the resolution of the per-thread
+ * fraction we stash in the tsd to pick one by (a 16-bit one).  Anything beyond
+ * the number of CPUs is wasted space, though.
  */
-#define SEC_NSHARDS_MAX 8
+#define SEC_NSHARDS_MAX ((size_t)UINT16_MAX)
+
+typedef struct sec_bin_stats_s sec_bin_stats_t;
+struct sec_bin_stats_s {
+	/* Bytes currently cached in the bin. */
+	size_t bytes;
+	/* Allocations satisfied out of the cache. */
+	uint64_t nhits;
+	/* Cacheable allocations that had to go to the fallback. */
+	uint64_t nmisses;
+	/*
+	 * Misses that fetched extra extents from the fallback to cache, and
+	 * the total number of extents so cached.
+	 */
+	uint64_t nfills;
+	uint64_t nfilled;
+	/* Extents handed back to the fallback by flushes of any kind. */
+	uint64_t nflushed;
+};
+
+static inline void
+sec_bin_stats_accum(sec_bin_stats_t *dst, sec_bin_stats_t *src) {
+	dst->bytes += src->bytes;
+	dst->nhits += src->nhits;
+	dst->nmisses += src->nmisses;
+	dst->nfills += src->nfills;
+	dst->nfilled += src->nfilled;
+	dst->nflushed += src->nflushed;
+}
 
-/*
- * For now, this is just one field; eventually, we'll probably want to get more
- * fine-grained data out (like per-size class statistics).
- */
 typedef struct sec_stats_s sec_stats_t;
 struct sec_stats_s {
 	/* Sum of bytes_cur across all shards. */
 	size_t bytes;
+	/*
+	 * Number of times a shard went over max_bytes and had to be flushed
+	 * down to bytes_after_flush.  If this is high relative to the number
+	 * of misses, max_bytes is probably too small for the workload.
+	 */
+	uint64_t noverflow_flushes;
+	/* The sum of the per-size-class stats below. */
+	sec_bin_stats_t total;
+	sec_bin_stats_t bins[SEC_NPSIZES];
 };
 
 static inline void
 sec_stats_accum(sec_stats_t *dst, sec_stats_t *src) {
 	dst->bytes += src->bytes;
+	dst->noverflow_flushes += src->noverflow_flushes;
+	sec_bin_stats_accum(&dst->total, &src->total);
+	for (pszind_t i = 0; i < SEC_NPSIZES; i++) {
+		sec_bin_stats_accum(&dst->bins[i], &src->bins[i]);
+	}
 }
 
+typedef struct sec_bin_s sec_bin_t;
+struct sec_bin_s {
+	/*
+	 * When we fail to fulfill an allocation, we do a batch-alloc on the
+	 * underlying allocator to fill extra items, as well.  We drop the SEC
+	 * lock while doing so, to allow operations on other bins to succeed.
+	 * That introduces the possibility of other threads also trying to
+	 * allocate out of this bin, failing, and also going to the backing
+	 * allocator.  To avoid a thundering herd problem in which lots of
+	 * threads do batch allocs and overfill this bin as a result, we only
+	 * allow one batch allocation at a time for a bin.  This bool tracks
+	 * whether or not some thread is already batch allocating.
+	 */
+	bool being_batch_filled;
+	edata_list_active_t freelist;
+	/* Number of bytes in this bin. */
+	size_t bytes_cur;
+	/*
+	 * The bin's counters.  The bytes field goes unused; we fill it in from
+	 * bytes_cur when merging.
+	 */
+	sec_bin_stats_t stats;
+};
+
 typedef struct sec_shard_s sec_shard_t;
 struct sec_shard_s {
 	/*
@@ -64,8 +128,17 @@ struct sec_shard_s {
 	 * hooks are installed.
 	 */
 	bool enabled;
-	edata_list_active_t freelist[SEC_NPSIZES];
+	sec_bin_t bins[SEC_NPSIZES];
+	/*
+	 * Every extent cached in the shard, in the order in which they were
+	 * cached (least recent first).  Overflow flushes and age-outs evict
+	 * from the head.
+	 */
+	edata_list_sec_t lru;
+	/* Number of bytes in all bins in the shard. */
 	size_t bytes_cur;
+	/* See the corresponding field in sec_stats_t. */
+	uint64_t noverflow_flushes;
 };
 
 typedef struct sec_s sec_t;
@@ -73,30 +146,27 @@ struct sec_s {
 	pai_t pai;
 	pai_t *fallback;
 
-	/*
-	 * We'll automatically refuse to cache any objects in this sec if
-	 * they're larger than alloc_max bytes.
-	 */
-	size_t alloc_max;
-	/*
-	 * Exceeding this amount of cached extents in a shard causes *all* of
-	 * the shards in that bin to be flushed.
-	 */
-	size_t bytes_max;
-
-	/*
-	 * We don't necessarily always use all the shards; requests are
-	 * distributed across shards [0, nshards - 1).
-	 */
-	size_t nshards;
-	sec_shard_t shards[SEC_NSHARDS_MAX];
+	sec_opts_t opts;
+	/* opts.nshards of them, or NULL if that's 0. */
+	sec_shard_t *shards;
 };
 
-bool sec_init(sec_t *sec, pai_t *fallback, size_t nshards, size_t alloc_max,
-    size_t bytes_max);
+bool sec_init(tsdn_t *tsdn, sec_t *sec, base_t *base, pai_t *fallback,
+    const sec_opts_t *opts);
 void sec_flush(tsdn_t *tsdn, sec_t *sec);
 void sec_disable(tsdn_t *tsdn, sec_t *sec);
 
+/*
+ * Returns extents that have been cached for longer than opts.max_idle_ms to
+ * the fallback.  Called from the background thread.
+ */
+void sec_do_deferred_work(tsdn_t *tsdn, sec_t *sec);
+/*
+ * How long (in ns) until sec_do_deferred_work has something to age out;
+ * BACKGROUND_THREAD_INDEFINITE_SLEEP if it never will without more activity.
+ */
+uint64_t sec_ns_until_deferred_work(tsdn_t *tsdn, sec_t *sec);
+
 /*
  * Morally, these two stats methods probably ought to be a single one (and the
  * mutex_prof_data ought to live in the sec_stats_t.  But splitting them apart
@@ -0,0 +1,72 @@
+#ifndef JEMALLOC_INTERNAL_SEC_OPTS_H
+#define JEMALLOC_INTERNAL_SEC_OPTS_H
+
+/*
+ * The configuration settings used by an sec_t.  Morally, this is part of the
+ * SEC interface, but we put it here for header-ordering reasons.
+ */
+
+typedef struct sec_opts_s sec_opts_t;
+struct sec_opts_s {
+	/*
+	 * We don't necessarily always use all the shards; requests are
+	 * distributed across shards [0, nshards - 1).
+	 */
+	size_t nshards;
+	/*
+	 * Whether to pick a shard by the CPU we're currently running on
+	 * (rather than by thread).  With at least as many shards as CPUs, this
+	 * means each shard's mutex is only ever contended across preemptions.
+	 * Ignored on platforms without getcpu support.
+	 */
+	bool shard_by_cpu;
+	/*
+	 * We'll automatically refuse to cache any objects in this sec if
+	 * they're larger than max_alloc bytes, instead forwarding such objects
+	 * directly to the fallback.
+	 */
+	size_t max_alloc;
+	/*
+	 * Exceeding this amount of cached extents in a shard causes the
+	 * shard's least recently cached extents (across all bins) to be
+	 * flushed, until at most bytes_after_flush bytes remain.
+	 */
+	size_t max_bytes;
+	size_t bytes_after_flush;
+	/*
+	 * When we can't satisfy an allocation out of the SEC because there are
+	 * no available ones cached, we allocate multiple of that size out of
+	 * the fallback allocator.  Eventually we might want to do something
+	 * cleverer, but for now we just grab a fixed number.  Fewer are
+	 * fetched if keeping them all would push the shard over max_bytes.
+	 */
+	size_t batch_fill_extra;
+	/*
+	 * Extents cached for longer than this get returned to the fallback by
+	 * the background thread.  0 means we never age extents out.
+	 */
+	uint64_t max_idle_ms;
+};
+
+#define SEC_OPTS_DEFAULT {						\
+	/* nshards */							\
+	4,								\
+	/* shard_by_cpu */						\
+	false,								\
+	/* max_alloc */							\
+	32 * 1024,							\
+	/*								\
+	 * max_bytes							\
+	 *								\
+	 * This corresponds to a maximum of 1MB cached per arena.	\
+	 */								\
+	256 * 1024,							\
+	/* bytes_after_flush */						\
+	128 * 1024,							\
+	/* batch_fill_extra */						\
+	0,								\
+	/* max_idle_ms */						\
+	0								\
+}
+
+#endif /* JEMALLOC_INTERNAL_SEC_OPTS_H */
@@ -23,9 +23,11 @@ JEMALLOC_DIAGNOSTIC_DISABLE_SPURIOUS
 const char *percpu_arena_mode_names[] = {
 	"percpu",
 	"phycpu",
+	"per_node",
 	"disabled",
 	"percpu",
-	"phycpu"
+	"phycpu",
+	"per_node"
 };
 percpu_arena_mode_t opt_percpu_arena = PERCPU_ARENA_DEFAULT;
 
@@ -36,6 +38,8 @@ static atomic_zd_t dirty_decay_ms_default;
 static atomic_zd_t muzzy_decay_ms_default;
 
 emap_t arena_emap_global;
+hpa_central_t arena_hpa_central_global;
+pa_cpu_hpa_t arena_hpa_cpu_global;
 
 const uint64_t h_steps[SMOOTHSTEP_NSTEPS] = {
 #define STEP(step, h, x, y)			\
@@ -83,7 +87,8 @@ arena_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
     const char **dss, ssize_t *dirty_decay_ms, ssize_t *muzzy_decay_ms,
     size_t *nactive, size_t *ndirty, size_t *nmuzzy, arena_stats_t *astats,
     bin_stats_data_t *bstats, arena_stats_large_t *lstats,
-    pac_estats_t *estats, hpa_shard_stats_t *hpastats, sec_stats_t *secstats) {
+    pac_estats_t *estats, hpa_shard_stats_t *hpastats, sec_stats_t *secstats,
+    sec_stats_t *pac_secstats) {
 	cassert(config_stats);
 
 	arena_basic_stats_merge(tsdn, arena, nthreads, dss, dirty_decay_ms,
@@ -141,7 +146,7 @@ arena_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
 	}
 
 	pa_shard_stats_merge(tsdn, &arena->pa_shard, &astats->pa_shard_stats,
-	    estats, hpastats, secstats, &astats->resident);
+	    estats, hpastats, secstats, pac_secstats, &astats->resident);
 
 	LOCKEDINT_MTX_UNLOCK(tsdn, arena->stats.mtx);
 
@@ -390,6 +395,16 @@ arena_decay_ms_get(arena_t *arena, extent_state_t state) {
 	return pa_decay_ms_get(&arena->pa_shard, state);
 }
 
+bool
+arena_hpa_dirty_decay_ms_set(tsdn_t *tsdn, arena_t *arena, ssize_t decay_ms) {
+	return pa_hpa_dirty_decay_ms_set(tsdn, &arena->pa_shard, decay_ms);
+}
+
+ssize_t
+arena_hpa_dirty_decay_ms_get(arena_t *arena) {
+	return pa_hpa_dirty_decay_ms_get(&arena->pa_shard);
+}
+
 static bool
 arena_decay_impl(tsdn_t *tsdn, arena_t *arena, decay_t *decay,
     pac_decay_stats_t *decay_stats, ecache_t *ecache,
@@ -453,6 +468,7 @@ arena_decay(tsdn_t *tsdn, arena_t *arena, bool is_background_thread, bool all) {
 		 * as possible", including flushing any caches (for situations
 		 * like thread death, or manual purge calls).
 		 */
+		sec_flush(tsdn, &arena->pa_shard.pac_sec);
 		sec_flush(tsdn, &arena->pa_shard.hpa_sec);
 	}
 	if (arena_decay_dirty(tsdn, arena, is_background_thread, all)) {
@@ -1323,8 +1339,12 @@ arena_set_extent_hooks(tsd_t *tsd, arena_t *arena,
 		info = arena_background_thread_info_get(arena);
 		malloc_mutex_lock(tsd_tsdn(tsd), &info->mtx);
 	}
-	/* No using the HPA now that we have the custom hooks. */
+	/*
+	 * No using the HPA or caching PAC extents now that we have the custom
+	 * hooks.
+	 */
 	pa_shard_disable_hpa(tsd_tsdn(tsd), &arena->pa_shard);
+	pa_shard_disable_pac_sec(tsd_tsdn(tsd), &arena->pa_shard);
 	extent_hooks_t *ret = base_extent_hooks_set(arena->base, extent_hooks);
 	if (have_background_thread) {
 		malloc_mutex_unlock(tsd_tsdn(tsd), &info->mtx);
@@ -1399,6 +1419,24 @@ arena_nthreads_dec(arena_t *arena, bool internal) {
 	atomic_fetch_sub_u(&arena->nthreads[internal], 1, ATOMIC_RELAXED);
 }
 
+/*
+ * With per-node arenas, arena i is node i's; otherwise an arena belongs to the
+ * node of the CPU that created it (which, given the way threads get assigned
+ * arenas, is usually where its users run).
+ */
+static unsigned
+arena_numa_node_choose(unsigned ind) {
+	if (!have_percpu_arena) {
+		return 0;
+	}
+	if ((opt_percpu_arena == per_node_arena || opt_percpu_arena ==
+	    per_node_arena_uninit) && ind < pages_numa_nnodes) {
+		return ind;
+	}
+	malloc_cpuid_t cpuid = malloc_getcpu();
+	return (cpuid < 0 ? 0 : pages_numa_cpu_node(cpuid));
+}
+
 arena_t *
 arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 	arena_t *arena;
@@ -1423,6 +1461,7 @@ arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 	atomic_store_u(&arena->nthreads[0], 0, ATOMIC_RELAXED);
 	atomic_store_u(&arena->nthreads[1], 0, ATOMIC_RELAXED);
 	arena->last_thd = NULL;
+	arena->numa_node = arena_numa_node_choose(ind);
 
 	if (config_stats) {
 		if (arena_stats_init(tsdn, &arena->stats)) {
@@ -1448,10 +1487,19 @@ arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 
 	nstime_t cur_time;
 	nstime_init_update(&cur_time);
+	/*
+	 * As with the HPA, we only cache PAC extents for arenas using the
+	 * default extent hooks; custom hooks presumably want to see every
+	 * deallocation.
+	 */
+	const sec_opts_t *pac_sec_opts = NULL;
+	if (opt_pac_sec && ehooks_are_default(base_ehooks_get(base))) {
+		pac_sec_opts = &opt_pac_sec_opts;
+	}
 	if (pa_shard_init(tsdn, &arena->pa_shard, &arena_emap_global, base, ind,
 	    &arena->stats.pa_shard_stats, LOCKEDINT_MTX(arena->stats.mtx),
 	    &cur_time, oversize_threshold, arena_dirty_decay_ms_default_get(),
-	    arena_muzzy_decay_ms_default_get())) {
+	    arena_muzzy_decay_ms_default_get(), pac_sec_opts)) {
 		goto label_error;
 	}
 
@@ -1476,14 +1524,20 @@ arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 	 * - Custom extent hooks (we should only return memory allocated from
 	 *   them in that case).
 	 * - Arena 0 initialization.  In this case, we're mid-bootstrapping, and
-	 *   so arena_hpa_global is not yet initialized.
+	 *   so we don't yet know whether the HPA is supported.
 	 */
 	if (opt_hpa && ehooks_are_default(base_ehooks_get(base)) && ind != 0) {
-		if (pa_shard_enable_hpa(&arena->pa_shard,
-		    &opt_hpa_opts, opt_hpa_sec_nshards, opt_hpa_sec_max_alloc,
-		    opt_hpa_sec_max_bytes)) {
+		hpa_shard_opts_t hpa_shard_opts = opt_hpa_opts;
+		hpa_shard_opts.deferral_allowed = background_thread_enabled();
+		if (pa_shard_enable_hpa(tsdn, &arena->pa_shard,
+		    &arena_hpa_central_global, &arena_hpa_cpu_global,
+		    &hpa_shard_opts, &opt_hpa_sec_opts)) {
 			goto label_error;
 		}
+		if (opt_numa_bind) {
+			pa_shard_set_numa_node(&arena->pa_shard,
+			    arena->numa_node);
+		}
 	}
 
 	/* We don't support reentrancy for arena 0 bootstrapping. */
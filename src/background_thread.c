@@ -13,6 +13,12 @@ JEMALLOC_DIAGNOSTIC_DISABLE_SPURIOUS
 /* Read-only after initialization. */
 bool opt_background_thread = BACKGROUND_THREAD_DEFAULT;
 size_t opt_max_background_threads = MAX_BACKGROUND_THREAD_LIMIT + 1;
+/*
+ * The longest a background thread responsible for an HPA-using arena will
+ * sleep before checking for deferred HPA work.
+ */
+size_t opt_background_thread_hpa_interval_max_ms =
+    BACKGROUND_THREAD_HPA_INTERVAL_MAX_DEFAULT_MS;
 
 /* Used for thread creation, termination and stats. */
 malloc_mutex_t background_thread_lock;
@@ -212,6 +218,40 @@ arena_decay_compute_purge_interval(tsdn_t *tsdn, arena_t *arena) {
 	return i1 < i2 ? i1 : i2;
 }
 
+/*
+ * The HPA (and the small extent caches, when aging out extents, and the PAC,
+ * when deferring coalescing or releasing retained address space) don't notify
+ * background threads when they generate deferred work; instead, threads
+ * responsible for an arena using them never sleep longer than
+ * opt_background_thread_hpa_interval_max_ms.
+ */
+static uint64_t
+hpa_interval_clamp(uint64_t interval) {
+	uint64_t max_interval =
+	    (uint64_t)opt_background_thread_hpa_interval_max_ms * 1000 * 1000;
+	if (interval > max_interval) {
+		interval = max_interval;
+	}
+	return (interval < BACKGROUND_THREAD_MIN_INTERVAL_NS) ?
+	    BACKGROUND_THREAD_MIN_INTERVAL_NS : interval;
+}
+
+static uint64_t
+arena_hpa_compute_interval(tsdn_t *tsdn, arena_t *arena) {
+	if (!pa_shard_polls_for_deferred_work(&arena->pa_shard)) {
+		return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	}
+	return hpa_interval_clamp(pa_shard_time_until_deferred_work(tsdn,
+	    &arena->pa_shard));
+}
+
+/* The per-CPU HPA shards belong to no arena; thread 0 looks after them. */
+static uint64_t
+cpu_hpa_compute_interval(tsdn_t *tsdn) {
+	return hpa_interval_clamp(pa_cpu_hpa_time_until_deferred_work(tsdn,
+	    &arena_hpa_cpu_global));
+}
+
 static void
 background_thread_sleep(tsdn_t *tsdn, background_thread_info_t *info,
     uint64_t interval) {
@@ -292,6 +332,7 @@ background_work_sleep_once(tsdn_t *tsdn, background_thread_info_t *info, unsigne
 			continue;
 		}
 		arena_decay(tsdn, arena, true, false);
+		pa_shard_do_deferred_work(tsdn, &arena->pa_shard);
 		if (min_interval == BACKGROUND_THREAD_MIN_INTERVAL_NS) {
 			/* Min interval will be used. */
 			continue;
@@ -302,6 +343,18 @@ background_work_sleep_once(tsdn_t *tsdn, background_thread_info_t *info, unsigne
 		if (min_interval > interval) {
 			min_interval = interval;
 		}
+		interval = arena_hpa_compute_interval(tsdn, arena);
+		assert(interval >= BACKGROUND_THREAD_MIN_INTERVAL_NS);
+		if (min_interval > interval) {
+			min_interval = interval;
+		}
+	}
+	if (ind == 0 && arena_hpa_cpu_global.nshards != 0) {
+		pa_cpu_hpa_do_deferred_work(tsdn, &arena_hpa_cpu_global);
+		uint64_t interval = cpu_hpa_compute_interval(tsdn);
+		if (min_interval > interval) {
+			min_interval = interval;
+		}
 	}
 	background_thread_sleep(tsdn, info, min_interval);
 }
@@ -533,6 +586,24 @@ background_thread_init(tsd_t *tsd, background_thread_info_t *info) {
 	n_background_threads++;
 }
 
+/*
+ * Tell the arenas' HPA shards (and the per-CPU ones) whether or not there are
+ * background threads around to do their deferred work.
+ */
+static void
+background_thread_deferral_allowed_set(tsdn_t *tsdn, bool deferral_allowed) {
+	unsigned narenas = narenas_total_get();
+	for (unsigned i = 0; i < narenas; i++) {
+		arena_t *arena = arena_get(tsdn, i, false);
+		if (arena != NULL) {
+			pa_shard_set_deferral_allowed(tsdn, &arena->pa_shard,
+			    deferral_allowed);
+		}
+	}
+	pa_cpu_hpa_set_deferral_allowed(tsdn, &arena_hpa_cpu_global,
+	    deferral_allowed);
+}
+
 static bool
 background_thread_create_locked(tsd_t *tsd, unsigned arena_ind) {
 	assert(have_background_thread);
@@ -583,6 +654,8 @@ background_thread_create_locked(tsd_t *tsd, unsigned arena_ind) {
 
 		return true;
 	}
+	/* Thread 0 is up; HPA work can be left to the background threads. */
+	background_thread_deferral_allowed_set(tsd_tsdn(tsd), true);
 
 	return false;
 }
@@ -647,6 +720,7 @@ background_threads_disable(tsd_t *tsd) {
 		return true;
 	}
 	assert(n_background_threads == 0);
+	background_thread_deferral_allowed_set(tsd_tsdn(tsd), false);
 
 	return false;
 }
@@ -782,6 +856,8 @@ background_thread_postfork_child(tsdn_t *tsdn) {
 		malloc_mutex_unlock(tsdn, &info->mtx);
 	}
 	malloc_mutex_unlock(tsdn, &background_thread_lock);
+	/* No background threads survive into the child. */
+	background_thread_deferral_allowed_set(tsdn, false);
 }
 
 bool
@@ -91,23 +91,51 @@ CTL_PROTO(config_xmalloc)
 CTL_PROTO(opt_abort)
 CTL_PROTO(opt_abort_conf)
 CTL_PROTO(opt_trust_madvise)
+CTL_PROTO(opt_process_madvise)
+CTL_PROTO(opt_numa_bind)
 CTL_PROTO(opt_confirm_conf)
 CTL_PROTO(opt_hpa)
 CTL_PROTO(opt_hpa_slab_max_alloc)
 CTL_PROTO(opt_hpa_hugification_threshold)
 CTL_PROTO(opt_hpa_dehugification_threshold)
 CTL_PROTO(opt_hpa_dirty_mult)
+CTL_PROTO(opt_hpa_dirty_decay_ms)
+CTL_PROTO(opt_hpa_muzzy_decay_ms)
+CTL_PROTO(opt_hpa_empty_max)
+CTL_PROTO(opt_hpa_central_empty_max)
+CTL_PROTO(opt_hpa_eden_size)
+CTL_PROTO(opt_hpa_eden_pretouch)
+CTL_PROTO(opt_hpa_cpu_shards)
+CTL_PROTO(opt_hpa_hugify_delay_ms)
+CTL_PROTO(opt_hpa_dehugify_delay_ms)
+CTL_PROTO(opt_hpa_hugify_sync)
+CTL_PROTO(opt_hpa_hugetlb)
+CTL_PROTO(opt_hpa_alloc_policy)
+CTL_PROTO(opt_hpa_sec_nshards)
+CTL_PROTO(opt_hpa_sec_shard_by_cpu)
 CTL_PROTO(opt_hpa_sec_max_alloc)
 CTL_PROTO(opt_hpa_sec_max_bytes)
-CTL_PROTO(opt_hpa_sec_nshards)
+CTL_PROTO(opt_hpa_sec_bytes_after_flush)
+CTL_PROTO(opt_hpa_sec_batch_fill_extra)
+CTL_PROTO(opt_hpa_sec_max_idle_ms)
+CTL_PROTO(opt_pac_sec)
+CTL_PROTO(opt_pac_sec_nshards)
+CTL_PROTO(opt_pac_sec_shard_by_cpu)
+CTL_PROTO(opt_pac_sec_max_alloc)
+CTL_PROTO(opt_pac_sec_max_bytes)
+CTL_PROTO(opt_pac_sec_bytes_after_flush)
+CTL_PROTO(opt_pac_sec_batch_fill_extra)
+CTL_PROTO(opt_pac_sec_max_idle_ms)
 CTL_PROTO(opt_metadata_thp)
 CTL_PROTO(opt_retain)
 CTL_PROTO(opt_dss)
 CTL_PROTO(opt_narenas)
 CTL_PROTO(opt_percpu_arena)
 CTL_PROTO(opt_oversize_threshold)
+CTL_PROTO(opt_ralloc_mremap_min)
 CTL_PROTO(opt_background_thread)
 CTL_PROTO(opt_max_background_threads)
+CTL_PROTO(opt_background_thread_hpa_interval_max_ms)
 CTL_PROTO(opt_dirty_decay_ms)
 CTL_PROTO(opt_muzzy_decay_ms)
 CTL_PROTO(opt_stats_print)
@@ -130,6 +158,9 @@ CTL_PROTO(opt_lg_tcache_flush_small_div)
 CTL_PROTO(opt_lg_tcache_flush_large_div)
 CTL_PROTO(opt_thp)
 CTL_PROTO(opt_lg_extent_max_active_fit)
+CTL_PROTO(opt_extent_coalesce_deferred)
+CTL_PROTO(opt_retained_limit)
+CTL_PROTO(opt_retained_idle_ms)
 CTL_PROTO(opt_prof)
 CTL_PROTO(opt_prof_prefix)
 CTL_PROTO(opt_prof_active)
@@ -157,8 +188,11 @@ CTL_PROTO(arena_i_dss)
 CTL_PROTO(arena_i_oversize_threshold)
 CTL_PROTO(arena_i_dirty_decay_ms)
 CTL_PROTO(arena_i_muzzy_decay_ms)
+CTL_PROTO(arena_i_hpa_dirty_decay_ms)
 CTL_PROTO(arena_i_extent_hooks)
 CTL_PROTO(arena_i_retain_grow_limit)
+CTL_PROTO(arena_i_retained_limit)
+CTL_PROTO(arena_i_retained_idle_ms)
 INDEX_PROTO(arena_i)
 CTL_PROTO(arenas_bin_i_size)
 CTL_PROTO(arenas_bin_i_nregs)
@@ -231,24 +265,36 @@ CTL_PROTO(stats_arenas_i_extents_j_retained_bytes)
 INDEX_PROTO(stats_arenas_i_extents_j)
 CTL_PROTO(stats_arenas_i_hpa_shard_npurge_passes)
 CTL_PROTO(stats_arenas_i_hpa_shard_npurges)
+CTL_PROTO(stats_arenas_i_hpa_shard_npurged)
+CTL_PROTO(stats_arenas_i_hpa_shard_npurge_syscalls)
 CTL_PROTO(stats_arenas_i_hpa_shard_nhugifies)
+CTL_PROTO(stats_arenas_i_hpa_shard_nhugify_failures)
 CTL_PROTO(stats_arenas_i_hpa_shard_ndehugifies)
+CTL_PROTO(stats_arenas_i_hpa_shard_ndehugifies_early)
+CTL_PROTO(stats_arenas_i_hpa_shard_nempty_releases)
+CTL_PROTO(stats_arenas_i_hpa_shard_nempty_pooled)
+CTL_PROTO(stats_arenas_i_hpa_shard_ndeferred_inline)
+CTL_PROTO(stats_arenas_i_hpa_shard_ndeferred_background)
 
 /* We have a set of stats for full slabs. */
 CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_npageslabs_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_npageslabs_huge)
+CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_npageslabs_hugetlb)
 CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_nactive_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_nactive_huge)
 CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_ndirty_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_ndirty_huge)
+CTL_PROTO(stats_arenas_i_hpa_shard_full_slabs_nmuzzy_nonhuge)
 
 /* A parallel set for the empty slabs. */
 CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_npageslabs_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_npageslabs_huge)
+CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_npageslabs_hugetlb)
 CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_nactive_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_nactive_huge)
 CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_ndirty_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_ndirty_huge)
+CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_nmuzzy_nonhuge)
 
 /*
  * And one for the slabs that are neither empty nor full, but indexed by how
@@ -256,12 +302,49 @@ CTL_PROTO(stats_arenas_i_hpa_shard_empty_slabs_ndirty_huge)
  */
 CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_huge)
+CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_hugetlb)
 CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_nactive_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_nactive_huge)
 CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_nonhuge)
 CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_huge)
+CTL_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j_nmuzzy_nonhuge)
 
 INDEX_PROTO(stats_arenas_i_hpa_shard_nonfull_slabs_j)
+
+/* Histograms of how full, and how dirty, the pageslabs are. */
+CTL_PROTO(stats_arenas_i_hpa_shard_nactive_hist_j_npageslabs_nonhuge)
+CTL_PROTO(stats_arenas_i_hpa_shard_nactive_hist_j_npageslabs_huge)
+INDEX_PROTO(stats_arenas_i_hpa_shard_nactive_hist_j)
+CTL_PROTO(stats_arenas_i_hpa_shard_ndirty_hist_j_npageslabs_nonhuge)
+CTL_PROTO(stats_arenas_i_hpa_shard_ndirty_hist_j_npageslabs_huge)
+INDEX_PROTO(stats_arenas_i_hpa_shard_ndirty_hist_j)
+CTL_PROTO(stats_arenas_i_hpa_sec_noverflow_flushes)
+CTL_PROTO(stats_arenas_i_hpa_sec_nhits)
+CTL_PROTO(stats_arenas_i_hpa_sec_nmisses)
+CTL_PROTO(stats_arenas_i_hpa_sec_nfills)
+CTL_PROTO(stats_arenas_i_hpa_sec_nfilled)
+CTL_PROTO(stats_arenas_i_hpa_sec_nflushed)
+CTL_PROTO(stats_arenas_i_hpa_sec_bins_j_bytes)
+CTL_PROTO(stats_arenas_i_hpa_sec_bins_j_nhits)
+CTL_PROTO(stats_arenas_i_hpa_sec_bins_j_nmisses)
+CTL_PROTO(stats_arenas_i_hpa_sec_bins_j_nfills)
+CTL_PROTO(stats_arenas_i_hpa_sec_bins_j_nfilled)
+CTL_PROTO(stats_arenas_i_hpa_sec_bins_j_nflushed)
+INDEX_PROTO(stats_arenas_i_hpa_sec_bins_j)
+CTL_PROTO(stats_arenas_i_pac_sec_bytes)
+CTL_PROTO(stats_arenas_i_pac_sec_noverflow_flushes)
+CTL_PROTO(stats_arenas_i_pac_sec_nhits)
+CTL_PROTO(stats_arenas_i_pac_sec_nmisses)
+CTL_PROTO(stats_arenas_i_pac_sec_nfills)
+CTL_PROTO(stats_arenas_i_pac_sec_nfilled)
+CTL_PROTO(stats_arenas_i_pac_sec_nflushed)
+CTL_PROTO(stats_arenas_i_pac_sec_bins_j_bytes)
+CTL_PROTO(stats_arenas_i_pac_sec_bins_j_nhits)
+CTL_PROTO(stats_arenas_i_pac_sec_bins_j_nmisses)
+CTL_PROTO(stats_arenas_i_pac_sec_bins_j_nfills)
+CTL_PROTO(stats_arenas_i_pac_sec_bins_j_nfilled)
+CTL_PROTO(stats_arenas_i_pac_sec_bins_j_nflushed)
+INDEX_PROTO(stats_arenas_i_pac_sec_bins_j)
 CTL_PROTO(stats_arenas_i_nthreads)
 CTL_PROTO(stats_arenas_i_uptime)
 CTL_PROTO(stats_arenas_i_dss)
@@ -285,6 +368,9 @@ CTL_PROTO(stats_arenas_i_metadata_thp)
 CTL_PROTO(stats_arenas_i_tcache_bytes)
 CTL_PROTO(stats_arenas_i_resident)
 CTL_PROTO(stats_arenas_i_abandoned_vm)
+CTL_PROTO(stats_arenas_i_retained_nrelease)
+CTL_PROTO(stats_arenas_i_retained_nunmap)
+CTL_PROTO(stats_arenas_i_retained_released)
 CTL_PROTO(stats_arenas_i_hpa_sec_bytes)
 INDEX_PROTO(stats_arenas_i)
 CTL_PROTO(stats_allocated)
@@ -292,12 +378,18 @@ CTL_PROTO(stats_active)
 CTL_PROTO(stats_background_thread_num_threads)
 CTL_PROTO(stats_background_thread_num_runs)
 CTL_PROTO(stats_background_thread_run_interval)
+CTL_PROTO(stats_hpa_central_nempty)
+CTL_PROTO(stats_hpa_central_nretained)
+CTL_PROTO(stats_hpa_central_eden_bytes)
 CTL_PROTO(stats_metadata)
 CTL_PROTO(stats_metadata_thp)
 CTL_PROTO(stats_resident)
 CTL_PROTO(stats_mapped)
 CTL_PROTO(stats_retained)
 CTL_PROTO(stats_zero_reallocs)
+CTL_PROTO(stats_numa_nnodes)
+CTL_PROTO(stats_numa_nodes_i_resident)
+INDEX_PROTO(stats_numa_nodes_i)
 CTL_PROTO(experimental_hooks_install)
 CTL_PROTO(experimental_hooks_remove)
 CTL_PROTO(experimental_thread_activity_callback)
@@ -396,6 +488,8 @@ static const ctl_named_node_t opt_node[] = {
 	{NAME("abort"),		CTL(opt_abort)},
 	{NAME("abort_conf"),	CTL(opt_abort_conf)},
 	{NAME("trust_madvise"),	CTL(opt_trust_madvise)},
+	{NAME("process_madvise"),	CTL(opt_process_madvise)},
+	{NAME("numa_bind"),	CTL(opt_numa_bind)},
 	{NAME("confirm_conf"),	CTL(opt_confirm_conf)},
 	{NAME("hpa"),		CTL(opt_hpa)},
 	{NAME("hpa_slab_max_alloc"),	CTL(opt_hpa_slab_max_alloc)},
@@ -404,17 +498,48 @@ static const ctl_named_node_t opt_node[] = {
 	{NAME("hpa_dehugification_threshold"),
 		CTL(opt_hpa_dehugification_threshold)},
 	{NAME("hpa_dirty_mult"), CTL(opt_hpa_dirty_mult)},
+	{NAME("hpa_dirty_decay_ms"),	CTL(opt_hpa_dirty_decay_ms)},
+	{NAME("hpa_muzzy_decay_ms"),	CTL(opt_hpa_muzzy_decay_ms)},
+	{NAME("hpa_empty_max"),	CTL(opt_hpa_empty_max)},
+	{NAME("hpa_central_empty_max"),	CTL(opt_hpa_central_empty_max)},
+	{NAME("hpa_eden_size"),	CTL(opt_hpa_eden_size)},
+	{NAME("hpa_eden_pretouch"),	CTL(opt_hpa_eden_pretouch)},
+	{NAME("hpa_cpu_shards"),	CTL(opt_hpa_cpu_shards)},
+	{NAME("hpa_hugify_delay_ms"),	CTL(opt_hpa_hugify_delay_ms)},
+	{NAME("hpa_dehugify_delay_ms"),	CTL(opt_hpa_dehugify_delay_ms)},
+	{NAME("hpa_hugify_sync"),	CTL(opt_hpa_hugify_sync)},
+	{NAME("hpa_hugetlb"),	CTL(opt_hpa_hugetlb)},
+	{NAME("hpa_alloc_policy"),	CTL(opt_hpa_alloc_policy)},
+	{NAME("hpa_sec_nshards"),	CTL(opt_hpa_sec_nshards)},
+	{NAME("hpa_sec_shard_by_cpu"),	CTL(opt_hpa_sec_shard_by_cpu)},
 	{NAME("hpa_sec_max_alloc"),	CTL(opt_hpa_sec_max_alloc)},
 	{NAME("hpa_sec_max_bytes"),	CTL(opt_hpa_sec_max_bytes)},
-	{NAME("hpa_sec_nshards"),	CTL(opt_hpa_sec_nshards)},
+	{NAME("hpa_sec_bytes_after_flush"),
+	    CTL(opt_hpa_sec_bytes_after_flush)},
+	{NAME("hpa_sec_batch_fill_extra"),
+	    CTL(opt_hpa_sec_batch_fill_extra)},
+	{NAME("hpa_sec_max_idle_ms"),	CTL(opt_hpa_sec_max_idle_ms)},
+	{NAME("pac_sec"),	CTL(opt_pac_sec)},
+	{NAME("pac_sec_nshards"),	CTL(opt_pac_sec_nshards)},
+	{NAME("pac_sec_shard_by_cpu"),	CTL(opt_pac_sec_shard_by_cpu)},
+	{NAME("pac_sec_max_alloc"),	CTL(opt_pac_sec_max_alloc)},
+	{NAME("pac_sec_max_bytes"),	CTL(opt_pac_sec_max_bytes)},
+	{NAME("pac_sec_bytes_after_flush"),
+	    CTL(opt_pac_sec_bytes_after_flush)},
+	{NAME("pac_sec_batch_fill_extra"),
+	    CTL(opt_pac_sec_batch_fill_extra)},
+	{NAME("pac_sec_max_idle_ms"),	CTL(opt_pac_sec_max_idle_ms)},
 	{NAME("metadata_thp"),	CTL(opt_metadata_thp)},
 	{NAME("retain"),	CTL(opt_retain)},
 	{NAME("dss"),		CTL(opt_dss)},
 	{NAME("narenas"),	CTL(opt_narenas)},
 	{NAME("percpu_arena"),	CTL(opt_percpu_arena)},
 	{NAME("oversize_threshold"),	CTL(opt_oversize_threshold)},
+	{NAME("ralloc_mremap_min"),	CTL(opt_ralloc_mremap_min)},
 	{NAME("background_thread"),	CTL(opt_background_thread)},
 	{NAME("max_background_threads"),	CTL(opt_max_background_threads)},
+	{NAME("background_thread_hpa_interval_max_ms"),
+		CTL(opt_background_thread_hpa_interval_max_ms)},
 	{NAME("dirty_decay_ms"), CTL(opt_dirty_decay_ms)},
 	{NAME("muzzy_decay_ms"), CTL(opt_muzzy_decay_ms)},
 	{NAME("stats_print"),	CTL(opt_stats_print)},
@@ -441,6 +566,9 @@ static const ctl_named_node_t opt_node[] = {
 		CTL(opt_lg_tcache_flush_large_div)},
 	{NAME("thp"),		CTL(opt_thp)},
 	{NAME("lg_extent_max_active_fit"), CTL(opt_lg_extent_max_active_fit)},
+	{NAME("extent_coalesce_deferred"), CTL(opt_extent_coalesce_deferred)},
+	{NAME("retained_limit"),	CTL(opt_retained_limit)},
+	{NAME("retained_idle_ms"),	CTL(opt_retained_idle_ms)},
 	{NAME("prof"),		CTL(opt_prof)},
 	{NAME("prof_prefix"),	CTL(opt_prof_prefix)},
 	{NAME("prof_active"),	CTL(opt_prof_active)},
@@ -478,8 +606,11 @@ static const ctl_named_node_t arena_i_node[] = {
 	{NAME("oversize_threshold"), CTL(arena_i_oversize_threshold)},
 	{NAME("dirty_decay_ms"), CTL(arena_i_dirty_decay_ms)},
 	{NAME("muzzy_decay_ms"), CTL(arena_i_muzzy_decay_ms)},
+	{NAME("hpa_dirty_decay_ms"), CTL(arena_i_hpa_dirty_decay_ms)},
 	{NAME("extent_hooks"),	CTL(arena_i_extent_hooks)},
-	{NAME("retain_grow_limit"),	CTL(arena_i_retain_grow_limit)}
+	{NAME("retain_grow_limit"),	CTL(arena_i_retain_grow_limit)},
+	{NAME("retained_limit"),	CTL(arena_i_retained_limit)},
+	{NAME("retained_idle_ms"),	CTL(arena_i_retained_idle_ms)}
 };
 static const ctl_named_node_t super_arena_i_node[] = {
 	{NAME(""),		CHILD(named, arena_i)}
@@ -682,6 +813,8 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_full_slabs_node[] = {
 		CTL(stats_arenas_i_hpa_shard_full_slabs_npageslabs_nonhuge)},
 	{NAME("npageslabs_huge"),
 		CTL(stats_arenas_i_hpa_shard_full_slabs_npageslabs_huge)},
+	{NAME("npageslabs_hugetlb"),
+		CTL(stats_arenas_i_hpa_shard_full_slabs_npageslabs_hugetlb)},
 	{NAME("nactive_nonhuge"),
 		CTL(stats_arenas_i_hpa_shard_full_slabs_nactive_nonhuge)},
 	{NAME("nactive_huge"),
@@ -689,7 +822,9 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_full_slabs_node[] = {
 	{NAME("ndirty_nonhuge"),
 		CTL(stats_arenas_i_hpa_shard_full_slabs_ndirty_nonhuge)},
 	{NAME("ndirty_huge"),
-		CTL(stats_arenas_i_hpa_shard_full_slabs_ndirty_huge)}
+		CTL(stats_arenas_i_hpa_shard_full_slabs_ndirty_huge)},
+	{NAME("nmuzzy_nonhuge"),
+		CTL(stats_arenas_i_hpa_shard_full_slabs_nmuzzy_nonhuge)}
 };
 
 static const ctl_named_node_t stats_arenas_i_hpa_shard_empty_slabs_node[] = {
@@ -697,6 +832,8 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_empty_slabs_node[] = {
 		CTL(stats_arenas_i_hpa_shard_empty_slabs_npageslabs_nonhuge)},
 	{NAME("npageslabs_huge"),
 		CTL(stats_arenas_i_hpa_shard_empty_slabs_npageslabs_huge)},
+	{NAME("npageslabs_hugetlb"),
+		CTL(stats_arenas_i_hpa_shard_empty_slabs_npageslabs_hugetlb)},
 	{NAME("nactive_nonhuge"),
 		CTL(stats_arenas_i_hpa_shard_empty_slabs_nactive_nonhuge)},
 	{NAME("nactive_huge"),
@@ -704,7 +841,9 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_empty_slabs_node[] = {
 	{NAME("ndirty_nonhuge"),
 		CTL(stats_arenas_i_hpa_shard_empty_slabs_ndirty_nonhuge)},
 	{NAME("ndirty_huge"),
-		CTL(stats_arenas_i_hpa_shard_empty_slabs_ndirty_huge)}
+		CTL(stats_arenas_i_hpa_shard_empty_slabs_ndirty_huge)},
+	{NAME("nmuzzy_nonhuge"),
+		CTL(stats_arenas_i_hpa_shard_empty_slabs_nmuzzy_nonhuge)}
 };
 
 static const ctl_named_node_t stats_arenas_i_hpa_shard_nonfull_slabs_j_node[] = {
@@ -712,6 +851,8 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_nonfull_slabs_j_node[] =
 		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_nonhuge)},
 	{NAME("npageslabs_huge"),
 		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_huge)},
+	{NAME("npageslabs_hugetlb"),
+		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_hugetlb)},
 	{NAME("nactive_nonhuge"),
 		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_nactive_nonhuge)},
 	{NAME("nactive_huge"),
@@ -719,7 +860,9 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_nonfull_slabs_j_node[] =
 	{NAME("ndirty_nonhuge"),
 		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_nonhuge)},
 	{NAME("ndirty_huge"),
-		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_huge)}
+		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_huge)},
+	{NAME("nmuzzy_nonhuge"),
+		CTL(stats_arenas_i_hpa_shard_nonfull_slabs_j_nmuzzy_nonhuge)}
 };
 
 static const ctl_named_node_t super_stats_arenas_i_hpa_shard_nonfull_slabs_j_node[] = {
@@ -732,6 +875,40 @@ static const ctl_indexed_node_t stats_arenas_i_hpa_shard_nonfull_slabs_node[] =
 	{INDEX(stats_arenas_i_hpa_shard_nonfull_slabs_j)}
 };
 
+static const ctl_named_node_t stats_arenas_i_hpa_shard_nactive_hist_j_node[] = {
+	{NAME("npageslabs_nonhuge"),
+		CTL(stats_arenas_i_hpa_shard_nactive_hist_j_npageslabs_nonhuge)},
+	{NAME("npageslabs_huge"),
+		CTL(stats_arenas_i_hpa_shard_nactive_hist_j_npageslabs_huge)}
+};
+
+static const ctl_named_node_t super_stats_arenas_i_hpa_shard_nactive_hist_j_node[] = {
+	{NAME(""),
+		CHILD(named, stats_arenas_i_hpa_shard_nactive_hist_j)}
+};
+
+static const ctl_indexed_node_t stats_arenas_i_hpa_shard_nactive_hist_node[] =
+{
+	{INDEX(stats_arenas_i_hpa_shard_nactive_hist_j)}
+};
+
+static const ctl_named_node_t stats_arenas_i_hpa_shard_ndirty_hist_j_node[] = {
+	{NAME("npageslabs_nonhuge"),
+		CTL(stats_arenas_i_hpa_shard_ndirty_hist_j_npageslabs_nonhuge)},
+	{NAME("npageslabs_huge"),
+		CTL(stats_arenas_i_hpa_shard_ndirty_hist_j_npageslabs_huge)}
+};
+
+static const ctl_named_node_t super_stats_arenas_i_hpa_shard_ndirty_hist_j_node[] = {
+	{NAME(""),
+		CHILD(named, stats_arenas_i_hpa_shard_ndirty_hist_j)}
+};
+
+static const ctl_indexed_node_t stats_arenas_i_hpa_shard_ndirty_hist_node[] =
+{
+	{INDEX(stats_arenas_i_hpa_shard_ndirty_hist_j)}
+};
+
 static const ctl_named_node_t stats_arenas_i_hpa_shard_node[] = {
 	{NAME("full_slabs"),	CHILD(named,
 	    stats_arenas_i_hpa_shard_full_slabs)},
@@ -739,11 +916,88 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_node[] = {
 	    stats_arenas_i_hpa_shard_empty_slabs)},
 	{NAME("nonfull_slabs"),	CHILD(indexed,
 	    stats_arenas_i_hpa_shard_nonfull_slabs)},
+	{NAME("nactive_hist"),	CHILD(indexed,
+	    stats_arenas_i_hpa_shard_nactive_hist)},
+	{NAME("ndirty_hist"),	CHILD(indexed,
+	    stats_arenas_i_hpa_shard_ndirty_hist)},
 
 	{NAME("npurge_passes"),	CTL(stats_arenas_i_hpa_shard_npurge_passes)},
 	{NAME("npurges"),	CTL(stats_arenas_i_hpa_shard_npurges)},
+	{NAME("npurged"),	CTL(stats_arenas_i_hpa_shard_npurged)},
+	{NAME("npurge_syscalls"),
+	    CTL(stats_arenas_i_hpa_shard_npurge_syscalls)},
 	{NAME("nhugifies"),	CTL(stats_arenas_i_hpa_shard_nhugifies)},
-	{NAME("ndehugifies"),	CTL(stats_arenas_i_hpa_shard_ndehugifies)}
+	{NAME("nhugify_failures"),
+	    CTL(stats_arenas_i_hpa_shard_nhugify_failures)},
+	{NAME("ndehugifies"),	CTL(stats_arenas_i_hpa_shard_ndehugifies)},
+	{NAME("ndehugifies_early"),
+	    CTL(stats_arenas_i_hpa_shard_ndehugifies_early)},
+	{NAME("nempty_releases"),
+	    CTL(stats_arenas_i_hpa_shard_nempty_releases)},
+	{NAME("nempty_pooled"),
+	    CTL(stats_arenas_i_hpa_shard_nempty_pooled)},
+	{NAME("ndeferred_inline"),
+	    CTL(stats_arenas_i_hpa_shard_ndeferred_inline)},
+	{NAME("ndeferred_background"),
+	    CTL(stats_arenas_i_hpa_shard_ndeferred_background)}
+};
+
+static const ctl_named_node_t stats_arenas_i_hpa_sec_bins_j_node[] = {
+	{NAME("bytes"),		CTL(stats_arenas_i_hpa_sec_bins_j_bytes)},
+	{NAME("nhits"),		CTL(stats_arenas_i_hpa_sec_bins_j_nhits)},
+	{NAME("nmisses"),	CTL(stats_arenas_i_hpa_sec_bins_j_nmisses)},
+	{NAME("nfills"),	CTL(stats_arenas_i_hpa_sec_bins_j_nfills)},
+	{NAME("nfilled"),	CTL(stats_arenas_i_hpa_sec_bins_j_nfilled)},
+	{NAME("nflushed"),	CTL(stats_arenas_i_hpa_sec_bins_j_nflushed)}
+};
+
+static const ctl_named_node_t super_stats_arenas_i_hpa_sec_bins_j_node[] = {
+	{NAME(""),		CHILD(named, stats_arenas_i_hpa_sec_bins_j)}
+};
+
+static const ctl_indexed_node_t stats_arenas_i_hpa_sec_bins_node[] = {
+	{INDEX(stats_arenas_i_hpa_sec_bins_j)}
+};
+
+static const ctl_named_node_t stats_arenas_i_hpa_sec_node[] = {
+	{NAME("bytes"),		CTL(stats_arenas_i_hpa_sec_bytes)},
+	{NAME("noverflow_flushes"),
+	    CTL(stats_arenas_i_hpa_sec_noverflow_flushes)},
+	{NAME("nhits"),		CTL(stats_arenas_i_hpa_sec_nhits)},
+	{NAME("nmisses"),	CTL(stats_arenas_i_hpa_sec_nmisses)},
+	{NAME("nfills"),	CTL(stats_arenas_i_hpa_sec_nfills)},
+	{NAME("nfilled"),	CTL(stats_arenas_i_hpa_sec_nfilled)},
+	{NAME("nflushed"),	CTL(stats_arenas_i_hpa_sec_nflushed)},
+	{NAME("bins"),		CHILD(indexed, stats_arenas_i_hpa_sec_bins)}
+};
+
+static const ctl_named_node_t stats_arenas_i_pac_sec_bins_j_node[] = {
+	{NAME("bytes"),		CTL(stats_arenas_i_pac_sec_bins_j_bytes)},
+	{NAME("nhits"),		CTL(stats_arenas_i_pac_sec_bins_j_nhits)},
+	{NAME("nmisses"),	CTL(stats_arenas_i_pac_sec_bins_j_nmisses)},
+	{NAME("nfills"),	CTL(stats_arenas_i_pac_sec_bins_j_nfills)},
+	{NAME("nfilled"),	CTL(stats_arenas_i_pac_sec_bins_j_nfilled)},
+	{NAME("nflushed"),	CTL(stats_arenas_i_pac_sec_bins_j_nflushed)}
+};
+
+static const ctl_named_node_t super_stats_arenas_i_pac_sec_bins_j_node[] = {
+	{NAME(""),		CHILD(named, stats_arenas_i_pac_sec_bins_j)}
+};
+
+static const ctl_indexed_node_t stats_arenas_i_pac_sec_bins_node[] = {
+	{INDEX(stats_arenas_i_pac_sec_bins_j)}
+};
+
+static const ctl_named_node_t stats_arenas_i_pac_sec_node[] = {
+	{NAME("bytes"),		CTL(stats_arenas_i_pac_sec_bytes)},
+	{NAME("noverflow_flushes"),
+	    CTL(stats_arenas_i_pac_sec_noverflow_flushes)},
+	{NAME("nhits"),		CTL(stats_arenas_i_pac_sec_nhits)},
+	{NAME("nmisses"),	CTL(stats_arenas_i_pac_sec_nmisses)},
+	{NAME("nfills"),	CTL(stats_arenas_i_pac_sec_nfills)},
+	{NAME("nfilled"),	CTL(stats_arenas_i_pac_sec_nfilled)},
+	{NAME("nflushed"),	CTL(stats_arenas_i_pac_sec_nflushed)},
+	{NAME("bins"),		CHILD(indexed, stats_arenas_i_pac_sec_bins)}
 };
 
 static const ctl_named_node_t stats_arenas_i_node[] = {
@@ -770,6 +1024,9 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
 	{NAME("tcache_bytes"),	CTL(stats_arenas_i_tcache_bytes)},
 	{NAME("resident"),	CTL(stats_arenas_i_resident)},
 	{NAME("abandoned_vm"),	CTL(stats_arenas_i_abandoned_vm)},
+	{NAME("retained_nrelease"), CTL(stats_arenas_i_retained_nrelease)},
+	{NAME("retained_nunmap"), CTL(stats_arenas_i_retained_nunmap)},
+	{NAME("retained_released"), CTL(stats_arenas_i_retained_released)},
 	{NAME("hpa_sec_bytes"),	CTL(stats_arenas_i_hpa_sec_bytes)},
 	{NAME("small"),		CHILD(named, stats_arenas_i_small)},
 	{NAME("large"),		CHILD(named, stats_arenas_i_large)},
@@ -777,7 +1034,9 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
 	{NAME("lextents"),	CHILD(indexed, stats_arenas_i_lextents)},
 	{NAME("extents"),	CHILD(indexed, stats_arenas_i_extents)},
 	{NAME("mutexes"),	CHILD(named, stats_arenas_i_mutexes)},
-	{NAME("hpa_shard"),	CHILD(named, stats_arenas_i_hpa_shard)}
+	{NAME("hpa_shard"),	CHILD(named, stats_arenas_i_hpa_shard)},
+	{NAME("hpa_sec"),	CHILD(named, stats_arenas_i_hpa_sec)},
+	{NAME("pac_sec"),	CHILD(named, stats_arenas_i_pac_sec)}
 };
 static const ctl_named_node_t super_stats_arenas_i_node[] = {
 	{NAME(""),		CHILD(named, stats_arenas_i)}
@@ -793,6 +1052,12 @@ static const ctl_named_node_t stats_background_thread_node[] = {
 	{NAME("run_interval"),	CTL(stats_background_thread_run_interval)}
 };
 
+static const ctl_named_node_t stats_hpa_central_node[] = {
+	{NAME("nempty"),	CTL(stats_hpa_central_nempty)},
+	{NAME("nretained"),	CTL(stats_hpa_central_nretained)},
+	{NAME("eden_bytes"),	CTL(stats_hpa_central_eden_bytes)}
+};
+
 #define OP(mtx) MUTEX_PROF_DATA_NODE(mutexes_##mtx)
 MUTEX_PROF_GLOBAL_MUTEXES
 #undef OP
@@ -805,6 +1070,18 @@ MUTEX_PROF_GLOBAL_MUTEXES
 };
 #undef MUTEX_PROF_DATA_NODE
 
+static const ctl_named_node_t stats_numa_nodes_i_node[] = {
+	{NAME("resident"),	CTL(stats_numa_nodes_i_resident)}
+};
+
+static const ctl_named_node_t super_stats_numa_nodes_i_node[] = {
+	{NAME(""),		CHILD(named, stats_numa_nodes_i)}
+};
+
+static const ctl_indexed_node_t stats_numa_nodes_node[] = {
+	{INDEX(stats_numa_nodes_i)}
+};
+
 static const ctl_named_node_t stats_node[] = {
 	{NAME("allocated"),	CTL(stats_allocated)},
 	{NAME("active"),	CTL(stats_active)},
@@ -815,9 +1092,12 @@ static const ctl_named_node_t stats_node[] = {
 	{NAME("retained"),	CTL(stats_retained)},
 	{NAME("background_thread"),
 	 CHILD(named, stats_background_thread)},
+	{NAME("hpa_central"),	CHILD(named, stats_hpa_central)},
 	{NAME("mutexes"),	CHILD(named, stats_mutexes)},
 	{NAME("arenas"),	CHILD(indexed, stats_arenas)},
 	{NAME("zero_reallocs"),	CTL(stats_zero_reallocs)},
+	{NAME("numa_nnodes"),	CTL(stats_numa_nnodes)},
+	{NAME("numa_nodes"),	CHILD(indexed, stats_numa_nodes)}
 };
 
 static const ctl_named_node_t experimental_hooks_node[] = {
@@ -1018,6 +1298,8 @@ ctl_arena_clear(ctl_arena_t *ctl_arena) {
 		    sizeof(hpa_shard_stats_t));
 		memset(&ctl_arena->astats->secstats, 0,
 		    sizeof(sec_stats_t));
+		memset(&ctl_arena->astats->pac_secstats, 0,
+		    sizeof(sec_stats_t));
 	}
 }
 
@@ -1032,7 +1314,8 @@ ctl_arena_stats_amerge(tsdn_t *tsdn, ctl_arena_t *ctl_arena, arena_t *arena) {
 		    &ctl_arena->pdirty, &ctl_arena->pmuzzy,
 		    &ctl_arena->astats->astats, ctl_arena->astats->bstats,
 		    ctl_arena->astats->lstats, ctl_arena->astats->estats,
-		    &ctl_arena->astats->hpastats, &ctl_arena->astats->secstats);
+		    &ctl_arena->astats->hpastats, &ctl_arena->astats->secstats,
+		    &ctl_arena->astats->pac_secstats);
 
 		for (i = 0; i < SC_NBINS; i++) {
 			bin_stats_t *bstats =
@@ -1102,6 +1385,16 @@ ctl_arena_stats_sdmerge(ctl_arena_t *ctl_sdarena, ctl_arena_t *ctl_arena,
 		    &sdstats->astats.pa_shard_stats.pac_stats.decay_muzzy.purged,
 		    &astats->astats.pa_shard_stats.pac_stats.decay_muzzy.purged);
 
+		ctl_accum_locked_u64(&sdstats->astats.pa_shard_stats.pac_stats
+		    .retained_release.npurge, &astats->astats.pa_shard_stats
+		    .pac_stats.retained_release.npurge);
+		ctl_accum_locked_u64(&sdstats->astats.pa_shard_stats.pac_stats
+		    .retained_release.nmadvise, &astats->astats.pa_shard_stats
+		    .pac_stats.retained_release.nmadvise);
+		ctl_accum_locked_u64(&sdstats->astats.pa_shard_stats.pac_stats
+		    .retained_release.purged, &astats->astats.pa_shard_stats
+		    .pac_stats.retained_release.purged);
+
 #define OP(mtx) malloc_mutex_prof_merge(				\
 		    &(sdstats->astats.mutex_prof_data[			\
 		        arena_prof_mutex_##mtx]),			\
@@ -1212,6 +1505,9 @@ MUTEX_PROF_ARENA_MUTEXES
 		/* Merge HPA stats. */
 		hpa_shard_stats_accum(&sdstats->hpastats, &astats->hpastats);
 		sec_stats_accum(&sdstats->secstats, &astats->secstats);
+
+		/* Merge PAC SEC stats. */
+		sec_stats_accum(&sdstats->pac_secstats, &astats->pac_secstats);
 	}
 }
 
@@ -1285,6 +1581,10 @@ ctl_refresh(tsdn_t *tsdn) {
 		tarenas[i] = arena_get(tsdn, i, false);
 	}
 
+	if (config_stats) {
+		memset(ctl_stats->numa_resident, 0,
+		    sizeof(ctl_stats->numa_resident));
+	}
 	for (i = 0; i < ctl_arenas->narenas; i++) {
 		ctl_arena_t *ctl_arena = arenas_i(i);
 		bool initialized = (tarenas[i] != NULL);
@@ -1293,10 +1593,22 @@ ctl_refresh(tsdn_t *tsdn) {
 		if (initialized) {
 			ctl_arena_refresh(tsdn, tarenas[i], ctl_sarena, i,
 			    false);
+			if (config_stats) {
+				/*
+				 * Attributed by the arena's node; what the
+				 * kernel actually did with a (preferred)
+				 * binding isn't something we track.
+				 */
+				ctl_stats->numa_resident[
+				    tarenas[i]->numa_node] +=
+				    ctl_arena->astats->astats.resident;
+			}
 		}
 	}
 
 	if (config_stats) {
+		pa_cpu_hpa_stats_merge(tsdn, &arena_hpa_cpu_global,
+		    &ctl_sarena->astats->hpastats);
 		ctl_stats->allocated = ctl_sarena->astats->allocated_small +
 		    ctl_sarena->astats->astats.allocated_large;
 		ctl_stats->active = (ctl_sarena->pactive << LG_PAGE);
@@ -1311,6 +1623,8 @@ ctl_refresh(tsdn_t *tsdn) {
 		    .pa_shard_stats.pac_stats.retained;
 
 		ctl_background_thread_stats_read(tsdn);
+		hpa_central_stats_read(tsdn, &arena_hpa_central_global,
+		    &ctl_stats->hpa_central);
 
 #define READ_GLOBAL_MUTEX_PROF_DATA(i, mtx)				\
     malloc_mutex_lock(tsdn, &mtx);					\
@@ -2096,6 +2410,8 @@ CTL_RO_CONFIG_GEN(config_xmalloc, bool)
 CTL_RO_NL_GEN(opt_abort, opt_abort, bool)
 CTL_RO_NL_GEN(opt_abort_conf, opt_abort_conf, bool)
 CTL_RO_NL_GEN(opt_trust_madvise, opt_trust_madvise, bool)
+CTL_RO_NL_GEN(opt_process_madvise, opt_process_madvise, bool)
+CTL_RO_NL_GEN(opt_numa_bind, opt_numa_bind, bool)
 CTL_RO_NL_GEN(opt_confirm_conf, opt_confirm_conf, bool)
 CTL_RO_NL_GEN(opt_hpa, opt_hpa, bool)
 CTL_RO_NL_GEN(opt_hpa_slab_max_alloc, opt_hpa_opts.slab_max_alloc, size_t)
@@ -2108,9 +2424,39 @@ CTL_RO_NL_GEN(opt_hpa_dehugification_threshold,
  * its representation are internal implementation details.
  */
 CTL_RO_NL_GEN(opt_hpa_dirty_mult, opt_hpa_opts.dirty_mult, fxp_t)
-CTL_RO_NL_GEN(opt_hpa_sec_max_alloc, opt_hpa_sec_max_alloc, size_t)
-CTL_RO_NL_GEN(opt_hpa_sec_max_bytes, opt_hpa_sec_max_bytes, size_t)
-CTL_RO_NL_GEN(opt_hpa_sec_nshards, opt_hpa_sec_nshards, size_t)
+CTL_RO_NL_GEN(opt_hpa_dirty_decay_ms, opt_hpa_opts.dirty_decay_ms, ssize_t)
+CTL_RO_NL_GEN(opt_hpa_muzzy_decay_ms, opt_hpa_opts.muzzy_decay_ms, ssize_t)
+CTL_RO_NL_GEN(opt_hpa_empty_max, opt_hpa_opts.empty_max, size_t)
+CTL_RO_NL_GEN(opt_hpa_central_empty_max, opt_hpa_central_empty_max, size_t)
+CTL_RO_NL_GEN(opt_hpa_eden_size, opt_hpa_eden_size, size_t)
+CTL_RO_NL_GEN(opt_hpa_eden_pretouch, opt_hpa_eden_pretouch, bool)
+CTL_RO_NL_GEN(opt_hpa_cpu_shards, opt_hpa_cpu_shards, unsigned)
+CTL_RO_NL_GEN(opt_hpa_hugify_delay_ms, opt_hpa_opts.hugify_delay_ms, uint64_t)
+CTL_RO_NL_GEN(opt_hpa_dehugify_delay_ms, opt_hpa_opts.dehugify_delay_ms,
+    uint64_t)
+CTL_RO_NL_GEN(opt_hpa_hugify_sync, opt_hpa_opts.hugify_sync, bool)
+CTL_RO_NL_GEN(opt_hpa_hugetlb, opt_hpa_opts.hugetlb, bool)
+CTL_RO_NL_GEN(opt_hpa_alloc_policy,
+    hpa_alloc_policy_names[opt_hpa_opts.alloc_policy], const char *)
+CTL_RO_NL_GEN(opt_hpa_sec_nshards, opt_hpa_sec_opts.nshards, size_t)
+CTL_RO_NL_GEN(opt_hpa_sec_shard_by_cpu, opt_hpa_sec_opts.shard_by_cpu, bool)
+CTL_RO_NL_GEN(opt_hpa_sec_max_alloc, opt_hpa_sec_opts.max_alloc, size_t)
+CTL_RO_NL_GEN(opt_hpa_sec_max_bytes, opt_hpa_sec_opts.max_bytes, size_t)
+CTL_RO_NL_GEN(opt_hpa_sec_bytes_after_flush,
+    opt_hpa_sec_opts.bytes_after_flush, size_t)
+CTL_RO_NL_GEN(opt_hpa_sec_batch_fill_extra, opt_hpa_sec_opts.batch_fill_extra,
+    size_t)
+CTL_RO_NL_GEN(opt_hpa_sec_max_idle_ms, opt_hpa_sec_opts.max_idle_ms, uint64_t)
+CTL_RO_NL_GEN(opt_pac_sec, opt_pac_sec, bool)
+CTL_RO_NL_GEN(opt_pac_sec_nshards, opt_pac_sec_opts.nshards, size_t)
+CTL_RO_NL_GEN(opt_pac_sec_shard_by_cpu, opt_pac_sec_opts.shard_by_cpu, bool)
+CTL_RO_NL_GEN(opt_pac_sec_max_alloc, opt_pac_sec_opts.max_alloc, size_t)
+CTL_RO_NL_GEN(opt_pac_sec_max_bytes, opt_pac_sec_opts.max_bytes, size_t)
+CTL_RO_NL_GEN(opt_pac_sec_bytes_after_flush,
+    opt_pac_sec_opts.bytes_after_flush, size_t)
+CTL_RO_NL_GEN(opt_pac_sec_batch_fill_extra, opt_pac_sec_opts.batch_fill_extra,
+    size_t)
+CTL_RO_NL_GEN(opt_pac_sec_max_idle_ms, opt_pac_sec_opts.max_idle_ms, uint64_t)
 CTL_RO_NL_GEN(opt_metadata_thp, metadata_thp_mode_names[opt_metadata_thp],
     const char *)
 CTL_RO_NL_GEN(opt_retain, opt_retain, bool)
@@ -2119,8 +2465,11 @@ CTL_RO_NL_GEN(opt_narenas, opt_narenas, unsigned)
 CTL_RO_NL_GEN(opt_percpu_arena, percpu_arena_mode_names[opt_percpu_arena],
     const char *)
 CTL_RO_NL_GEN(opt_oversize_threshold, opt_oversize_threshold, size_t)
+CTL_RO_NL_GEN(opt_ralloc_mremap_min, opt_ralloc_mremap_min, size_t)
 CTL_RO_NL_GEN(opt_background_thread, opt_background_thread, bool)
 CTL_RO_NL_GEN(opt_max_background_threads, opt_max_background_threads, size_t)
+CTL_RO_NL_GEN(opt_background_thread_hpa_interval_max_ms,
+    opt_background_thread_hpa_interval_max_ms, size_t)
 CTL_RO_NL_GEN(opt_dirty_decay_ms, opt_dirty_decay_ms, ssize_t)
 CTL_RO_NL_GEN(opt_muzzy_decay_ms, opt_muzzy_decay_ms, ssize_t)
 CTL_RO_NL_GEN(opt_stats_print, opt_stats_print, bool)
@@ -2148,6 +2497,10 @@ CTL_RO_NL_GEN(opt_lg_tcache_flush_large_div, opt_lg_tcache_flush_large_div,
 CTL_RO_NL_GEN(opt_thp, thp_mode_names[opt_thp], const char *)
 CTL_RO_NL_GEN(opt_lg_extent_max_active_fit, opt_lg_extent_max_active_fit,
     size_t)
+CTL_RO_NL_GEN(opt_extent_coalesce_deferred, opt_extent_coalesce_deferred,
+    bool)
+CTL_RO_NL_GEN(opt_retained_limit, opt_retained_limit, size_t)
+CTL_RO_NL_GEN(opt_retained_idle_ms, opt_retained_idle_ms, ssize_t)
 CTL_RO_NL_CGEN(config_prof, opt_prof, opt_prof, bool)
 CTL_RO_NL_CGEN(config_prof, opt_prof_prefix, opt_prof_prefix, const char *)
 CTL_RO_NL_CGEN(config_prof, opt_prof_active, opt_prof_active, bool)
@@ -2506,6 +2859,12 @@ arena_i_decay(tsdn_t *tsdn, unsigned arena_ind, bool all) {
 					    all);
 				}
 			}
+			/*
+			 * The per-CPU HPA shards belong to no arena, so only
+			 * get a look-in here.
+			 */
+			pa_cpu_hpa_do_deferred_work(tsdn,
+			    &arena_hpa_cpu_global);
 		} else {
 			arena_t *tarena;
 
@@ -2820,6 +3179,41 @@ arena_i_muzzy_decay_ms_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
 	    newlen, false);
 }
 
+static int
+arena_i_hpa_dirty_decay_ms_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	unsigned arena_ind;
+	arena_t *arena;
+
+	MIB_UNSIGNED(arena_ind, 1);
+	arena = arena_get(tsd_tsdn(tsd), arena_ind, false);
+	if (arena == NULL) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	if (oldp != NULL && oldlenp != NULL) {
+		ssize_t oldval = arena_hpa_dirty_decay_ms_get(arena);
+		READ(oldval, ssize_t);
+	}
+	if (newp != NULL) {
+		if (newlen != sizeof(ssize_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		if (arena_hpa_dirty_decay_ms_set(tsd_tsdn(tsd), arena,
+		    *(ssize_t *)newp)) {
+			ret = EFAULT;
+			goto label_return;
+		}
+	}
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
 static int
 arena_i_extent_hooks_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
     void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
@@ -2914,6 +3308,80 @@ label_return:
 	return ret;
 }
 
+static int
+arena_i_retained_limit_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	unsigned arena_ind;
+	arena_t *arena;
+
+	if (!opt_retain) {
+		/* Only relevant when retain is enabled. */
+		return ENOENT;
+	}
+
+	MIB_UNSIGNED(arena_ind, 1);
+	arena = arena_get(tsd_tsdn(tsd), arena_ind, false);
+	if (arena == NULL) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	if (oldp != NULL && oldlenp != NULL) {
+		size_t oldval = pac_retained_limit_get(&arena->pa_shard.pac);
+		READ(oldval, size_t);
+	}
+	if (newp != NULL) {
+		if (newlen != sizeof(size_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		pac_retained_limit_set(&arena->pa_shard.pac, *(size_t *)newp);
+	}
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+arena_i_retained_idle_ms_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	unsigned arena_ind;
+	arena_t *arena;
+
+	if (!opt_retain) {
+		/* Only relevant when retain is enabled. */
+		return ENOENT;
+	}
+
+	MIB_UNSIGNED(arena_ind, 1);
+	arena = arena_get(tsd_tsdn(tsd), arena_ind, false);
+	if (arena == NULL) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	if (oldp != NULL && oldlenp != NULL) {
+		ssize_t oldval = pac_retained_idle_ms_get(&arena->pa_shard.pac);
+		READ(oldval, ssize_t);
+	}
+	if (newp != NULL) {
+		if (newlen != sizeof(ssize_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		if (pac_retained_idle_ms_set(&arena->pa_shard.pac,
+		    *(ssize_t *)newp)) {
+			ret = EFAULT;
+			goto label_return;
+		}
+	}
+	ret = 0;
+label_return:
+	return ret;
+}
+
 static const ctl_named_node_t *
 arena_i_index(tsdn_t *tsdn, const size_t *mib, size_t miblen,
     size_t i) {
@@ -3298,9 +3766,29 @@ CTL_RO_CGEN(config_stats, stats_background_thread_num_runs,
 CTL_RO_CGEN(config_stats, stats_background_thread_run_interval,
     nstime_ns(&ctl_stats->background_thread.run_interval), uint64_t)
 
+CTL_RO_CGEN(config_stats, stats_hpa_central_nempty,
+    ctl_stats->hpa_central.nempty, size_t)
+CTL_RO_CGEN(config_stats, stats_hpa_central_nretained,
+    ctl_stats->hpa_central.nretained, size_t)
+CTL_RO_CGEN(config_stats, stats_hpa_central_eden_bytes,
+    ctl_stats->hpa_central.eden_bytes, size_t)
+
 CTL_RO_CGEN(config_stats, stats_zero_reallocs,
     atomic_load_zu(&zero_realloc_count, ATOMIC_RELAXED), size_t)
 
+CTL_RO_CGEN(config_stats, stats_numa_nnodes, pages_numa_nnodes, unsigned)
+CTL_RO_CGEN(config_stats, stats_numa_nodes_i_resident,
+    ctl_stats->numa_resident[mib[2]], size_t)
+
+static const ctl_named_node_t *
+stats_numa_nodes_i_index(tsdn_t *tsdn, const size_t *mib, size_t miblen,
+    size_t i) {
+	if (i >= pages_numa_nnodes) {
+		return NULL;
+	}
+	return super_stats_numa_nodes_i_node;
+}
+
 CTL_RO_GEN(stats_arenas_i_dss, arenas_i(mib[2])->dss, const char *)
 CTL_RO_GEN(stats_arenas_i_dirty_decay_ms, arenas_i(mib[2])->dirty_decay_ms,
     ssize_t)
@@ -3363,6 +3851,16 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_abandoned_vm,
     &arenas_i(mib[2])->astats->astats.pa_shard_stats.pac_stats.abandoned_vm,
     ATOMIC_RELAXED), size_t)
 
+CTL_RO_CGEN(config_stats, stats_arenas_i_retained_nrelease,
+    locked_read_u64_unsynchronized(&arenas_i(mib[2])->astats->astats
+    .pa_shard_stats.pac_stats.retained_release.npurge), uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_retained_nunmap,
+    locked_read_u64_unsynchronized(&arenas_i(mib[2])->astats->astats
+    .pa_shard_stats.pac_stats.retained_release.nmadvise), uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_retained_released,
+    locked_read_u64_unsynchronized(&arenas_i(mib[2])->astats->astats
+    .pa_shard_stats.pac_stats.retained_release.purged), uint64_t)
+
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bytes,
     arenas_i(mib[2])->astats->secstats.bytes, size_t)
 
@@ -3566,10 +4064,39 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_npurge_passes,
     arenas_i(mib[2])->astats->hpastats.nonderived_stats.npurge_passes, uint64_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_npurges,
     arenas_i(mib[2])->astats->hpastats.nonderived_stats.npurges, uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_npurged,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.npurged, uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_npurge_syscalls,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.npurge_syscalls,
+    uint64_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nhugifies,
     arenas_i(mib[2])->astats->hpastats.nonderived_stats.nhugifies, uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nhugify_failures,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.nhugify_failures,
+    uint64_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ndehugifies,
     arenas_i(mib[2])->astats->hpastats.nonderived_stats.ndehugifies, uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ndehugifies_early,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.ndehugifies_early,
+    uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nempty_releases,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.nempty_releases,
+    uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nempty_pooled,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.nempty_pooled,
+    uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ndeferred_inline,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.ndeferred_inline,
+    uint64_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ndeferred_background,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.ndeferred_background,
+    uint64_t);
+
+/*
+ * Muzzy pages only exist in nonhuge slabs (hugifying a slab faults them back
+ * in), so there's no nmuzzy_huge.  Conversely, hugetlb slabs are always huge;
+ * npageslabs_hugetlb counts the ones among the npageslabs_huge.
+ */
 
 /* Full, nonhuge */
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_npageslabs_nonhuge,
@@ -3579,6 +4106,8 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_nactive_nonhuge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.full_slabs[0].nactive, size_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_ndirty_nonhuge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.full_slabs[0].ndirty, size_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_nmuzzy_nonhuge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.full_slabs[0].nmuzzy, size_t);
 
 /* Full, huge */
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_npageslabs_huge,
@@ -3588,6 +4117,9 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_nactive_huge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.full_slabs[1].nactive, size_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_ndirty_huge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.full_slabs[1].ndirty, size_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_full_slabs_npageslabs_hugetlb,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.full_slabs[1].nhugetlb,
+    size_t);
 
 /* Empty, nonhuge */
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_npageslabs_nonhuge,
@@ -3597,6 +4129,8 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_nactive_nonhuge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.empty_slabs[0].nactive, size_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_ndirty_nonhuge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.empty_slabs[0].ndirty, size_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_nmuzzy_nonhuge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.empty_slabs[0].nmuzzy, size_t);
 
 /* Empty, huge */
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_npageslabs_huge,
@@ -3606,6 +4140,9 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_nactive_huge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.empty_slabs[1].nactive, size_t);
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_ndirty_huge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.empty_slabs[1].ndirty, size_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_empty_slabs_npageslabs_hugetlb,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.empty_slabs[1].nhugetlb,
+    size_t);
 
 /* Nonfull, nonhuge */
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_nonhuge,
@@ -3617,6 +4154,9 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_nactive_nonhu
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_nonhuge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.nonfull_slabs[mib[5]][0].ndirty,
     size_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_nmuzzy_nonhuge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.nonfull_slabs[mib[5]][0].nmuzzy,
+    size_t);
 
 /* Nonfull, huge */
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_huge,
@@ -3628,6 +4168,9 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_nactive_huge,
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_ndirty_huge,
     arenas_i(mib[2])->astats->hpastats.psset_stats.nonfull_slabs[mib[5]][1].ndirty,
     size_t);
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nonfull_slabs_j_npageslabs_hugetlb,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.nonfull_slabs[mib[5]][1].nhugetlb,
+    size_t);
 
 static const ctl_named_node_t *
 stats_arenas_i_hpa_shard_nonfull_slabs_j_index(tsdn_t *tsdn, const size_t *mib,
@@ -3638,6 +4181,112 @@ stats_arenas_i_hpa_shard_nonfull_slabs_j_index(tsdn_t *tsdn, const size_t *mib,
 	return super_stats_arenas_i_hpa_shard_nonfull_slabs_j_node;
 }
 
+CTL_RO_CGEN(config_stats,
+    stats_arenas_i_hpa_shard_nactive_hist_j_npageslabs_nonhuge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.nactive_hist[mib[5]][0],
+    size_t);
+CTL_RO_CGEN(config_stats,
+    stats_arenas_i_hpa_shard_nactive_hist_j_npageslabs_huge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.nactive_hist[mib[5]][1],
+    size_t);
+
+static const ctl_named_node_t *
+stats_arenas_i_hpa_shard_nactive_hist_j_index(tsdn_t *tsdn, const size_t *mib,
+    size_t miblen, size_t j) {
+	if (j >= PSSET_NHIST) {
+		return NULL;
+	}
+	return super_stats_arenas_i_hpa_shard_nactive_hist_j_node;
+}
+
+CTL_RO_CGEN(config_stats,
+    stats_arenas_i_hpa_shard_ndirty_hist_j_npageslabs_nonhuge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.ndirty_hist[mib[5]][0],
+    size_t);
+CTL_RO_CGEN(config_stats,
+    stats_arenas_i_hpa_shard_ndirty_hist_j_npageslabs_huge,
+    arenas_i(mib[2])->astats->hpastats.psset_stats.ndirty_hist[mib[5]][1],
+    size_t);
+
+static const ctl_named_node_t *
+stats_arenas_i_hpa_shard_ndirty_hist_j_index(tsdn_t *tsdn, const size_t *mib,
+    size_t miblen, size_t j) {
+	if (j >= PSSET_NHIST) {
+		return NULL;
+	}
+	return super_stats_arenas_i_hpa_shard_ndirty_hist_j_node;
+}
+
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_noverflow_flushes,
+    arenas_i(mib[2])->astats->secstats.noverflow_flushes, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_nhits,
+    arenas_i(mib[2])->astats->secstats.total.nhits, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_nmisses,
+    arenas_i(mib[2])->astats->secstats.total.nmisses, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_nfills,
+    arenas_i(mib[2])->astats->secstats.total.nfills, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_nfilled,
+    arenas_i(mib[2])->astats->secstats.total.nfilled, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_nflushed,
+    arenas_i(mib[2])->astats->secstats.total.nflushed, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bins_j_bytes,
+    arenas_i(mib[2])->astats->secstats.bins[mib[5]].bytes, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bins_j_nhits,
+    arenas_i(mib[2])->astats->secstats.bins[mib[5]].nhits, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bins_j_nmisses,
+    arenas_i(mib[2])->astats->secstats.bins[mib[5]].nmisses, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bins_j_nfills,
+    arenas_i(mib[2])->astats->secstats.bins[mib[5]].nfills, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bins_j_nfilled,
+    arenas_i(mib[2])->astats->secstats.bins[mib[5]].nfilled, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bins_j_nflushed,
+    arenas_i(mib[2])->astats->secstats.bins[mib[5]].nflushed, uint64_t)
+
+static const ctl_named_node_t *
+stats_arenas_i_hpa_sec_bins_j_index(tsdn_t *tsdn, const size_t *mib,
+    size_t miblen, size_t j) {
+	if (j >= SEC_NPSIZES) {
+		return NULL;
+	}
+	return super_stats_arenas_i_hpa_sec_bins_j_node;
+}
+
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bytes,
+    arenas_i(mib[2])->astats->pac_secstats.bytes, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_noverflow_flushes,
+    arenas_i(mib[2])->astats->pac_secstats.noverflow_flushes, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_nhits,
+    arenas_i(mib[2])->astats->pac_secstats.total.nhits, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_nmisses,
+    arenas_i(mib[2])->astats->pac_secstats.total.nmisses, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_nfills,
+    arenas_i(mib[2])->astats->pac_secstats.total.nfills, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_nfilled,
+    arenas_i(mib[2])->astats->pac_secstats.total.nfilled, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_nflushed,
+    arenas_i(mib[2])->astats->pac_secstats.total.nflushed, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bins_j_bytes,
+    arenas_i(mib[2])->astats->pac_secstats.bins[mib[5]].bytes, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bins_j_nhits,
+    arenas_i(mib[2])->astats->pac_secstats.bins[mib[5]].nhits, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bins_j_nmisses,
+    arenas_i(mib[2])->astats->pac_secstats.bins[mib[5]].nmisses, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bins_j_nfills,
+    arenas_i(mib[2])->astats->pac_secstats.bins[mib[5]].nfills, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bins_j_nfilled,
+    arenas_i(mib[2])->astats->pac_secstats.bins[mib[5]].nfilled, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_pac_sec_bins_j_nflushed,
+    arenas_i(mib[2])->astats->pac_secstats.bins[mib[5]].nflushed, uint64_t)
+
+static const ctl_named_node_t *
+stats_arenas_i_pac_sec_bins_j_index(tsdn_t *tsdn, const size_t *mib,
+    size_t miblen, size_t j) {
+	if (j >= SEC_NPSIZES) {
+		return NULL;
+	}
+	return super_stats_arenas_i_pac_sec_bins_j_node;
+}
+
 static bool
 ctl_arenas_i_verify(size_t i) {
 	size_t a = arenas_i2a_impl(i, true, true);
@@ -11,6 +11,7 @@ ecache_init(tsdn_t *tsdn, ecache_t *ecache, extent_state_t state, unsigned ind,
 	ecache->state = state;
 	ecache->ind = ind;
 	ecache->delay_coalesce = delay_coalesce;
+	atomic_store_u(&ecache->ncoalesce_pending, 0, ATOMIC_RELAXED);
 	eset_init(&ecache->eset, state);
 	return false;
 }
@@ -58,6 +58,9 @@ ehooks_default_alloc_impl(tsdn_t *tsdn, void *new_addr, size_t size,
 	if (have_madvise_huge && ret) {
 		pages_set_thp_state(ret, size);
 	}
+	if (opt_numa_bind && ret != NULL) {
+		pages_numa_bind(ret, size, arena->numa_node);
+	}
 	return ret;
 }
 
@@ -162,6 +162,20 @@ emap_register_boundary(tsdn_t *tsdn, emap_t *emap, edata_t *edata,
 	return false;
 }
 
+bool
+emap_register_prepare(tsdn_t *tsdn, emap_t *emap, void *addr, size_t size) {
+	EMAP_DECLARE_RTREE_CTX;
+
+	/* A fake edata_t, as in emap_split_prepare, just for the lookup. */
+	edata_t range = {0};
+	edata_init(&range, 0U, addr, size, false, 0, 0, extent_state_active,
+	    false, false, EXTENT_PAI_PAC, EXTENT_NOT_HEAD);
+
+	rtree_leaf_elm_t *elm_a, *elm_b;
+	return emap_rtree_leaf_elms_lookup(tsdn, emap, rtree_ctx, &range,
+	    false, true, &elm_a, &elm_b);
+}
+
 void
 emap_register_interior(tsdn_t *tsdn, emap_t *emap, edata_t *edata,
     szind_t szind) {
@@ -6,10 +6,26 @@
 const bitmap_info_t eset_bitmap_info =
     BITMAP_INFO_INITIALIZER(SC_NPSIZES+1);
 
+static void
+eset_bin_init(eset_bin_t *bin) {
+	edata_heap_new(&bin->heap);
+	/*
+	 * heap_min doesn't need initialization; it gets filled in when the bin
+	 * goes from empty to non-empty.
+	 */
+}
+
+static void
+eset_bin_stats_init(eset_bin_stats_t *bin_stats) {
+	atomic_store_zu(&bin_stats->nextents, 0, ATOMIC_RELAXED);
+	atomic_store_zu(&bin_stats->nbytes, 0, ATOMIC_RELAXED);
+}
+
 void
 eset_init(eset_t *eset, extent_state_t state) {
 	for (unsigned i = 0; i < SC_NPSIZES + 1; i++) {
-		edata_heap_new(&eset->heaps[i]);
+		eset_bin_init(&eset->bins[i]);
+		eset_bin_stats_init(&eset->bin_stats[i]);
 	}
 	bitmap_init(eset->bitmap, &eset_bitmap_info, true);
 	edata_list_inactive_init(&eset->lru);
@@ -24,28 +40,30 @@ eset_npages_get(eset_t *eset) {
 
 size_t
 eset_nextents_get(eset_t *eset, pszind_t pind) {
-	return atomic_load_zu(&eset->nextents[pind], ATOMIC_RELAXED);
+	return atomic_load_zu(&eset->bin_stats[pind].nextents, ATOMIC_RELAXED);
 }
 
 size_t
 eset_nbytes_get(eset_t *eset, pszind_t pind) {
-	return atomic_load_zu(&eset->nbytes[pind], ATOMIC_RELAXED);
+	return atomic_load_zu(&eset->bin_stats[pind].nbytes, ATOMIC_RELAXED);
 }
 
 static void
 eset_stats_add(eset_t *eset, pszind_t pind, size_t sz) {
-	size_t cur = atomic_load_zu(&eset->nextents[pind], ATOMIC_RELAXED);
-	atomic_store_zu(&eset->nextents[pind], cur + 1, ATOMIC_RELAXED);
-	cur = atomic_load_zu(&eset->nbytes[pind], ATOMIC_RELAXED);
-	atomic_store_zu(&eset->nbytes[pind], cur + sz, ATOMIC_RELAXED);
+	eset_bin_stats_t *bin_stats = &eset->bin_stats[pind];
+	size_t cur = atomic_load_zu(&bin_stats->nextents, ATOMIC_RELAXED);
+	atomic_store_zu(&bin_stats->nextents, cur + 1, ATOMIC_RELAXED);
+	cur = atomic_load_zu(&bin_stats->nbytes, ATOMIC_RELAXED);
+	atomic_store_zu(&bin_stats->nbytes, cur + sz, ATOMIC_RELAXED);
 }
 
 static void
 eset_stats_sub(eset_t *eset, pszind_t pind, size_t sz) {
-	size_t cur = atomic_load_zu(&eset->nextents[pind], ATOMIC_RELAXED);
-	atomic_store_zu(&eset->nextents[pind], cur - 1, ATOMIC_RELAXED);
-	cur = atomic_load_zu(&eset->nbytes[pind], ATOMIC_RELAXED);
-	atomic_store_zu(&eset->nbytes[pind], cur - sz, ATOMIC_RELAXED);
+	eset_bin_stats_t *bin_stats = &eset->bin_stats[pind];
+	size_t cur = atomic_load_zu(&bin_stats->nextents, ATOMIC_RELAXED);
+	atomic_store_zu(&bin_stats->nextents, cur - 1, ATOMIC_RELAXED);
+	cur = atomic_load_zu(&bin_stats->nbytes, ATOMIC_RELAXED);
+	atomic_store_zu(&bin_stats->nbytes, cur - sz, ATOMIC_RELAXED);
 }
 
 void
@@ -55,11 +73,17 @@ eset_insert(eset_t *eset, edata_t *edata) {
 	size_t size = edata_size_get(edata);
 	size_t psz = sz_psz_quantize_floor(size);
 	pszind_t pind = sz_psz2ind(psz);
-	if (edata_heap_empty(&eset->heaps[pind])) {
+	eset_bin_t *bin = &eset->bins[pind];
+	edata_cmp_summary_t edata_cmp_summary = edata_cmp_summary_get(edata);
+	if (edata_heap_empty(&bin->heap)) {
 		bitmap_unset(eset->bitmap, &eset_bitmap_info,
 		    (size_t)pind);
+		bin->heap_min = edata_cmp_summary;
+	} else if (edata_cmp_summary_comp(edata_cmp_summary,
+	    bin->heap_min) < 0) {
+		bin->heap_min = edata_cmp_summary;
 	}
-	edata_heap_insert(&eset->heaps[pind], edata);
+	edata_heap_insert(&bin->heap, edata);
 
 	if (config_stats) {
 		eset_stats_add(eset, pind, size);
@@ -85,15 +109,24 @@ eset_remove(eset_t *eset, edata_t *edata) {
 	size_t size = edata_size_get(edata);
 	size_t psz = sz_psz_quantize_floor(size);
 	pszind_t pind = sz_psz2ind(psz);
-	edata_heap_remove(&eset->heaps[pind], edata);
+	eset_bin_t *bin = &eset->bins[pind];
+	edata_heap_remove(&bin->heap, edata);
 
 	if (config_stats) {
 		eset_stats_sub(eset, pind, size);
 	}
 
-	if (edata_heap_empty(&eset->heaps[pind])) {
+	if (edata_heap_empty(&bin->heap)) {
 		bitmap_set(eset->bitmap, &eset_bitmap_info,
 		    (size_t)pind);
+	} else if (edata_cmp_summary_comp(edata_cmp_summary_get(edata),
+	    bin->heap_min) == 0) {
+		/*
+		 * We just took out the minimum; only then does the cached one
+		 * need updating.
+		 */
+		bin->heap_min = edata_cmp_summary_get(
+		    edata_heap_first(&bin->heap));
 	}
 	edata_list_inactive_remove(&eset->lru, edata);
 	size_t npages = size >> LG_PAGE;
@@ -127,8 +160,8 @@ eset_fit_alignment(eset_t *eset, size_t min_size, size_t max_size,
 	    (pszind_t)bitmap_ffu(eset->bitmap, &eset_bitmap_info,
 	    (size_t)i+1)) {
 		assert(i < SC_NPSIZES);
-		assert(!edata_heap_empty(&eset->heaps[i]));
-		edata_t *edata = edata_heap_first(&eset->heaps[i]);
+		assert(!edata_heap_empty(&eset->bins[i].heap));
+		edata_t *edata = edata_heap_first(&eset->bins[i].heap);
 		uintptr_t base = (uintptr_t)edata_base_get(edata);
 		size_t candidate_size = edata_size_get(edata);
 		assert(candidate_size >= min_size);
@@ -158,40 +191,45 @@ eset_fit_alignment(eset_t *eset, size_t min_size, size_t max_size,
  * avoiding reusing and splitting large extents for smaller sizes.  In practice,
  * it's set to opt_lg_extent_max_active_fit for the dirty eset and SC_PTR_BITS
  * for others.
+ *
+ * Finding the first fit means looking at the minimum of every non-empty bin in
+ * range; we compare the cached heap_min summaries to do so, and only go to the
+ * heap for the one bin we end up picking from.
  */
 static edata_t *
 eset_first_fit(eset_t *eset, size_t size, bool exact_only,
     unsigned lg_max_fit) {
-	edata_t *ret = NULL;
-
 	pszind_t pind = sz_psz2ind(sz_psz_quantize_ceil(size));
 
 	if (exact_only) {
-		return edata_heap_empty(&eset->heaps[pind]) ? NULL :
-		    edata_heap_first(&eset->heaps[pind]);
+		return edata_heap_empty(&eset->bins[pind].heap) ? NULL :
+		    edata_heap_first(&eset->bins[pind].heap);
 	}
 
+	if (lg_max_fit == SC_PTR_BITS) {
+		/*
+		 * We'll shift by this below, and shifting out all the bits is
+		 * undefined.  Decreasing is safe, since the page size is larger
+		 * than 1 byte.
+		 */
+		lg_max_fit = SC_PTR_BITS - 1;
+	}
+
+	pszind_t ret_ind = SC_NPSIZES + 1;
+	edata_cmp_summary_t ret_summ = {0, 0};
 	for (pszind_t i = (pszind_t)bitmap_ffu(eset->bitmap,
 	    &eset_bitmap_info, (size_t)pind);
 	    i < SC_NPSIZES + 1;
 	    i = (pszind_t)bitmap_ffu(eset->bitmap, &eset_bitmap_info,
 	    (size_t)i+1)) {
-		assert(!edata_heap_empty(&eset->heaps[i]));
-		edata_t *edata = edata_heap_first(&eset->heaps[i]);
-		assert(edata_size_get(edata) >= size);
-		if (lg_max_fit == SC_PTR_BITS) {
-			/*
-			 * We'll shift by this below, and shifting out all the
-			 * bits is undefined.  Decreasing is safe, since the
-			 * page size is larger than 1 byte.
-			 */
-			lg_max_fit = SC_PTR_BITS - 1;
-		}
+		assert(!edata_heap_empty(&eset->bins[i].heap));
 		if ((sz_pind2sz(i) >> lg_max_fit) > size) {
 			break;
 		}
-		if (ret == NULL || edata_snad_comp(edata, ret) < 0) {
-			ret = edata;
+		if (ret_ind == SC_NPSIZES + 1 || edata_cmp_summary_comp(
+		    eset->bins[i].heap_min, ret_summ) < 0) {
+			ret_ind = i;
+			ret_summ = eset->bins[i].heap_min;
 		}
 		if (i == SC_NPSIZES) {
 			break;
@@ -199,6 +237,13 @@ eset_first_fit(eset_t *eset, size_t size, bool exact_only,
 		assert(i < SC_NPSIZES);
 	}
 
+	if (ret_ind == SC_NPSIZES + 1) {
+		return NULL;
+	}
+	edata_t *ret = edata_heap_first(&eset->bins[ret_ind].heap);
+	assert(edata_size_get(ret) >= size);
+	assert(edata_cmp_summary_comp(edata_cmp_summary_get(ret),
+	    ret_summ) == 0);
 	return ret;
 }
 
@@ -12,6 +12,7 @@
 /* Data. */
 
 size_t opt_lg_extent_max_active_fit = LG_EXTENT_MAX_ACTIVE_FIT_DEFAULT;
+bool opt_extent_coalesce_deferred = false;
 
 static bool extent_commit_impl(tsdn_t *tsdn, ehooks_t *ehooks, edata_t *edata,
     size_t offset, size_t length, bool growing_retained);
@@ -750,6 +751,8 @@ extent_alloc_retained(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
 	assert(alignment != 0);
 
 	malloc_mutex_lock(tsdn, &pac->grow_mtx);
+	/* Keeps pac_retained_release from seeing the ecache as idle. */
+	pac->retained_nuse++;
 
 	edata_t *edata = extent_recycle(tsdn, pac, ehooks,
 	    &pac->ecache_retained, new_addr, size, alignment, zero,
@@ -948,6 +951,77 @@ extent_try_coalesce_large(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
 	    coalesced, growing_retained, true);
 }
 
+/*
+ * Coalesces the queued-up extents of a delay_coalesce ecache (see
+ * opt_extent_coalesce_deferred) as fully as extent_record would have.  We go
+ * in address order, so that runs of neighboring extents get merged by forward
+ * coalescing from the lowest one; the entries for the ones merged into it
+ * then find nothing at their addresses.
+ */
+static void
+extent_coalesce_deferred_locked(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
+    ecache_t *ecache) {
+	malloc_mutex_assert_owner(tsdn, &ecache->mtx);
+	assert(ecache->delay_coalesce);
+
+	/*
+	 * Coalescing drops the mutex around each merge, so work from a copy;
+	 * anything freed in the meantime queues up behind it.
+	 */
+	void *pending[ECACHE_COALESCE_PENDING_MAX];
+	unsigned npending = ecache_ncoalesce_pending_get(ecache);
+	memcpy(pending, ecache->coalesce_pending, npending * sizeof(void *));
+	atomic_store_u(&ecache->ncoalesce_pending, 0, ATOMIC_RELAXED);
+
+	for (unsigned i = 1; i < npending; i++) {
+		void *addr = pending[i];
+		unsigned j;
+		for (j = i; j > 0 && (uintptr_t)pending[j - 1] > (uintptr_t)addr;
+		    j--) {
+			pending[j] = pending[j - 1];
+		}
+		pending[j] = addr;
+	}
+
+	for (unsigned i = 0; i < npending; i++) {
+		edata_t *edata = emap_lock_edata_from_addr(tsdn, pac->emap,
+		    pending[i], /* inactive_only */ true);
+		if (edata == NULL) {
+			continue;
+		}
+		/*
+		 * We hold ecache->mtx, so an extent in our state is in our
+		 * eset, and stays there until we take it out.
+		 */
+		bool in_eset = edata_base_get(edata) == pending[i]
+		    && edata_arena_ind_get(edata) == ecache_ind_get(ecache)
+		    && edata_pai_get(edata) == EXTENT_PAI_PAC
+		    && edata_state_get(edata) == ecache->state;
+		emap_unlock_edata(tsdn, pac->emap, edata);
+		if (!in_eset) {
+			continue;
+		}
+		extent_activate_locked(tsdn, ecache, edata);
+		bool coalesced;
+		do {
+			edata = extent_try_coalesce_large(tsdn, pac, ehooks,
+			    ecache, edata, &coalesced, false);
+		} while (coalesced);
+		extent_deactivate_locked(tsdn, ecache, edata);
+	}
+}
+
+void
+ecache_coalesce_deferred(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
+    ecache_t *ecache) {
+	if (ecache_ncoalesce_pending_get(ecache) == 0) {
+		return;
+	}
+	malloc_mutex_lock(tsdn, &ecache->mtx);
+	extent_coalesce_deferred_locked(tsdn, pac, ehooks, ecache);
+	malloc_mutex_unlock(tsdn, &ecache->mtx);
+}
+
 /* Purge a single extent to retained / unmapped directly. */
 static void
 extent_maximally_purge(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
@@ -988,6 +1062,25 @@ extent_record(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
 	if (!ecache->delay_coalesce) {
 		edata = extent_try_coalesce(tsdn, pac,  ehooks, ecache, edata,
 		    NULL, growing_retained);
+	} else if (opt_extent_coalesce_deferred
+	    && edata_size_get(edata) >= SC_LARGE_MINCLASS
+	    && edata_size_get(edata) <
+	    atomic_load_zu(&pac->oversize_threshold, ATOMIC_RELAXED)) {
+		assert(ecache == &pac->ecache_dirty);
+		/*
+		 * Queue the extent up for coalescing later, and make it
+		 * available for reuse in the meantime.  Oversize extents skip
+		 * this, to still get purged right away below.
+		 */
+		while (ecache_ncoalesce_pending_get(ecache)
+		    == ECACHE_COALESCE_PENDING_MAX) {
+			extent_coalesce_deferred_locked(tsdn, pac, ehooks,
+			    ecache);
+		}
+		unsigned npending = ecache_ncoalesce_pending_get(ecache);
+		ecache->coalesce_pending[npending] = edata_base_get(edata);
+		atomic_store_u(&ecache->ncoalesce_pending, npending + 1,
+		    ATOMIC_RELAXED);
 	} else if (edata_size_get(edata) >= SC_LARGE_MINCLASS) {
 		assert(ecache == &pac->ecache_dirty);
 		/* Always coalesce large extents eagerly. */
@@ -1290,6 +1383,96 @@ extent_merge_wrapper(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
 	return extent_merge_impl(tsdn, pac, ehooks, a, b, false);
 }
 
+bool
+extent_move_wrapper(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks,
+    edata_t *edata, size_t new_size) {
+	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
+	    WITNESS_RANK_CORE, 0);
+	assert(edata_state_get(edata) == extent_state_active);
+	assert(!edata_slab_get(edata));
+	assert(new_size > edata_size_get(edata));
+	assert((new_size & PAGE_MASK) == 0);
+
+	/*
+	 * Only mappings of our own can be moved about.  Custom hooks may hand
+	 * out memory that's anything but, and the dss is contiguous by design.
+	 */
+	if (!pages_can_move || !ehooks_are_default(ehooks)
+	    || (have_dss && extent_in_dss(edata_base_get(edata)))) {
+		return true;
+	}
+
+	void *old_base = edata_base_get(edata);
+	size_t old_size = edata_size_get(edata);
+	uintptr_t offset = (uintptr_t)edata_addr_get(edata)
+	    - (uintptr_t)old_base;
+	/*
+	 * Get the rtree leaves for wherever the extent ends up ready first, so
+	 * that once any pages have moved, registering it can't fail.
+	 */
+	if (emap_register_prepare(tsdn, pac->emap, old_base, new_size)) {
+		return true;
+	}
+	void *new_base;
+	bool movable;
+	if (!pages_grow(old_base, old_size, new_size, &movable)) {
+		new_base = old_base;
+		extent_deregister_no_gdump_sub(tsdn, pac, edata);
+	} else {
+		if (!movable) {
+			/* E.g., the extent spans more than one mapping. */
+			return true;
+		}
+		/*
+		 * Reserve the destination ourselves and move onto that, so
+		 * nothing but the move itself can fail once the pages go.
+		 */
+		bool commit = true;
+		new_base = pages_map(NULL, new_size, PAGE, &commit);
+		if (new_base == NULL) {
+			return true;
+		}
+		if (emap_register_prepare(tsdn, pac->emap, new_base,
+		    new_size)) {
+			pages_unmap(new_base, new_size);
+			return true;
+		}
+		/*
+		 * The old range stops being ours once its pages have moved
+		 * (another thread could map it straight away), so nothing may
+		 * be left pointing at it by then.  Neighbors looking to
+		 * coalesce see a gap meanwhile.
+		 */
+		extent_deregister_no_gdump_sub(tsdn, pac, edata);
+		if (pages_move(old_base, old_size, new_base, new_size)) {
+			/*
+			 * The reservation may or may not still be mapped (and
+			 * if not, maybe by someone else), so it's left alone, as
+			 * extents_abandon_vm does with what it can't return.
+			 */
+			bool err = extent_register_no_gdump_add(tsdn, pac,
+			    edata);
+			assert(!err);
+			emap_remap(tsdn, pac->emap, edata,
+			    edata_szind_get(edata), /* slab */ false);
+			return true;
+		}
+	}
+
+	if (config_prof) {
+		extent_gdump_sub(tsdn, edata);
+	}
+	edata_addr_set(edata, (void *)((uintptr_t)new_base + offset));
+	edata_size_set(edata, new_size);
+	if (new_base != old_base) {
+		/* It's a mapping of its own now, as though freshly grown. */
+		edata_sn_set(edata, extent_sn_next(pac));
+		edata_is_head_set(edata, true);
+	}
+	extent_reregister(tsdn, pac, edata);
+	return false;
+}
+
 bool
 extent_boot(void) {
 	assert(sizeof(slab_data_t) >= sizeof(e_prof_info_t));
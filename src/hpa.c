@@ -6,15 +6,23 @@
 #include "jemalloc/internal/flat_bitmap.h"
 #include "jemalloc/internal/witness.h"
 
-#define HPA_EDEN_SIZE (128 * HUGEPAGE)
+const char *hpa_alloc_policy_names[] = {
+	"oldest",
+	"fullest",
+	"lowest_address"
+};
 
 static edata_t *hpa_alloc(tsdn_t *tsdn, pai_t *self, size_t size,
     size_t alignment, bool zero);
+static size_t hpa_alloc_batch(tsdn_t *tsdn, pai_t *self, size_t size,
+    size_t nallocs, edata_list_active_t *results);
 static bool hpa_expand(tsdn_t *tsdn, pai_t *self, edata_t *edata,
     size_t old_size, size_t new_size, bool zero);
 static bool hpa_shrink(tsdn_t *tsdn, pai_t *self, edata_t *edata,
     size_t old_size, size_t new_size);
 static void hpa_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata);
+static void hpa_dalloc_batch(tsdn_t *tsdn, pai_t *self,
+    edata_list_active_t *list);
 
 bool
 hpa_supported() {
@@ -47,8 +55,9 @@ hpa_supported() {
 }
 
 bool
-hpa_shard_init(hpa_shard_t *shard, emap_t *emap, base_t *base,
-    edata_cache_t *edata_cache, unsigned ind, const hpa_shard_opts_t *opts) {
+hpa_shard_init(hpa_shard_t *shard, hpa_central_t *central, emap_t *emap,
+    base_t *base, edata_cache_t *edata_cache, unsigned ind,
+    const hpa_shard_opts_t *opts) {
 	/* malloc_conf processing should have filtered out these cases. */
 	assert(hpa_supported());
 	bool err;
@@ -64,23 +73,50 @@ hpa_shard_init(hpa_shard_t *shard, emap_t *emap, base_t *base,
 	}
 
 	assert(edata_cache != NULL);
+	shard->central = central;
 	shard->base = base;
 	edata_cache_small_init(&shard->ecs, edata_cache);
-	psset_init(&shard->psset);
+	psset_init(&shard->psset, opts->alloc_policy);
 	shard->age_counter = 0;
-	shard->eden = NULL;
-	shard->eden_len = 0;
+	shard->numa_node = -1;
 	shard->ind = ind;
 	shard->emap = emap;
 
 	shard->opts = *opts;
 
 	shard->npending_purge = 0;
+	shard->npending_purge_muzzy = 0;
+
+	/* Without lazy purging, nothing ever becomes muzzy. */
+	if (!pages_can_purge_lazy) {
+		shard->opts.muzzy_decay_ms = 0;
+	}
+
+	/* decay_init insists on zeroed memory. */
+	memset(&shard->decay, 0, sizeof(shard->decay));
+	memset(&shard->muzzy_decay, 0, sizeof(shard->muzzy_decay));
+	nstime_t cur_time;
+	nstime_init_update(&cur_time);
+	if (decay_init(&shard->decay, &cur_time, opts->dirty_decay_ms)) {
+		return true;
+	}
+	if (decay_init(&shard->muzzy_decay, &cur_time,
+	    shard->opts.muzzy_decay_ms)) {
+		return true;
+	}
 
 	shard->stats.npurge_passes = 0;
 	shard->stats.npurges = 0;
+	shard->stats.npurged = 0;
+	shard->stats.npurge_syscalls = 0;
 	shard->stats.nhugifies = 0;
+	shard->stats.nhugify_failures = 0;
 	shard->stats.ndehugifies = 0;
+	shard->stats.ndehugifies_early = 0;
+	shard->stats.nempty_releases = 0;
+	shard->stats.nempty_pooled = 0;
+	shard->stats.ndeferred_inline = 0;
+	shard->stats.ndeferred_background = 0;
 
 	/*
 	 * Fill these in last, so that if an hpa_shard gets used despite
@@ -88,9 +124,11 @@ hpa_shard_init(hpa_shard_t *shard, emap_t *emap, base_t *base,
 	 * operating on corrupted data.
 	 */
 	shard->pai.alloc = &hpa_alloc;
+	shard->pai.alloc_batch = &hpa_alloc_batch;
 	shard->pai.expand = &hpa_expand;
 	shard->pai.shrink = &hpa_shrink;
 	shard->pai.dalloc = &hpa_dalloc;
+	shard->pai.dalloc_batch = &hpa_dalloc_batch;
 
 	return false;
 }
@@ -106,8 +144,16 @@ hpa_shard_nonderived_stats_accum(hpa_shard_nonderived_stats_t *dst,
     hpa_shard_nonderived_stats_t *src) {
 	dst->npurge_passes += src->npurge_passes;
 	dst->npurges += src->npurges;
+	dst->npurged += src->npurged;
+	dst->npurge_syscalls += src->npurge_syscalls;
 	dst->nhugifies += src->nhugifies;
+	dst->nhugify_failures += src->nhugify_failures;
 	dst->ndehugifies += src->ndehugifies;
+	dst->ndehugifies_early += src->ndehugifies_early;
+	dst->nempty_releases += src->nempty_releases;
+	dst->nempty_pooled += src->nempty_pooled;
+	dst->ndeferred_inline += src->ndeferred_inline;
+	dst->ndeferred_background += src->ndeferred_background;
 }
 
 void
@@ -128,12 +174,6 @@ hpa_shard_stats_merge(tsdn_t *tsdn, hpa_shard_t *shard,
 	malloc_mutex_unlock(tsdn, &shard->grow_mtx);
 }
 
-static hpdata_t *
-hpa_alloc_ps(tsdn_t *tsdn, hpa_shard_t *shard) {
-	return (hpdata_t *)base_alloc(tsdn, shard->base, sizeof(hpdata_t),
-	    CACHELINE);
-}
-
 static bool
 hpa_good_hugification_candidate(hpa_shard_t *shard, hpdata_t *ps) {
 	/*
@@ -145,26 +185,107 @@ hpa_good_hugification_candidate(hpa_shard_t *shard, hpdata_t *ps) {
 	    >= shard->opts.hugification_threshold;
 }
 
+static size_t
+hpa_adjusted_ndirty(hpa_shard_t *shard) {
+	return psset_ndirty(&shard->psset) - shard->npending_purge;
+}
+
+static size_t
+hpa_adjusted_nmuzzy(hpa_shard_t *shard) {
+	return psset_nmuzzy(&shard->psset) - shard->npending_purge_muzzy;
+}
+
+/* Whether we purge dirty pages lazily, leaving them muzzy. */
+static bool
+hpa_purge_lazy(hpa_shard_t *shard) {
+	return decay_ms_read(&shard->muzzy_decay) != 0;
+}
+
+/*
+ * decay_epoch_advanced says whether the caller has just moved the decay epoch
+ * forward.  Much like the PAC, we only purge down to the decay limit at those
+ * points; pages dirtied in between get to live until the next one.
+ */
+static bool
+hpa_should_purge(hpa_shard_t *shard, bool decay_epoch_advanced) {
+	size_t adjusted_ndirty = hpa_adjusted_ndirty(shard);
+	if (shard->opts.dirty_mult != (fxp_t)-1) {
+		/*
+		 * Another simple static check; purge whenever dirty exceeds 25%
+		 * of active.
+		 */
+		size_t max_ndirty = fxp_mul_frac(psset_nactive(&shard->psset),
+		    shard->opts.dirty_mult);
+		if (adjusted_ndirty > max_ndirty) {
+			return true;
+		}
+	}
+	if (decay_ms_read(&shard->decay) == 0) {
+		return adjusted_ndirty > 0;
+	}
+	return decay_epoch_advanced
+	    && adjusted_ndirty > decay_npages_limit_get(&shard->decay);
+}
+
+/*
+ * The muzzy analogue of hpa_should_purge; there's no muzzy_mult, so only the
+ * decay curve matters.
+ */
 static bool
-hpa_should_purge(hpa_shard_t *shard) {
-	if (shard->opts.dirty_mult == (fxp_t)-1) {
+hpa_should_purge_muzzy(hpa_shard_t *shard, bool decay_epoch_advanced) {
+	size_t adjusted_nmuzzy = hpa_adjusted_nmuzzy(shard);
+	ssize_t decay_ms = decay_ms_read(&shard->muzzy_decay);
+	if (decay_ms < 0) {
 		return false;
 	}
-	size_t adjusted_ndirty = psset_ndirty(&shard->psset)
-	    - shard->npending_purge;
-	/*
-	 * Another simple static check; purge whenever dirty exceeds 25% of
-	 * active.
-	 */
-	size_t max_ndirty = fxp_mul_frac(psset_nactive(&shard->psset),
-	    shard->opts.dirty_mult);
-	return adjusted_ndirty > max_ndirty;
+	if (decay_ms == 0) {
+		return adjusted_nmuzzy > 0;
+	}
+	return decay_epoch_advanced
+	    && adjusted_nmuzzy > decay_npages_limit_get(&shard->muzzy_decay);
+}
+
+/*
+ * Moves the epoch of decay (which tracks npages_current pages) forward if its
+ * deadline has passed, returning whether or not it did.
+ */
+static bool
+hpa_maybe_advance_decay_epoch(tsdn_t *tsdn, hpa_shard_t *shard,
+    decay_t *decay, size_t npages_current) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	if (decay_ms_read(decay) <= 0) {
+		return false;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	return decay_maybe_advance_epoch(decay, &now, npages_current);
 }
 
 static void
 hpa_update_purge_hugify_eligibility(hpa_shard_t *shard, hpdata_t *ps) {
 	if (hpdata_changing_state_get(ps)) {
 		hpdata_purge_allowed_set(ps, false);
+		hpdata_muzzy_purge_allowed_set(ps, false);
+		hpdata_hugify_allowed_set(ps, false);
+		return;
+	}
+	bool purge_eligible;
+	if (hpdata_hugetlb_get(ps)) {
+		/*
+		 * Explicit hugepages can only be given back whole, so an empty
+		 * pageslab is the only kind worth purging.  Doing so costs us
+		 * the hugepage just like dehugifying does, so the dehugify
+		 * delay applies.
+		 */
+		purge_eligible = hpdata_empty(ps);
+		if (purge_eligible && !hpdata_purge_allowed_get(ps)
+		    && shard->opts.dehugify_delay_ms > 0) {
+			nstime_t now;
+			nstime_init_update(&now);
+			hpdata_time_purge_allowed_set(ps, &now);
+		}
+		hpdata_purge_allowed_set(ps, purge_eligible);
+		hpdata_muzzy_purge_allowed_set(ps, false);
 		hpdata_hugify_allowed_set(ps, false);
 		return;
 	}
@@ -182,8 +303,11 @@ hpa_update_purge_hugify_eligibility(hpa_shard_t *shard, hpdata_t *ps) {
 	 * is probably time-based for both purging and hugifying; only hugify a
 	 * hugepage if it's met the criteria for some extended period of time,
 	 * and only dehugify it if it's failed to meet the criteria for an
-	 * extended period of time.  When background threads are on, we should
-	 * try to take this hit on one of them, as well.
+	 * extended period of time.  That's what the hugify_delay_ms and
+	 * dehugify_delay_ms options do; we note here when a hugepage starts
+	 * (or stops) meeting the criteria, and hpa_try_hugify and
+	 * hpa_try_purge enforce the delays.  When background threads are on,
+	 * we should try to take this hit on one of them, as well.
 	 *
 	 * I think the ideal setting is THP always enabled, and defrag set to
 	 * deferred; in that case we don't need any explicit calls on the
@@ -195,92 +319,246 @@ hpa_update_purge_hugify_eligibility(hpa_shard_t *shard, hpdata_t *ps) {
 	 * overall max dirty pages setting.  That setting is 1 dirty page per 4
 	 * active pages; i.e. 4/5s of hugepage pages must be active.
 	 */
-	if ((!hpdata_huge_get(ps) && hpdata_ndirty_get(ps) > 0)
+	purge_eligible = (!hpdata_huge_get(ps)
+	    && hpdata_ndirty_get(ps) > 0)
 	    || (hpdata_ndirty_get(ps) != 0
 	    && hpdata_ndirty_get(ps) * PAGE
-	    >= shard->opts.dehugification_threshold)) {
-		hpdata_purge_allowed_set(ps, true);
+	    >= shard->opts.dehugification_threshold);
+	/*
+	 * A pretouched pageslab's dirty pages were faulted in on purpose;
+	 * purging them before it's had its chance to be hugified would just
+	 * throw that work away.  hpa_try_hugify decides, once the hugify delay
+	 * has passed, whether to keep them.
+	 */
+	if (hpdata_pretouched_get(ps)) {
+		purge_eligible = false;
 	}
-	if (hpa_good_hugification_candidate(shard, ps)
-	    && !hpdata_huge_get(ps)) {
-		hpdata_hugify_allowed_set(ps, true);
+	if (purge_eligible && !hpdata_purge_allowed_get(ps)
+	    && hpdata_huge_get(ps) && shard->opts.dehugify_delay_ms > 0) {
+		nstime_t now;
+		nstime_init_update(&now);
+		hpdata_time_purge_allowed_set(ps, &now);
 	}
+	hpdata_purge_allowed_set(ps, purge_eligible);
+	/*
+	 * Muzzy pages are cheap to keep around (the OS can take them back
+	 * whenever it likes), so any amount of them makes a candidate; the
+	 * muzzy decay curve decides how many we actually purge.
+	 */
+	hpdata_muzzy_purge_allowed_set(ps, hpdata_nmuzzy_get(ps) > 0);
+
+	/*
+	 * A pageslab that drops back below the hugification threshold has to
+	 * start its hugify delay over again once it recovers.  One we failed
+	 * to collapse waits for its allocations to change first (it's still
+	 * been advised to be huge, so the OS may yet get to it on its own).
+	 */
+	bool hugify_eligible = (hpa_good_hugification_candidate(shard, ps)
+	    || hpdata_pretouched_get(ps)) && !hpdata_huge_get(ps)
+	    && !hpdata_collapse_failed_get(ps);
+	if (hugify_eligible && !hpdata_hugify_allowed_get(ps)
+	    && shard->opts.hugify_delay_ms > 0) {
+		nstime_t now;
+		nstime_init_update(&now);
+		hpdata_time_hugify_allowed_set(ps, &now);
+	}
+	hpdata_hugify_allowed_set(ps, hugify_eligible);
+}
+
+/*
+ * The number of nanoseconds from now until delay_ms milliseconds have passed
+ * since the given start time; 0 if they already have.
+ */
+static uint64_t
+hpa_ns_until_delay_passed(const nstime_t *now, nstime_t start,
+    uint64_t delay_ms) {
+	nstime_t deadline;
+	nstime_copy(&deadline, &start);
+	nstime_iadd(&deadline, delay_ms * KQU(1000000));
+	if (nstime_compare(&deadline, now) <= 0) {
+		return 0;
+	}
+	nstime_subtract(&deadline, now);
+	return nstime_ns(&deadline);
+}
+
+/*
+ * How long until we're allowed to act on the pageslabs at the heads of the
+ * hugify and purge lists (BACKGROUND_THREAD_INDEFINITE_SLEEP if they're empty).
+ * Only the heads matter, since the lists are ordered by eligibility time.
+ */
+static uint64_t
+hpa_ns_until_hugify_allowed(hpa_shard_t *shard, hpdata_t *to_hugify) {
+	if (to_hugify == NULL) {
+		return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	}
+	if (shard->opts.hugify_delay_ms == 0) {
+		return 0;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	return hpa_ns_until_delay_passed(&now,
+	    hpdata_time_hugify_allowed_get(to_hugify),
+	    shard->opts.hugify_delay_ms);
+}
+
+static uint64_t
+hpa_ns_until_purge_allowed(hpa_shard_t *shard, hpdata_t *to_purge) {
+	if (to_purge == NULL) {
+		return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	}
+	if (!hpdata_huge_get(to_purge) || shard->opts.dehugify_delay_ms == 0) {
+		return 0;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	return hpa_ns_until_delay_passed(&now,
+	    hpdata_time_purge_allowed_get(to_purge),
+	    shard->opts.dehugify_delay_ms);
+}
+
+/*
+ * Tries to get a pageslab from the OS's explicit hugepage pool; NULL if we
+ * can't (in which case we fall back to the central).  These are mapped one at a time,
+ * since the pool is a scarce resource and mapping reserves the pages.
+ */
+static hpdata_t *
+hpa_grow_hugetlb(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_assert_owner(tsdn, &shard->grow_mtx);
+	void *addr = pages_map_hugetlb(HUGEPAGE);
+	if (addr == NULL) {
+		return NULL;
+	}
+	hpdata_t *ps = hpa_central_hpdata_alloc(tsdn, shard->central);
+	if (ps == NULL) {
+		pages_unmap(addr, HUGEPAGE);
+		return NULL;
+	}
+	hpdata_init_hugetlb(ps, addr, shard->age_counter++);
+	return ps;
 }
 
+/*
+ * Gets a pageslab from the central, which might be an empty one some other
+ * shard gave up (in which case it needn't be pristine).
+ */
 static hpdata_t *
 hpa_grow(tsdn_t *tsdn, hpa_shard_t *shard) {
 	malloc_mutex_assert_owner(tsdn, &shard->grow_mtx);
 	hpdata_t *ps = NULL;
-
-	/* Is eden a perfect fit? */
-	if (shard->eden != NULL && shard->eden_len == HUGEPAGE) {
-		ps = hpa_alloc_ps(tsdn, shard);
-		if (ps == NULL) {
-			return NULL;
-		}
-		hpdata_init(ps, shard->eden, shard->age_counter++);
-		shard->eden = NULL;
-		shard->eden_len = 0;
-		return ps;
+	if (shard->opts.hugetlb) {
+		ps = hpa_grow_hugetlb(tsdn, shard);
+	}
+	if (ps == NULL) {
+		ps = hpa_central_extract(tsdn, shard->central,
+		    shard->age_counter++);
 	}
-
 	/*
-	 * We're about to try to allocate from eden by splitting.  If eden is
-	 * NULL, we have to allocate it too.  Otherwise, we just have to
-	 * allocate an edata_t for the new psset.
+	 * Binding only steers pages faulted in from here on; a pooled pageslab
+	 * keeps whatever it already has resident.  Failure just means we get
+	 * the default policy.
 	 */
-	if (shard->eden == NULL) {
-		/*
-		 * During development, we're primarily concerned with systems
-		 * with overcommit.  Eventually, we should be more careful here.
-		 */
-		bool commit = true;
-		/* Allocate address space, bailing if we fail. */
-		void *new_eden = pages_map(NULL, HPA_EDEN_SIZE, HUGEPAGE,
-		    &commit);
-		if (new_eden == NULL) {
-			return NULL;
-		}
-		ps = hpa_alloc_ps(tsdn, shard);
-		if (ps == NULL) {
-			pages_unmap(new_eden, HPA_EDEN_SIZE);
-			return NULL;
-		}
-		shard->eden = new_eden;
-		shard->eden_len = HPA_EDEN_SIZE;
-	} else {
-		/* Eden is already nonempty; only need an edata for ps. */
-		ps = hpa_alloc_ps(tsdn, shard);
-		if (ps == NULL) {
-			return NULL;
-		}
+	if (ps != NULL && shard->numa_node >= 0) {
+		pages_numa_bind(hpdata_addr_get(ps), HUGEPAGE,
+		    (unsigned)shard->numa_node);
 	}
-	assert(ps != NULL);
-	assert(shard->eden != NULL);
-	assert(shard->eden_len > HUGEPAGE);
-	assert(shard->eden_len % HUGEPAGE == 0);
-	assert(HUGEPAGE_ADDR2BASE(shard->eden) == shard->eden);
+	return ps;
+}
 
-	hpdata_init(ps, shard->eden, shard->age_counter++);
+/*
+ * Gathers up the dirty ranges of the pageslabs being purged, so that we can
+ * hand them to the OS a batch at a time rather than one by one.  Lazy purges
+ * can't be batched, but we still funnel them through here to share the logic.
+ */
+typedef struct hpa_range_accum_s hpa_range_accum_t;
+struct hpa_range_accum_s {
+	pages_range_t ranges[PAGES_PURGE_BATCH_MAX];
+	size_t nranges;
+	bool lazy;
+	uint64_t nsyscalls;
+};
 
-	char *eden_char = (char *)shard->eden;
-	eden_char += HUGEPAGE;
-	shard->eden = (void *)eden_char;
-	shard->eden_len -= HUGEPAGE;
+static void
+hpa_range_accum_init(hpa_range_accum_t *accum, bool lazy) {
+	accum->nranges = 0;
+	accum->lazy = lazy;
+	accum->nsyscalls = 0;
+}
 
-	return ps;
+static void
+hpa_range_accum_flush(hpa_range_accum_t *accum) {
+	if (!accum->lazy) {
+		accum->nsyscalls += pages_purge_forced_batch(accum->ranges,
+		    accum->nranges);
+		accum->nranges = 0;
+		return;
+	}
+	for (size_t i = 0; i < accum->nranges; i++) {
+		accum->nsyscalls++;
+		if (pages_purge_lazy(accum->ranges[i].addr,
+		    accum->ranges[i].size)) {
+			/*
+			 * The pages still get marked muzzy; purging them
+			 * forcibly again later is harmless.
+			 */
+			accum->nsyscalls++;
+			pages_purge_forced(accum->ranges[i].addr,
+			    accum->ranges[i].size);
+		}
+	}
+	accum->nranges = 0;
 }
 
-/* Returns whether or not we purged anything. */
-static bool
-hpa_try_purge(tsdn_t *tsdn, hpa_shard_t *shard) {
-	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+static void
+hpa_range_accum_add(hpa_range_accum_t *accum, void *addr, size_t size) {
+	if (accum->nranges > 0) {
+		/* Ranges that meet across a pageslab boundary can merge. */
+		pages_range_t *last = &accum->ranges[accum->nranges - 1];
+		if ((uintptr_t)last->addr + last->size == (uintptr_t)addr) {
+			last->size += size;
+			return;
+		}
+	}
+	if (accum->nranges == PAGES_PURGE_BATCH_MAX) {
+		hpa_range_accum_flush(accum);
+	}
+	accum->ranges[accum->nranges].addr = addr;
+	accum->ranges[accum->nranges].size = size;
+	accum->nranges++;
+}
 
-	hpdata_t *to_purge = psset_pick_purge(&shard->psset);
-	if (to_purge == NULL) {
+/* The most pageslabs we'll purge in one go (i.e. per lock drop). */
+#define HPA_PURGE_BATCH_MAX_SLABS 8
+
+typedef struct hpa_purge_item_s hpa_purge_item_t;
+struct hpa_purge_item_s {
+	hpdata_t *ps;
+	hpdata_purge_kind_t kind;
+	bool dehugify;
+	/*
+	 * Whether we're handing the (empty, hugetlb) pageslab's hugepage back
+	 * to the OS wholesale; if so, purge_state goes unused.
+	 */
+	bool release;
+	size_t num_to_purge;
+	hpdata_purge_state_t purge_state;
+};
+
+/*
+ * Marks the next purge candidate (for purging its dirty or, if muzzy is set,
+ * its muzzy pages) as mid-purge and gathers the metadata we'll need to purge
+ * it with the lock dropped.  Returns false if there's no candidate we're
+ * allowed to purge yet.
+ */
+static bool
+hpa_purge_start(hpa_shard_t *shard, hpa_purge_item_t *item, bool muzzy) {
+	hpdata_t *to_purge = muzzy ? psset_pick_purge_muzzy(&shard->psset)
+	    : psset_pick_purge(&shard->psset);
+	if (hpa_ns_until_purge_allowed(shard, to_purge) != 0) {
 		return false;
 	}
-	assert(hpdata_purge_allowed_get(to_purge));
+	assert(muzzy ? hpdata_muzzy_purge_allowed_get(to_purge)
+	    : hpdata_purge_allowed_get(to_purge));
 	assert(!hpdata_changing_state_get(to_purge));
 
 	/*
@@ -292,6 +570,7 @@ hpa_try_purge(tsdn_t *tsdn, hpa_shard_t *shard) {
 	assert(hpdata_alloc_allowed_get(to_purge));
 	hpdata_mid_purge_set(to_purge, true);
 	hpdata_purge_allowed_set(to_purge, false);
+	hpdata_muzzy_purge_allowed_set(to_purge, false);
 	hpdata_hugify_allowed_set(to_purge, false);
 	/*
 	 * Unlike with hugification (where concurrent
@@ -303,68 +582,240 @@ hpa_try_purge(tsdn_t *tsdn, hpa_shard_t *shard) {
 	hpdata_alloc_allowed_set(to_purge, false);
 	psset_update_end(&shard->psset, to_purge);
 
-	/* Gather all the metadata we'll need during the purge. */
-	bool dehugify = hpdata_huge_get(to_purge);
-	hpdata_purge_state_t purge_state;
-	size_t num_to_purge = hpdata_purge_begin(to_purge, &purge_state);
-
-	shard->npending_purge += num_to_purge;
-
-	malloc_mutex_unlock(tsdn, &shard->mtx);
-
-	/* Actually do the purging, now that the lock is dropped. */
-	if (dehugify) {
-		pages_nohuge(hpdata_addr_get(to_purge), HUGEPAGE);
+	if (muzzy) {
+		item->kind = hpdata_purge_muzzy;
+	} else if (hpa_purge_lazy(shard)) {
+		item->kind = hpdata_purge_dirty_lazy;
+	} else {
+		item->kind = hpdata_purge_dirty_forced;
 	}
-	size_t total_purged = 0;
-	uint64_t purges_this_pass = 0;
-	void *purge_addr;
-	size_t purge_size;
-	while (hpdata_purge_next(to_purge, &purge_state, &purge_addr,
-	    &purge_size)) {
-		total_purged += purge_size;
-		assert(total_purged <= HUGEPAGE);
-		purges_this_pass++;
-		pages_purge_forced(purge_addr, purge_size);
+	item->ps = to_purge;
+	item->release = hpdata_hugetlb_get(to_purge);
+	if (item->release) {
+		assert(hpdata_empty(to_purge));
+		assert(!muzzy);
+		item->dehugify = false;
+		item->num_to_purge = hpdata_ndirty_get(to_purge);
+	} else {
+		item->dehugify = hpdata_huge_get(to_purge);
+		item->num_to_purge = hpdata_purge_begin(to_purge,
+		    &item->purge_state, item->kind);
 	}
 
-	malloc_mutex_lock(tsdn, &shard->mtx);
+	if (muzzy) {
+		shard->npending_purge_muzzy += item->num_to_purge;
+	} else {
+		shard->npending_purge += item->num_to_purge;
+	}
+	return true;
+}
+
+static void
+hpa_purge_finish(tsdn_t *tsdn, hpa_shard_t *shard, hpa_purge_item_t *item,
+    const nstime_t *now) {
+	hpdata_t *to_purge = item->ps;
+
 	/* The shard updates */
-	shard->npending_purge -= num_to_purge;
+	if (item->kind == hpdata_purge_muzzy) {
+		shard->npending_purge_muzzy -= item->num_to_purge;
+	} else {
+		shard->npending_purge -= item->num_to_purge;
+	}
 	shard->stats.npurge_passes++;
-	shard->stats.npurges += purges_this_pass;
-	if (dehugify) {
+	shard->stats.npurged += item->num_to_purge;
+	if (item->dehugify) {
 		shard->stats.ndehugifies++;
+		if (hpa_ns_until_delay_passed(now,
+		    hpdata_time_hugified_get(to_purge),
+		    HPA_DEHUGIFY_EARLY_MS) != 0) {
+			shard->stats.ndehugifies_early++;
+		}
+	}
+
+	if (item->release) {
+		/* The hugepage is gone; keep the metadata for a later grow. */
+		psset_remove(&shard->psset, to_purge);
+		hpa_central_release(tsdn, shard->central, to_purge,
+		    /* unmapped */ true);
+		return;
 	}
 
 	/* The hpdata updates. */
 	psset_update_begin(&shard->psset, to_purge);
-	if (dehugify) {
+	if (item->dehugify) {
 		hpdata_dehugify(to_purge);
 	}
-	hpdata_purge_end(to_purge, &purge_state);
+	hpdata_purge_end(to_purge, &item->purge_state);
 	hpdata_mid_purge_set(to_purge, false);
 
 	hpdata_alloc_allowed_set(to_purge, true);
 	hpa_update_purge_hugify_eligibility(shard, to_purge);
 
 	psset_update_end(&shard->psset, to_purge);
+}
+
+/*
+ * Purges a batch of pageslabs (the first of which the caller has decided we
+ * should purge; we take more only while hpa_should_purge, or
+ * hpa_should_purge_muzzy if we're purging muzzy pages, still says so), with
+ * the lock dropped.  Returns the number of pageslabs purged.
+ */
+static size_t
+hpa_try_purge(tsdn_t *tsdn, hpa_shard_t *shard, bool muzzy,
+    bool decay_epoch_advanced) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+
+	hpa_purge_item_t items[HPA_PURGE_BATCH_MAX_SLABS];
+	size_t nitems = 0;
+	do {
+		if (!hpa_purge_start(shard, &items[nitems], muzzy)) {
+			break;
+		}
+		nitems++;
+	} while (nitems < HPA_PURGE_BATCH_MAX_SLABS
+	    && (muzzy ? hpa_should_purge_muzzy(shard, decay_epoch_advanced)
+	    : hpa_should_purge(shard, decay_epoch_advanced)));
+	if (nitems == 0) {
+		return 0;
+	}
+
+	malloc_mutex_unlock(tsdn, &shard->mtx);
 
+	/* Actually do the purging, now that the lock is dropped. */
+	hpa_range_accum_t accum;
+	hpa_range_accum_init(&accum,
+	    items[0].kind == hpdata_purge_dirty_lazy);
+	uint64_t npurges = 0;
+	uint64_t nreleases = 0;
+	bool any_dehugify = false;
+	for (size_t i = 0; i < nitems; i++) {
+		hpa_purge_item_t *item = &items[i];
+		if (item->release) {
+			pages_unmap(hpdata_addr_get(item->ps), HUGEPAGE);
+			nreleases++;
+			continue;
+		}
+		if (item->dehugify) {
+			pages_nohuge(hpdata_addr_get(item->ps), HUGEPAGE);
+			any_dehugify = true;
+		}
+		size_t total_purged = 0;
+		void *purge_addr;
+		size_t purge_size;
+		while (hpdata_purge_next(item->ps, &item->purge_state,
+		    &purge_addr, &purge_size)) {
+			total_purged += purge_size;
+			assert(total_purged <= HUGEPAGE);
+			npurges++;
+			hpa_range_accum_add(&accum, purge_addr, purge_size);
+		}
+	}
+	hpa_range_accum_flush(&accum);
+	nstime_t now;
+	if (any_dehugify) {
+		nstime_init_update(&now);
+	} else {
+		nstime_init_zero(&now);
+	}
+
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	/* Each release is a purge of its own, done with one munmap. */
+	shard->stats.npurges += npurges + nreleases;
+	shard->stats.npurge_syscalls += accum.nsyscalls + nreleases;
+	for (size_t i = 0; i < nitems; i++) {
+		hpa_purge_finish(tsdn, shard, &items[i], &now);
+	}
+
+	return nitems;
+}
+
+static bool
+hpa_should_release_empty(hpa_shard_t *shard) {
+	return psset_nempty(&shard->psset) > shard->opts.empty_max;
+}
+
+/*
+ * Gives up the longest-empty pageslab, with the lock dropped.  If the central
+ * pool has room for it, it gets purged and goes there, for any shard to reuse.
+ * Otherwise, we hand it back to the OS: without opt_retain (or for an explicit
+ * hugepage, which we can't purge safely), that means unmapping it; otherwise,
+ * we dehugify and purge it, and the central keeps the address space.  Returns
+ * whether or not we gave anything up.
+ */
+static bool
+hpa_try_release_empty(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+
+	hpdata_t *to_release = psset_pick_release(&shard->psset);
+	/* A pageslab mid-hugify can become empty; leave it be. */
+	if (to_release == NULL || hpdata_changing_state_get(to_release)) {
+		return false;
+	}
+	assert(hpdata_empty(to_release));
+	/*
+	 * Once it's out of the psset, nobody else can get at it; it has no
+	 * allocations for anyone to free.  Whoever gets it next decides what
+	 * it's eligible for.
+	 */
+	psset_remove(&shard->psset, to_release);
+	hpdata_purge_allowed_set(to_release, false);
+	hpdata_muzzy_purge_allowed_set(to_release, false);
+	hpdata_hugify_allowed_set(to_release, false);
+	shard->stats.nempty_releases++;
+
+	bool unmap = !opt_retain || hpdata_hugetlb_get(to_release);
+	bool dehugify = !unmap && hpdata_huge_get(to_release);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	bool pooled = !hpa_central_insert(tsdn, shard->central, to_release);
+	if (!pooled) {
+		void *addr = hpdata_addr_get(to_release);
+		if (unmap) {
+			pages_unmap(addr, HUGEPAGE);
+		} else {
+			if (dehugify) {
+				pages_nohuge(addr, HUGEPAGE);
+			}
+			pages_purge_forced(addr, HUGEPAGE);
+		}
+		hpa_central_release(tsdn, shard->central, to_release, unmap);
+	}
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	if (pooled) {
+		shard->stats.nempty_pooled++;
+	}
 	return true;
 }
 
-/* Returns whether or not we hugified anything. */
+/*
+ * Returns whether or not we hugified anything (or settled what to do with a
+ * pretouched pageslab's pages).  forced says whether we're
+ * doing deferred work on behalf of the background thread, where we can afford
+ * to collapse synchronously.
+ */
 static bool
-hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
+hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard, bool forced) {
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 
 	hpdata_t *to_hugify = psset_pick_hugify(&shard->psset);
-	if (to_hugify == NULL) {
+	if (hpa_ns_until_hugify_allowed(shard, to_hugify) != 0) {
 		return false;
 	}
 	assert(hpdata_hugify_allowed_get(to_hugify));
 	assert(!hpdata_changing_state_get(to_hugify));
 
+	if (hpdata_pretouched_get(to_hugify)
+	    && !hpa_good_hugification_candidate(shard, to_hugify)) {
+		/*
+		 * It didn't fill up within its hugify delay; whatever of its
+		 * prefaulted pages went unused are just dirty pages now.
+		 */
+		psset_update_begin(&shard->psset, to_hugify);
+		hpdata_pretouched_set(to_hugify, false);
+		hpa_update_purge_hugify_eligibility(shard, to_hugify);
+		psset_update_end(&shard->psset, to_hugify);
+		return true;
+	}
+
 	/*
 	 * Don't let anyone else purge or hugify this page while
 	 * we're hugifying it (allocations and deallocations are
@@ -373,10 +824,14 @@ hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
 	psset_update_begin(&shard->psset, to_hugify);
 	hpdata_mid_hugify_set(to_hugify, true);
 	hpdata_purge_allowed_set(to_hugify, false);
+	hpdata_muzzy_purge_allowed_set(to_hugify, false);
 	hpdata_hugify_allowed_set(to_hugify, false);
 	assert(hpdata_alloc_allowed_get(to_hugify));
 	psset_update_end(&shard->psset, to_hugify);
 
+	bool collapse = forced && shard->opts.hugify_sync
+	    && pages_collapse_supported();
+
 	malloc_mutex_unlock(tsdn, &shard->mtx);
 
 	bool err = pages_huge(hpdata_addr_get(to_hugify),
@@ -388,12 +843,38 @@ hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
 	 * Just eat the error and pretend we were successful.
 	 */
 	(void)err;
+	/*
+	 * A collapse, on the other hand, tells us for sure whether we got the
+	 * hugepage.
+	 */
+	bool collapse_failed = collapse
+	    && pages_collapse(hpdata_addr_get(to_hugify), HUGEPAGE);
+
+	nstime_t now;
+	nstime_init_update(&now);
 
 	malloc_mutex_lock(tsdn, &shard->mtx);
+	if (collapse_failed) {
+		shard->stats.nhugify_failures++;
+		/*
+		 * Leave it nonhuge; it becomes a hugification candidate again
+		 * (with its delay starting over) once something is allocated
+		 * from or freed to it.  Don't report it as progress, so the
+		 * caller doesn't keep retrying it.
+		 */
+		psset_update_begin(&shard->psset, to_hugify);
+		hpdata_mid_hugify_set(to_hugify, false);
+		hpdata_pretouched_set(to_hugify, false);
+		hpdata_collapse_failed_set(to_hugify, true);
+		hpa_update_purge_hugify_eligibility(shard, to_hugify);
+		psset_update_end(&shard->psset, to_hugify);
+		return false;
+	}
 	shard->stats.nhugifies++;
 
 	psset_update_begin(&shard->psset, to_hugify);
 	hpdata_hugify(to_hugify);
+	hpdata_time_hugified_set(to_hugify, &now);
 	hpdata_mid_hugify_set(to_hugify, false);
 	hpa_update_purge_hugify_eligibility(shard, to_hugify);
 	psset_update_end(&shard->psset, to_hugify);
@@ -401,33 +882,70 @@ hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
 	return true;
 }
 
+/*
+ * Does purging and hugification work.  When called on an allocation or
+ * deallocation pathway (forced == false), we skip the work entirely if it can
+ * be deferred to the background thread.
+ */
 static void
-hpa_do_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard) {
+hpa_shard_maybe_do_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard,
+    bool forced) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	if (!forced && shard->opts.deferral_allowed) {
+		return;
+	}
+	/*
+	 * Inline, we do at most some fixed number of operations, to impose a
+	 * worst-case latency bound.  On a background thread, we keep going so
+	 * long as there's work to do, but only touch each pageslab a couple of
+	 * times; an unfortunate combination of hugification and
+	 * dehugification thresholds could otherwise keep us cycling forever.
+	 */
+	size_t max_ops = (forced ? 2 * psset_npageslabs(&shard->psset) + 1
+	    : 100);
+	size_t nops = 0;
+	bool decay_epoch_advanced = hpa_maybe_advance_decay_epoch(tsdn, shard,
+	    &shard->decay, hpa_adjusted_ndirty(shard));
+	bool muzzy_decay_epoch_advanced = hpa_maybe_advance_decay_epoch(tsdn,
+	    shard, &shard->muzzy_decay, hpa_adjusted_nmuzzy(shard));
 	bool hugified;
-	bool purged;
-	size_t nloop = 0;
-	/* Just *some* bound, to impose a worst-case latency bound. */
-	size_t maxloops = 100;;
+	bool released;
+	size_t npurged;
 	do {
 		malloc_mutex_assert_owner(tsdn, &shard->mtx);
-		hugified = hpa_try_hugify(tsdn, shard);
+		hugified = hpa_try_hugify(tsdn, shard, forced);
+
+		/* Get rid of excess empties before bothering to purge them. */
+		released = hpa_should_release_empty(shard)
+		    && hpa_try_release_empty(tsdn, shard);
 
-		purged = false;
-		if (hpa_should_purge(shard)) {
-			purged = hpa_try_purge(tsdn, shard);
+		npurged = 0;
+		if (hpa_should_purge(shard, decay_epoch_advanced)) {
+			npurged = hpa_try_purge(tsdn, shard, /* muzzy */ false,
+			    decay_epoch_advanced);
+		}
+		if (hpa_should_purge_muzzy(shard, muzzy_decay_epoch_advanced)) {
+			npurged += hpa_try_purge(tsdn, shard, /* muzzy */ true,
+			    muzzy_decay_epoch_advanced);
 		}
 		malloc_mutex_assert_owner(tsdn, &shard->mtx);
-	} while ((hugified || purged) && nloop++ < maxloops);
+		nops += (size_t)hugified + (size_t)released + npurged;
+	} while ((hugified || released || npurged > 0) && nops < max_ops);
+
+	if (forced) {
+		shard->stats.ndeferred_background += nops;
+	} else {
+		shard->stats.ndeferred_inline += nops;
+	}
 }
 
 static edata_t *
-hpa_try_alloc_no_grow(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, bool *oom) {
+hpa_try_alloc_one_no_grow(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
+    bool *oom) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 	bool err;
-	malloc_mutex_lock(tsdn, &shard->mtx);
 	edata_t *edata = edata_cache_small_get(tsdn, &shard->ecs);
-	*oom = false;
 	if (edata == NULL) {
-		malloc_mutex_unlock(tsdn, &shard->mtx);
 		*oom = true;
 		return NULL;
 	}
@@ -436,7 +954,6 @@ hpa_try_alloc_no_grow(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, bool *oom)
 	hpdata_t *ps = psset_pick_alloc(&shard->psset, size);
 	if (ps == NULL) {
 		edata_cache_small_put(tsdn, &shard->ecs, edata);
-		malloc_mutex_unlock(tsdn, &shard->mtx);
 		return NULL;
 	}
 
@@ -483,30 +1000,56 @@ hpa_try_alloc_no_grow(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, bool *oom)
 		 */
 		psset_update_end(&shard->psset, ps);
 		edata_cache_small_put(tsdn, &shard->ecs, edata);
-		malloc_mutex_unlock(tsdn, &shard->mtx);
 		*oom = true;
 		return NULL;
 	}
 
 	hpa_update_purge_hugify_eligibility(shard, ps);
 	psset_update_end(&shard->psset, ps);
+	return edata;
+}
 
-	hpa_do_deferred_work(tsdn, shard);
-	malloc_mutex_unlock(tsdn, &shard->mtx);
+static size_t
+hpa_try_alloc_batch_no_grow_locked(tsdn_t *tsdn, hpa_shard_t *shard,
+    size_t size, bool *oom, size_t nallocs, edata_list_active_t *results) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	size_t nsuccess = 0;
+	for (; nsuccess < nallocs; nsuccess++) {
+		edata_t *edata = hpa_try_alloc_one_no_grow(tsdn, shard, size,
+		    oom);
+		if (edata == NULL) {
+			break;
+		}
+		edata_list_active_append(results, edata);
+	}
+	return nsuccess;
+}
 
-	return edata;
+static size_t
+hpa_try_alloc_batch_no_grow(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
+    bool *oom, size_t nallocs, edata_list_active_t *results) {
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	size_t nsuccess = hpa_try_alloc_batch_no_grow_locked(tsdn, shard, size,
+	    oom, nallocs, results);
+	if (nsuccess > 0) {
+		hpa_shard_maybe_do_deferred_work(tsdn, shard,
+		    /* forced */ false);
+	}
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	return nsuccess;
 }
 
-static edata_t *
-hpa_alloc_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size) {
+static size_t
+hpa_alloc_batch_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
+    size_t nallocs, edata_list_active_t *results) {
 	assert(size <= shard->opts.slab_max_alloc);
-	bool err;
-	bool oom;
-	edata_t *edata;
+	bool oom = false;
+
+	size_t nsuccess = hpa_try_alloc_batch_no_grow(tsdn, shard, size, &oom,
+	    nallocs, results);
 
-	edata = hpa_try_alloc_no_grow(tsdn, shard, size, &oom);
-	if (edata != NULL) {
-		return edata;
+	if (nsuccess == nallocs || oom) {
+		return nsuccess;
 	}
 
 	/* Nothing in the psset works; we have to grow it. */
@@ -515,10 +1058,11 @@ hpa_alloc_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size) {
 	 * Check for grow races; maybe some earlier thread expanded the psset
 	 * in between when we dropped the main mutex and grabbed the grow mutex.
 	 */
-	edata = hpa_try_alloc_no_grow(tsdn, shard, size, &oom);
-	if (edata != NULL || oom) {
+	nsuccess += hpa_try_alloc_batch_no_grow(tsdn, shard, size, &oom,
+	    nallocs - nsuccess, results);
+	if (nsuccess == nallocs || oom) {
 		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
-		return edata;
+		return nsuccess;
 	}
 
 	/*
@@ -529,121 +1073,107 @@ hpa_alloc_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size) {
 	hpdata_t *ps = hpa_grow(tsdn, shard);
 	if (ps == NULL) {
 		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
-		return NULL;
-	}
-
-	/* We got the pageslab; allocate from it. */
-	malloc_mutex_lock(tsdn, &shard->mtx);
-
-	psset_insert(&shard->psset, ps);
-
-	edata = edata_cache_small_get(tsdn, &shard->ecs);
-	if (edata == NULL) {
-		malloc_mutex_unlock(tsdn, &shard->mtx);
-		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
-		return NULL;
+		return nsuccess;
 	}
 
 	/*
-	 * TODO: the tail of this function is quite similar to the tail of
-	 * hpa_try_alloc_no_grow (both, broadly, do the metadata management of
-	 * initializing an edata_t from an hpdata_t once both have been
-	 * allocated).  The only differences are in error case handling and lock
-	 * management (we hold grow_mtx, but should drop it before doing any
-	 * deferred work).  With a little refactoring, we could unify the paths.
+	 * We got the pageslab; allocate from it.  This does an unlock followed
+	 * by a lock on the same mutex, and holds the grow mutex while doing
+	 * deferred work, but this is an uncommon path; the simplicity is worth
+	 * it.
 	 */
-	psset_update_begin(&shard->psset, ps);
-
-	void *addr = hpdata_reserve_alloc(ps, size);
-	edata_init(edata, shard->ind, addr, size, /* slab */ false,
-	    SC_NSIZES, /* sn */ 0, extent_state_active, /* zeroed */ false,
-	    /* committed */ true, EXTENT_PAI_HPA, EXTENT_NOT_HEAD);
-	edata_ps_set(edata, ps);
-
-	err = emap_register_boundary(tsdn, shard->emap, edata,
-	    SC_NSIZES, /* slab */ false);
-	if (err) {
-		hpdata_unreserve(ps, edata_addr_get(edata),
-		    edata_size_get(edata));
-
-		edata_cache_small_put(tsdn, &shard->ecs, edata);
-
-		/* We'll do a fake purge; the pages weren't really touched. */
-		hpdata_purge_state_t purge_state;
-		void *purge_addr;
-		size_t purge_size;
-		hpdata_purge_begin(ps, &purge_state);
-		bool found_extent = hpdata_purge_next(ps, &purge_state,
-		    &purge_addr, &purge_size);
-		assert(found_extent);
-		assert(purge_addr == addr);
-		assert(purge_size == size);
-		found_extent = hpdata_purge_next(ps, &purge_state,
-		    &purge_addr, &purge_size);
-		assert(!found_extent);
-		hpdata_purge_end(ps, &purge_state);
-
-		psset_update_end(&shard->psset, ps);
-		malloc_mutex_unlock(tsdn, &shard->mtx);
-		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
-		return NULL;
-	}
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	hpdata_shard_set(ps, shard);
 	hpa_update_purge_hugify_eligibility(shard, ps);
-	psset_update_end(&shard->psset, ps);
-
+	psset_insert(&shard->psset, ps);
+	nsuccess += hpa_try_alloc_batch_no_grow_locked(tsdn, shard, size, &oom,
+	    nallocs - nsuccess, results);
 	/*
 	 * Drop grow_mtx before doing deferred work; other threads blocked on it
 	 * should be allowed to proceed while we're working.
 	 */
 	malloc_mutex_unlock(tsdn, &shard->grow_mtx);
 
-	hpa_do_deferred_work(tsdn, shard);
-
+	hpa_shard_maybe_do_deferred_work(tsdn, shard, /* forced */ false);
 	malloc_mutex_unlock(tsdn, &shard->mtx);
-	return edata;
+
+	return nsuccess;
 }
 
 static hpa_shard_t *
 hpa_from_pai(pai_t *self) {
 	assert(self->alloc = &hpa_alloc);
+	assert(self->alloc_batch = &hpa_alloc_batch);
 	assert(self->expand = &hpa_expand);
 	assert(self->shrink = &hpa_shrink);
 	assert(self->dalloc = &hpa_dalloc);
+	assert(self->dalloc_batch = &hpa_dalloc_batch);
 	return (hpa_shard_t *)self;
 }
 
-static edata_t *
-hpa_alloc(tsdn_t *tsdn, pai_t *self, size_t size,
-    size_t alignment, bool zero) {
+static size_t
+hpa_alloc_batch(tsdn_t *tsdn, pai_t *self, size_t size, size_t nallocs,
+    edata_list_active_t *results) {
+	assert(nallocs > 0);
 	assert((size & PAGE_MASK) == 0);
 	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
 	    WITNESS_RANK_CORE, 0);
-
 	hpa_shard_t *shard = hpa_from_pai(self);
-	/* We don't handle alignment or zeroing for now. */
-	if (alignment > PAGE || zero) {
-		return NULL;
-	}
+
 	if (size > shard->opts.slab_max_alloc) {
-		return NULL;
+		return 0;
 	}
 
-	edata_t *edata = hpa_alloc_psset(tsdn, shard, size);
+	size_t nsuccess = hpa_alloc_batch_psset(tsdn, shard, size, nallocs,
+	    results);
+
+	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
+	    WITNESS_RANK_CORE, 0);
+
+	/*
+	 * Guard the sanity checks with config_debug because the loop cannot be
+	 * proven non-circular by the compiler, even if everything within the
+	 * loop is optimized away.
+	 */
+	if (config_debug) {
+		edata_t *edata;
+		ql_foreach(edata, &results->head, ql_link_active) {
+			emap_assert_mapped(tsdn, shard->emap, edata);
+			assert(edata_pai_get(edata) == EXTENT_PAI_HPA);
+			assert(edata_state_get(edata) == extent_state_active);
+			assert(edata_arena_ind_get(edata) == shard->ind);
+			assert(edata_szind_get_maybe_invalid(edata) ==
+			    SC_NSIZES);
+			assert(!edata_slab_get(edata));
+			assert(edata_committed_get(edata));
+			assert(edata_base_get(edata) == edata_addr_get(edata));
+			assert(edata_base_get(edata) != NULL);
+		}
+	}
+	return nsuccess;
+}
 
+static edata_t *
+hpa_alloc(tsdn_t *tsdn, pai_t *self, size_t size,
+    size_t alignment, bool zero) {
+	assert((size & PAGE_MASK) == 0);
 	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
 	    WITNESS_RANK_CORE, 0);
 
-	if (edata != NULL) {
-		emap_assert_mapped(tsdn, shard->emap, edata);
-		assert(edata_pai_get(edata) == EXTENT_PAI_HPA);
-		assert(edata_state_get(edata) == extent_state_active);
-		assert(edata_arena_ind_get(edata) == shard->ind);
-		assert(edata_szind_get_maybe_invalid(edata) == SC_NSIZES);
-		assert(!edata_slab_get(edata));
-		assert(edata_committed_get(edata));
-		assert(edata_base_get(edata) == edata_addr_get(edata));
-		assert(edata_base_get(edata) != NULL);
+	/* We don't handle alignment or zeroing for now. */
+	if (alignment > PAGE || zero) {
+		return NULL;
 	}
+	/*
+	 * An alloc with alignment == PAGE and zero == false is equivalent to a
+	 * batch alloc of 1.  Just do that, so we can share code.
+	 */
+	edata_list_active_t results;
+	edata_list_active_init(&results);
+	size_t nallocs = hpa_alloc_batch(tsdn, self, size, /* nallocs */ 1,
+	    &results);
+	assert(nallocs == 0 || nallocs == 1);
+	edata_t *edata = edata_list_active_first(&results);
 	return edata;
 }
 
@@ -662,8 +1192,8 @@ hpa_shrink(tsdn_t *tsdn, pai_t *self, edata_t *edata,
 }
 
 static void
-hpa_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata) {
-	hpa_shard_t *shard = hpa_from_pai(self);
+hpa_dalloc_prepare_unlocked(tsdn_t *tsdn, hpa_shard_t *shard, edata_t *edata) {
+	malloc_mutex_assert_not_owner(tsdn, &shard->mtx);
 
 	edata_addr_set(edata, edata_base_get(edata));
 	edata_zeroed_set(edata, false);
@@ -676,33 +1206,159 @@ hpa_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata) {
 	assert(edata_committed_get(edata));
 	assert(edata_base_get(edata) != NULL);
 
-	hpdata_t *ps = edata_ps_get(edata);
-	/* Currently, all edatas come from pageslabs. */
-	assert(ps != NULL);
 	emap_deregister_boundary(tsdn, shard->emap, edata);
-	/*
-	 * Note that the shard mutex protects ps's metadata too; it wouldn't be
-	 * correct to try to read most information out of it without the lock.
-	 */
-	malloc_mutex_lock(tsdn, &shard->mtx);
+}
+
+static void
+hpa_dalloc_locked(tsdn_t *tsdn, hpa_shard_t *shard, edata_t *edata) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 
 	/*
 	 * Release the metadata early, to avoid having to remember to do it
-	 * while we're also doing tricky purging logic.
+	 * while we're also doing tricky purging logic.  First, we need to grab
+	 * a few bits of metadata from it.
+	 *
+	 * Note that the shard mutex protects ps's metadata too; it wouldn't be
+	 * correct to try to read most information out of it without the lock.
 	 */
+	hpdata_t *ps = edata_ps_get(edata);
+	/* Currently, all edatas come from pageslabs. */
+	assert(ps != NULL);
+	assert(hpdata_shard_get(ps) == shard);
 	void *unreserve_addr = edata_addr_get(edata);
 	size_t unreserve_size = edata_size_get(edata);
 	edata_cache_small_put(tsdn, &shard->ecs, edata);
 
 	psset_update_begin(&shard->psset, ps);
 	hpdata_unreserve(ps, unreserve_addr, unreserve_size);
-
 	hpa_update_purge_hugify_eligibility(shard, ps);
 	psset_update_end(&shard->psset, ps);
+}
 
-	hpa_do_deferred_work(tsdn, shard);
+static void
+hpa_dalloc_batch(tsdn_t *tsdn, pai_t *self, edata_list_active_t *list) {
+	hpa_shard_t *shard = hpa_from_pai(self);
 
+	edata_t *edata;
+	ql_foreach(edata, &list->head, ql_link_active) {
+		hpa_dalloc_prepare_unlocked(tsdn, shard, edata);
+	}
+
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	/* Now, remove from the list. */
+	while ((edata = edata_list_active_first(list)) != NULL) {
+		edata_list_active_remove(list, edata);
+		hpa_dalloc_locked(tsdn, shard, edata);
+	}
+	hpa_shard_maybe_do_deferred_work(tsdn, shard, /* forced */ false);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+}
+
+static void
+hpa_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata) {
+	/* Just a dalloc_batch of size 1; this lets us share logic. */
+	edata_list_active_t dalloc_list;
+	edata_list_active_init(&dalloc_list);
+	edata_list_active_append(&dalloc_list, edata);
+	hpa_dalloc_batch(tsdn, self, &dalloc_list);
+}
+
+ssize_t
+hpa_shard_dirty_decay_ms_get(hpa_shard_t *shard) {
+	return decay_ms_read(&shard->decay);
+}
+
+bool
+hpa_shard_dirty_decay_ms_set(tsdn_t *tsdn, hpa_shard_t *shard,
+    ssize_t decay_ms) {
+	if (!decay_ms_valid(decay_ms)) {
+		return true;
+	}
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	nstime_t cur_time;
+	nstime_init_update(&cur_time);
+	decay_reinit(&shard->decay, &cur_time, decay_ms);
+	/* Pick up a newly shortened decay time right away if we can. */
+	hpa_shard_maybe_do_deferred_work(tsdn, shard, /* forced */ false);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	return false;
+}
+
+void
+hpa_shard_set_deferral_allowed(tsdn_t *tsdn, hpa_shard_t *shard,
+    bool deferral_allowed) {
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	bool deferral_previously_allowed = shard->opts.deferral_allowed;
+	shard->opts.deferral_allowed = deferral_allowed;
+	if (deferral_previously_allowed && !deferral_allowed) {
+		/*
+		 * Nobody is going to come along and do the work we'd been
+		 * putting off; catch up now.
+		 */
+		hpa_shard_maybe_do_deferred_work(tsdn, shard,
+		    /* forced */ true);
+	}
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+}
+
+void
+hpa_shard_do_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	hpa_shard_maybe_do_deferred_work(tsdn, shard, /* forced */ true);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	hpa_central_pretouch(tsdn, shard->central);
+}
+
+/*
+ * How long until the next epoch of decay is due, if it's tracking any pages
+ * (BACKGROUND_THREAD_INDEFINITE_SLEEP otherwise).
+ */
+static uint64_t
+hpa_ns_until_decay_epoch(decay_t *decay, size_t npages) {
+	if (decay_ms_read(decay) <= 0 || npages == 0) {
+		return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	return hpa_ns_until_delay_passed(&now, decay->deadline,
+	    /* delay_ms */ 0);
+}
+
+uint64_t
+hpa_shard_time_until_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	uint64_t time_ns = hpa_ns_until_hugify_allowed(shard,
+	    psset_pick_hugify(&shard->psset));
+	if (hpa_should_purge(shard, /* decay_epoch_advanced */ false)) {
+		uint64_t purge_ns = hpa_ns_until_purge_allowed(shard,
+		    psset_pick_purge(&shard->psset));
+		if (purge_ns < time_ns) {
+			time_ns = purge_ns;
+		}
+	}
+	if (hpa_should_purge_muzzy(shard, /* decay_epoch_advanced */ false)) {
+		/* Muzzy pageslabs are never huge, so there's no delay. */
+		time_ns = 0;
+	}
+	if (hpa_should_release_empty(shard)) {
+		time_ns = 0;
+	}
+	if (hpa_central_pretouch_pending(shard->central)) {
+		time_ns = 0;
+	}
+	/* Come back when the next decay epoch is due. */
+	uint64_t decay_ns = hpa_ns_until_decay_epoch(&shard->decay,
+	    hpa_adjusted_ndirty(shard));
+	if (decay_ns < time_ns) {
+		time_ns = decay_ns;
+	}
+	decay_ns = hpa_ns_until_decay_epoch(&shard->muzzy_decay,
+	    hpa_adjusted_nmuzzy(shard));
+	if (decay_ns < time_ns) {
+		time_ns = decay_ns;
+	}
 	malloc_mutex_unlock(tsdn, &shard->mtx);
+	return time_ns;
 }
 
 void
@@ -749,6 +1405,8 @@ hpa_shard_destroy(tsdn_t *tsdn, hpa_shard_t *shard) {
 		assert(hpdata_empty(ps));
 		psset_remove(&shard->psset, ps);
 		pages_unmap(hpdata_addr_get(ps), HUGEPAGE);
+		hpa_central_release(tsdn, shard->central, ps,
+		    /* unmapped */ true);
 	}
 }
 
@@ -3,206 +3,243 @@
 
 #include "jemalloc/internal/hpa_central.h"
 
-void
-hpa_central_init(hpa_central_t *central, edata_cache_t *edata_cache,
-    emap_t *emap) {
-	central->emap = emap;
-	edata_cache_small_init(&central->ecs, edata_cache);
-	eset_init(&central->eset, extent_state_dirty);
-	central->sn_next = 0;
+#include "jemalloc/internal/witness.h"
+
+bool
+hpa_central_init(hpa_central_t *central, base_t *base, size_t empty_max,
+    size_t eden_size, bool pretouch) {
+	assert(eden_size != 0 && HUGEPAGE_CEILING(eden_size) == eden_size);
+	if (malloc_mutex_init(&central->grow_mtx, "hpa_central_grow",
+	    WITNESS_RANK_HPA_GROW, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	if (malloc_mutex_init(&central->mtx, "hpa_central",
+	    WITNESS_RANK_HPA, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	central->eden = NULL;
+	central->eden_len = 0;
+	central->eden_size = eden_size;
+	central->eden_committed = false;
+	central->pretouch = pretouch;
+	central->eden_pretouched = false;
+	atomic_store_b(&central->pretouch_pending, false, ATOMIC_RELAXED);
+	central->base = base;
+	hpdata_empty_list_init(&central->empty);
+	central->nempty = 0;
+	central->empty_max = empty_max;
+	hpdata_empty_list_init(&central->retained);
+	central->nretained = 0;
+	hpdata_empty_list_init(&central->unused);
+	return false;
+}
+
+/* Pops the first hpdata off of list, which mtx guards; NULL if it's empty. */
+static hpdata_t *
+hpa_central_pop(tsdn_t *tsdn, hpa_central_t *central,
+    hpdata_empty_list_t *list) {
+	malloc_mutex_assert_owner(tsdn, &central->mtx);
+	hpdata_t *ps = hpdata_empty_list_first(list);
+	if (ps != NULL) {
+		hpdata_empty_list_remove(list, ps);
+	}
+	return ps;
 }
 
-/*
- * Returns the trail, or NULL in case of failure (which can only occur in case
- * of an emap operation failure; i.e. OOM).
- */
-static edata_t *
-hpa_central_split(tsdn_t *tsdn, hpa_central_t *central, edata_t *edata,
-    size_t size) {
-	edata_t *trail = edata_cache_small_get(tsdn, &central->ecs);
-	if (trail == NULL) {
+hpdata_t *
+hpa_central_hpdata_alloc(tsdn_t *tsdn, hpa_central_t *central) {
+	malloc_mutex_lock(tsdn, &central->mtx);
+	hpdata_t *ps = hpa_central_pop(tsdn, central, &central->unused);
+	malloc_mutex_unlock(tsdn, &central->mtx);
+	if (ps != NULL) {
+		return ps;
+	}
+	return (hpdata_t *)base_alloc(tsdn, central->base, sizeof(hpdata_t),
+	    CACHELINE);
+}
+
+static hpdata_t *
+hpa_central_grow(tsdn_t *tsdn, hpa_central_t *central, uint64_t age) {
+	malloc_mutex_assert_owner(tsdn, &central->grow_mtx);
+	hpdata_t *ps = hpa_central_hpdata_alloc(tsdn, central);
+	if (ps == NULL) {
 		return NULL;
 	}
-	size_t cursize = edata_size_get(edata);
-	edata_init(trail, edata_arena_ind_get(edata),
-	    (void *)((uintptr_t)edata_base_get(edata) + size), cursize - size,
-	    /* slab */ false, SC_NSIZES, edata_sn_get(edata),
-	    edata_state_get(edata), edata_zeroed_get(edata),
-	    edata_committed_get(edata), EXTENT_PAI_HPA, EXTENT_NOT_HEAD);
-
-	emap_prepare_t prepare;
-	bool err = emap_split_prepare(tsdn, central->emap, &prepare, edata,
-	    size, trail, cursize - size);
-	if (err) {
-		edata_cache_small_put(tsdn, &central->ecs, trail);
+	if (central->eden == NULL) {
+		/*
+		 * Just reserve the address space; where the OS doesn't
+		 * overcommit, we commit it a pageslab at a time below (and
+		 * where it does, the mapping is MAP_NORESERVE).
+		 */
+		bool commit = false;
+		void *new_eden = pages_map(NULL, central->eden_size, HUGEPAGE,
+		    &commit);
+		if (new_eden == NULL) {
+			hpa_central_release(tsdn, central, ps,
+			    /* unmapped */ true);
+			return NULL;
+		}
+		central->eden = new_eden;
+		central->eden_len = central->eden_size;
+		central->eden_committed = commit;
+		central->eden_pretouched = false;
+	}
+	assert(central->eden_len >= HUGEPAGE);
+	assert(central->eden_len % HUGEPAGE == 0);
+	assert(HUGEPAGE_ADDR2BASE(central->eden) == central->eden);
+
+	/* Pretouching commits the hugepage itself. */
+	if (!central->eden_committed && !central->eden_pretouched
+	    && pages_commit(central->eden, HUGEPAGE)) {
+		hpa_central_release(tsdn, central, ps, /* unmapped */ true);
 		return NULL;
 	}
-	emap_lock_edata2(tsdn, central->emap, edata, trail);
-	edata_size_set(edata, size);
-	emap_split_commit(tsdn, central->emap, &prepare, edata, size, trail,
-	    cursize - size);
-	emap_unlock_edata2(tsdn, central->emap, edata, trail);
+	hpdata_init(ps, central->eden, age);
+	if (central->eden_pretouched) {
+		/* Its pages are resident, and so have to be accounted for. */
+		hpdata_touch_all(ps);
+		hpdata_pretouched_set(ps, true);
+		central->eden_pretouched = false;
+	}
 
-	return trail;
+	if (central->eden_len == HUGEPAGE) {
+		central->eden = NULL;
+		central->eden_len = 0;
+	} else {
+		central->eden = (void *)((uintptr_t)central->eden + HUGEPAGE);
+		central->eden_len -= HUGEPAGE;
+	}
+	atomic_store_b(&central->pretouch_pending, central->pretouch
+	    && central->eden != NULL, ATOMIC_RELAXED);
+	return ps;
 }
 
-edata_t *
-hpa_central_alloc_reuse(tsdn_t *tsdn, hpa_central_t *central,
-    size_t size_min, size_t size_goal) {
-	assert((size_min & PAGE_MASK) == 0);
-	assert((size_goal & PAGE_MASK) == 0);
-
-	/*
-	 * Fragmentation avoidance is more important in the HPA than giving the
-	 * user their preferred amount of space, since we expect the average
-	 * unused extent to be more costly (PAC extents can get purged away
-	 * easily at any granularity; HPA extents are much more difficult to
-	 * purge away if they get stranded).  So we always search for the
-	 * earliest (in first-fit ordering) extent that can satisfy the request,
-	 * and use it, regardless of the goal size.
-	 */
-	edata_t *edata = eset_fit(&central->eset, size_min, PAGE,
-	    /* exact_only */ false, /* lg_max_fit */ SC_PTR_BITS);
-	if (edata == NULL) {
-		return NULL;
+void
+hpa_central_pretouch(tsdn_t *tsdn, hpa_central_t *central) {
+	if (!hpa_central_pretouch_pending(central)) {
+		return;
 	}
-
-	eset_remove(&central->eset, edata);
-	/* Maybe the first fit is also under the limit. */
-	if (edata_size_get(edata) <= size_goal) {
-		goto label_success;
+	/* Whoever holds the lock is growing, which makes this moot anyway. */
+	if (malloc_mutex_trylock(tsdn, &central->grow_mtx)) {
+		return;
+	}
+	if (central->eden != NULL && !central->eden_pretouched) {
+		/*
+		 * Nobody has this memory yet (we hold grow_mtx), so it's still
+		 * as fresh as when it was mapped.
+		 */
+		if (central->eden_committed || !pages_commit(central->eden,
+		    HUGEPAGE)) {
+			pages_prefault(central->eden, HUGEPAGE);
+			central->eden_pretouched = true;
+		}
 	}
+	atomic_store_b(&central->pretouch_pending, false, ATOMIC_RELAXED);
+	malloc_mutex_unlock(tsdn, &central->grow_mtx);
+}
 
-	/* Otherwise, split. */
-	edata_t *trail = hpa_central_split(tsdn, central, edata, size_goal);
-	if (trail == NULL) {
-		eset_insert(&central->eset, edata);
-		return NULL;
+hpdata_t *
+hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, uint64_t age) {
+	malloc_mutex_lock(tsdn, &central->mtx);
+	/* Pooled pageslabs come first; their address space is still mapped. */
+	hpdata_t *ps = hpa_central_pop(tsdn, central, &central->empty);
+	if (ps != NULL) {
+		central->nempty--;
+		malloc_mutex_unlock(tsdn, &central->mtx);
+		assert(hpdata_empty(ps));
+		hpdata_age_set(ps, age);
+		return ps;
 	}
-	emap_assert_mapped(tsdn, central->emap, trail);
-	eset_insert(&central->eset, trail);
-
-label_success:
-	emap_assert_mapped(tsdn, central->emap, edata);
-	assert(edata_size_get(edata) >= size_min);
-	/*
-	 * We don't yet support purging in the hpa_central; everything should be
-	 * dirty.
-	 */
-	assert(edata_state_get(edata) == extent_state_dirty);
-	assert(edata_base_get(edata) == edata_addr_get(edata));
-	edata_state_set(edata, extent_state_active);
-	return edata;
+	ps = hpa_central_pop(tsdn, central, &central->retained);
+	if (ps != NULL) {
+		central->nretained--;
+	}
+	malloc_mutex_unlock(tsdn, &central->mtx);
+	if (ps != NULL) {
+		hpdata_init(ps, hpdata_addr_get(ps), age);
+		return ps;
+	}
+
+	malloc_mutex_lock(tsdn, &central->grow_mtx);
+	ps = hpa_central_grow(tsdn, central, age);
+	malloc_mutex_unlock(tsdn, &central->grow_mtx);
+	return ps;
 }
 
 bool
-hpa_central_alloc_grow(tsdn_t *tsdn, hpa_central_t *central,
-    size_t size, edata_t *edata) {
-	assert((size & PAGE_MASK) == 0);
-	assert(edata_base_get(edata) == edata_addr_get(edata));
-	assert(edata_size_get(edata) >= size);
-	assert(edata_arena_ind_get(edata)
-	    == base_ind_get(central->ecs.fallback->base));
-	assert(edata_is_head_get(edata));
-	assert(edata_state_get(edata) == extent_state_active);
-	assert(edata_pai_get(edata) == EXTENT_PAI_HPA);
-	assert(edata_slab_get(edata) == false);
-	assert(edata_szind_get_maybe_invalid(edata) == SC_NSIZES);
-
-	/* edata should be a new alloc, and hence not already mapped. */
-	emap_assert_not_mapped(tsdn, central->emap, edata);
-
-	size_t cursize = edata_size_get(edata);
-
-	bool err = emap_register_boundary(tsdn, central->emap, edata, SC_NSIZES,
-	    /* slab */ false);
-	if (err) {
+hpa_central_insert(tsdn_t *tsdn, hpa_central_t *central, hpdata_t *ps) {
+	assert(hpdata_empty(ps));
+	assert(!hpdata_in_psset_get(ps));
+	/* An explicit hugepage can't be purged safely. */
+	if (hpdata_hugetlb_get(ps)) {
 		return true;
 	}
-	/* No splitting is necessary. */
-	if (cursize == size) {
-		size_t sn = central->sn_next++;
-		edata_sn_set(edata, sn);
-		return false;
+	malloc_mutex_lock(tsdn, &central->mtx);
+	if (central->nempty >= central->empty_max) {
+		malloc_mutex_unlock(tsdn, &central->mtx);
+		return true;
 	}
+	/* Hold its place in the pool while it's purged. */
+	central->nempty++;
+	malloc_mutex_unlock(tsdn, &central->mtx);
 
-	/* We should split. */
-	edata_t *trail = hpa_central_split(tsdn, central, edata, size);
-	if (trail == NULL) {
-		emap_deregister_boundary(tsdn, central->emap, NULL);
+	void *addr = hpdata_addr_get(ps);
+	if (hpdata_huge_get(ps)) {
+		pages_nohuge(addr, HUGEPAGE);
+	}
+	if (pages_purge_forced(addr, HUGEPAGE)) {
+		malloc_mutex_lock(tsdn, &central->mtx);
+		central->nempty--;
+		malloc_mutex_unlock(tsdn, &central->mtx);
 		return true;
 	}
-	size_t sn = central->sn_next++;
-	edata_sn_set(edata, sn);
-	edata_sn_set(trail, sn);
+	hpdata_init(ps, addr, hpdata_age_get(ps));
 
-	edata_state_set(trail, extent_state_dirty);
-	eset_insert(&central->eset, trail);
+	malloc_mutex_lock(tsdn, &central->mtx);
+	hpdata_empty_list_prepend(&central->empty, ps);
+	malloc_mutex_unlock(tsdn, &central->mtx);
 	return false;
 }
 
-static edata_t *
-hpa_central_dalloc_get_merge_candidate(tsdn_t *tsdn, hpa_central_t *central,
-    void *addr) {
-	edata_t *edata = emap_lock_edata_from_addr(tsdn, central->emap, addr,
-	    /* inactive_only */ true);
-	if (edata == NULL) {
-		return NULL;
+void
+hpa_central_release(tsdn_t *tsdn, hpa_central_t *central, hpdata_t *ps,
+    bool unmapped) {
+	malloc_mutex_lock(tsdn, &central->mtx);
+	if (unmapped) {
+		hpdata_empty_list_append(&central->unused, ps);
+	} else {
+		hpdata_empty_list_append(&central->retained, ps);
+		central->nretained++;
 	}
-	extent_pai_t pai = edata_pai_get(edata);
-	extent_state_t state = edata_state_get(edata);
-	emap_unlock_edata(tsdn, central->emap, edata);
+	malloc_mutex_unlock(tsdn, &central->mtx);
+}
 
-	if (pai != EXTENT_PAI_HPA) {
-		return NULL;
-	}
-	if (state == extent_state_active) {
-		return NULL;
-	}
+void
+hpa_central_stats_read(tsdn_t *tsdn, hpa_central_t *central,
+    hpa_central_stats_t *stats) {
+	malloc_mutex_lock(tsdn, &central->mtx);
+	stats->nempty = central->nempty;
+	stats->nretained = central->nretained;
+	malloc_mutex_unlock(tsdn, &central->mtx);
+	malloc_mutex_lock(tsdn, &central->grow_mtx);
+	stats->eden_bytes = central->eden_len;
+	malloc_mutex_unlock(tsdn, &central->grow_mtx);
+}
 
-	return edata;
+void
+hpa_central_prefork(tsdn_t *tsdn, hpa_central_t *central) {
+	malloc_mutex_prefork(tsdn, &central->grow_mtx);
+	malloc_mutex_prefork(tsdn, &central->mtx);
 }
 
-/* Merges b into a, freeing b back to the edata cache.. */
-static void
-hpa_central_dalloc_merge(tsdn_t *tsdn, hpa_central_t *central, edata_t *a,
-    edata_t *b) {
-	emap_prepare_t prepare;
-	emap_merge_prepare(tsdn, central->emap, &prepare, a, b);
-	emap_lock_edata2(tsdn, central->emap, a, b);
-	edata_size_set(a, edata_size_get(a) + edata_size_get(b));
-	emap_merge_commit(tsdn, central->emap, &prepare, a, b);
-	emap_unlock_edata2(tsdn, central->emap, a, b);
-	edata_cache_small_put(tsdn, &central->ecs, b);
+void
+hpa_central_postfork_parent(tsdn_t *tsdn, hpa_central_t *central) {
+	malloc_mutex_postfork_parent(tsdn, &central->grow_mtx);
+	malloc_mutex_postfork_parent(tsdn, &central->mtx);
 }
 
 void
-hpa_central_dalloc(tsdn_t *tsdn, hpa_central_t *central, edata_t *edata) {
-	assert(edata_state_get(edata) == extent_state_active);
-	assert(edata_ps_get(edata) == NULL);
-
-	/*
-	 * These should really be called at the pa interface level, but
-	 * currently they're not.
-	 */
-	edata_addr_set(edata, edata_base_get(edata));
-	edata_zeroed_set(edata, false);
-
-	if (!edata_is_head_get(edata)) {
-		edata_t *lead = hpa_central_dalloc_get_merge_candidate(tsdn,
-		    central, edata_before_get(edata));
-		if (lead != NULL) {
-			eset_remove(&central->eset, lead);
-			hpa_central_dalloc_merge(tsdn, central, lead, edata);
-			edata = lead;
-		}
-	}
-	edata_t *trail = hpa_central_dalloc_get_merge_candidate(tsdn, central,
-	    edata_past_get(edata));
-	if (trail != NULL && !edata_is_head_get(trail)) {
-		eset_remove(&central->eset, trail);
-		hpa_central_dalloc_merge(tsdn, central, edata, trail);
-	}
-	edata_state_set(edata, extent_state_dirty);
-	eset_insert(&central->eset, edata);
+hpa_central_postfork_child(tsdn_t *tsdn, hpa_central_t *central) {
+	malloc_mutex_postfork_child(tsdn, &central->grow_mtx);
+	malloc_mutex_postfork_child(tsdn, &central->mtx);
 }
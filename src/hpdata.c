@@ -4,7 +4,12 @@
 #include "jemalloc/internal/hpdata.h"
 
 static int
-hpdata_age_comp(const hpdata_t *a, const hpdata_t *b) {
+hpdata_alloc_comp(const hpdata_t *a, const hpdata_t *b) {
+	uint64_t a_key = hpdata_alloc_key_get(a);
+	uint64_t b_key = hpdata_alloc_key_get(b);
+	if (a_key != b_key) {
+		return (a_key > b_key) - (a_key < b_key);
+	}
 	uint64_t a_age = hpdata_age_get(a);
 	uint64_t b_age = hpdata_age_get(b);
 	/*
@@ -15,21 +20,32 @@ hpdata_age_comp(const hpdata_t *a, const hpdata_t *b) {
 	return (a_age > b_age) - (a_age < b_age);
 }
 
-ph_gen(, hpdata_age_heap_, hpdata_age_heap_t, hpdata_t, ph_link, hpdata_age_comp)
+ph_gen(, hpdata_alloc_heap_, hpdata_alloc_heap_t, hpdata_t, ph_link,
+    hpdata_alloc_comp)
 
 void
 hpdata_init(hpdata_t *hpdata, void *addr, uint64_t age) {
 	hpdata_addr_set(hpdata, addr);
 	hpdata_age_set(hpdata, age);
+	hpdata_shard_set(hpdata, NULL);
+	hpdata_alloc_key_set(hpdata, 0);
 	hpdata->h_huge = false;
+	hpdata->h_hugetlb = false;
+	hpdata->h_pretouched = false;
 	hpdata->h_alloc_allowed = true;
 	hpdata->h_in_psset_alloc_container = false;
 	hpdata->h_purge_allowed = false;
 	hpdata->h_in_psset_purge_container = false;
+	hpdata->h_muzzy_purge_allowed = false;
+	hpdata->h_in_psset_muzzy_purge_container = false;
 	hpdata->h_hugify_allowed = false;
 	hpdata->h_in_psset_hugify_container = false;
 	hpdata->h_mid_purge = false;
 	hpdata->h_mid_hugify = false;
+	hpdata->h_collapse_failed = false;
+	nstime_init_zero(&hpdata->h_time_purge_allowed);
+	nstime_init_zero(&hpdata->h_time_hugify_allowed);
+	nstime_init_zero(&hpdata->h_time_hugified);
 	hpdata->h_updating = false;
 	hpdata->h_in_psset = false;
 	hpdata_longest_free_range_set(hpdata, HUGEPAGE_PAGES);
@@ -37,10 +53,20 @@ hpdata_init(hpdata_t *hpdata, void *addr, uint64_t age) {
 	fb_init(hpdata->active_pages, HUGEPAGE_PAGES);
 	hpdata->h_ntouched = 0;
 	fb_init(hpdata->touched_pages, HUGEPAGE_PAGES);
+	hpdata->h_nmuzzy = 0;
+	fb_init(hpdata->muzzy_pages, HUGEPAGE_PAGES);
 
 	hpdata_assert_consistent(hpdata);
 }
 
+void
+hpdata_init_hugetlb(hpdata_t *hpdata, void *addr, uint64_t age) {
+	hpdata_init(hpdata, addr, age);
+	/* It's huge (and fully backed) from the moment it's mapped. */
+	hpdata_hugify(hpdata);
+	hpdata->h_hugetlb = true;
+}
+
 void *
 hpdata_reserve_alloc(hpdata_t *hpdata, size_t sz) {
 	hpdata_assert_consistent(hpdata);
@@ -92,6 +118,7 @@ hpdata_reserve_alloc(hpdata_t *hpdata, size_t sz) {
 	result = begin;
 	fb_set_range(hpdata->active_pages, HUGEPAGE_PAGES, begin, npages);
 	hpdata->h_nactive += npages;
+	hpdata->h_collapse_failed = false;
 
 	/*
 	 * We might be about to dirty some memory for the first time; update our
@@ -101,6 +128,11 @@ hpdata_reserve_alloc(hpdata_t *hpdata, size_t sz) {
 	    result, npages);
 	fb_set_range(hpdata->touched_pages, HUGEPAGE_PAGES, result, npages);
 	hpdata->h_ntouched += new_dirty;
+	/* Some of those may have been muzzy; they aren't any more. */
+	size_t old_muzzy = fb_scount(hpdata->muzzy_pages, HUGEPAGE_PAGES,
+	    result, npages);
+	fb_unset_range(hpdata->muzzy_pages, HUGEPAGE_PAGES, result, npages);
+	hpdata->h_nmuzzy -= old_muzzy;
 
 	/*
 	 * We might have shrunk the longest free range.  We have to keep
@@ -154,18 +186,32 @@ hpdata_unreserve(hpdata_t *hpdata, void *addr, size_t sz) {
 	}
 
 	hpdata->h_nactive -= npages;
+	hpdata->h_collapse_failed = false;
 
 	hpdata_assert_consistent(hpdata);
 }
 
 size_t
-hpdata_purge_begin(hpdata_t *hpdata, hpdata_purge_state_t *purge_state) {
+hpdata_purge_begin(hpdata_t *hpdata, hpdata_purge_state_t *purge_state,
+    hpdata_purge_kind_t kind) {
 	hpdata_assert_consistent(hpdata);
 	/* See the comment in reserve. */
 
+	purge_state->kind = kind;
 	purge_state->npurged = 0;
 	purge_state->next_purge_search_begin = 0;
 
+	if (kind == hpdata_purge_muzzy) {
+		/*
+		 * Nothing can allocate out of the hpdata while we purge it, so
+		 * the muzzy pages stay muzzy until we're done.
+		 */
+		memcpy(purge_state->to_purge, hpdata->muzzy_pages,
+		    sizeof(purge_state->to_purge));
+		hpdata_assert_consistent(hpdata);
+		return hpdata->h_nmuzzy;
+	}
+
 	/*
 	 * Initialize to_purge with everything that's not active but that is
 	 * dirty.
@@ -230,28 +276,59 @@ hpdata_purge_end(hpdata_t *hpdata, hpdata_purge_state_t *purge_state) {
 	assert(purge_state->npurged == fb_scount(purge_state->to_purge,
 	    HUGEPAGE_PAGES, 0, HUGEPAGE_PAGES));
 
+	if (purge_state->kind == hpdata_purge_dirty_lazy) {
+		fb_bit_or(hpdata->muzzy_pages, hpdata->muzzy_pages,
+		    purge_state->to_purge, HUGEPAGE_PAGES);
+		hpdata->h_nmuzzy += purge_state->npurged;
+	}
 	fb_bit_not(purge_state->to_purge, purge_state->to_purge,
 	    HUGEPAGE_PAGES);
-	fb_bit_and(hpdata->touched_pages, hpdata->touched_pages,
-	    purge_state->to_purge, HUGEPAGE_PAGES);
-	assert(hpdata->h_ntouched >= purge_state->npurged);
-	hpdata->h_ntouched -= purge_state->npurged;
+	if (purge_state->kind == hpdata_purge_muzzy) {
+		fb_bit_and(hpdata->muzzy_pages, hpdata->muzzy_pages,
+		    purge_state->to_purge, HUGEPAGE_PAGES);
+		assert(hpdata->h_nmuzzy >= purge_state->npurged);
+		hpdata->h_nmuzzy -= purge_state->npurged;
+	} else {
+		fb_bit_and(hpdata->touched_pages, hpdata->touched_pages,
+		    purge_state->to_purge, HUGEPAGE_PAGES);
+		assert(hpdata->h_ntouched >= purge_state->npurged);
+		hpdata->h_ntouched -= purge_state->npurged;
+	}
 
 	hpdata_assert_consistent(hpdata);
 }
 
+void
+hpdata_touch_all(hpdata_t *hpdata) {
+	hpdata_assert_consistent(hpdata);
+	assert(!hpdata->h_in_psset || hpdata->h_updating);
+	fb_set_range(hpdata->touched_pages, HUGEPAGE_PAGES, 0, HUGEPAGE_PAGES);
+	hpdata->h_ntouched = HUGEPAGE_PAGES;
+	fb_init(hpdata->muzzy_pages, HUGEPAGE_PAGES);
+	hpdata->h_nmuzzy = 0;
+	hpdata_assert_consistent(hpdata);
+}
+
 void
 hpdata_hugify(hpdata_t *hpdata) {
 	hpdata_assert_consistent(hpdata);
+	/* The psset files purge candidates by hugeness. */
+	assert(!hpdata->h_in_psset_purge_container);
+	assert(!hpdata->h_in_psset_muzzy_purge_container);
 	hpdata->h_huge = true;
+	hpdata->h_pretouched = false;
 	fb_set_range(hpdata->touched_pages, HUGEPAGE_PAGES, 0, HUGEPAGE_PAGES);
 	hpdata->h_ntouched = HUGEPAGE_PAGES;
+	fb_init(hpdata->muzzy_pages, HUGEPAGE_PAGES);
+	hpdata->h_nmuzzy = 0;
 	hpdata_assert_consistent(hpdata);
 }
 
 void
 hpdata_dehugify(hpdata_t *hpdata) {
 	hpdata_assert_consistent(hpdata);
+	assert(!hpdata->h_in_psset_purge_container);
+	assert(!hpdata->h_hugetlb);
 	hpdata->h_huge = false;
 	hpdata_assert_consistent(hpdata);
 }
@@ -145,11 +145,32 @@ malloc_mutex_t arenas_lock;
 /* The global hpa, and whether it's on. */
 bool opt_hpa = false;
 hpa_shard_opts_t opt_hpa_opts = HPA_SHARD_OPTS_DEFAULT;
+/*
+ * How many empty pageslabs given up by the HPA shards (see
+ * hpa_shard_opts_t.empty_max) the central pool holds on to for other shards.
+ */
+size_t opt_hpa_central_empty_max = 0;
+/*
+ * How much address space the HPA reserves at a time (rounded up to a multiple
+ * of HUGEPAGE), and whether the background threads fault in the next hugepage
+ * of it ahead of time.
+ */
+size_t opt_hpa_eden_size = HPA_CENTRAL_EDEN_SIZE_DEFAULT;
+bool opt_hpa_eden_pretouch = false;
+/*
+ * How many HPA shards to serve slab allocations from, by CPU, independently
+ * of arenas; 0 means slabs come from the arena's own shard.
+ */
+unsigned opt_hpa_cpu_shards = 0;
+
+sec_opts_t opt_hpa_sec_opts = SEC_OPTS_DEFAULT;
 
-size_t opt_hpa_sec_max_alloc = 32 * 1024;
-/* These settings correspond to a maximum of 1MB cached per arena. */
-size_t opt_hpa_sec_max_bytes = 256 * 1024;
-size_t opt_hpa_sec_nshards = 4;
+/*
+ * Whether to put a small extent cache in front of the PAC as well, and how to
+ * configure it.
+ */
+bool opt_pac_sec = false;
+sec_opts_t opt_pac_sec_opts = SEC_OPTS_DEFAULT;
 
 /*
  * Arenas that are used to service external requests.  Not all elements of the
@@ -1140,6 +1161,9 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 #define CONF_HANDLE_INT64_T(o, n, min, max, check_min, check_max, clip)	\
 			CONF_HANDLE_T_SIGNED(int64_t, o, n, min, max,	\
 			    check_min, check_max, clip)
+#define CONF_HANDLE_UINT64_T(o, n, min, max, check_min, check_max, clip)	\
+			CONF_HANDLE_T_U(uint64_t, o, n, min, max,	\
+			    check_min, check_max, clip)
 #define CONF_HANDLE_SSIZE_T(o, n, min, max)				\
 			CONF_HANDLE_T_SIGNED(ssize_t, o, n, min, max,	\
 			    CONF_CHECK_MIN, CONF_CHECK_MAX, false)
@@ -1163,6 +1187,8 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			CONF_HANDLE_BOOL(opt_abort, "abort")
 			CONF_HANDLE_BOOL(opt_abort_conf, "abort_conf")
 			CONF_HANDLE_BOOL(opt_trust_madvise, "trust_madvise")
+			CONF_HANDLE_BOOL(opt_process_madvise, "process_madvise")
+			CONF_HANDLE_BOOL(opt_numa_bind, "numa_bind")
 			if (strncmp("metadata_thp", k, klen) == 0) {
 				int i;
 				bool match = false;
@@ -1364,10 +1390,22 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			CONF_HANDLE_SIZE_T(opt_oversize_threshold,
 			    "oversize_threshold", 0, SC_LARGE_MAXCLASS,
 			    CONF_DONT_CHECK_MIN, CONF_CHECK_MAX, false)
+			CONF_HANDLE_SIZE_T(opt_ralloc_mremap_min,
+			    "ralloc_mremap_min", 0, SC_LARGE_MAXCLASS,
+			    CONF_DONT_CHECK_MIN, CONF_CHECK_MAX, /* clip */ true)
 			CONF_HANDLE_SIZE_T(opt_lg_extent_max_active_fit,
 			    "lg_extent_max_active_fit", 0,
 			    (sizeof(size_t) << 3), CONF_DONT_CHECK_MIN,
 			    CONF_CHECK_MAX, false)
+			CONF_HANDLE_BOOL(opt_extent_coalesce_deferred,
+			    "extent_coalesce_deferred")
+			CONF_HANDLE_SIZE_T(opt_retained_limit, "retained_limit",
+			    0, SIZE_T_MAX, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, false)
+			CONF_HANDLE_SSIZE_T(opt_retained_idle_ms,
+			    "retained_idle_ms", -1, NSTIME_SEC_MAX * KQU(1000) <
+			    QU(SSIZE_MAX) ? NSTIME_SEC_MAX * KQU(1000) :
+			    SSIZE_MAX);
 
 			if (strncmp("percpu_arena", k, klen) == 0) {
 				bool match = false;
@@ -1398,6 +1436,10 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 					   opt_max_background_threads,
 					   CONF_CHECK_MIN, CONF_CHECK_MAX,
 					   true);
+			CONF_HANDLE_SIZE_T(
+			    opt_background_thread_hpa_interval_max_ms,
+			    "background_thread_hpa_interval_max_ms", 0, 0,
+			    CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX, false);
 			CONF_HANDLE_BOOL(opt_hpa, "hpa")
 			CONF_HANDLE_SIZE_T(opt_hpa_opts.slab_max_alloc,
 			    "hpa_slab_max_alloc", PAGE, HUGEPAGE,
@@ -1465,12 +1507,104 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 				CONF_CONTINUE;
 			}
 
-			CONF_HANDLE_SIZE_T(opt_hpa_sec_max_alloc, "hpa_sec_max_alloc",
-			    PAGE, 0, CONF_CHECK_MIN, CONF_DONT_CHECK_MAX, true);
-			CONF_HANDLE_SIZE_T(opt_hpa_sec_max_bytes, "hpa_sec_max_bytes",
-			    PAGE, 0, CONF_CHECK_MIN, CONF_DONT_CHECK_MAX, true);
-			CONF_HANDLE_SIZE_T(opt_hpa_sec_nshards, "hpa_sec_nshards",
-			    0, 0, CONF_CHECK_MIN, CONF_DONT_CHECK_MAX, true);
+			CONF_HANDLE_SSIZE_T(opt_hpa_opts.dirty_decay_ms,
+			    "hpa_dirty_decay_ms", -1, NSTIME_SEC_MAX * KQU(1000) <
+			    QU(SSIZE_MAX) ? NSTIME_SEC_MAX * KQU(1000) :
+			    SSIZE_MAX);
+			CONF_HANDLE_SSIZE_T(opt_hpa_opts.muzzy_decay_ms,
+			    "hpa_muzzy_decay_ms", -1, NSTIME_SEC_MAX * KQU(1000) <
+			    QU(SSIZE_MAX) ? NSTIME_SEC_MAX * KQU(1000) :
+			    SSIZE_MAX);
+			CONF_HANDLE_SIZE_T(opt_hpa_opts.empty_max,
+			    "hpa_empty_max", 0, 0, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, false);
+			CONF_HANDLE_SIZE_T(opt_hpa_central_empty_max,
+			    "hpa_central_empty_max", 0, 0, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, false);
+			CONF_HANDLE_SIZE_T(opt_hpa_eden_size, "hpa_eden_size",
+			    HUGEPAGE, SC_LARGE_MAXCLASS, CONF_CHECK_MIN,
+			    CONF_CHECK_MAX, true);
+			CONF_HANDLE_BOOL(opt_hpa_eden_pretouch,
+			    "hpa_eden_pretouch")
+			if (CONF_MATCH("hpa_cpu_shards") && !have_percpu_arena) {
+				CONF_ERROR("No getcpu support", k, klen, v,
+				    vlen);
+				CONF_CONTINUE;
+			}
+			CONF_HANDLE_UNSIGNED(opt_hpa_cpu_shards,
+			    "hpa_cpu_shards", 0, 0, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, false);
+			CONF_HANDLE_UINT64_T(opt_hpa_opts.hugify_delay_ms,
+			    "hpa_hugify_delay_ms", 0, 0, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, false);
+			CONF_HANDLE_UINT64_T(opt_hpa_opts.dehugify_delay_ms,
+			    "hpa_dehugify_delay_ms", 0, 0, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, false);
+			CONF_HANDLE_BOOL(opt_hpa_opts.hugify_sync,
+			    "hpa_hugify_sync");
+			CONF_HANDLE_BOOL(opt_hpa_opts.hugetlb, "hpa_hugetlb");
+			if (strncmp("hpa_alloc_policy", k, klen) == 0) {
+				int i;
+				bool match = false;
+				for (i = 0; i < hpa_alloc_policy_limit; i++) {
+					if (strncmp(hpa_alloc_policy_names[i],
+					    v, vlen) == 0) {
+						opt_hpa_opts.alloc_policy = i;
+						match = true;
+						break;
+					}
+				}
+				if (!match) {
+					CONF_ERROR("Invalid conf value",
+					    k, klen, v, vlen);
+				}
+				CONF_CONTINUE;
+			}
+
+			/*
+			 * The small extent caches in front of the HPA and the
+			 * PAC are configured independently, but identically.
+			 */
+#define CONF_HANDLE_SEC_OPTS(o, prefix)					\
+			CONF_HANDLE_SIZE_T(o.nshards, prefix "nshards", 0,	\
+			    SEC_NSHARDS_MAX, CONF_CHECK_MIN, CONF_CHECK_MAX,	\
+			    true);						\
+			if (CONF_MATCH(prefix "shard_by_cpu")) {		\
+				if (CONF_MATCH_VALUE("true")) {			\
+					if (!have_percpu_arena) {		\
+						CONF_ERROR(			\
+						    "No getcpu support",	\
+						    k, klen, v, vlen);		\
+					}					\
+					o.shard_by_cpu = true;			\
+				} else if (CONF_MATCH_VALUE("false")) {	\
+					o.shard_by_cpu = false;			\
+				} else {					\
+					CONF_ERROR("Invalid conf value",	\
+					    k, klen, v, vlen);			\
+				}						\
+				CONF_CONTINUE;					\
+			}							\
+			CONF_HANDLE_SIZE_T(o.max_alloc, prefix "max_alloc",	\
+			    PAGE, 0, CONF_CHECK_MIN, CONF_DONT_CHECK_MAX,	\
+			    true);						\
+			CONF_HANDLE_SIZE_T(o.max_bytes, prefix "max_bytes",	\
+			    PAGE, 0, CONF_CHECK_MIN, CONF_DONT_CHECK_MAX,	\
+			    true);						\
+			CONF_HANDLE_SIZE_T(o.bytes_after_flush,		\
+			    prefix "bytes_after_flush", 0, 0, CONF_CHECK_MIN,	\
+			    CONF_DONT_CHECK_MAX, true);				\
+			CONF_HANDLE_SIZE_T(o.batch_fill_extra,		\
+			    prefix "batch_fill_extra", 0, 0, CONF_CHECK_MIN,	\
+			    CONF_DONT_CHECK_MAX, true);				\
+			CONF_HANDLE_UINT64_T(o.max_idle_ms,			\
+			    prefix "max_idle_ms", 0, 0, CONF_DONT_CHECK_MIN,	\
+			    CONF_DONT_CHECK_MAX, false);
+
+			CONF_HANDLE_SEC_OPTS(opt_hpa_sec_opts, "hpa_sec_")
+			CONF_HANDLE_BOOL(opt_pac_sec, "pac_sec")
+			CONF_HANDLE_SEC_OPTS(opt_pac_sec_opts, "pac_sec_")
+#undef CONF_HANDLE_SEC_OPTS
 
 			if (CONF_MATCH("slab_sizes")) {
 				if (CONF_MATCH_VALUE("default")) {
@@ -1723,6 +1857,12 @@ malloc_init_hard_a0_locked() {
 	if (emap_init(&arena_emap_global, b0get(), /* zeroed */ true)) {
 		return true;
 	}
+	opt_hpa_eden_size = HUGEPAGE_CEILING(opt_hpa_eden_size);
+	if (hpa_central_init(&arena_hpa_central_global, b0get(),
+	    opt_hpa_central_empty_max, opt_hpa_eden_size,
+	    opt_hpa_eden_pretouch)) {
+		return true;
+	}
 	if (extent_boot()) {
 		return true;
 	}
@@ -1768,11 +1908,20 @@ malloc_init_hard_a0_locked() {
 			opt_hpa = false;
 		}
 	} else if (opt_hpa) {
-		if (pa_shard_enable_hpa(&a0->pa_shard, &opt_hpa_opts,
-		    opt_hpa_sec_nshards, opt_hpa_sec_max_alloc,
-		    opt_hpa_sec_max_bytes)) {
+		/*
+		 * Background threads aren't running yet; we'll allow deferral
+		 * once thread 0 gets created.
+		 */
+		hpa_shard_opts_t hpa_shard_opts = opt_hpa_opts;
+		hpa_shard_opts.deferral_allowed = false;
+		if (pa_shard_enable_hpa(TSDN_NULL, &a0->pa_shard,
+		    &arena_hpa_central_global, &arena_hpa_cpu_global,
+		    &hpa_shard_opts, &opt_hpa_sec_opts)) {
 			return true;
 		}
+		if (opt_numa_bind) {
+			pa_shard_set_numa_node(&a0->pa_shard, a0->numa_node);
+		}
 	}
 
 	malloc_init_state = malloc_init_a0_initialized;
@@ -1931,6 +2080,40 @@ malloc_init_percpu(void) {
 	opt_percpu_arena = percpu_arena_as_initialized(opt_percpu_arena);
 }
 
+static bool
+malloc_init_hpa_cpu_shards(tsdn_t *tsdn) {
+	if (!opt_hpa || opt_hpa_cpu_shards == 0) {
+		return false;
+	}
+	if (!have_percpu_arena || malloc_getcpu() < 0) {
+		opt_hpa_cpu_shards = 0;
+		malloc_printf("<jemalloc>: getcpu() not available; slabs will "
+		    "come from per-arena HPA shards.\n");
+		if (opt_abort) {
+			abort();
+		}
+		return false;
+	}
+	if (opt_hpa_cpu_shards > ncpus) {
+		opt_hpa_cpu_shards = ncpus;
+	}
+	/*
+	 * These shards belong to no arena; background thread 0 does their
+	 * deferred work once it's up, and until then they do it as they go.
+	 */
+	hpa_shard_opts_t hpa_shard_opts = opt_hpa_opts;
+	hpa_shard_opts.deferral_allowed = false;
+	if (pa_cpu_hpa_init(tsdn, &arena_hpa_cpu_global, opt_hpa_cpu_shards,
+	    ncpus, &arena_hpa_central_global, &arena_emap_global, b0get(),
+	    &hpa_shard_opts)) {
+		return true;
+	}
+	if (opt_numa_bind) {
+		pa_cpu_hpa_set_numa_nodes(&arena_hpa_cpu_global);
+	}
+	return false;
+}
+
 static bool
 malloc_init_hard_finish(void) {
 	if (malloc_mutex_boot()) {
@@ -2001,6 +2184,10 @@ malloc_init_hard(void) {
 
 	malloc_init_percpu();
 
+	if (malloc_init_hpa_cpu_shards(tsd_tsdn(tsd))) {
+		UNLOCK_RETURN(tsd_tsdn(tsd), true, true)
+	}
+
 	if (malloc_init_hard_finish()) {
 		UNLOCK_RETURN(tsd_tsdn(tsd), true, true)
 	}
@@ -4182,7 +4369,28 @@ _malloc_prefork(void)
 				}
 			}
 		}
-
+		switch (i) {
+		case 3:
+			pa_cpu_hpa_prefork3(tsd_tsdn(tsd),
+			    &arena_hpa_cpu_global);
+			break;
+		case 4:
+			pa_cpu_hpa_prefork4(tsd_tsdn(tsd),
+			    &arena_hpa_cpu_global);
+			/*
+			 * The central HPA locks rank between the shards' (taken
+			 * in stage 4) and the edata caches' (stage 5).
+			 */
+			hpa_central_prefork(tsd_tsdn(tsd),
+			    &arena_hpa_central_global);
+			break;
+		case 5:
+			pa_cpu_hpa_prefork5(tsd_tsdn(tsd),
+			    &arena_hpa_cpu_global);
+			break;
+		default:
+			break;
+		}
 	}
 	prof_prefork1(tsd_tsdn(tsd));
 	stats_prefork(tsd_tsdn(tsd));
@@ -4221,6 +4429,8 @@ _malloc_postfork(void)
 			arena_postfork_parent(tsd_tsdn(tsd), arena);
 		}
 	}
+	pa_cpu_hpa_postfork_parent(tsd_tsdn(tsd), &arena_hpa_cpu_global);
+	hpa_central_postfork_parent(tsd_tsdn(tsd), &arena_hpa_central_global);
 	prof_postfork_parent(tsd_tsdn(tsd));
 	if (have_background_thread) {
 		background_thread_postfork_parent(tsd_tsdn(tsd));
@@ -4251,6 +4461,8 @@ jemalloc_postfork_child(void) {
 			arena_postfork_child(tsd_tsdn(tsd), arena);
 		}
 	}
+	pa_cpu_hpa_postfork_child(tsd_tsdn(tsd), &arena_hpa_cpu_global);
+	hpa_central_postfork_child(tsd_tsdn(tsd), &arena_hpa_central_global);
 	prof_postfork_child(tsd_tsdn(tsd));
 	if (have_background_thread) {
 		background_thread_postfork_child(tsd_tsdn(tsd));
@@ -4258,6 +4470,7 @@ jemalloc_postfork_child(void) {
 	malloc_mutex_postfork_child(tsd_tsdn(tsd), &arenas_lock);
 	tcache_postfork_child(tsd_tsdn(tsd));
 	ctl_postfork_child(tsd_tsdn(tsd));
+	pages_postfork_child();
 }
 
 /******************************************************************************/
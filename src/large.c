@@ -8,6 +8,11 @@
 #include "jemalloc/internal/prof_recent.h"
 #include "jemalloc/internal/util.h"
 
+/******************************************************************************/
+/* Data. */
+
+size_t opt_ralloc_mremap_min = RALLOC_MREMAP_MIN_DEFAULT;
+
 /******************************************************************************/
 
 void *
@@ -78,6 +83,25 @@ large_ralloc_no_move_shrink(tsdn_t *tsdn, edata_t *edata, size_t usize) {
 	return false;
 }
 
+static void
+large_ralloc_zero_trailing(edata_t *edata, size_t old_usize) {
+	if (config_cache_oblivious) {
+		/*
+		 * Zero the trailing bytes of the original allocation's last
+		 * page, since they are in an indeterminate state.  There will
+		 * always be trailing bytes, because ptr's offset from the
+		 * beginning of the extent is a multiple of CACHELINE in
+		 * [0 .. PAGE).
+		 */
+		void *zbase = (void *)((uintptr_t)edata_addr_get(edata)
+		    + old_usize);
+		void *zpast = PAGE_ADDR2BASE((void *)((uintptr_t)zbase + PAGE));
+		size_t nzero = (uintptr_t)zpast - (uintptr_t)zbase;
+		assert(nzero > 0);
+		memset(zbase, 0, nzero);
+	}
+}
+
 static bool
 large_ralloc_no_move_expand(tsdn_t *tsdn, edata_t *edata, size_t usize,
     bool zero) {
@@ -95,22 +119,34 @@ large_ralloc_no_move_expand(tsdn_t *tsdn, edata_t *edata, size_t usize,
 	}
 
 	if (zero) {
-		if (config_cache_oblivious) {
-			/*
-			 * Zero the trailing bytes of the original allocation's
-			 * last page, since they are in an indeterminate state.
-			 * There will always be trailing bytes, because ptr's
-			 * offset from the beginning of the extent is a multiple
-			 * of CACHELINE in [0 .. PAGE).
-			 */
-			void *zbase = (void *)
-			    ((uintptr_t)edata_addr_get(edata) + old_usize);
-			void *zpast = PAGE_ADDR2BASE((void *)((uintptr_t)zbase +
-			    PAGE));
-			size_t nzero = (uintptr_t)zpast - (uintptr_t)zbase;
-			assert(nzero > 0);
-			memset(zbase, 0, nzero);
-		}
+		large_ralloc_zero_trailing(edata, old_usize);
+	}
+	arena_extent_ralloc_large_expand(tsdn, arena, edata, old_usize);
+
+	return false;
+}
+
+/*
+ * Grows the allocation by moving its pages to where there's room, rather than
+ * copying its contents over.  The pages that get added are demand-zeroed.
+ */
+static bool
+large_ralloc_move_remap(tsdn_t *tsdn, edata_t *edata, size_t usize,
+    bool zero) {
+	arena_t *arena = arena_get_from_edata(edata);
+
+	size_t old_size = edata_size_get(edata);
+	size_t old_usize = edata_usize_get(edata);
+	size_t new_size = usize + sz_large_pad;
+
+	bool err = pa_move(tsdn, &arena->pa_shard, edata, old_size, new_size,
+	    sz_size2index(usize));
+	if (err) {
+		return true;
+	}
+
+	if (zero) {
+		large_ralloc_zero_trailing(edata, old_usize);
 	}
 	arena_extent_ralloc_large_expand(tsdn, arena, edata, old_usize);
 
@@ -162,6 +198,26 @@ large_ralloc_no_move(tsdn_t *tsdn, edata_t *edata, size_t usize_min,
 	return true;
 }
 
+static bool
+large_ralloc_may_move_remap(arena_t *arena, edata_t *edata, void *ptr,
+    size_t usize, size_t alignment) {
+	size_t oldusize = edata_usize_get(edata);
+	if (usize <= oldusize || opt_ralloc_mremap_min == 0
+	    || oldusize < opt_ralloc_mremap_min) {
+		return false;
+	}
+	/* The allocation stays in its arena. */
+	if (arena != NULL && arena != arena_get_from_edata(edata)) {
+		return false;
+	}
+	/*
+	 * ptr keeps its offset into its first page, so alignments of up to a
+	 * page hold on if they do already.
+	 */
+	return alignment == 0 || (alignment <= PAGE
+	    && ((uintptr_t)ptr & (alignment - 1)) == 0);
+}
+
 static void *
 large_ralloc_move_helper(tsdn_t *tsdn, arena_t *arena, size_t usize,
     size_t alignment, bool zero) {
@@ -192,13 +248,37 @@ large_ralloc(tsdn_t *tsdn, arena_t *arena, void *ptr, size_t usize,
 		return edata_addr_get(edata);
 	}
 
+	/*
+	 * Short of that, it's cheaper to have the OS move a big allocation's
+	 * pages than to copy them over.
+	 */
+	void *ret;
+	if (large_ralloc_may_move_remap(arena, edata, ptr, usize, alignment)
+	    && !large_ralloc_move_remap(tsdn, edata, usize, zero)) {
+		ret = edata_addr_get(edata);
+		if (ret == ptr) {
+			/* The kernel found room to grow the mapping in place. */
+			hook_invoke_expand(hook_args->is_realloc
+			    ? hook_expand_realloc : hook_expand_rallocx, ptr,
+			    oldusize, usize, (uintptr_t)ptr, hook_args->args);
+		} else {
+			hook_invoke_alloc(hook_args->is_realloc
+			    ? hook_alloc_realloc : hook_alloc_rallocx, ret,
+			    (uintptr_t)ret, hook_args->args);
+			hook_invoke_dalloc(hook_args->is_realloc
+			    ? hook_dalloc_realloc : hook_dalloc_rallocx, ptr,
+			    hook_args->args);
+		}
+		arena_decay_tick(tsdn, arena_get_from_edata(edata));
+		return ret;
+	}
+
 	/*
 	 * usize and old size are different enough that we need to use a
 	 * different size class.  In that case, fall back to allocating new
 	 * space and copying.
 	 */
-	void *ret = large_ralloc_move_helper(tsdn, arena, usize, alignment,
-	    zero);
+	ret = large_ralloc_move_helper(tsdn, arena, usize, alignment, zero);
 	if (ret == NULL) {
 		return NULL;
 	}
@@ -18,7 +18,7 @@ bool
 pa_shard_init(tsdn_t *tsdn, pa_shard_t *shard, emap_t *emap, base_t *base,
     unsigned ind, pa_shard_stats_t *stats, malloc_mutex_t *stats_mtx,
     nstime_t *cur_time, size_t oversize_threshold, ssize_t dirty_decay_ms,
-    ssize_t muzzy_decay_ms) {
+    ssize_t muzzy_decay_ms, const sec_opts_t *pac_sec_opts) {
 	/* This will change eventually, but for now it should hold. */
 	assert(base_ind_get(base) == ind);
 	if (edata_cache_init(&shard->edata_cache, base)) {
@@ -30,11 +30,23 @@ pa_shard_init(tsdn_t *tsdn, pa_shard_t *shard, emap_t *emap, base_t *base,
 	    &stats->pac_stats, stats_mtx)) {
 		return true;
 	}
+	/*
+	 * Even when unused, we initialize the SEC (with no shards, which
+	 * allocates nothing), so that flushing it and the like are no-ops.
+	 */
+	sec_opts_t disabled_sec_opts = SEC_OPTS_DEFAULT;
+	disabled_sec_opts.nshards = 0;
+	if (sec_init(tsdn, &shard->pac_sec, base, &shard->pac.pai,
+	    pac_sec_opts != NULL ? pac_sec_opts : &disabled_sec_opts)) {
+		return true;
+	}
+	shard->use_pac_sec = (shard->pac_sec.opts.nshards > 0);
 
 	shard->ind = ind;
 
 	shard->ever_used_hpa = false;
 	atomic_store_b(&shard->use_hpa, false, ATOMIC_RELAXED);
+	shard->cpu_hpa = NULL;
 
 	atomic_store_zu(&shard->nactive, 0, ATOMIC_RELAXED);
 
@@ -49,22 +61,68 @@ pa_shard_init(tsdn_t *tsdn, pa_shard_t *shard, emap_t *emap, base_t *base,
 }
 
 bool
-pa_shard_enable_hpa(pa_shard_t *shard, const hpa_shard_opts_t *hpa_opts,
-    size_t sec_nshards, size_t sec_alloc_max, size_t sec_bytes_max) {
-	if (hpa_shard_init(&shard->hpa_shard, shard->emap, shard->base,
-	    &shard->edata_cache, shard->ind, hpa_opts)) {
+pa_shard_enable_hpa(tsdn_t *tsdn, pa_shard_t *shard,
+    hpa_central_t *central, pa_cpu_hpa_t *cpu_hpa,
+    const hpa_shard_opts_t *hpa_opts, const sec_opts_t *hpa_sec_opts) {
+	if (hpa_shard_init(&shard->hpa_shard, central, shard->emap,
+	    shard->base, &shard->edata_cache, shard->ind, hpa_opts)) {
 		return true;
 	}
-	if (sec_init(&shard->hpa_sec, &shard->hpa_shard.pai, sec_nshards,
-	    sec_alloc_max, sec_bytes_max)) {
+	if (sec_init(tsdn, &shard->hpa_sec, shard->base,
+	    &shard->hpa_shard.pai, hpa_sec_opts)) {
 		return true;
 	}
+	shard->cpu_hpa = cpu_hpa;
 	shard->ever_used_hpa = true;
 	atomic_store_b(&shard->use_hpa, true, ATOMIC_RELAXED);
 
 	return false;
 }
 
+bool
+pa_cpu_hpa_init(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa, unsigned nshards,
+    unsigned ncpus, hpa_central_t *central, emap_t *emap, base_t *base,
+    const hpa_shard_opts_t *hpa_opts) {
+	assert(have_percpu_arena);
+	assert(nshards > 0 && nshards <= ncpus);
+	if (edata_cache_init(&cpu_hpa->edata_cache, base)) {
+		return true;
+	}
+	hpa_shard_t *shards = (hpa_shard_t *)base_alloc(tsdn, base,
+	    nshards * sizeof(hpa_shard_t), CACHELINE);
+	if (shards == NULL) {
+		return true;
+	}
+	for (unsigned i = 0; i < nshards; i++) {
+		if (hpa_shard_init(&shards[i], central, emap, base,
+		    &cpu_hpa->edata_cache, base_ind_get(base), hpa_opts)) {
+			return true;
+		}
+	}
+	cpu_hpa->ncpus = ncpus;
+	cpu_hpa->shards = shards;
+	/* Set last; until then, nobody looks at the rest. */
+	cpu_hpa->nshards = nshards;
+	return false;
+}
+
+void
+pa_shard_set_numa_node(pa_shard_t *shard, unsigned node) {
+	assert(node < pages_numa_nnodes);
+	shard->hpa_shard.numa_node = (int)node;
+}
+
+void
+pa_cpu_hpa_set_numa_nodes(pa_cpu_hpa_t *cpu_hpa) {
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		/* The inverse of the CPU -> shard mapping in pa_cpu_hpa_alloc. */
+		unsigned cpu = (i * cpu_hpa->ncpus + cpu_hpa->nshards - 1)
+		    / cpu_hpa->nshards;
+		cpu_hpa->shards[i].numa_node = (int)pages_numa_cpu_node(
+		    (int)cpu);
+	}
+}
+
 void
 pa_shard_disable_hpa(tsdn_t *tsdn, pa_shard_t *shard) {
 	atomic_store_b(&shard->use_hpa, false, ATOMIC_RELAXED);
@@ -74,9 +132,38 @@ pa_shard_disable_hpa(tsdn_t *tsdn, pa_shard_t *shard) {
 	}
 }
 
+void
+pa_shard_disable_pac_sec(tsdn_t *tsdn, pa_shard_t *shard) {
+	/*
+	 * Rather than clearing use_pac_sec (which we'd then have to read
+	 * atomically), we leave the SEC in place but make it forward
+	 * everything to the PAC.
+	 */
+	sec_disable(tsdn, &shard->pac_sec);
+}
+
+void
+pa_shard_set_deferral_allowed(tsdn_t *tsdn, pa_shard_t *shard,
+    bool deferral_allowed) {
+	if (shard->ever_used_hpa) {
+		hpa_shard_set_deferral_allowed(tsdn, &shard->hpa_shard,
+		    deferral_allowed);
+	}
+}
+
+void
+pa_cpu_hpa_set_deferral_allowed(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa,
+    bool deferral_allowed) {
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_set_deferral_allowed(tsdn, &cpu_hpa->shards[i],
+		    deferral_allowed);
+	}
+}
+
 void
 pa_shard_reset(tsdn_t *tsdn, pa_shard_t *shard) {
 	atomic_store_zu(&shard->nactive, 0, ATOMIC_RELAXED);
+	sec_flush(tsdn, &shard->pac_sec);
 	if (shard->ever_used_hpa) {
 		sec_flush(tsdn, &shard->hpa_sec);
 	}
@@ -84,6 +171,7 @@ pa_shard_reset(tsdn_t *tsdn, pa_shard_t *shard) {
 
 void
 pa_shard_destroy(tsdn_t *tsdn, pa_shard_t *shard) {
+	sec_flush(tsdn, &shard->pac_sec);
 	pac_destroy(tsdn, &shard->pac);
 	if (shard->ever_used_hpa) {
 		sec_flush(tsdn, &shard->hpa_sec);
@@ -91,10 +179,53 @@ pa_shard_destroy(tsdn_t *tsdn, pa_shard_t *shard) {
 	}
 }
 
+static pai_t *
+pa_get_pac_pai(pa_shard_t *shard) {
+	return shard->use_pac_sec ? &shard->pac_sec.pai : &shard->pac.pai;
+}
+
 static pai_t *
 pa_get_pai(pa_shard_t *shard, edata_t *edata) {
 	return (edata_pai_get(edata) == EXTENT_PAI_PAC
-	    ? &shard->pac.pai : &shard->hpa_sec.pai);
+	    ? pa_get_pac_pai(shard) : &shard->hpa_sec.pai);
+}
+
+/*
+ * Frees of extents from the per-CPU HPA shards have to go back to the shard
+ * they came from, rather than to this one.
+ */
+static pai_t *
+pa_get_dalloc_pai(pa_shard_t *shard, edata_t *edata) {
+	if (edata_pai_get(edata) == EXTENT_PAI_HPA) {
+		hpa_shard_t *owner = hpdata_shard_get(edata_ps_get(edata));
+		if (owner != &shard->hpa_shard) {
+			edata_arena_ind_set(edata, owner->ind);
+			return &owner->pai;
+		}
+	}
+	return pa_get_pai(shard, edata);
+}
+
+static edata_t *
+pa_cpu_hpa_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size,
+    size_t alignment, bool zero) {
+	pa_cpu_hpa_t *cpu_hpa = shard->cpu_hpa;
+	if (cpu_hpa == NULL || cpu_hpa->nshards == 0) {
+		return NULL;
+	}
+	malloc_cpuid_t cpuid = malloc_getcpu();
+	if (cpuid < 0) {
+		return NULL;
+	}
+	/* Neighbouring CPUs share shards, if there are fewer shards. */
+	unsigned ind = (unsigned)cpuid % cpu_hpa->ncpus * cpu_hpa->nshards
+	    / cpu_hpa->ncpus;
+	edata_t *edata = pai_alloc(tsdn, &cpu_hpa->shards[ind].pai, size,
+	    alignment, zero);
+	if (edata != NULL) {
+		edata_arena_ind_set(edata, shard->ind);
+	}
+	return edata;
 }
 
 edata_t *
@@ -105,15 +236,22 @@ pa_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size, size_t alignment,
 
 	edata_t *edata = NULL;
 	if (atomic_load_b(&shard->use_hpa, ATOMIC_RELAXED)) {
-		edata = pai_alloc(tsdn, &shard->hpa_sec.pai, size, alignment,
-		    zero);
+		if (slab) {
+			edata = pa_cpu_hpa_alloc(tsdn, shard, size, alignment,
+			    zero);
+		}
+		if (edata == NULL) {
+			edata = pai_alloc(tsdn, &shard->hpa_sec.pai, size,
+			    alignment, zero);
+		}
 	}
 	/*
 	 * Fall back to the PAC if the HPA is off or couldn't serve the given
 	 * allocation request.
 	 */
 	if (edata == NULL) {
-		edata = pai_alloc(tsdn, &shard->pac.pai, size, alignment, zero);
+		edata = pai_alloc(tsdn, pa_get_pac_pai(shard), size, alignment,
+		    zero);
 	}
 
 	if (edata != NULL) {
@@ -153,6 +291,26 @@ pa_expand(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
 	return false;
 }
 
+bool
+pa_move(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
+    size_t new_size, szind_t szind) {
+	assert(new_size > old_size);
+	assert(edata_size_get(edata) == old_size);
+	assert((new_size & PAGE_MASK) == 0);
+
+	if (edata_pai_get(edata) != EXTENT_PAI_PAC) {
+		return true;
+	}
+	if (pac_move(tsdn, &shard->pac, edata, new_size)) {
+		return true;
+	}
+
+	pa_nactive_add(shard, (new_size - old_size) >> LG_PAGE);
+	edata_szind_set(edata, szind);
+	emap_remap(tsdn, shard->emap, edata, szind, /* slab */ false);
+	return false;
+}
+
 bool
 pa_shrink(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
     size_t new_size, szind_t szind, bool *generated_dirty) {
@@ -186,7 +344,7 @@ pa_dalloc(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata,
 	edata_addr_set(edata, edata_base_get(edata));
 	edata_szind_set(edata, SC_NSIZES);
 	pa_nactive_sub(shard, edata_size_get(edata) >> LG_PAGE);
-	pai_t *pai = pa_get_pai(shard, edata);
+	pai_t *pai = pa_get_dalloc_pai(shard, edata);
 	pai_dalloc(tsdn, pai, edata);
 	*generated_dirty = (edata_pai_get(edata) == EXTENT_PAI_PAC);
 }
@@ -208,3 +366,76 @@ ssize_t
 pa_decay_ms_get(pa_shard_t *shard, extent_state_t state) {
 	return pac_decay_ms_get(&shard->pac, state);
 }
+
+bool
+pa_hpa_dirty_decay_ms_set(tsdn_t *tsdn, pa_shard_t *shard, ssize_t decay_ms) {
+	if (!shard->ever_used_hpa) {
+		return true;
+	}
+	return hpa_shard_dirty_decay_ms_set(tsdn, &shard->hpa_shard, decay_ms);
+}
+
+ssize_t
+pa_hpa_dirty_decay_ms_get(pa_shard_t *shard) {
+	if (!shard->ever_used_hpa) {
+		return -1;
+	}
+	return hpa_shard_dirty_decay_ms_get(&shard->hpa_shard);
+}
+
+void
+pa_shard_do_deferred_work(tsdn_t *tsdn, pa_shard_t *shard) {
+	sec_do_deferred_work(tsdn, &shard->pac_sec);
+	pac_do_deferred_work(tsdn, &shard->pac);
+	if (shard->ever_used_hpa) {
+		/* Aged-out extents go to the HPA, so age them out first. */
+		sec_do_deferred_work(tsdn, &shard->hpa_sec);
+		hpa_shard_do_deferred_work(tsdn, &shard->hpa_shard);
+	}
+}
+
+uint64_t
+pa_shard_time_until_deferred_work(tsdn_t *tsdn, pa_shard_t *shard) {
+	uint64_t time_ns = sec_ns_until_deferred_work(tsdn, &shard->pac_sec);
+	uint64_t pac_ns = pac_ns_until_deferred_work(&shard->pac);
+	if (pac_ns < time_ns) {
+		time_ns = pac_ns;
+	}
+	if (!shard->ever_used_hpa) {
+		return time_ns;
+	}
+	uint64_t hpa_ns = hpa_shard_time_until_deferred_work(tsdn,
+	    &shard->hpa_shard);
+	if (hpa_ns < time_ns) {
+		time_ns = hpa_ns;
+	}
+	uint64_t sec_ns = sec_ns_until_deferred_work(tsdn, &shard->hpa_sec);
+	return sec_ns < time_ns ? sec_ns : time_ns;
+}
+
+void
+pa_cpu_hpa_do_deferred_work(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_do_deferred_work(tsdn, &cpu_hpa->shards[i]);
+	}
+}
+
+uint64_t
+pa_cpu_hpa_time_until_deferred_work(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	uint64_t time_ns = BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		uint64_t shard_ns = hpa_shard_time_until_deferred_work(tsdn,
+		    &cpu_hpa->shards[i]);
+		if (shard_ns < time_ns) {
+			time_ns = shard_ns;
+		}
+	}
+	return time_ns;
+}
+
+bool
+pa_shard_polls_for_deferred_work(pa_shard_t *shard) {
+	return shard->ever_used_hpa
+	    || (shard->use_pac_sec && shard->pac_sec.opts.max_idle_ms != 0)
+	    || pac_polls_for_deferred_work(&shard->pac);
+}
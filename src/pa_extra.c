@@ -16,6 +16,7 @@ pa_shard_prefork0(tsdn_t *tsdn, pa_shard_t *shard) {
 
 void
 pa_shard_prefork2(tsdn_t *tsdn, pa_shard_t *shard) {
+	sec_prefork2(tsdn, &shard->pac_sec);
 	if (shard->ever_used_hpa) {
 		sec_prefork2(tsdn, &shard->hpa_sec);
 	}
@@ -53,6 +54,7 @@ pa_shard_postfork_parent(tsdn_t *tsdn, pa_shard_t *shard) {
 	malloc_mutex_postfork_parent(tsdn, &shard->pac.grow_mtx);
 	malloc_mutex_postfork_parent(tsdn, &shard->pac.decay_dirty.mtx);
 	malloc_mutex_postfork_parent(tsdn, &shard->pac.decay_muzzy.mtx);
+	sec_postfork_parent(tsdn, &shard->pac_sec);
 	if (shard->ever_used_hpa) {
 		sec_postfork_parent(tsdn, &shard->hpa_sec);
 		hpa_shard_postfork_parent(tsdn, &shard->hpa_shard);
@@ -68,12 +70,54 @@ pa_shard_postfork_child(tsdn_t *tsdn, pa_shard_t *shard) {
 	malloc_mutex_postfork_child(tsdn, &shard->pac.grow_mtx);
 	malloc_mutex_postfork_child(tsdn, &shard->pac.decay_dirty.mtx);
 	malloc_mutex_postfork_child(tsdn, &shard->pac.decay_muzzy.mtx);
+	sec_postfork_child(tsdn, &shard->pac_sec);
 	if (shard->ever_used_hpa) {
 		sec_postfork_child(tsdn, &shard->hpa_sec);
 		hpa_shard_postfork_child(tsdn, &shard->hpa_shard);
 	}
 }
 
+void
+pa_cpu_hpa_prefork3(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_prefork3(tsdn, &cpu_hpa->shards[i]);
+	}
+}
+
+void
+pa_cpu_hpa_prefork4(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_prefork4(tsdn, &cpu_hpa->shards[i]);
+	}
+}
+
+void
+pa_cpu_hpa_prefork5(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	if (cpu_hpa->nshards > 0) {
+		edata_cache_prefork(tsdn, &cpu_hpa->edata_cache);
+	}
+}
+
+void
+pa_cpu_hpa_postfork_parent(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	if (cpu_hpa->nshards > 0) {
+		edata_cache_postfork_parent(tsdn, &cpu_hpa->edata_cache);
+	}
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_postfork_parent(tsdn, &cpu_hpa->shards[i]);
+	}
+}
+
+void
+pa_cpu_hpa_postfork_child(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa) {
+	if (cpu_hpa->nshards > 0) {
+		edata_cache_postfork_child(tsdn, &cpu_hpa->edata_cache);
+	}
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_postfork_child(tsdn, &cpu_hpa->shards[i]);
+	}
+}
+
 void
 pa_shard_basic_stats_merge(pa_shard_t *shard, size_t *nactive, size_t *ndirty,
     size_t *nmuzzy) {
@@ -86,7 +130,7 @@ void
 pa_shard_stats_merge(tsdn_t *tsdn, pa_shard_t *shard,
     pa_shard_stats_t *pa_shard_stats_out, pac_estats_t *estats_out,
     hpa_shard_stats_t *hpa_stats_out, sec_stats_t *sec_stats_out,
-    size_t *resident) {
+    sec_stats_t *pac_sec_stats_out, size_t *resident) {
 	cassert(config_stats);
 
 	pa_shard_stats_out->pac_stats.retained +=
@@ -127,6 +171,20 @@ pa_shard_stats_merge(tsdn_t *tsdn, pa_shard_t *shard,
 	    locked_read_u64(tsdn, LOCKEDINT_MTX(*shard->stats_mtx),
 	    &shard->pac.stats->decay_muzzy.purged));
 
+	/* Retained release stats */
+	locked_inc_u64_unsynchronized(
+	    &pa_shard_stats_out->pac_stats.retained_release.npurge,
+	    locked_read_u64(tsdn, LOCKEDINT_MTX(*shard->stats_mtx),
+	    &shard->pac.stats->retained_release.npurge));
+	locked_inc_u64_unsynchronized(
+	    &pa_shard_stats_out->pac_stats.retained_release.nmadvise,
+	    locked_read_u64(tsdn, LOCKEDINT_MTX(*shard->stats_mtx),
+	    &shard->pac.stats->retained_release.nmadvise));
+	locked_inc_u64_unsynchronized(
+	    &pa_shard_stats_out->pac_stats.retained_release.purged,
+	    locked_read_u64(tsdn, LOCKEDINT_MTX(*shard->stats_mtx),
+	    &shard->pac.stats->retained_release.purged));
+
 	atomic_load_add_store_zu(&pa_shard_stats_out->pac_stats.abandoned_vm,
 	    atomic_load_zu(&shard->pac.stats->abandoned_vm, ATOMIC_RELAXED));
 
@@ -149,12 +207,23 @@ pa_shard_stats_merge(tsdn_t *tsdn, pa_shard_t *shard,
 		estats_out[i].retained_bytes = retained_bytes;
 	}
 
+	sec_stats_merge(tsdn, &shard->pac_sec, pac_sec_stats_out);
 	if (shard->ever_used_hpa) {
 		hpa_shard_stats_merge(tsdn, &shard->hpa_shard, hpa_stats_out);
 		sec_stats_merge(tsdn, &shard->hpa_sec, sec_stats_out);
 	}
 }
 
+void
+pa_cpu_hpa_stats_merge(tsdn_t *tsdn, pa_cpu_hpa_t *cpu_hpa,
+    hpa_shard_stats_t *hpa_stats_out) {
+	cassert(config_stats);
+
+	for (unsigned i = 0; i < cpu_hpa->nshards; i++) {
+		hpa_shard_stats_merge(tsdn, &cpu_hpa->shards[i], hpa_stats_out);
+	}
+}
+
 static void
 pa_shard_mtx_stats_read_single(tsdn_t *tsdn, mutex_prof_data_t *mutex_prof_data,
     malloc_mutex_t *mtx, int ind) {
@@ -178,6 +247,8 @@ pa_shard_mtx_stats_read(tsdn_t *tsdn, pa_shard_t *shard,
 	    &shard->pac.decay_dirty.mtx, arena_prof_mutex_decay_dirty);
 	pa_shard_mtx_stats_read_single(tsdn, mutex_prof_data,
 	    &shard->pac.decay_muzzy.mtx, arena_prof_mutex_decay_muzzy);
+	sec_mutex_stats_read(tsdn, &shard->pac_sec,
+	    &mutex_prof_data[arena_prof_mutex_pac_sec]);
 
 	if (shard->ever_used_hpa) {
 		pa_shard_mtx_stats_read_single(tsdn, mutex_prof_data,
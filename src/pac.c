@@ -3,6 +3,9 @@
 
 #include "jemalloc/internal/pac.h"
 
+size_t opt_retained_limit = 0;
+ssize_t opt_retained_idle_ms = -1;
+
 static edata_t *pac_alloc_impl(tsdn_t *tsdn, pai_t *self, size_t size,
     size_t alignment, bool zero);
 static bool pac_expand_impl(tsdn_t *tsdn, pai_t *self, edata_t *edata,
@@ -74,6 +77,13 @@ pac_init(tsdn_t *tsdn, pac_t *pac, base_t *base, emap_t *emap,
 	    WITNESS_RANK_EXTENT_GROW, malloc_mutex_rank_exclusive)) {
 		return true;
 	}
+	atomic_store_zu(&pac->retained_limit, opt_retained_limit,
+	    ATOMIC_RELAXED);
+	atomic_store_zd(&pac->retained_idle_ms, opt_retained_idle_ms,
+	    ATOMIC_RELAXED);
+	pac->retained_nuse = 0;
+	pac->retained_nuse_seen = 0;
+	nstime_copy(&pac->retained_use_time, cur_time);
 	atomic_store_zu(&pac->oversize_threshold, oversize_threshold,
 	    ATOMIC_RELAXED);
 	if (decay_init(&pac->decay_dirty, cur_time, dirty_decay_ms)) {
@@ -91,9 +101,11 @@ pac_init(tsdn_t *tsdn, pac_t *pac, base_t *base, emap_t *emap,
 	atomic_store_zu(&pac->extent_sn_next, 0, ATOMIC_RELAXED);
 
 	pac->pai.alloc = &pac_alloc_impl;
+	pac->pai.alloc_batch = &pai_alloc_batch_default;
 	pac->pai.expand = &pac_expand_impl;
 	pac->pai.shrink = &pac_shrink_impl;
 	pac->pai.dalloc = &pac_dalloc_impl;
+	pac->pai.dalloc_batch = &pai_dalloc_batch_default;
 
 	return false;
 }
@@ -196,6 +208,22 @@ pac_dalloc_impl(tsdn_t *tsdn, pai_t *self, edata_t *edata) {
 	ecache_dalloc(tsdn, pac, ehooks, &pac->ecache_dirty, edata);
 }
 
+bool
+pac_move(tsdn_t *tsdn, pac_t *pac, edata_t *edata, size_t new_size) {
+	ehooks_t *ehooks = pac_ehooks_get(pac);
+	size_t old_size = edata_size_get(edata);
+
+	if (extent_move_wrapper(tsdn, pac, ehooks, edata, new_size)) {
+		return true;
+	}
+	/* The old range got unmapped, and all of the new one mapped. */
+	if (config_stats) {
+		atomic_fetch_add_zu(&pac->stats->pac_mapped,
+		    new_size - old_size, ATOMIC_RELAXED);
+	}
+	return false;
+}
+
 bool
 pac_retain_grow_limit_get_set(tsdn_t *tsdn, pac_t *pac, size_t *old_limit,
     size_t *new_limit) {
@@ -438,6 +466,148 @@ pac_decay_ms_get(pac_t *pac, extent_state_t state) {
 	return decay_ms_read(decay);
 }
 
+size_t
+pac_retained_limit_get(pac_t *pac) {
+	return atomic_load_zu(&pac->retained_limit, ATOMIC_RELAXED);
+}
+
+void
+pac_retained_limit_set(pac_t *pac, size_t limit) {
+	atomic_store_zu(&pac->retained_limit, limit, ATOMIC_RELAXED);
+}
+
+ssize_t
+pac_retained_idle_ms_get(pac_t *pac) {
+	return atomic_load_zd(&pac->retained_idle_ms, ATOMIC_RELAXED);
+}
+
+bool
+pac_retained_idle_ms_set(pac_t *pac, ssize_t idle_ms) {
+	if (!decay_ms_valid(idle_ms)) {
+		return true;
+	}
+	atomic_store_zd(&pac->retained_idle_ms, idle_ms, ATOMIC_RELAXED);
+	return false;
+}
+
+/*
+ * How many pages of retained address space to keep, going by the limit and by
+ * how long it's been since the retained ecache was last used.
+ */
+static size_t
+pac_retained_npages_keep(tsdn_t *tsdn, pac_t *pac, size_t npages) {
+	size_t limit = pac_retained_limit_get(pac);
+	if (limit != 0 && (limit >> LG_PAGE) < npages) {
+		npages = limit >> LG_PAGE;
+	}
+	ssize_t idle_ms = pac_retained_idle_ms_get(pac);
+	if (idle_ms < 0) {
+		return npages;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	malloc_mutex_lock(tsdn, &pac->grow_mtx);
+	if (pac->retained_nuse != pac->retained_nuse_seen
+	    || nstime_compare(&now, &pac->retained_use_time) < 0) {
+		/* Used since the last check (or the clock went backwards). */
+		pac->retained_nuse_seen = pac->retained_nuse;
+		nstime_copy(&pac->retained_use_time, &now);
+	} else {
+		nstime_subtract(&now, &pac->retained_use_time);
+		if (nstime_msec(&now) >= (uint64_t)idle_ms) {
+			npages = 0;
+		}
+	}
+	malloc_mutex_unlock(tsdn, &pac->grow_mtx);
+	return npages;
+}
+
+static void
+pac_retained_release(tsdn_t *tsdn, pac_t *pac) {
+	size_t npages = ecache_npages_get(&pac->ecache_retained);
+	if (npages == 0) {
+		return;
+	}
+	size_t npages_keep = pac_retained_npages_keep(tsdn, pac, npages);
+	if (npages_keep >= npages) {
+		return;
+	}
+	ehooks_t *ehooks = pac_ehooks_get(pac);
+	if (ehooks_destroy_is_noop(ehooks)) {
+		/* We'd just be forgetting about the address space. */
+		return;
+	}
+
+	/* Least recently retained first. */
+	uint64_t nunmapped = 0;
+	uint64_t npages_unmapped = 0;
+	edata_t *edata;
+	while ((edata = ecache_evict(tsdn, pac, ehooks, &pac->ecache_retained,
+	    npages_keep)) != NULL) {
+		nunmapped++;
+		npages_unmapped += edata_size_get(edata) >> LG_PAGE;
+		extent_destroy_wrapper(tsdn, pac, ehooks, edata);
+	}
+	if (nunmapped != 0) {
+		/*
+		 * Otherwise the next growth would reserve as much as the last
+		 * one did, taking us right back over the limit.
+		 */
+		malloc_mutex_lock(tsdn, &pac->grow_mtx);
+		exp_grow_restart(&pac->exp_grow, npages_keep << LG_PAGE);
+		malloc_mutex_unlock(tsdn, &pac->grow_mtx);
+	}
+
+	if (config_stats && nunmapped != 0) {
+		LOCKEDINT_MTX_LOCK(tsdn, *pac->stats_mtx);
+		locked_inc_u64(tsdn, LOCKEDINT_MTX(*pac->stats_mtx),
+		    &pac->stats->retained_release.npurge, 1);
+		locked_inc_u64(tsdn, LOCKEDINT_MTX(*pac->stats_mtx),
+		    &pac->stats->retained_release.nmadvise, nunmapped);
+		locked_inc_u64(tsdn, LOCKEDINT_MTX(*pac->stats_mtx),
+		    &pac->stats->retained_release.purged, npages_unmapped);
+		LOCKEDINT_MTX_UNLOCK(tsdn, *pac->stats_mtx);
+	}
+}
+
+void
+pac_do_deferred_work(tsdn_t *tsdn, pac_t *pac) {
+	ecache_coalesce_deferred(tsdn, pac, pac_ehooks_get(pac),
+	    &pac->ecache_dirty);
+	pac_retained_release(tsdn, pac);
+}
+
+uint64_t
+pac_ns_until_deferred_work(pac_t *pac) {
+	if (ecache_ncoalesce_pending_get(&pac->ecache_dirty) != 0) {
+		return 0;
+	}
+	size_t retained = ecache_npages_get(&pac->ecache_retained) << LG_PAGE;
+	if (retained == 0 || ehooks_destroy_is_noop(pac_ehooks_get(pac))) {
+		/* Nothing that pac_retained_release could unmap. */
+		return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	}
+	size_t limit = pac_retained_limit_get(pac);
+	if (limit != 0 && retained > limit) {
+		return 0;
+	}
+	/*
+	 * Checking back once per idle period means retained address space gets
+	 * released somewhere between one and two periods after its last use.
+	 */
+	ssize_t idle_ms = pac_retained_idle_ms_get(pac);
+	if (idle_ms >= 0) {
+		return (uint64_t)idle_ms * 1000 * 1000;
+	}
+	return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+}
+
+bool
+pac_polls_for_deferred_work(pac_t *pac) {
+	return opt_extent_coalesce_deferred || pac_retained_limit_get(pac) != 0
+	    || pac_retained_idle_ms_get(pac) >= 0;
+}
+
 void
 pac_reset(tsdn_t *tsdn, pac_t *pac) {
 	/*
@@ -16,6 +16,21 @@
 #ifdef __NetBSD__
 #include <sys/bitops.h>	/* ilog2 */
 #endif
+#if defined(JEMALLOC_HAVE_PROCESS_MADVISE) &&				\
+    defined(JEMALLOC_PURGE_MADVISE_DONTNEED) &&				\
+    defined(JEMALLOC_PURGE_MADVISE_DONTNEED_ZEROS)
+#  define PAGES_PURGE_PROCESS_MADVISE
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#endif
+#if defined(JEMALLOC_HAVE_MADVISE_COLLAPSE) && !defined(MADV_COLLAPSE)
+#  include <linux/mman.h>
+#endif
+#ifdef JEMALLOC_HAVE_MBIND
+#  include <sys/syscall.h>
+/* From <linux/mempolicy.h>, which needn't be installed. */
+#  define PAGES_MPOL_PREFERRED 1
+#endif
 #ifdef JEMALLOC_HAVE_VM_MAKE_TAG
 #define PAGES_FD_TAG VM_MAKE_TAG(101U)
 #else
@@ -47,6 +62,31 @@ thp_mode_t init_system_thp_mode;
 /* Runtime support for lazy purge. Irrelevant when !pages_can_purge_lazy. */
 static bool pages_can_purge_lazy_runtime = true;
 
+/* Whether the kernel knows MADV_COLLAPSE; detected at boot. */
+static bool pages_can_collapse_runtime = false;
+
+unsigned pages_numa_nnodes = 1;
+uint8_t pages_numa_cpu_nodes[PAGES_NUMA_CPUS_MAX];
+bool opt_numa_bind = false;
+/* Whether mbind(2) works (i.e. the kernel has NUMA support); set at boot. */
+static bool pages_can_bind_runtime = false;
+
+bool opt_process_madvise = true;
+#ifdef PAGES_PURGE_PROCESS_MADVISE
+/*
+ * A pidfd referring to ourselves, for process_madvise(2); -1 if we can't use
+ * it.  Only changes while we're single-threaded (at boot and in the child
+ * after a fork), except for being turned off below.
+ */
+static int process_madvise_pidfd = -1;
+/*
+ * Kernels before 6.13 only accept a few kinds of advice through
+ * process_madvise, none of which purge; we find out on first use, and fall
+ * back to plain madvise from then on.
+ */
+static atomic_b_t process_madvise_usable = ATOMIC_INIT(false);
+#endif
+
 #ifdef JEMALLOC_PURGE_MADVISE_DONTNEED_ZEROS
 static int madvise_dont_need_zeros_is_faulty = -1;
 /**
@@ -307,6 +347,34 @@ pages_map(void *addr, size_t size, size_t alignment, bool *commit) {
 	return ret;
 }
 
+void *
+pages_map_hugetlb(size_t size) {
+	assert(size != 0);
+	assert(HUGEPAGE_CEILING(size) == size);
+#if !defined(_WIN32) && defined(MAP_HUGETLB)
+	int flags = MAP_PRIVATE | MAP_ANON | MAP_HUGETLB;
+#  ifdef MAP_HUGE_SHIFT
+	/* Ask for our hugepage size, rather than the pool's default one. */
+	flags |= (LG_HUGEPAGE << MAP_HUGE_SHIFT);
+#  endif
+	void *ret = mmap(NULL, size, PAGES_PROT_COMMIT, flags, PAGES_FD_TAG, 0);
+	if (ret == MAP_FAILED) {
+		return NULL;
+	}
+	if (HUGEPAGE_ADDR2BASE(ret) != ret) {
+		/*
+		 * The kernel aligns hugetlb mappings to the hugepage size it
+		 * backs them with; this one must be using some other size.
+		 */
+		os_pages_unmap(ret, size);
+		return NULL;
+	}
+	return ret;
+#else
+	return NULL;
+#endif
+}
+
 void
 pages_unmap(void *addr, size_t size) {
 	assert(PAGE_ADDR2BASE(addr) == addr);
@@ -315,6 +383,55 @@ pages_unmap(void *addr, size_t size) {
 	os_pages_unmap(addr, size);
 }
 
+bool
+pages_grow(void *addr, size_t size, size_t new_size, bool *r_movable) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+	assert(PAGE_CEILING(new_size) == new_size);
+	assert(new_size > size);
+
+#ifdef PAGES_CAN_MOVE
+	/*
+	 * Without MREMAP_MAYMOVE, the kernel either grows the mapping in place
+	 * or fails without changing anything.  ENOMEM means something's in the
+	 * way; anything else (EFAULT, say, if the range spans more than one
+	 * mapping) would stop a move just the same.
+	 */
+	if (mremap(addr, size, new_size, 0) != MAP_FAILED) {
+		return false;
+	}
+	*r_movable = (errno == ENOMEM);
+	return true;
+#else
+	*r_movable = false;
+	return true;
+#endif
+}
+
+bool
+pages_move(void *addr, size_t size, void *new_addr, size_t new_size) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+	assert(PAGE_ADDR2BASE(new_addr) == new_addr);
+	assert(PAGE_CEILING(new_size) == new_size);
+
+#ifdef PAGES_CAN_MOVE
+	/*
+	 * Older kernels unmap new_addr before checking the rest, so on failure
+	 * the caller can't know what's there anymore.
+	 */
+	void *ret = mremap(addr, size, new_size, MREMAP_MAYMOVE | MREMAP_FIXED,
+	    new_addr);
+	if (ret == MAP_FAILED) {
+		return true;
+	}
+	assert(ret == new_addr);
+	return false;
+#else
+	return true;
+#endif
+}
+
 static bool
 pages_commit_impl(void *addr, size_t size, bool commit) {
 	assert(PAGE_ADDR2BASE(addr) == addr);
@@ -421,6 +538,96 @@ pages_purge_forced(void *addr, size_t size) {
 #endif
 }
 
+#ifdef PAGES_PURGE_PROCESS_MADVISE
+static void
+pages_process_madvise_init(void) {
+	if (process_madvise_pidfd != -1) {
+		close(process_madvise_pidfd);
+		process_madvise_pidfd = -1;
+	}
+	atomic_store_b(&process_madvise_usable, false, ATOMIC_RELAXED);
+	if (!opt_process_madvise || !pages_can_purge_forced
+	    || madvise_dont_need_zeros_is_faulty) {
+		return;
+	}
+	int pidfd = (int)syscall(SYS_pidfd_open, getpid(), 0);
+	if (pidfd == -1) {
+		return;
+	}
+	process_madvise_pidfd = pidfd;
+	atomic_store_b(&process_madvise_usable, true, ATOMIC_RELAXED);
+}
+
+/* Returns true on failure, in which case nothing need have been purged. */
+static bool
+pages_purge_process_madvise(const pages_range_t *ranges, size_t nranges) {
+	struct iovec vec[PAGES_PURGE_BATCH_MAX];
+	assert(nranges <= PAGES_PURGE_BATCH_MAX);
+	size_t total_size = 0;
+	for (size_t i = 0; i < nranges; i++) {
+		assert(PAGE_ADDR2BASE(ranges[i].addr) == ranges[i].addr);
+		assert(PAGE_CEILING(ranges[i].size) == ranges[i].size);
+		vec[i].iov_base = ranges[i].addr;
+		vec[i].iov_len = ranges[i].size;
+		total_size += ranges[i].size;
+	}
+	ssize_t purged = (ssize_t)syscall(SYS_process_madvise,
+	    process_madvise_pidfd, vec, nranges, MADV_DONTNEED, 0);
+	if (purged == -1 && (errno == EINVAL || errno == ENOSYS
+	    || errno == EPERM || errno == EBADF)) {
+		/* Not something retrying will fix. */
+		atomic_store_b(&process_madvise_usable, false, ATOMIC_RELAXED);
+	}
+	return purged != (ssize_t)total_size;
+}
+#endif
+
+bool
+pages_purge_forced_batch_supported(void) {
+#ifdef PAGES_PURGE_PROCESS_MADVISE
+	return atomic_load_b(&process_madvise_usable, ATOMIC_RELAXED);
+#else
+	return false;
+#endif
+}
+
+size_t
+pages_purge_forced_batch(const pages_range_t *ranges, size_t nranges) {
+	size_t nsyscalls = 0;
+	size_t i = 0;
+#ifdef PAGES_PURGE_PROCESS_MADVISE
+	while (nranges - i > 1
+	    && atomic_load_b(&process_madvise_usable, ATOMIC_RELAXED)) {
+		size_t nbatch = nranges - i;
+		if (nbatch > PAGES_PURGE_BATCH_MAX) {
+			nbatch = PAGES_PURGE_BATCH_MAX;
+		}
+		nsyscalls++;
+		if (pages_purge_process_madvise(&ranges[i], nbatch)) {
+			/*
+			 * Redo the whole batch the slow way; purging a range
+			 * twice is harmless.
+			 */
+			break;
+		}
+		i += nbatch;
+	}
+#endif
+	for (; i < nranges; i++) {
+		nsyscalls++;
+		pages_purge_forced(ranges[i].addr, ranges[i].size);
+	}
+	return nsyscalls;
+}
+
+void
+pages_postfork_child(void) {
+#ifdef PAGES_PURGE_PROCESS_MADVISE
+	/* Our pidfd still refers to the parent. */
+	pages_process_madvise_init();
+#endif
+}
+
 static bool
 pages_huge_impl(void *addr, size_t size, bool aligned) {
 	if (aligned) {
@@ -439,6 +646,23 @@ pages_huge_impl(void *addr, size_t size, bool aligned) {
 #endif
 }
 
+void
+pages_prefault(void *addr, size_t size) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+#if defined(JEMALLOC_HAVE_MADVISE) && defined(MADV_POPULATE_WRITE)
+	/* Linux 5.14 and up. */
+	if (madvise(addr, size, MADV_POPULATE_WRITE) == 0) {
+		return;
+	}
+#endif
+	/* Fresh memory is zeroed; writing zeros leaves it as it was. */
+	for (uintptr_t page = (uintptr_t)addr; page < (uintptr_t)addr + size;
+	    page += os_page) {
+		*(volatile char *)page = 0;
+	}
+}
+
 bool
 pages_huge(void *addr, size_t size) {
 	return pages_huge_impl(addr, size, true);
@@ -449,6 +673,56 @@ pages_huge_unaligned(void *addr, size_t size) {
 	return pages_huge_impl(addr, size, false);
 }
 
+static bool
+pages_collapse_impl(void *addr, size_t size) {
+	assert(HUGEPAGE_ADDR2BASE(addr) == addr);
+	assert(HUGEPAGE_CEILING(size) == size);
+#ifdef JEMALLOC_HAVE_MADVISE_COLLAPSE
+	if (!pages_can_collapse_runtime) {
+		return true;
+	}
+	return (madvise(addr, size, MADV_COLLAPSE) != 0);
+#else
+	return true;
+#endif
+}
+
+pages_collapse_t *JET_MUTABLE pages_collapse = pages_collapse_impl;
+
+static bool
+pages_collapse_supported_impl(void) {
+	return pages_can_collapse_runtime;
+}
+pages_collapse_supported_t *JET_MUTABLE pages_collapse_supported =
+    pages_collapse_supported_impl;
+
+bool
+pages_numa_bind(void *addr, size_t size, unsigned node) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+#ifdef JEMALLOC_HAVE_MBIND
+	if (!pages_can_bind_runtime || node >= PAGES_NUMA_NODES_MAX) {
+		return true;
+	}
+	enum {BITS_PER_LONG = sizeof(unsigned long) * 8};
+	unsigned long nodemask[PAGES_NUMA_NODES_MAX / BITS_PER_LONG] = {0};
+	nodemask[node / BITS_PER_LONG] = 1UL << (node % BITS_PER_LONG);
+	/*
+	 * A preferred node rather than a strict binding: if the node runs out
+	 * of memory, we'd rather get remote pages than fail.
+	 */
+	return (syscall(SYS_mbind, addr, size, PAGES_MPOL_PREFERRED, nodemask,
+	    PAGES_NUMA_NODES_MAX + 1, 0) != 0);
+#else
+	return true;
+#endif
+}
+
+bool
+pages_numa_bind_supported(void) {
+	return pages_can_bind_runtime;
+}
+
 static bool
 pages_nohuge_impl(void *addr, size_t size, bool aligned) {
 	if (aligned) {
@@ -689,6 +963,94 @@ label_error:
 	opt_thp = init_system_thp_mode = thp_mode_not_supported;
 }
 
+#ifndef _WIN32
+/*
+ * Reads up to size - 1 bytes of the given file into buf, NUL-terminating
+ * them.  Returns true on failure.
+ */
+static bool
+pages_read_file(const char *path, char *buf, size_t size) {
+#if defined(JEMALLOC_USE_SYSCALL) && defined(SYS_open)
+	int fd = (int)syscall(SYS_open, path, O_RDONLY);
+#elif defined(JEMALLOC_USE_SYSCALL) && defined(SYS_openat)
+	int fd = (int)syscall(SYS_openat, AT_FDCWD, path, O_RDONLY);
+#else
+	int fd = open(path, O_RDONLY);
+#endif
+	if (fd == -1) {
+		return true;
+	}
+	ssize_t nread = malloc_read_fd(fd, buf, size - 1);
+#if defined(JEMALLOC_USE_SYSCALL) && defined(SYS_close)
+	syscall(SYS_close, fd);
+#else
+	close(fd);
+#endif
+	if (nread < 0) {
+		return true;
+	}
+	buf[nread] = '\0';
+	return false;
+}
+
+/*
+ * Parses the next range out of a sysfs list like "0-3,8,10-11\n", returning
+ * where to continue from, or NULL once there's nothing (sensible) left.
+ */
+static const char *
+pages_numa_list_next(const char *s, unsigned *first, unsigned *last) {
+	if (*s == ',') {
+		s++;
+	}
+	if (*s < '0' || *s > '9') {
+		return NULL;
+	}
+	char *end;
+	*first = *last = (unsigned)malloc_strtoumax(s, &end, 10);
+	if (*end == '-') {
+		*last = (unsigned)malloc_strtoumax(end + 1, &end, 10);
+	}
+	return (*last < *first ? NULL : end);
+}
+
+static void
+pages_numa_init(void) {
+	char buf[4096];
+	if (pages_read_file("/sys/devices/system/node/online", buf,
+	    sizeof(buf))) {
+		return;
+	}
+	unsigned nnodes = 0;
+	unsigned first, last;
+	for (const char *s = buf; (s = pages_numa_list_next(s, &first, &last))
+	    != NULL;) {
+		nnodes = last + 1;
+	}
+	if (nnodes > PAGES_NUMA_NODES_MAX) {
+		nnodes = PAGES_NUMA_NODES_MAX;
+	}
+	for (unsigned node = 0; node < nnodes; node++) {
+		char path[64];
+		malloc_snprintf(path, sizeof(path),
+		    "/sys/devices/system/node/node%u/cpulist", node);
+		if (pages_read_file(path, buf, sizeof(buf))) {
+			/* Offline (or nonexistent) nodes have no CPUs. */
+			continue;
+		}
+		for (const char *s = buf; (s = pages_numa_list_next(s, &first,
+		    &last)) != NULL;) {
+			for (unsigned cpu = first; cpu <= last
+			    && cpu < PAGES_NUMA_CPUS_MAX; cpu++) {
+				pages_numa_cpu_nodes[cpu] = (uint8_t)node;
+			}
+		}
+	}
+	if (nnodes > 0) {
+		pages_numa_nnodes = nnodes;
+	}
+}
+#endif
+
 bool
 pages_boot(void) {
 	os_page = os_page_detect();
@@ -735,6 +1097,46 @@ pages_boot(void) {
 
 	init_thp_state();
 
+#ifdef PAGES_PURGE_PROCESS_MADVISE
+	pages_process_madvise_init();
+#endif
+
+#ifndef _WIN32
+	pages_numa_init();
+#endif
+#ifdef JEMALLOC_HAVE_MBIND
+	if (opt_numa_bind) {
+		/* Binding a page we own to node 0 fails only without NUMA. */
+		bool committed = false;
+		void *page = os_pages_map(NULL, PAGE, PAGE, &committed);
+		if (page == NULL) {
+			return true;
+		}
+		pages_can_bind_runtime = true;
+		if (pages_numa_bind(page, PAGE, 0)) {
+			pages_can_bind_runtime = false;
+		}
+		os_pages_unmap(page, PAGE);
+	}
+#endif
+	if (opt_numa_bind && !pages_can_bind_runtime) {
+		opt_numa_bind = false;
+		malloc_write("<jemalloc>: mbind(2) not available; NUMA binding "
+		    "disabled\n");
+		if (opt_abort) {
+			abort();
+		}
+	}
+
+#ifdef JEMALLOC_HAVE_MADVISE_COLLAPSE
+	/*
+	 * The kernel validates the advice before noticing that the range is
+	 * empty, so this tells us whether it knows MADV_COLLAPSE (Linux 6.1 and
+	 * later) without collapsing anything.
+	 */
+	pages_can_collapse_runtime = (madvise(NULL, 0, MADV_COLLAPSE) == 0);
+#endif
+
 #ifdef __FreeBSD__
 	/*
 	 * FreeBSD doesn't need the check; madvise(2) is known to work.
@@ -9,15 +9,19 @@ static const bitmap_info_t psset_bitmap_info =
     BITMAP_INFO_INITIALIZER(PSSET_NPSIZES);
 
 void
-psset_init(psset_t *psset) {
+psset_init(psset_t *psset, hpa_alloc_policy_t alloc_policy) {
+	assert(alloc_policy < hpa_alloc_policy_limit);
+	psset->alloc_policy = alloc_policy;
 	for (unsigned i = 0; i < PSSET_NPSIZES; i++) {
-		hpdata_age_heap_new(&psset->pageslabs[i]);
+		hpdata_alloc_heap_new(&psset->pageslabs[i]);
 	}
 	bitmap_init(psset->bitmap, &psset_bitmap_info, /* fill */ true);
 	memset(&psset->merged_stats, 0, sizeof(psset->merged_stats));
 	memset(&psset->stats, 0, sizeof(psset->stats));
 	hpdata_empty_list_init(&psset->empty);
-	hpdata_purge_list_init(&psset->to_purge);
+	hpdata_purge_list_init(&psset->to_purge[0]);
+	hpdata_purge_list_init(&psset->to_purge[1]);
+	hpdata_muzzy_purge_list_init(&psset->to_purge_muzzy);
 	hpdata_hugify_list_init(&psset->to_hugify);
 }
 
@@ -26,6 +30,8 @@ psset_bin_stats_accum(psset_bin_stats_t *dst, psset_bin_stats_t *src) {
 	dst->npageslabs += src->npageslabs;
 	dst->nactive += src->nactive;
 	dst->ndirty += src->ndirty;
+	dst->nmuzzy += src->nmuzzy;
+	dst->nhugetlb += src->nhugetlb;
 }
 
 void
@@ -40,6 +46,13 @@ psset_stats_accum(psset_stats_t *dst, psset_stats_t *src) {
 		psset_bin_stats_accum(&dst->nonfull_slabs[i][1],
 		    &src->nonfull_slabs[i][1]);
 	}
+	for (size_t i = 0; i < PSSET_NHIST; i++) {
+		for (size_t huge = 0; huge <= 1; huge++) {
+			dst->nactive_hist[i][huge] +=
+			    src->nactive_hist[i][huge];
+			dst->ndirty_hist[i][huge] += src->ndirty_hist[i][huge];
+		}
+	}
 }
 
 /*
@@ -61,10 +74,19 @@ psset_bin_stats_insert_remove(psset_t *psset, psset_bin_stats_t *binstats,
 	binstats[huge_idx].npageslabs += mul * 1;
 	binstats[huge_idx].nactive += mul * hpdata_nactive_get(ps);
 	binstats[huge_idx].ndirty += mul * hpdata_ndirty_get(ps);
+	binstats[huge_idx].nmuzzy += mul * hpdata_nmuzzy_get(ps);
+	binstats[huge_idx].nhugetlb += mul * (size_t)hpdata_hugetlb_get(ps);
 
 	psset->merged_stats.npageslabs += mul * 1;
 	psset->merged_stats.nactive += mul * hpdata_nactive_get(ps);
 	psset->merged_stats.ndirty += mul * hpdata_ndirty_get(ps);
+	psset->merged_stats.nmuzzy += mul * hpdata_nmuzzy_get(ps);
+	psset->merged_stats.nhugetlb += mul * (size_t)hpdata_hugetlb_get(ps);
+
+	psset->stats.nactive_hist[psset_hist_ind(hpdata_nactive_get(ps))][
+	    huge_idx] += mul * 1;
+	psset->stats.ndirty_hist[psset_hist_ind(hpdata_ndirty_get(ps))][
+	    huge_idx] += mul * 1;
 
 	if (config_debug) {
 		psset_bin_stats_t check_stats = {0};
@@ -82,6 +104,21 @@ psset_bin_stats_insert_remove(psset_t *psset, psset_bin_stats_t *binstats,
 		    == check_stats.npageslabs);
 		assert(psset->merged_stats.nactive == check_stats.nactive);
 		assert(psset->merged_stats.ndirty == check_stats.ndirty);
+		assert(psset->merged_stats.nmuzzy == check_stats.nmuzzy);
+		assert(psset->merged_stats.nhugetlb == check_stats.nhugetlb);
+
+		size_t nactive_hist_sum = 0;
+		size_t ndirty_hist_sum = 0;
+		for (size_t i = 0; i < PSSET_NHIST; i++) {
+			for (size_t huge = 0; huge <= 1; huge++) {
+				nactive_hist_sum +=
+				    psset->stats.nactive_hist[i][huge];
+				ndirty_hist_sum +=
+				    psset->stats.ndirty_hist[i][huge];
+			}
+		}
+		assert(nactive_hist_sum == check_stats.npageslabs);
+		assert(ndirty_hist_sum == check_stats.npageslabs);
 	}
 }
 
@@ -97,20 +134,44 @@ psset_bin_stats_remove(psset_t *psset, psset_bin_stats_t *binstats,
 	psset_bin_stats_insert_remove(psset, binstats, ps, false);
 }
 
+/*
+ * The primary ordering key of ps in its allocation heap, under the psset's
+ * allocation policy; pageslabs with smaller keys get picked first.  Only
+ * things that can't change while ps is in the heap can go into it; everything
+ * else (e.g. nactive) is only updated between psset_update_begin and
+ * psset_update_end calls, during which it's out of the heap.
+ */
+static uint64_t
+psset_alloc_key(psset_t *psset, hpdata_t *ps) {
+	switch (psset->alloc_policy) {
+	case hpa_alloc_policy_oldest:
+		/* Then the age decides by itself. */
+		return 0;
+	case hpa_alloc_policy_fullest:
+		return HUGEPAGE_PAGES - hpdata_nactive_get(ps);
+	case hpa_alloc_policy_lowest_address:
+		return (uint64_t)((uintptr_t)hpdata_addr_get(ps) >> LG_HUGEPAGE);
+	default:
+		not_reached();
+		return 0;
+	}
+}
+
 static void
 psset_hpdata_heap_remove(psset_t *psset, pszind_t pind, hpdata_t *ps) {
-	hpdata_age_heap_remove(&psset->pageslabs[pind], ps);
-	if (hpdata_age_heap_empty(&psset->pageslabs[pind])) {
+	hpdata_alloc_heap_remove(&psset->pageslabs[pind], ps);
+	if (hpdata_alloc_heap_empty(&psset->pageslabs[pind])) {
 		bitmap_set(psset->bitmap, &psset_bitmap_info, (size_t)pind);
 	}
 }
 
 static void
 psset_hpdata_heap_insert(psset_t *psset, pszind_t pind, hpdata_t *ps) {
-	if (hpdata_age_heap_empty(&psset->pageslabs[pind])) {
+	if (hpdata_alloc_heap_empty(&psset->pageslabs[pind])) {
 		bitmap_unset(psset->bitmap, &psset_bitmap_info, (size_t)pind);
 	}
-	hpdata_age_heap_insert(&psset->pageslabs[pind], ps);
+	hpdata_alloc_key_set(ps, psset_alloc_key(psset, ps));
+	hpdata_alloc_heap_insert(&psset->pageslabs[pind], ps);
 }
 
 static void
@@ -201,6 +262,21 @@ psset_alloc_container_remove(psset_t *psset, hpdata_t *ps) {
 	}
 }
 
+/*
+ * Slabs only change hugeness while out of the purge container (purging and
+ * hugifying both disallow purging first), so the hugeness at removal time
+ * matches the one at insertion.
+ */
+static void
+psset_purge_list_append(psset_t *psset, hpdata_t *ps) {
+	hpdata_purge_list_append(&psset->to_purge[hpdata_huge_get(ps)], ps);
+}
+
+static void
+psset_purge_list_remove(psset_t *psset, hpdata_t *ps) {
+	hpdata_purge_list_remove(&psset->to_purge[hpdata_huge_get(ps)], ps);
+}
+
 void
 psset_update_begin(psset_t *psset, hpdata_t *ps) {
 	hpdata_assert_consistent(ps);
@@ -217,7 +293,7 @@ psset_update_begin(psset_t *psset, hpdata_t *ps) {
 		psset_alloc_container_remove(psset, ps);
 	}
 	/*
-	 * We don't update presence in the purge list or hugify list; we try to
+	 * We don't update presence in the purge lists or hugify list; we try to
 	 * keep those FIFO, even in the presence of other metadata updates.
 	 * We'll update presence at the end of the metadata update if necessary.
 	 */
@@ -241,11 +317,21 @@ psset_update_end(psset_t *psset, hpdata_t *ps) {
 	if (hpdata_purge_allowed_get(ps)
 	    && !hpdata_in_psset_purge_container_get(ps)) {
 		hpdata_in_psset_purge_container_set(ps, true);
-		hpdata_purge_list_append(&psset->to_purge, ps);
+		psset_purge_list_append(psset, ps);
 	} else if (!hpdata_purge_allowed_get(ps)
 	    && hpdata_in_psset_purge_container_get(ps)) {
 		hpdata_in_psset_purge_container_set(ps, false);
-		hpdata_purge_list_remove(&psset->to_purge, ps);
+		psset_purge_list_remove(psset, ps);
+	}
+
+	if (hpdata_muzzy_purge_allowed_get(ps)
+	    && !hpdata_in_psset_muzzy_purge_container_get(ps)) {
+		hpdata_in_psset_muzzy_purge_container_set(ps, true);
+		hpdata_muzzy_purge_list_append(&psset->to_purge_muzzy, ps);
+	} else if (!hpdata_muzzy_purge_allowed_get(ps)
+	    && hpdata_in_psset_muzzy_purge_container_get(ps)) {
+		hpdata_in_psset_muzzy_purge_container_set(ps, false);
+		hpdata_muzzy_purge_list_remove(&psset->to_purge_muzzy, ps);
 	}
 
 	if (hpdata_hugify_allowed_get(ps)
@@ -271,7 +357,7 @@ psset_pick_alloc(psset_t *psset, size_t size) {
 	if (pind == PSSET_NPSIZES) {
 		return hpdata_empty_list_first(&psset->empty);
 	}
-	hpdata_t *ps = hpdata_age_heap_first(&psset->pageslabs[pind]);
+	hpdata_t *ps = hpdata_alloc_heap_first(&psset->pageslabs[pind]);
 	if (ps == NULL) {
 		return NULL;
 	}
@@ -283,7 +369,16 @@ psset_pick_alloc(psset_t *psset, size_t size) {
 
 hpdata_t *
 psset_pick_purge(psset_t *psset) {
-	return hpdata_purge_list_first(&psset->to_purge);
+	hpdata_t *ps = hpdata_purge_list_first(&psset->to_purge[0]);
+	if (ps != NULL) {
+		return ps;
+	}
+	return hpdata_purge_list_first(&psset->to_purge[1]);
+}
+
+hpdata_t *
+psset_pick_purge_muzzy(psset_t *psset) {
+	return hpdata_muzzy_purge_list_first(&psset->to_purge_muzzy);
 }
 
 hpdata_t *
@@ -291,6 +386,11 @@ psset_pick_hugify(psset_t *psset) {
 	return hpdata_hugify_list_first(&psset->to_hugify);
 }
 
+hpdata_t *
+psset_pick_release(psset_t *psset) {
+	return hpdata_empty_list_last(&psset->empty);
+}
+
 void
 psset_insert(psset_t *psset, hpdata_t *ps) {
 	hpdata_in_psset_set(ps, true);
@@ -301,7 +401,11 @@ psset_insert(psset_t *psset, hpdata_t *ps) {
 	}
 	if (hpdata_purge_allowed_get(ps)) {
 		hpdata_in_psset_purge_container_set(ps, true);
-		hpdata_purge_list_append(&psset->to_purge, ps);
+		psset_purge_list_append(psset, ps);
+	}
+	if (hpdata_muzzy_purge_allowed_get(ps)) {
+		hpdata_in_psset_muzzy_purge_container_set(ps, true);
+		hpdata_muzzy_purge_list_append(&psset->to_purge_muzzy, ps);
 	}
 	if (hpdata_hugify_allowed_get(ps)) {
 		hpdata_in_psset_hugify_container_set(ps, true);
@@ -319,10 +423,14 @@ psset_remove(psset_t *psset, hpdata_t *ps) {
 	}
 	if (hpdata_in_psset_purge_container_get(ps)) {
 		hpdata_in_psset_purge_container_set(ps, false);
-		hpdata_purge_list_remove(&psset->to_purge, ps);
+		psset_purge_list_remove(psset, ps);
 	}
-	if (hpdata_in_psset_purge_container_get(ps)) {
-		hpdata_in_psset_purge_container_set(ps, false);
-		hpdata_purge_list_remove(&psset->to_purge, ps);
+	if (hpdata_in_psset_muzzy_purge_container_get(ps)) {
+		hpdata_in_psset_muzzy_purge_container_set(ps, false);
+		hpdata_muzzy_purge_list_remove(&psset->to_purge_muzzy, ps);
+	}
+	if (hpdata_in_psset_hugify_container_get(ps)) {
+		hpdata_in_psset_hugify_container_set(ps, false);
+		hpdata_hugify_list_remove(&psset->to_hugify, ps);
 	}
 }
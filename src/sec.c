@@ -5,17 +5,43 @@
 
 static edata_t *sec_alloc(tsdn_t *tsdn, pai_t *self, size_t size,
     size_t alignment, bool zero);
+static size_t sec_alloc_batch(tsdn_t *tsdn, pai_t *self, size_t size,
+    size_t nallocs, edata_list_active_t *results);
 static bool sec_expand(tsdn_t *tsdn, pai_t *self, edata_t *edata,
     size_t old_size, size_t new_size, bool zero);
 static bool sec_shrink(tsdn_t *tsdn, pai_t *self, edata_t *edata,
     size_t old_size, size_t new_size);
 static void sec_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata);
+static void sec_dalloc_batch(tsdn_t *tsdn, pai_t *self,
+    edata_list_active_t *list);
 
-bool sec_init(sec_t *sec, pai_t *fallback, size_t nshards, size_t alloc_max,
-    size_t bytes_max) {
+static void
+sec_bin_init(sec_bin_t *bin) {
+	bin->being_batch_filled = false;
+	edata_list_active_init(&bin->freelist);
+	bin->bytes_cur = 0;
+	memset(&bin->stats, 0, sizeof(bin->stats));
+}
+
+bool
+sec_init(tsdn_t *tsdn, sec_t *sec, base_t *base, pai_t *fallback,
+    const sec_opts_t *opts) {
+	size_t nshards = opts->nshards;
 	if (nshards > SEC_NSHARDS_MAX) {
 		nshards = SEC_NSHARDS_MAX;
 	}
+	sec->shards = NULL;
+	if (nshards > 0) {
+		/*
+		 * Cacheline-align the array so that at least the first shard's
+		 * mutex doesn't share a line with unrelated base allocations.
+		 */
+		sec->shards = (sec_shard_t *)base_alloc(tsdn, base,
+		    nshards * sizeof(sec_shard_t), CACHELINE);
+		if (sec->shards == NULL) {
+			return true;
+		}
+	}
 	for (size_t i = 0; i < nshards; i++) {
 		sec_shard_t *shard = &sec->shards[i];
 		bool err = malloc_mutex_init(&shard->mtx, "sec_shard",
@@ -25,33 +51,47 @@ bool sec_init(sec_t *sec, pai_t *fallback, size_t nshards, size_t alloc_max,
 		}
 		shard->enabled = true;
 		for (pszind_t j = 0; j < SEC_NPSIZES; j++) {
-			edata_list_active_init(&shard->freelist[j]);
+			sec_bin_init(&shard->bins[j]);
 		}
+		edata_list_sec_init(&shard->lru);
 		shard->bytes_cur = 0;
+		shard->noverflow_flushes = 0;
 	}
 	sec->fallback = fallback;
-	sec->alloc_max = alloc_max;
-	if (sec->alloc_max > sz_pind2sz(SEC_NPSIZES - 1)) {
-		sec->alloc_max = sz_pind2sz(SEC_NPSIZES - 1);
+	sec->opts = *opts;
+	sec->opts.nshards = nshards;
+	if (!have_percpu_arena) {
+		sec->opts.shard_by_cpu = false;
+	}
+	if (sec->opts.max_alloc > sz_pind2sz(SEC_NPSIZES - 1)) {
+		sec->opts.max_alloc = sz_pind2sz(SEC_NPSIZES - 1);
+	}
+	if (sec->opts.bytes_after_flush > sec->opts.max_bytes) {
+		sec->opts.bytes_after_flush = sec->opts.max_bytes;
 	}
-
-	sec->bytes_max = bytes_max;
-	sec->nshards = nshards;
 
 	/*
 	 * Initialize these last so that an improper use of an SEC whose
 	 * initialization failed will segfault in an easy-to-spot way.
 	 */
 	sec->pai.alloc = &sec_alloc;
+	sec->pai.alloc_batch = &sec_alloc_batch;
 	sec->pai.expand = &sec_expand;
 	sec->pai.shrink = &sec_shrink;
 	sec->pai.dalloc = &sec_dalloc;
+	sec->pai.dalloc_batch = &sec_dalloc_batch;
 
 	return false;
 }
 
 static sec_shard_t *
 sec_shard_pick(tsdn_t *tsdn, sec_t *sec) {
+	if (sec->opts.shard_by_cpu) {
+		malloc_cpuid_t cpuid = malloc_getcpu();
+		if (cpuid >= 0) {
+			return &sec->shards[(size_t)cpuid % sec->opts.nshards];
+		}
+	}
 	/*
 	 * Eventually, we should implement affinity, tracking source shard using
 	 * the edata_t's newly freed up fields.  For now, just randomly
@@ -60,65 +100,290 @@ sec_shard_pick(tsdn_t *tsdn, sec_t *sec) {
 	if (tsdn_null(tsdn)) {
 		return &sec->shards[0];
 	}
+	/*
+	 * The per-thread value is shared by every SEC the thread uses, and
+	 * they needn't agree on their number of shards; so we keep a random
+	 * 16-bit fraction in the tsd, and scale it by this SEC's nshards here
+	 * (the trick from Daniel Lemire's "A fast alternative to the modulo
+	 * reduction").
+	 */
 	tsd_t *tsd = tsdn_tsd(tsdn);
-	uint8_t *idxp = tsd_sec_shardp_get(tsd);
-	if (*idxp == (uint8_t)-1) {
-		/*
-		 * First use; initialize using the trick from Daniel Lemire's
-		 * "A fast alternative to the modulo reduction.  Use a 64 bit
-		 * number to store 32 bits, since we'll deliberately overflow
-		 * when we multiply by the number of shards.
-		 */
-		uint64_t rand32 = prng_lg_range_u64(tsd_prng_statep_get(tsd), 32);
-		uint32_t idx = (uint32_t)((rand32 * (uint64_t)sec->nshards) >> 32);
-		assert(idx < (uint32_t)sec->nshards);
-		*idxp = (uint8_t)idx;
+	uint16_t *fracp = tsd_sec_shardp_get(tsd);
+	if (*fracp == (uint16_t)-1) {
+		/* First use; the all-ones value means "unassigned". */
+		*fracp = (uint16_t)prng_range_u64(tsd_prng_statep_get(tsd),
+		    UINT16_MAX);
+	}
+	size_t idx = ((size_t)*fracp * sec->opts.nshards) >> 16;
+	assert(idx < sec->opts.nshards);
+	return &sec->shards[idx];
+}
+
+/*
+ * Records that edata was just cached in the shard, as of now (which may be
+ * NULL if we don't track idle times).
+ */
+static void
+sec_shard_lru_append_locked(tsdn_t *tsdn, sec_shard_t *shard, edata_t *edata,
+    nstime_t *now) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	if (now != NULL) {
+		edata_sec_cached_time_set(edata, now);
+	}
+	edata_list_sec_append(&shard->lru, edata);
+}
+
+/*
+ * The number of nanoseconds until edata will have been cached for longer than
+ * max_idle_ms; 0 if it already has.
+ */
+static uint64_t
+sec_ns_until_idle(sec_t *sec, const nstime_t *now, edata_t *edata) {
+	nstime_t deadline;
+	nstime_copy(&deadline, edata_sec_cached_time_get(edata));
+	nstime_iadd(&deadline, sec->opts.max_idle_ms * KQU(1000000));
+	if (nstime_compare(&deadline, now) <= 0) {
+		return 0;
+	}
+	nstime_subtract(&deadline, now);
+	return nstime_ns(&deadline);
+}
+
+/* Takes edata out of the shard, and moves it onto to_flush. */
+static void
+sec_shard_evict_locked(tsdn_t *tsdn, sec_shard_t *shard, edata_t *edata,
+    edata_list_active_t *to_flush) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	size_t size = edata_size_get(edata);
+	sec_bin_t *bin = &shard->bins[sz_psz2ind(size)];
+	assert(size <= bin->bytes_cur && size <= shard->bytes_cur);
+	edata_list_sec_remove(&shard->lru, edata);
+	edata_list_active_remove(&bin->freelist, edata);
+	bin->bytes_cur -= size;
+	shard->bytes_cur -= size;
+	bin->stats.nflushed++;
+	edata_list_active_append(to_flush, edata);
+}
+
+/*
+ * Empties the shard onto to_flush.  The caller hands the extents to the
+ * fallback once it has dropped the shard lock; some fallbacks (e.g. the PAC)
+ * may not be called with it held.
+ */
+static void
+sec_do_flush_locked(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard,
+    edata_list_active_t *to_flush) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	shard->bytes_cur = 0;
+	edata_list_sec_init(&shard->lru);
+	for (pszind_t i = 0; i < SEC_NPSIZES; i++) {
+		sec_bin_t *bin = &shard->bins[i];
+		/* Every extent in a bin has the bin's size. */
+		bin->stats.nflushed += bin->bytes_cur / sz_pind2sz(i);
+		bin->bytes_cur = 0;
+		edata_list_active_concat(to_flush, &bin->freelist);
+	}
+}
+
+/*
+ * Called once we've exceeded the shard limit; moves the least recently cached
+ * extents in the shard, regardless of bin, onto to_flush until we're back
+ * down to bytes_after_flush.  As with full flushes, the caller returns them to
+ * the fallback after unlocking.
+ */
+static void
+sec_do_overflow_flush_locked(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard,
+    edata_list_active_t *to_flush) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	shard->noverflow_flushes++;
+	while (shard->bytes_cur > sec->opts.bytes_after_flush) {
+		edata_t *edata = edata_list_sec_first(&shard->lru);
+		assert(edata != NULL);
+		sec_shard_evict_locked(tsdn, shard, edata, to_flush);
 	}
-	return &sec->shards[*idxp];
 }
 
 static edata_t *
 sec_shard_alloc_locked(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard,
-    pszind_t pszind) {
+    sec_bin_t *bin) {
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 	if (!shard->enabled) {
 		return NULL;
 	}
-	edata_t *edata = edata_list_active_first(&shard->freelist[pszind]);
+	edata_t *edata = edata_list_active_first(&bin->freelist);
 	if (edata != NULL) {
-		edata_list_active_remove(&shard->freelist[pszind], edata);
-		assert(edata_size_get(edata) <= shard->bytes_cur);
-		shard->bytes_cur -= edata_size_get(edata);
+		edata_list_active_remove(&bin->freelist, edata);
+		edata_list_sec_remove(&shard->lru, edata);
+		size_t size = edata_size_get(edata);
+		assert(size <= bin->bytes_cur && size <= shard->bytes_cur);
+		bin->bytes_cur -= size;
+		shard->bytes_cur -= size;
+		bin->stats.nhits++;
 	}
 	return edata;
 }
 
+/*
+ * Called on a miss; decides how many extents beyond the one being allocated we
+ * should fetch from the fallback to cache.  A nonzero return claims the bin's
+ * batch fill, which the caller must complete with sec_batch_fill_and_alloc.
+ */
+static size_t
+sec_batch_fill_nextra_locked(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard,
+    sec_bin_t *bin, size_t size) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	if (!shard->enabled || bin->being_batch_filled) {
+		return 0;
+	}
+	assert(shard->bytes_cur <= sec->opts.max_bytes);
+	size_t nextra = (sec->opts.max_bytes - shard->bytes_cur) / size;
+	if (nextra > sec->opts.batch_fill_extra) {
+		nextra = sec->opts.batch_fill_extra;
+	}
+	if (nextra > 0) {
+		bin->being_batch_filled = true;
+	}
+	return nextra;
+}
+
+static edata_t *
+sec_batch_fill_and_alloc(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard,
+    sec_bin_t *bin, size_t size, size_t nextra) {
+	malloc_mutex_assert_not_owner(tsdn, &shard->mtx);
+
+	edata_list_active_t result;
+	edata_list_active_init(&result);
+	size_t nalloc = pai_alloc_batch(tsdn, sec->fallback, size, 1 + nextra,
+	    &result);
+
+	edata_t *ret = edata_list_active_first(&result);
+	if (ret != NULL) {
+		edata_list_active_remove(&result, ret);
+	}
+
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	bin->being_batch_filled = false;
+	if (nalloc <= 1) {
+		/*
+		 * Nothing to cache.  The fallback is allowed to return a short
+		 * batch without being out of memory, so we still need to try
+		 * the single allocation if we got nothing at all.
+		 */
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		if (ret == NULL) {
+			ret = pai_alloc(tsdn, sec->fallback, size, PAGE,
+			    /* zero */ false);
+		}
+		return ret;
+	}
+	if (!shard->enabled) {
+		/* We got disabled while the lock was dropped. */
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		pai_dalloc_batch(tsdn, sec->fallback, &result);
+		return ret;
+	}
+	nstime_t now;
+	if (sec->opts.max_idle_ms != 0) {
+		nstime_init_update(&now);
+	}
+	edata_t *edata;
+	ql_foreach(edata, &result.head, ql_link_active) {
+		sec_shard_lru_append_locked(tsdn, shard, edata,
+		    sec->opts.max_idle_ms != 0 ? &now : NULL);
+	}
+	edata_list_active_concat(&bin->freelist, &result);
+	bin->bytes_cur += (nalloc - 1) * size;
+	shard->bytes_cur += (nalloc - 1) * size;
+	bin->stats.nfills++;
+	bin->stats.nfilled += nalloc - 1;
+	/*
+	 * We sized the batch to fit, but deallocations may have raced with us
+	 * while the lock was dropped.
+	 */
+	edata_list_active_t to_flush;
+	edata_list_active_init(&to_flush);
+	if (shard->bytes_cur > sec->opts.max_bytes) {
+		sec_do_overflow_flush_locked(tsdn, sec, shard, &to_flush);
+	}
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	if (!edata_list_active_empty(&to_flush)) {
+		pai_dalloc_batch(tsdn, sec->fallback, &to_flush);
+	}
+	return ret;
+}
+
 static edata_t *
 sec_alloc(tsdn_t *tsdn, pai_t *self, size_t size, size_t alignment, bool zero) {
 	assert((size & PAGE_MASK) == 0);
 
 	sec_t *sec = (sec_t *)self;
 
-	if (zero || alignment > PAGE || sec->nshards == 0
-	    || size > sec->alloc_max) {
+	if (zero || alignment > PAGE || sec->opts.nshards == 0
+	    || size > sec->opts.max_alloc) {
 		return pai_alloc(tsdn, sec->fallback, size, alignment, zero);
 	}
 	pszind_t pszind = sz_psz2ind(size);
 	sec_shard_t *shard = sec_shard_pick(tsdn, sec);
+	sec_bin_t *bin = &shard->bins[pszind];
+	size_t nextra = 0;
 	malloc_mutex_lock(tsdn, &shard->mtx);
-	edata_t *edata = sec_shard_alloc_locked(tsdn, sec, shard, pszind);
+	edata_t *edata = sec_shard_alloc_locked(tsdn, sec, shard, bin);
+	if (edata == NULL && shard->enabled) {
+		bin->stats.nmisses++;
+		nextra = sec_batch_fill_nextra_locked(tsdn, sec, shard, bin,
+		    size);
+	}
 	malloc_mutex_unlock(tsdn, &shard->mtx);
 	if (edata == NULL) {
-		/*
-		 * See the note in dalloc, below; really, we should add a
-		 * batch_alloc method to the PAI and get more than one extent at
-		 * a time.
-		 */
-		edata = pai_alloc(tsdn, sec->fallback, size, alignment, zero);
+		if (nextra > 0) {
+			edata = sec_batch_fill_and_alloc(tsdn, sec, shard, bin,
+			    size, nextra);
+		} else {
+			edata = pai_alloc(tsdn, sec->fallback, size, alignment,
+			    zero);
+		}
 	}
 	return edata;
 }
 
+static size_t
+sec_alloc_batch(tsdn_t *tsdn, pai_t *self, size_t size, size_t nallocs,
+    edata_list_active_t *results) {
+	assert((size & PAGE_MASK) == 0);
+
+	sec_t *sec = (sec_t *)self;
+
+	if (sec->opts.nshards == 0 || size > sec->opts.max_alloc) {
+		return pai_alloc_batch(tsdn, sec->fallback, size, nallocs,
+		    results);
+	}
+	pszind_t pszind = sz_psz2ind(size);
+	sec_shard_t *shard = sec_shard_pick(tsdn, sec);
+	sec_bin_t *bin = &shard->bins[pszind];
+	size_t nsuccess = 0;
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	for (; nsuccess < nallocs; nsuccess++) {
+		edata_t *edata = sec_shard_alloc_locked(tsdn, sec, shard, bin);
+		if (edata == NULL) {
+			break;
+		}
+		edata_list_active_append(results, edata);
+	}
+	if (shard->enabled) {
+		bin->stats.nmisses += nallocs - nsuccess;
+	}
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	/*
+	 * Callers asking for a batch already get to amortize the fallback's
+	 * locking, so we don't bother overfetching on their behalf.
+	 */
+	if (nsuccess < nallocs) {
+		nsuccess += pai_alloc_batch(tsdn, sec->fallback, size,
+		    nallocs - nsuccess, results);
+	}
+	return nsuccess;
+}
+
 static bool
 sec_expand(tsdn_t *tsdn, pai_t *self, edata_t *edata, size_t old_size,
     size_t new_size, bool zero) {
@@ -133,113 +398,195 @@ sec_shrink(tsdn_t *tsdn, pai_t *self, edata_t *edata, size_t old_size,
 	return pai_shrink(tsdn, sec->fallback, edata, old_size, new_size);
 }
 
-static void
-sec_do_flush_locked(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard) {
-	malloc_mutex_assert_owner(tsdn, &shard->mtx);
-	shard->bytes_cur = 0;
-	edata_list_active_t to_flush;
-	edata_list_active_init(&to_flush);
-	for (pszind_t i = 0; i < SEC_NPSIZES; i++) {
-		edata_list_active_concat(&to_flush, &shard->freelist[i]);
-	}
-	/*
-	 * A better way to do this would be to add a batch dalloc function to
-	 * the pai_t.  Practically, the current method turns into O(n) locks and
-	 * unlocks at the fallback allocator.  But some implementations (e.g.
-	 * HPA) can straightforwardly do many deallocations in a single lock /
-	 * unlock pair.
-	 */
-	while (!edata_list_active_empty(&to_flush)) {
-		edata_t *e = edata_list_active_first(&to_flush);
-		edata_list_active_remove(&to_flush, e);
-		pai_dalloc(tsdn, sec->fallback, e);
-	}
-}
-
 static void
 sec_shard_dalloc_locked(tsdn_t *tsdn, sec_t *sec, sec_shard_t *shard,
-    edata_t *edata) {
+    edata_t *edata, edata_list_active_t *to_flush) {
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
-	assert(shard->bytes_cur <= sec->bytes_max);
+	assert(shard->bytes_cur <= sec->opts.max_bytes);
 	size_t size = edata_size_get(edata);
 	pszind_t pszind = sz_psz2ind(size);
 	/*
 	 * Prepending here results in FIFO allocation per bin, which seems
 	 * reasonable.
 	 */
-	edata_list_active_prepend(&shard->freelist[pszind], edata);
+	sec_bin_t *bin = &shard->bins[pszind];
+	edata_list_active_prepend(&bin->freelist, edata);
+	nstime_t now;
+	if (sec->opts.max_idle_ms != 0) {
+		nstime_init_update(&now);
+	}
+	sec_shard_lru_append_locked(tsdn, shard, edata,
+	    sec->opts.max_idle_ms != 0 ? &now : NULL);
+	bin->bytes_cur += size;
 	shard->bytes_cur += size;
-	if (shard->bytes_cur > sec->bytes_max) {
-		/*
-		 * We've exceeded the shard limit.  We make two nods in the
-		 * direction of fragmentation avoidance: we flush everything in
-		 * the shard, rather than one particular bin, and we hold the
-		 * lock while flushing (in case one of the extents we flush is
-		 * highly preferred from a fragmentation-avoidance perspective
-		 * in the backing allocator).  This has the extra advantage of
-		 * not requiring advanced cache balancing strategies.
-		 */
-		sec_do_flush_locked(tsdn, sec, shard);
+	if (shard->bytes_cur > sec->opts.max_bytes) {
+		sec_do_overflow_flush_locked(tsdn, sec, shard, to_flush);
 	}
 }
 
 static void
 sec_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata) {
 	sec_t *sec = (sec_t *)self;
-	if (sec->nshards == 0 || edata_size_get(edata) > sec->alloc_max) {
+	if (sec->opts.nshards == 0
+	    || edata_size_get(edata) > sec->opts.max_alloc) {
 		pai_dalloc(tsdn, sec->fallback, edata);
 		return;
 	}
+	edata_list_active_t to_flush;
+	edata_list_active_init(&to_flush);
 	sec_shard_t *shard = sec_shard_pick(tsdn, sec);
 	malloc_mutex_lock(tsdn, &shard->mtx);
 	if (shard->enabled) {
-		sec_shard_dalloc_locked(tsdn, sec, shard, edata);
+		sec_shard_dalloc_locked(tsdn, sec, shard, edata, &to_flush);
 		malloc_mutex_unlock(tsdn, &shard->mtx);
+		if (!edata_list_active_empty(&to_flush)) {
+			pai_dalloc_batch(tsdn, sec->fallback, &to_flush);
+		}
 	} else {
 		malloc_mutex_unlock(tsdn, &shard->mtx);
 		pai_dalloc(tsdn, sec->fallback, edata);
 	}
 }
 
+static void
+sec_dalloc_batch(tsdn_t *tsdn, pai_t *self, edata_list_active_t *list) {
+	sec_t *sec = (sec_t *)self;
+	if (sec->opts.nshards == 0) {
+		pai_dalloc_batch(tsdn, sec->fallback, list);
+		return;
+	}
+	/*
+	 * Anything we can't cache, or that overflow flushes evict, gets passed
+	 * along in a batch of its own.
+	 */
+	edata_list_active_t to_fallback;
+	edata_list_active_init(&to_fallback);
+	sec_shard_t *shard = sec_shard_pick(tsdn, sec);
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	edata_t *edata;
+	while ((edata = edata_list_active_first(list)) != NULL) {
+		edata_list_active_remove(list, edata);
+		if (shard->enabled
+		    && edata_size_get(edata) <= sec->opts.max_alloc) {
+			sec_shard_dalloc_locked(tsdn, sec, shard, edata,
+			    &to_fallback);
+		} else {
+			edata_list_active_append(&to_fallback, edata);
+		}
+	}
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	if (!edata_list_active_empty(&to_fallback)) {
+		pai_dalloc_batch(tsdn, sec->fallback, &to_fallback);
+	}
+}
+
 void
 sec_flush(tsdn_t *tsdn, sec_t *sec) {
-	for (size_t i = 0; i < sec->nshards; i++) {
+	edata_list_active_t to_flush;
+	edata_list_active_init(&to_flush);
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		malloc_mutex_lock(tsdn, &sec->shards[i].mtx);
-		sec_do_flush_locked(tsdn, sec, &sec->shards[i]);
+		sec_do_flush_locked(tsdn, sec, &sec->shards[i], &to_flush);
 		malloc_mutex_unlock(tsdn, &sec->shards[i].mtx);
 	}
+	/*
+	 * Some implementations (e.g. HPA) can do many deallocations in a
+	 * single lock / unlock pair; others fall back to one dalloc apiece.
+	 */
+	if (!edata_list_active_empty(&to_flush)) {
+		pai_dalloc_batch(tsdn, sec->fallback, &to_flush);
+	}
 }
 
 void
 sec_disable(tsdn_t *tsdn, sec_t *sec) {
-	for (size_t i = 0; i < sec->nshards; i++) {
+	edata_list_active_t to_flush;
+	edata_list_active_init(&to_flush);
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		malloc_mutex_lock(tsdn, &sec->shards[i].mtx);
 		sec->shards[i].enabled = false;
-		sec_do_flush_locked(tsdn, sec, &sec->shards[i]);
+		sec_do_flush_locked(tsdn, sec, &sec->shards[i], &to_flush);
 		malloc_mutex_unlock(tsdn, &sec->shards[i].mtx);
 	}
+	if (!edata_list_active_empty(&to_flush)) {
+		pai_dalloc_batch(tsdn, sec->fallback, &to_flush);
+	}
+}
+
+void
+sec_do_deferred_work(tsdn_t *tsdn, sec_t *sec) {
+	if (sec->opts.max_idle_ms == 0) {
+		return;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	edata_list_active_t to_flush;
+	edata_list_active_init(&to_flush);
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
+		sec_shard_t *shard = &sec->shards[i];
+		malloc_mutex_lock(tsdn, &shard->mtx);
+		edata_t *edata;
+		while ((edata = edata_list_sec_first(&shard->lru)) != NULL
+		    && sec_ns_until_idle(sec, &now, edata) == 0) {
+			sec_shard_evict_locked(tsdn, shard, edata, &to_flush);
+		}
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+	}
+	if (!edata_list_active_empty(&to_flush)) {
+		pai_dalloc_batch(tsdn, sec->fallback, &to_flush);
+	}
+}
+
+uint64_t
+sec_ns_until_deferred_work(tsdn_t *tsdn, sec_t *sec) {
+	if (sec->opts.max_idle_ms == 0) {
+		return BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	uint64_t time_ns = BACKGROUND_THREAD_INDEFINITE_SLEEP;
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
+		sec_shard_t *shard = &sec->shards[i];
+		malloc_mutex_lock(tsdn, &shard->mtx);
+		/* The LRU is ordered by caching time; only the head matters. */
+		edata_t *edata = edata_list_sec_first(&shard->lru);
+		if (edata != NULL) {
+			uint64_t ns = sec_ns_until_idle(sec, &now, edata);
+			if (ns < time_ns) {
+				time_ns = ns;
+			}
+		}
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+	}
+	return time_ns;
 }
 
 void
 sec_stats_merge(tsdn_t *tsdn, sec_t *sec, sec_stats_t *stats) {
-	size_t sum = 0;
-	for (size_t i = 0; i < sec->nshards; i++) {
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		/*
-		 * We could save these lock acquisitions by making bytes_cur
-		 * atomic, but stats collection is rare anyways and we expect
-		 * the number and type of stats to get more interesting.
+		 * We could save these lock acquisitions by making the counters
+		 * atomic, but stats collection is rare anyways.
 		 */
-		malloc_mutex_lock(tsdn, &sec->shards[i].mtx);
-		sum += sec->shards[i].bytes_cur;
-		malloc_mutex_unlock(tsdn, &sec->shards[i].mtx);
+		sec_shard_t *shard = &sec->shards[i];
+		malloc_mutex_lock(tsdn, &shard->mtx);
+		stats->bytes += shard->bytes_cur;
+		stats->noverflow_flushes += shard->noverflow_flushes;
+		for (pszind_t j = 0; j < SEC_NPSIZES; j++) {
+			sec_bin_t *bin = &shard->bins[j];
+			sec_bin_stats_t bin_stats = bin->stats;
+			bin_stats.bytes = bin->bytes_cur;
+			sec_bin_stats_accum(&stats->bins[j], &bin_stats);
+			sec_bin_stats_accum(&stats->total, &bin_stats);
+		}
+		malloc_mutex_unlock(tsdn, &shard->mtx);
 	}
-	stats->bytes += sum;
 }
 
 void
 sec_mutex_stats_read(tsdn_t *tsdn, sec_t *sec,
     mutex_prof_data_t *mutex_prof_data) {
-	for (size_t i = 0; i < sec->nshards; i++) {
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		malloc_mutex_lock(tsdn, &sec->shards[i].mtx);
 		malloc_mutex_prof_accum(tsdn, mutex_prof_data,
 		    &sec->shards[i].mtx);
@@ -249,21 +596,21 @@ sec_mutex_stats_read(tsdn_t *tsdn, sec_t *sec,
 
 void
 sec_prefork2(tsdn_t *tsdn, sec_t *sec) {
-	for (size_t i = 0; i < sec->nshards; i++) {
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		malloc_mutex_prefork(tsdn, &sec->shards[i].mtx);
 	}
 }
 
 void
 sec_postfork_parent(tsdn_t *tsdn, sec_t *sec) {
-	for (size_t i = 0; i < sec->nshards; i++) {
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		malloc_mutex_postfork_parent(tsdn, &sec->shards[i].mtx);
 	}
 }
 
 void
 sec_postfork_child(tsdn_t *tsdn, sec_t *sec) {
-	for (size_t i = 0; i < sec->nshards; i++) {
+	for (size_t i = 0; i < sec->opts.nshards; i++) {
 		malloc_mutex_postfork_child(tsdn, &sec->shards[i].mtx);
 	}
 }
@@ -784,6 +784,89 @@ stats_arena_extents_print(emitter_t *emitter, unsigned i) {
 	}
 }
 
+/*
+ * Prints the histograms of how many pages of each pageslab are active, and how
+ * many are dirty.
+ */
+static void
+stats_arena_hpa_shard_hist_print(emitter_t *emitter, unsigned i) {
+	emitter_row_t header_row;
+	emitter_row_init(&header_row);
+	emitter_row_t row;
+	emitter_row_init(&row);
+
+	COL_HDR(row, pages, NULL, right, 12, title)
+	COL_HDR(row, nactive_huge, NULL, right, 16, size)
+	COL_HDR(row, nactive_nonhuge, NULL, right, 20, size)
+	COL_HDR(row, ndirty_huge, NULL, right, 16, size)
+	COL_HDR(row, ndirty_nonhuge, NULL, right, 20, size)
+
+	size_t nactive_mib[CTL_MAX_DEPTH];
+	CTL_LEAF_PREPARE(nactive_mib, 0, "stats.arenas");
+	nactive_mib[2] = i;
+	CTL_LEAF_PREPARE(nactive_mib, 3, "hpa_shard.nactive_hist");
+	size_t ndirty_mib[CTL_MAX_DEPTH];
+	CTL_LEAF_PREPARE(ndirty_mib, 0, "stats.arenas");
+	ndirty_mib[2] = i;
+	CTL_LEAF_PREPARE(ndirty_mib, 3, "hpa_shard.ndirty_hist");
+
+	size_t nactive_hist[PSSET_NHIST][2];
+	size_t ndirty_hist[PSSET_NHIST][2];
+	for (size_t j = 0; j < PSSET_NHIST; j++) {
+		nactive_mib[5] = j;
+		CTL_LEAF(nactive_mib, 6, "npageslabs_nonhuge",
+		    &nactive_hist[j][0], size_t);
+		CTL_LEAF(nactive_mib, 6, "npageslabs_huge",
+		    &nactive_hist[j][1], size_t);
+		ndirty_mib[5] = j;
+		CTL_LEAF(ndirty_mib, 6, "npageslabs_nonhuge",
+		    &ndirty_hist[j][0], size_t);
+		CTL_LEAF(ndirty_mib, 6, "npageslabs_huge",
+		    &ndirty_hist[j][1], size_t);
+	}
+
+	emitter_table_printf(emitter,
+	    "  Pageslabs by number of active / dirty pages:\n");
+	emitter_table_row(emitter, &header_row);
+	for (size_t j = 0; j < PSSET_NHIST; j++) {
+		/* The inverse of psset_hist_ind. */
+		size_t first = (j * HUGEPAGE_PAGES + PSSET_NHIST - 1)
+		    / PSSET_NHIST;
+		size_t last = (j == PSSET_NHIST - 1 ? HUGEPAGE_PAGES :
+		    ((j + 1) * HUGEPAGE_PAGES + PSSET_NHIST - 1) / PSSET_NHIST
+		    - 1);
+		char pages[32];
+		malloc_snprintf(pages, sizeof(pages), "%zu-%zu", first, last);
+		col_pages.str_val = pages;
+		col_nactive_huge.size_val = nactive_hist[j][1];
+		col_nactive_nonhuge.size_val = nactive_hist[j][0];
+		col_ndirty_huge.size_val = ndirty_hist[j][1];
+		col_ndirty_nonhuge.size_val = ndirty_hist[j][0];
+		emitter_table_row(emitter, &row);
+	}
+
+	emitter_json_array_kv_begin(emitter, "nactive_hist");
+	for (size_t j = 0; j < PSSET_NHIST; j++) {
+		emitter_json_object_begin(emitter);
+		emitter_json_kv(emitter, "npageslabs_huge", emitter_type_size,
+		    &nactive_hist[j][1]);
+		emitter_json_kv(emitter, "npageslabs_nonhuge",
+		    emitter_type_size, &nactive_hist[j][0]);
+		emitter_json_object_end(emitter);
+	}
+	emitter_json_array_end(emitter); /* End "nactive_hist" */
+	emitter_json_array_kv_begin(emitter, "ndirty_hist");
+	for (size_t j = 0; j < PSSET_NHIST; j++) {
+		emitter_json_object_begin(emitter);
+		emitter_json_kv(emitter, "npageslabs_huge", emitter_type_size,
+		    &ndirty_hist[j][1]);
+		emitter_json_kv(emitter, "npageslabs_nonhuge",
+		    emitter_type_size, &ndirty_hist[j][0]);
+		emitter_json_object_end(emitter);
+	}
+	emitter_json_array_end(emitter); /* End "ndirty_hist" */
+}
+
 static void
 stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 	emitter_row_t header_row;
@@ -793,25 +876,51 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 
 	uint64_t npurge_passes;
 	uint64_t npurges;
+	uint64_t npurged;
+	uint64_t npurge_syscalls;
 	uint64_t nhugifies;
+	uint64_t nhugify_failures;
 	uint64_t ndehugifies;
+	uint64_t ndehugifies_early;
+	uint64_t nempty_releases;
+	uint64_t nempty_pooled;
+	uint64_t ndeferred_inline;
+	uint64_t ndeferred_background;
 
 	CTL_M2_GET("stats.arenas.0.hpa_shard.npurge_passes",
 	    i, &npurge_passes, uint64_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.npurges",
 	    i, &npurges, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.npurged",
+	    i, &npurged, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.npurge_syscalls",
+	    i, &npurge_syscalls, uint64_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.nhugifies",
 	    i, &nhugifies, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.nhugify_failures",
+	    i, &nhugify_failures, uint64_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.ndehugifies",
 	    i, &ndehugifies, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.ndehugifies_early",
+	    i, &ndehugifies_early, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.nempty_releases",
+	    i, &nempty_releases, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.nempty_pooled",
+	    i, &nempty_pooled, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.ndeferred_inline",
+	    i, &ndeferred_inline, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.ndeferred_background",
+	    i, &ndeferred_background, uint64_t);
 
 	size_t npageslabs_huge;
+	size_t npageslabs_hugetlb;
 	size_t nactive_huge;
 	size_t ndirty_huge;
 
 	size_t npageslabs_nonhuge;
 	size_t nactive_nonhuge;
 	size_t ndirty_nonhuge;
+	size_t nmuzzy_nonhuge;
 	size_t nretained_nonhuge;
 
 	size_t sec_bytes;
@@ -824,27 +933,67 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 	    "HPA shard stats:\n"
 	    "  Purge passes: %" FMTu64 " (%" FMTu64 " / sec)\n"
 	    "  Purges: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Pages purged: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Purge syscalls: %" FMTu64 " (%" FMTu64 " / sec, %" FMTu64
+	    " purges / syscall)\n"
 	    "  Hugeifies: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Hugeify failures: %" FMTu64 " (%" FMTu64 " / sec)\n"
 	    "  Dehugifies: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Dehugifies within %" FMTu64 "s of hugify: %" FMTu64 " (%"
+	    FMTu64 " / sec)\n"
+	    "  Empty pageslabs released: %" FMTu64 " (%" FMTu64 " / sec, %"
+	    FMTu64 " to the central pool)\n"
+	    "  Deferred work done inline: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Deferred work done in background: %" FMTu64 " (%" FMTu64
+	    " / sec)\n"
 	    "\n",
 	    npurge_passes, rate_per_second(npurge_passes, uptime),
 	    npurges, rate_per_second(npurges, uptime),
+	    npurged, rate_per_second(npurged, uptime),
+	    npurge_syscalls, rate_per_second(npurge_syscalls, uptime),
+	    npurge_syscalls == 0 ? 0 : npurges / npurge_syscalls,
 	    nhugifies, rate_per_second(nhugifies, uptime),
-	    ndehugifies, rate_per_second(ndehugifies, uptime));
+	    nhugify_failures, rate_per_second(nhugify_failures, uptime),
+	    ndehugifies, rate_per_second(ndehugifies, uptime),
+	    (uint64_t)(HPA_DEHUGIFY_EARLY_MS / 1000), ndehugifies_early,
+	    rate_per_second(ndehugifies_early, uptime),
+	    nempty_releases, rate_per_second(nempty_releases, uptime),
+	    nempty_pooled,
+	    ndeferred_inline, rate_per_second(ndeferred_inline, uptime),
+	    ndeferred_background, rate_per_second(ndeferred_background,
+	    uptime));
 
 	emitter_json_object_kv_begin(emitter, "hpa_shard");
 	emitter_json_kv(emitter, "npurge_passes", emitter_type_uint64,
 	    &npurge_passes);
 	emitter_json_kv(emitter, "npurges", emitter_type_uint64,
 	    &npurges);
+	emitter_json_kv(emitter, "npurged", emitter_type_uint64,
+	    &npurged);
+	emitter_json_kv(emitter, "npurge_syscalls", emitter_type_uint64,
+	    &npurge_syscalls);
 	emitter_json_kv(emitter, "nhugifies", emitter_type_uint64,
 	    &nhugifies);
+	emitter_json_kv(emitter, "nhugify_failures", emitter_type_uint64,
+	    &nhugify_failures);
 	emitter_json_kv(emitter, "ndehugifies", emitter_type_uint64,
 	    &ndehugifies);
+	emitter_json_kv(emitter, "ndehugifies_early", emitter_type_uint64,
+	    &ndehugifies_early);
+	emitter_json_kv(emitter, "nempty_releases", emitter_type_uint64,
+	    &nempty_releases);
+	emitter_json_kv(emitter, "nempty_pooled", emitter_type_uint64,
+	    &nempty_pooled);
+	emitter_json_kv(emitter, "ndeferred_inline", emitter_type_uint64,
+	    &ndeferred_inline);
+	emitter_json_kv(emitter, "ndeferred_background", emitter_type_uint64,
+	    &ndeferred_background);
 
 	/* Next, full slab stats. */
 	CTL_M2_GET("stats.arenas.0.hpa_shard.full_slabs.npageslabs_huge",
 	    i, &npageslabs_huge, size_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.full_slabs.npageslabs_hugetlb",
+	    i, &npageslabs_hugetlb, size_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.full_slabs.nactive_huge",
 	    i, &nactive_huge, size_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.full_slabs.ndirty_huge",
@@ -856,23 +1005,29 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 	    i, &nactive_nonhuge, size_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.full_slabs.ndirty_nonhuge",
 	    i, &ndirty_nonhuge, size_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.full_slabs.nmuzzy_nonhuge",
+	    i, &nmuzzy_nonhuge, size_t);
 	nretained_nonhuge = npageslabs_nonhuge * HUGEPAGE_PAGES
-	    - nactive_nonhuge - ndirty_nonhuge;
+	    - nactive_nonhuge - ndirty_nonhuge - nmuzzy_nonhuge;
 
 	emitter_table_printf(emitter,
 	    "  In full slabs:\n"
-	    "      npageslabs: %zu huge, %zu nonhuge\n"
+	    "      npageslabs: %zu huge (%zu hugetlb), %zu nonhuge\n"
 	    "      nactive: %zu huge, %zu nonhuge \n"
 	    "      ndirty: %zu huge, %zu nonhuge \n"
+	    "      nmuzzy: 0 huge, %zu nonhuge \n"
 	    "      nretained: 0 huge, %zu nonhuge \n",
-	    npageslabs_huge, npageslabs_nonhuge,
+	    npageslabs_huge, npageslabs_hugetlb, npageslabs_nonhuge,
 	    nactive_huge, nactive_nonhuge,
 	    ndirty_huge, ndirty_nonhuge,
+	    nmuzzy_nonhuge,
 	    nretained_nonhuge);
 
 	emitter_json_object_kv_begin(emitter, "full_slabs");
 	emitter_json_kv(emitter, "npageslabs_huge", emitter_type_size,
 	    &npageslabs_huge);
+	emitter_json_kv(emitter, "npageslabs_hugetlb", emitter_type_size,
+	    &npageslabs_hugetlb);
 	emitter_json_kv(emitter, "nactive_huge", emitter_type_size,
 	    &nactive_huge);
 	emitter_json_kv(emitter, "nactive_huge", emitter_type_size,
@@ -883,11 +1038,15 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 	    &nactive_nonhuge);
 	emitter_json_kv(emitter, "ndirty_nonhuge", emitter_type_size,
 	    &ndirty_nonhuge);
+	emitter_json_kv(emitter, "nmuzzy_nonhuge", emitter_type_size,
+	    &nmuzzy_nonhuge);
 	emitter_json_object_end(emitter); /* End "full_slabs" */
 
 	/* Next, empty slab stats. */
 	CTL_M2_GET("stats.arenas.0.hpa_shard.empty_slabs.npageslabs_huge",
 	    i, &npageslabs_huge, size_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.empty_slabs.npageslabs_hugetlb",
+	    i, &npageslabs_hugetlb, size_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.empty_slabs.nactive_huge",
 	    i, &nactive_huge, size_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.empty_slabs.ndirty_huge",
@@ -899,24 +1058,30 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 	    i, &nactive_nonhuge, size_t);
 	CTL_M2_GET("stats.arenas.0.hpa_shard.empty_slabs.ndirty_nonhuge",
 	    i, &ndirty_nonhuge, size_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.empty_slabs.nmuzzy_nonhuge",
+	    i, &nmuzzy_nonhuge, size_t);
 	nretained_nonhuge = npageslabs_nonhuge * HUGEPAGE_PAGES
-	    - nactive_nonhuge - ndirty_nonhuge;
+	    - nactive_nonhuge - ndirty_nonhuge - nmuzzy_nonhuge;
 
 	emitter_table_printf(emitter,
 	    "  In empty slabs:\n"
-	    "      npageslabs: %zu huge, %zu nonhuge\n"
+	    "      npageslabs: %zu huge (%zu hugetlb), %zu nonhuge\n"
 	    "      nactive: %zu huge, %zu nonhuge \n"
 	    "      ndirty: %zu huge, %zu nonhuge \n"
+	    "      nmuzzy: 0 huge, %zu nonhuge \n"
 	    "      nretained: 0 huge, %zu nonhuge \n"
 	    "\n",
-	    npageslabs_huge, npageslabs_nonhuge,
+	    npageslabs_huge, npageslabs_hugetlb, npageslabs_nonhuge,
 	    nactive_huge, nactive_nonhuge,
 	    ndirty_huge, ndirty_nonhuge,
+	    nmuzzy_nonhuge,
 	    nretained_nonhuge);
 
 	emitter_json_object_kv_begin(emitter, "empty_slabs");
 	emitter_json_kv(emitter, "npageslabs_huge", emitter_type_size,
 	    &npageslabs_huge);
+	emitter_json_kv(emitter, "npageslabs_hugetlb", emitter_type_size,
+	    &npageslabs_hugetlb);
 	emitter_json_kv(emitter, "nactive_huge", emitter_type_size,
 	    &nactive_huge);
 	emitter_json_kv(emitter, "nactive_huge", emitter_type_size,
@@ -927,16 +1092,20 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 	    &nactive_nonhuge);
 	emitter_json_kv(emitter, "ndirty_nonhuge", emitter_type_size,
 	    &ndirty_nonhuge);
+	emitter_json_kv(emitter, "nmuzzy_nonhuge", emitter_type_size,
+	    &nmuzzy_nonhuge);
 	emitter_json_object_end(emitter); /* End "empty_slabs" */
 
 	COL_HDR(row, size, NULL, right, 20, size)
 	COL_HDR(row, ind, NULL, right, 4, unsigned)
 	COL_HDR(row, npageslabs_huge, NULL, right, 16, size)
+	COL_HDR(row, npageslabs_hugetlb, NULL, right, 20, size)
 	COL_HDR(row, nactive_huge, NULL, right, 16, size)
 	COL_HDR(row, ndirty_huge, NULL, right, 16, size)
 	COL_HDR(row, npageslabs_nonhuge, NULL, right, 20, size)
 	COL_HDR(row, nactive_nonhuge, NULL, right, 20, size)
 	COL_HDR(row, ndirty_nonhuge, NULL, right, 20, size)
+	COL_HDR(row, nmuzzy_nonhuge, NULL, right, 20, size)
 	COL_HDR(row, nretained_nonhuge, NULL, right, 20, size)
 
 	size_t stats_arenas_mib[CTL_MAX_DEPTH];
@@ -952,6 +1121,8 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 
 		CTL_LEAF(stats_arenas_mib, 6, "npageslabs_huge",
 		    &npageslabs_huge, size_t);
+		CTL_LEAF(stats_arenas_mib, 6, "npageslabs_hugetlb",
+		    &npageslabs_hugetlb, size_t);
 		CTL_LEAF(stats_arenas_mib, 6, "nactive_huge",
 		    &nactive_huge, size_t);
 		CTL_LEAF(stats_arenas_mib, 6, "ndirty_huge",
@@ -963,8 +1134,10 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 		    &nactive_nonhuge, size_t);
 		CTL_LEAF(stats_arenas_mib, 6, "ndirty_nonhuge",
 		    &ndirty_nonhuge, size_t);
+		CTL_LEAF(stats_arenas_mib, 6, "nmuzzy_nonhuge",
+		    &nmuzzy_nonhuge, size_t);
 		nretained_nonhuge = npageslabs_nonhuge * HUGEPAGE_PAGES
-		    - nactive_nonhuge - ndirty_nonhuge;
+		    - nactive_nonhuge - ndirty_nonhuge - nmuzzy_nonhuge;
 
 		bool in_gap_prev = in_gap;
 		in_gap = (npageslabs_huge == 0 && npageslabs_nonhuge == 0);
@@ -976,11 +1149,13 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 		col_size.size_val = sz_pind2sz(j);
 		col_ind.size_val = j;
 		col_npageslabs_huge.size_val = npageslabs_huge;
+		col_npageslabs_hugetlb.size_val = npageslabs_hugetlb;
 		col_nactive_huge.size_val = nactive_huge;
 		col_ndirty_huge.size_val = ndirty_huge;
 		col_npageslabs_nonhuge.size_val = npageslabs_nonhuge;
 		col_nactive_nonhuge.size_val = nactive_nonhuge;
 		col_ndirty_nonhuge.size_val = ndirty_nonhuge;
+		col_nmuzzy_nonhuge.size_val = nmuzzy_nonhuge;
 		col_nretained_nonhuge.size_val = nretained_nonhuge;
 		if (!in_gap) {
 			emitter_table_row(emitter, &row);
@@ -989,6 +1164,8 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 		emitter_json_object_begin(emitter);
 		emitter_json_kv(emitter, "npageslabs_huge", emitter_type_size,
 		    &npageslabs_huge);
+		emitter_json_kv(emitter, "npageslabs_hugetlb",
+		    emitter_type_size, &npageslabs_hugetlb);
 		emitter_json_kv(emitter, "nactive_huge", emitter_type_size,
 		    &nactive_huge);
 		emitter_json_kv(emitter, "ndirty_huge", emitter_type_size,
@@ -999,10 +1176,140 @@ stats_arena_hpa_shard_print(emitter_t *emitter, unsigned i, uint64_t uptime) {
 		    &nactive_nonhuge);
 		emitter_json_kv(emitter, "ndirty_nonhuge", emitter_type_size,
 		    &ndirty_nonhuge);
+		emitter_json_kv(emitter, "nmuzzy_nonhuge", emitter_type_size,
+		    &nmuzzy_nonhuge);
 		emitter_json_object_end(emitter);
 	}
 	emitter_json_array_end(emitter); /* End "nonfull_slabs" */
+	if (in_gap) {
+		emitter_table_printf(emitter, "                     ---\n");
+	}
+
+	stats_arena_hpa_shard_hist_print(emitter, i);
 	emitter_json_object_end(emitter); /* End "hpa_shard" */
+}
+
+/*
+ * Prints the stats of the small extent cache whose ctl node (under
+ * stats.arenas.<i>) is name.
+ */
+static void
+stats_arena_sec_print(emitter_t *emitter, unsigned i, uint64_t uptime,
+    const char *name, const char *title) {
+	emitter_row_t header_row;
+	emitter_row_init(&header_row);
+	emitter_row_t row;
+	emitter_row_init(&row);
+
+	size_t bytes;
+	uint64_t noverflow_flushes;
+	uint64_t nhits;
+	uint64_t nmisses;
+	uint64_t nfills;
+	uint64_t nfilled;
+	uint64_t nflushed;
+
+	size_t stats_arenas_mib[CTL_MAX_DEPTH];
+	CTL_LEAF_PREPARE(stats_arenas_mib, 0, "stats.arenas");
+	stats_arenas_mib[2] = i;
+	CTL_LEAF_PREPARE(stats_arenas_mib, 3, name);
+
+	CTL_LEAF(stats_arenas_mib, 4, "bytes", &bytes, size_t);
+	CTL_LEAF(stats_arenas_mib, 4, "noverflow_flushes", &noverflow_flushes,
+	    uint64_t);
+	CTL_LEAF(stats_arenas_mib, 4, "nhits", &nhits, uint64_t);
+	CTL_LEAF(stats_arenas_mib, 4, "nmisses", &nmisses, uint64_t);
+	CTL_LEAF(stats_arenas_mib, 4, "nfills", &nfills, uint64_t);
+	CTL_LEAF(stats_arenas_mib, 4, "nfilled", &nfilled, uint64_t);
+	CTL_LEAF(stats_arenas_mib, 4, "nflushed", &nflushed, uint64_t);
+
+	emitter_table_printf(emitter,
+	    "%s small extent cache stats:\n"
+	    "  Bytes cached: %zu\n"
+	    "  Hits: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Misses: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Batch fills: %" FMTu64 " (%" FMTu64 " / sec, %" FMTu64
+	    " extents cached)\n"
+	    "  Extents flushed: %" FMTu64 " (%" FMTu64 " / sec)\n"
+	    "  Flushes due to overflowing %s_max_bytes: %" FMTu64 " (%"
+	    FMTu64 " / sec)\n",
+	    title,
+	    bytes,
+	    nhits, rate_per_second(nhits, uptime),
+	    nmisses, rate_per_second(nmisses, uptime),
+	    nfills, rate_per_second(nfills, uptime), nfilled,
+	    nflushed, rate_per_second(nflushed, uptime),
+	    name, noverflow_flushes, rate_per_second(noverflow_flushes, uptime));
+
+	emitter_json_object_kv_begin(emitter, name);
+	emitter_json_kv(emitter, "bytes", emitter_type_size, &bytes);
+	emitter_json_kv(emitter, "noverflow_flushes", emitter_type_uint64,
+	    &noverflow_flushes);
+	emitter_json_kv(emitter, "nhits", emitter_type_uint64, &nhits);
+	emitter_json_kv(emitter, "nmisses", emitter_type_uint64, &nmisses);
+	emitter_json_kv(emitter, "nfills", emitter_type_uint64, &nfills);
+	emitter_json_kv(emitter, "nfilled", emitter_type_uint64, &nfilled);
+	emitter_json_kv(emitter, "nflushed", emitter_type_uint64, &nflushed);
+
+	COL_HDR(row, size, NULL, right, 20, size)
+	COL_HDR(row, ind, NULL, right, 4, unsigned)
+	COL_HDR(row, bytes, NULL, right, 13, size)
+	COL_HDR(row, nhits, NULL, right, 13, uint64)
+	COL_HDR(row, nmisses, NULL, right, 13, uint64)
+	COL_HDR(row, nfills, NULL, right, 13, uint64)
+	COL_HDR(row, nfilled, NULL, right, 13, uint64)
+	COL_HDR(row, nflushed, NULL, right, 13, uint64)
+
+	CTL_LEAF_PREPARE(stats_arenas_mib, 4, "bins");
+
+	emitter_table_row(emitter, &header_row);
+	emitter_json_array_kv_begin(emitter, "bins");
+	bool in_gap = false;
+	for (pszind_t j = 0; j < SEC_NPSIZES; j++) {
+		stats_arenas_mib[5] = j;
+
+		CTL_LEAF(stats_arenas_mib, 6, "bytes", &bytes, size_t);
+		CTL_LEAF(stats_arenas_mib, 6, "nhits", &nhits, uint64_t);
+		CTL_LEAF(stats_arenas_mib, 6, "nmisses", &nmisses, uint64_t);
+		CTL_LEAF(stats_arenas_mib, 6, "nfills", &nfills, uint64_t);
+		CTL_LEAF(stats_arenas_mib, 6, "nfilled", &nfilled, uint64_t);
+		CTL_LEAF(stats_arenas_mib, 6, "nflushed", &nflushed, uint64_t);
+
+		bool in_gap_prev = in_gap;
+		in_gap = (bytes == 0 && nhits == 0 && nmisses == 0
+		    && nflushed == 0);
+		if (in_gap_prev && !in_gap) {
+			emitter_table_printf(emitter,
+			    "                     ---\n");
+		}
+
+		col_size.size_val = sz_pind2sz(j);
+		col_ind.unsigned_val = j;
+		col_bytes.size_val = bytes;
+		col_nhits.uint64_val = nhits;
+		col_nmisses.uint64_val = nmisses;
+		col_nfills.uint64_val = nfills;
+		col_nfilled.uint64_val = nfilled;
+		col_nflushed.uint64_val = nflushed;
+		if (!in_gap) {
+			emitter_table_row(emitter, &row);
+		}
+
+		emitter_json_object_begin(emitter);
+		emitter_json_kv(emitter, "bytes", emitter_type_size, &bytes);
+		emitter_json_kv(emitter, "nhits", emitter_type_uint64, &nhits);
+		emitter_json_kv(emitter, "nmisses", emitter_type_uint64,
+		    &nmisses);
+		emitter_json_kv(emitter, "nfills", emitter_type_uint64,
+		    &nfills);
+		emitter_json_kv(emitter, "nfilled", emitter_type_uint64,
+		    &nfilled);
+		emitter_json_kv(emitter, "nflushed", emitter_type_uint64,
+		    &nflushed);
+		emitter_json_object_end(emitter);
+	}
+	emitter_json_array_end(emitter); /* End "bins" */
+	emitter_json_object_end(emitter); /* End name */
 	if (in_gap) {
 		emitter_table_printf(emitter, "                     ---\n");
 	}
@@ -1049,6 +1356,7 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	size_t base, internal, resident, metadata_thp, extent_avail;
 	uint64_t dirty_npurge, dirty_nmadvise, dirty_purged;
 	uint64_t muzzy_npurge, muzzy_nmadvise, muzzy_purged;
+	uint64_t retained_nrelease, retained_nunmap, retained_released;
 	size_t small_allocated;
 	uint64_t small_nmalloc, small_ndalloc, small_nrequests, small_nfills,
 	    small_nflushes;
@@ -1087,6 +1395,13 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	CTL_M2_GET("stats.arenas.0.muzzy_nmadvise", i, &muzzy_nmadvise,
 	    uint64_t);
 	CTL_M2_GET("stats.arenas.0.muzzy_purged", i, &muzzy_purged, uint64_t);
+	CTL_M2_GET("stats.arenas.0.retained", i, &retained, size_t);
+	CTL_M2_GET("stats.arenas.0.retained_nrelease", i, &retained_nrelease,
+	    uint64_t);
+	CTL_M2_GET("stats.arenas.0.retained_nunmap", i, &retained_nunmap,
+	    uint64_t);
+	CTL_M2_GET("stats.arenas.0.retained_released", i, &retained_released,
+	    uint64_t);
 
 	emitter_row_t decay_row;
 	emitter_row_init(&decay_row);
@@ -1115,6 +1430,13 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	emitter_json_kv(emitter, "muzzy_purged", emitter_type_uint64,
 	    &muzzy_purged);
 
+	emitter_json_kv(emitter, "retained_nrelease", emitter_type_uint64,
+	    &retained_nrelease);
+	emitter_json_kv(emitter, "retained_nunmap", emitter_type_uint64,
+	    &retained_nunmap);
+	emitter_json_kv(emitter, "retained_released", emitter_type_uint64,
+	    &retained_released);
+
 	/* Table-style emission. */
 	COL(decay_row, decay_type, right, 9, title);
 	col_decay_type.str_val = "decaying:";
@@ -1187,6 +1509,29 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 
 	emitter_table_row(emitter, &decay_row);
 
+	/*
+	 * Retained row; released by the retained_limit / retained_idle_ms
+	 * policy rather than decayed, hence no time.
+	 */
+	col_decay_type.str_val = "retained:";
+
+	col_decay_time.type = emitter_type_title;
+	col_decay_time.str_val = "N/A";
+
+	col_decay_npages.type = emitter_type_size;
+	col_decay_npages.size_val = retained / page;
+
+	col_decay_sweeps.type = emitter_type_uint64;
+	col_decay_sweeps.uint64_val = retained_nrelease;
+
+	col_decay_madvises.type = emitter_type_uint64;
+	col_decay_madvises.uint64_val = retained_nunmap;
+
+	col_decay_purged.type = emitter_type_uint64;
+	col_decay_purged.uint64_val = retained_released;
+
+	emitter_table_row(emitter, &decay_row);
+
 	/* Small / large / total allocation counts. */
 	emitter_row_t alloc_count_row;
 	emitter_row_init(&alloc_count_row);
@@ -1360,9 +1705,16 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	}
 	if (extents) {
 		stats_arena_extents_print(emitter, i);
+		bool pac_sec;
+		CTL_GET("opt.pac_sec", &pac_sec, bool);
+		if (pac_sec) {
+			stats_arena_sec_print(emitter, i, uptime, "pac_sec",
+			    "PAC");
+		}
 	}
 	if (hpa) {
 		stats_arena_hpa_shard_print(emitter, i, uptime);
+		stats_arena_sec_print(emitter, i, uptime, "hpa_sec", "HPA");
 	}
 }
 
@@ -1376,7 +1728,7 @@ stats_general_print(emitter_t *emitter) {
 	uint64_t u64v;
 	int64_t i64v;
 	ssize_t ssv, ssv2;
-	size_t sv, bsz, usz, u32sz, i64sz, ssz, sssz, cpsz;
+	size_t sv, bsz, usz, u32sz, u64sz, i64sz, ssz, sssz, cpsz;
 
 	bsz = sizeof(bool);
 	usz = sizeof(unsigned);
@@ -1384,6 +1736,7 @@ stats_general_print(emitter_t *emitter) {
 	sssz = sizeof(ssize_t);
 	cpsz = sizeof(const char *);
 	u32sz = sizeof(uint32_t);
+	u64sz = sizeof(uint64_t);
 	i64sz = sizeof(int64_t);
 
 	CTL_GET("version", &cpv, const char *);
@@ -1442,6 +1795,8 @@ stats_general_print(emitter_t *emitter) {
 
 #define OPT_WRITE_INT64(name)						\
 	OPT_WRITE(name, i64v, i64sz, emitter_type_int64)
+#define OPT_WRITE_UINT64(name)						\
+	OPT_WRITE(name, u64v, u64sz, emitter_type_uint64)
 
 #define OPT_WRITE_SIZE_T(name)						\
 	OPT_WRITE(name, sv, ssz, emitter_type_size)
@@ -1464,6 +1819,9 @@ stats_general_print(emitter_t *emitter) {
 	OPT_WRITE_UNSIGNED("narenas")
 	OPT_WRITE_CHAR_P("percpu_arena")
 	OPT_WRITE_SIZE_T("oversize_threshold")
+	OPT_WRITE_SIZE_T("ralloc_mremap_min")
+	OPT_WRITE_BOOL("process_madvise")
+	OPT_WRITE_BOOL("numa_bind")
 	OPT_WRITE_BOOL("hpa")
 	OPT_WRITE_SIZE_T("hpa_slab_max_alloc")
 	OPT_WRITE_SIZE_T("hpa_hugification_threshold")
@@ -1485,14 +1843,42 @@ stats_general_print(emitter_t *emitter) {
 			    "opt.hpa_dirty_mult", emitter_type_string, &bufp);
 		}
 	}
+	OPT_WRITE_SSIZE_T("hpa_dirty_decay_ms")
+	OPT_WRITE_SSIZE_T("hpa_muzzy_decay_ms")
+	OPT_WRITE_SIZE_T("hpa_empty_max")
+	OPT_WRITE_SIZE_T("hpa_central_empty_max")
+	OPT_WRITE_SIZE_T("hpa_eden_size")
+	OPT_WRITE_BOOL("hpa_eden_pretouch")
+	OPT_WRITE_UNSIGNED("hpa_cpu_shards")
+	OPT_WRITE_UINT64("hpa_hugify_delay_ms")
+	OPT_WRITE_UINT64("hpa_dehugify_delay_ms")
+	OPT_WRITE_BOOL("hpa_hugify_sync")
+	OPT_WRITE_BOOL("hpa_hugetlb")
+	OPT_WRITE_CHAR_P("hpa_alloc_policy")
+	OPT_WRITE_SIZE_T("hpa_sec_nshards")
+	OPT_WRITE_BOOL("hpa_sec_shard_by_cpu")
 	OPT_WRITE_SIZE_T("hpa_sec_max_alloc")
 	OPT_WRITE_SIZE_T("hpa_sec_max_bytes")
-	OPT_WRITE_SIZE_T("hpa_sec_nshards")
+	OPT_WRITE_SIZE_T("hpa_sec_bytes_after_flush")
+	OPT_WRITE_SIZE_T("hpa_sec_batch_fill_extra")
+	OPT_WRITE_UINT64("hpa_sec_max_idle_ms")
+	OPT_WRITE_BOOL("pac_sec")
+	OPT_WRITE_SIZE_T("pac_sec_nshards")
+	OPT_WRITE_BOOL("pac_sec_shard_by_cpu")
+	OPT_WRITE_SIZE_T("pac_sec_max_alloc")
+	OPT_WRITE_SIZE_T("pac_sec_max_bytes")
+	OPT_WRITE_SIZE_T("pac_sec_bytes_after_flush")
+	OPT_WRITE_SIZE_T("pac_sec_batch_fill_extra")
+	OPT_WRITE_UINT64("pac_sec_max_idle_ms")
 	OPT_WRITE_CHAR_P("metadata_thp")
 	OPT_WRITE_BOOL_MUTABLE("background_thread", "background_thread")
+	OPT_WRITE_SIZE_T("background_thread_hpa_interval_max_ms")
 	OPT_WRITE_SSIZE_T_MUTABLE("dirty_decay_ms", "arenas.dirty_decay_ms")
 	OPT_WRITE_SSIZE_T_MUTABLE("muzzy_decay_ms", "arenas.muzzy_decay_ms")
 	OPT_WRITE_SIZE_T("lg_extent_max_active_fit")
+	OPT_WRITE_BOOL("extent_coalesce_deferred")
+	OPT_WRITE_SIZE_T("retained_limit")
+	OPT_WRITE_SSIZE_T("retained_idle_ms")
 	OPT_WRITE_CHAR_P("junk")
 	OPT_WRITE_BOOL("zero")
 	OPT_WRITE_BOOL("utrace")
@@ -1534,6 +1920,7 @@ stats_general_print(emitter_t *emitter) {
 #undef OPT_WRITE_BOOL
 #undef OPT_WRITE_BOOL_MUTABLE
 #undef OPT_WRITE_UNSIGNED
+#undef OPT_WRITE_UINT64
 #undef OPT_WRITE_SSIZE_T
 #undef OPT_WRITE_SSIZE_T_MUTABLE
 #undef OPT_WRITE_CHAR_P
@@ -1723,6 +2110,25 @@ stats_print_helper(emitter_t *emitter, bool merged, bool destroyed,
 	emitter_table_printf(emitter,
 	    "Count of realloc(non-null-ptr, 0) calls: %zu\n", zero_reallocs);
 
+	/* Resident memory per NUMA node (by arena); noise on one node. */
+	unsigned numa_nnodes;
+	CTL_GET("stats.numa_nnodes", &numa_nnodes, unsigned);
+	emitter_json_array_kv_begin(emitter, "numa_nodes");
+	for (unsigned i = 0; i < numa_nnodes; i++) {
+		size_t node_resident;
+		CTL_M2_GET("stats.numa_nodes.0.resident", i, &node_resident,
+		    size_t);
+		emitter_json_object_begin(emitter);
+		emitter_json_kv(emitter, "resident", emitter_type_size,
+		    &node_resident);
+		emitter_json_object_end(emitter);
+		if (numa_nnodes > 1) {
+			emitter_table_printf(emitter,
+			    "NUMA node %u resident: %zu\n", i, node_resident);
+		}
+	}
+	emitter_json_array_end(emitter); /* Close "numa_nodes". */
+
 	/* Background thread stats. */
 	emitter_json_object_kv_begin(emitter, "background_thread");
 	emitter_json_kv(emitter, "num_threads", emitter_type_size,
@@ -1738,6 +2144,28 @@ stats_print_helper(emitter_t *emitter, bool merged, bool destroyed,
 	    num_background_threads, background_thread_num_runs,
 	    background_thread_run_interval);
 
+	/* The HPA's process-wide source of pageslabs. */
+	size_t hpa_central_nempty, hpa_central_nretained, hpa_central_eden_bytes;
+	CTL_GET("stats.hpa_central.nempty", &hpa_central_nempty, size_t);
+	CTL_GET("stats.hpa_central.nretained", &hpa_central_nretained, size_t);
+	CTL_GET("stats.hpa_central.eden_bytes", &hpa_central_eden_bytes,
+	    size_t);
+	emitter_json_object_kv_begin(emitter, "hpa_central");
+	emitter_json_kv(emitter, "nempty", emitter_type_size,
+	    &hpa_central_nempty);
+	emitter_json_kv(emitter, "nretained", emitter_type_size,
+	    &hpa_central_nretained);
+	emitter_json_kv(emitter, "eden_bytes", emitter_type_size,
+	    &hpa_central_eden_bytes);
+	emitter_json_object_end(emitter); /* Close "hpa_central". */
+
+	if (hpa) {
+		emitter_table_printf(emitter, "HPA central: pooled empty "
+		    "pageslabs: %zu, retained pageslabs: %zu, unused eden: "
+		    "%zu\n", hpa_central_nempty, hpa_central_nretained,
+		    hpa_central_eden_bytes);
+	}
+
 	if (mutex) {
 		emitter_row_t row;
 		emitter_col_t name;
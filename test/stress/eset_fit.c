@@ -0,0 +1,229 @@
+#include "test/jemalloc_test.h"
+#include "test/bench.h"
+
+#include "jemalloc/internal/eset.h"
+
+/*
+ * Compares first-fit selection out of an eset against the way it used to be
+ * done, before the bins cached their minimums: walking the same bins, but
+ * going to each heap for its first extent and comparing those.  Both sides
+ * see the same extents, and do the same remove / reinsert on what they pick
+ * (as extent recycling would, give or take the splitting).
+ */
+
+#define NEDATAS (16 * 1024)
+
+/*
+ * What the eset looked like before, bookkeeping and all; its own set of bins
+ * over the same sizes.
+ */
+typedef struct heap_eset_s heap_eset_t;
+struct heap_eset_s {
+	edata_heap_t heaps[SC_NPSIZES + 1];
+	atomic_zu_t nextents[SC_NPSIZES + 1];
+	atomic_zu_t nbytes[SC_NPSIZES + 1];
+	bitmap_t bitmap[BITMAP_GROUPS(SC_NPSIZES + 1)];
+	edata_list_inactive_t lru;
+	atomic_zu_t npages;
+};
+
+static const bitmap_info_t heap_eset_bitmap_info =
+    BITMAP_INFO_INITIALIZER(SC_NPSIZES+1);
+
+static eset_t eset;
+static heap_eset_t heap_eset;
+/*
+ * The edata_ts get allocated one at a time and in no particular order, as
+ * they'd be out of the edata_cache, so that the heap walk has to chase them.
+ */
+static edata_t *eset_edatas[NEDATAS];
+static edata_t *heap_eset_edatas[NEDATAS];
+static size_t fit_size;
+
+static pszind_t
+heap_eset_pind(edata_t *edata) {
+	return sz_psz2ind(sz_psz_quantize_floor(edata_size_get(edata)));
+}
+
+static void
+heap_eset_stats_update(heap_eset_t *heap_eset, pszind_t pind, size_t size,
+    bool add) {
+	size_t nextents = atomic_load_zu(&heap_eset->nextents[pind],
+	    ATOMIC_RELAXED);
+	size_t nbytes = atomic_load_zu(&heap_eset->nbytes[pind], ATOMIC_RELAXED);
+	size_t npages = atomic_load_zu(&heap_eset->npages, ATOMIC_RELAXED);
+	if (add) {
+		nextents++;
+		nbytes += size;
+		npages += size >> LG_PAGE;
+	} else {
+		nextents--;
+		nbytes -= size;
+		npages -= size >> LG_PAGE;
+	}
+	atomic_store_zu(&heap_eset->nextents[pind], nextents, ATOMIC_RELAXED);
+	atomic_store_zu(&heap_eset->nbytes[pind], nbytes, ATOMIC_RELAXED);
+	atomic_store_zu(&heap_eset->npages, npages, ATOMIC_RELAXED);
+}
+
+static void
+heap_eset_insert(heap_eset_t *heap_eset, edata_t *edata) {
+	pszind_t pind = heap_eset_pind(edata);
+	if (edata_heap_empty(&heap_eset->heaps[pind])) {
+		bitmap_unset(heap_eset->bitmap, &heap_eset_bitmap_info,
+		    (size_t)pind);
+	}
+	edata_heap_insert(&heap_eset->heaps[pind], edata);
+	heap_eset_stats_update(heap_eset, pind, edata_size_get(edata), true);
+	edata_list_inactive_append(&heap_eset->lru, edata);
+}
+
+static void
+heap_eset_remove(heap_eset_t *heap_eset, edata_t *edata) {
+	pszind_t pind = heap_eset_pind(edata);
+	edata_heap_remove(&heap_eset->heaps[pind], edata);
+	heap_eset_stats_update(heap_eset, pind, edata_size_get(edata), false);
+	if (edata_heap_empty(&heap_eset->heaps[pind])) {
+		bitmap_set(heap_eset->bitmap, &heap_eset_bitmap_info,
+		    (size_t)pind);
+	}
+	edata_list_inactive_remove(&heap_eset->lru, edata);
+}
+
+static edata_t *
+heap_eset_first_fit(heap_eset_t *heap_eset, size_t size) {
+	edata_t *ret = NULL;
+	pszind_t pind = sz_psz2ind(sz_psz_quantize_ceil(size));
+	for (pszind_t i = (pszind_t)bitmap_ffu(heap_eset->bitmap,
+	    &heap_eset_bitmap_info, (size_t)pind);
+	    i < SC_NPSIZES + 1;
+	    i = (pszind_t)bitmap_ffu(heap_eset->bitmap, &heap_eset_bitmap_info,
+	    (size_t)i+1)) {
+		edata_t *edata = edata_heap_first(&heap_eset->heaps[i]);
+		if (ret == NULL || edata_snad_comp(edata, ret) < 0) {
+			ret = edata;
+		}
+		if (i == SC_NPSIZES) {
+			break;
+		}
+	}
+	return ret;
+}
+
+static edata_t *
+bench_edata_new(uint64_t *prng_state, unsigned ind) {
+	edata_t *edata = malloc(sizeof(edata_t));
+	assert_ptr_not_null(edata, "Unexpected malloc() failure");
+	/* Sizes spread (roughly log-uniformly) from a page to 32K pages. */
+	unsigned lg_npages = (unsigned)prng_range_u64(prng_state, 15);
+	size_t npages = ((size_t)1 << lg_npages)
+	    + (size_t)prng_range_u64(prng_state, (uint64_t)1 << lg_npages);
+	edata_init(edata, /* arena_ind */ 0,
+	    (void *)((uintptr_t)(ind + 1) << LG_PAGE),
+	    npages << LG_PAGE, /* slab */ false, SC_NSIZES,
+	    /* sn */ (size_t)prng_range_u64(prng_state, NEDATAS),
+	    extent_state_retained, /* zeroed */ false, /* committed */ false,
+	    EXTENT_PAI_PAC, EXTENT_NOT_HEAD);
+	return edata;
+}
+
+static void
+bench_init(void) {
+	/*
+	 * Stress tests get the internals as a separate copy from the library
+	 * that malloc() initializes, so the size tables need setting up here.
+	 */
+	sc_data_t sc_data;
+	sc_boot(&sc_data);
+	sz_boot(&sc_data);
+
+	eset_init(&eset, extent_state_retained);
+	memset(&heap_eset, 0, sizeof(heap_eset));
+	bitmap_init(heap_eset.bitmap, &heap_eset_bitmap_info, true);
+	for (unsigned i = 0; i < SC_NPSIZES + 1; i++) {
+		edata_heap_new(&heap_eset.heaps[i]);
+	}
+	edata_list_inactive_init(&heap_eset.lru);
+
+	uint64_t prng_state = 12345;
+	for (unsigned i = 0; i < NEDATAS; i++) {
+		eset_edatas[i] = bench_edata_new(&prng_state, i);
+		/* Interleave the two sets' allocations. */
+		heap_eset_edatas[i] = malloc(sizeof(edata_t));
+		assert_ptr_not_null(heap_eset_edatas[i],
+		    "Unexpected malloc() failure");
+		memcpy(heap_eset_edatas[i], eset_edatas[i], sizeof(edata_t));
+	}
+	/* Insert in shuffled order. */
+	for (unsigned i = NEDATAS - 1; i > 0; i--) {
+		unsigned j = (unsigned)prng_range_u64(&prng_state, i + 1);
+		edata_t *tmp = eset_edatas[i];
+		eset_edatas[i] = eset_edatas[j];
+		eset_edatas[j] = tmp;
+		tmp = heap_eset_edatas[i];
+		heap_eset_edatas[i] = heap_eset_edatas[j];
+		heap_eset_edatas[j] = tmp;
+	}
+	for (unsigned i = 0; i < NEDATAS; i++) {
+		eset_insert(&eset, eset_edatas[i]);
+		heap_eset_insert(&heap_eset, heap_eset_edatas[i]);
+	}
+}
+
+static void
+bench_fini(void) {
+	for (unsigned i = 0; i < NEDATAS; i++) {
+		eset_remove(&eset, eset_edatas[i]);
+		free(eset_edatas[i]);
+		free(heap_eset_edatas[i]);
+	}
+}
+
+static void
+eset_fit_cycle(void) {
+	/* As for the retained eset; the walk spans every bin. */
+	edata_t *edata = eset_fit(&eset, fit_size, PAGE, /* exact_only */ false,
+	    SC_PTR_BITS);
+	assert_ptr_not_null(edata, "");
+	eset_remove(&eset, edata);
+	eset_insert(&eset, edata);
+}
+
+static void
+heap_eset_fit_cycle(void) {
+	edata_t *edata = heap_eset_first_fit(&heap_eset, fit_size);
+	assert_ptr_not_null(edata, "");
+	heap_eset_remove(&heap_eset, edata);
+	heap_eset_insert(&heap_eset, edata);
+}
+
+static void
+bench_fit(size_t size) {
+	fit_size = size;
+	/* Both sides should agree on what they're picking. */
+	expect_ptr_eq(edata_addr_get(eset_fit(&eset, fit_size, PAGE, false,
+	    SC_PTR_BITS)), edata_addr_get(heap_eset_first_fit(&heap_eset,
+	    fit_size)), "");
+	compare_funcs(100 * 1000, 1000 * 1000, "cached bin minimums",
+	    eset_fit_cycle, "heap walk", heap_eset_fit_cycle);
+}
+
+TEST_BEGIN(test_fit_small) {
+	bench_fit(PAGE);
+}
+TEST_END
+
+TEST_BEGIN(test_fit_large) {
+	bench_fit((size_t)1 << 24);
+}
+TEST_END
+
+int
+main(void) {
+	bench_init();
+	int ret = test_no_reentrancy(
+	    test_fit_small,
+	    test_fit_large);
+	bench_fini();
+	return ret;
+}
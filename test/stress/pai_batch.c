@@ -0,0 +1,75 @@
+#include "test/jemalloc_test.h"
+#include "test/bench.h"
+
+#include "jemalloc/internal/hpa.h"
+
+#define SHARD_IND 111
+#define NALLOCS 32
+
+/*
+ * A freestanding HPA shard, set up the same way as in the hpa unit test; we
+ * want to measure the page allocator interface itself, without arena or tcache
+ * overheads in the way.
+ */
+static base_t *base;
+static edata_cache_t shard_edata_cache;
+static emap_t emap;
+static hpa_central_t central;
+static hpa_shard_t shard;
+
+static edata_t *allocs[NALLOCS];
+
+static void
+shard_init(void) {
+	base = base_new(TSDN_NULL, SHARD_IND, &ehooks_default_extent_hooks);
+	assert_ptr_not_null(base, "");
+	assert_false(edata_cache_init(&shard_edata_cache, base), "");
+	assert_false(emap_init(&emap, base, /* zeroed */ false), "");
+
+	hpa_shard_opts_t opts = HPA_SHARD_OPTS_DEFAULT;
+	/* Keep purging out of the picture; it would swamp the lock costs. */
+	opts.dirty_mult = (fxp_t)-1;
+	assert_false(hpa_central_init(&central, base, /* empty_max */ 0,
+	    HPA_CENTRAL_EDEN_SIZE_DEFAULT, /* pretouch */ false), "");
+	assert_false(hpa_shard_init(&shard, &central, &emap, base,
+	    &shard_edata_cache, SHARD_IND, &opts), "");
+}
+
+static void
+pai_alloc_dalloc_single(void) {
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	for (int i = 0; i < NALLOCS; i++) {
+		allocs[i] = pai_alloc(tsdn, &shard.pai, PAGE, PAGE,
+		    /* zero */ false);
+		assert_ptr_not_null(allocs[i], "Unexpected alloc failure");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard.pai, allocs[i]);
+	}
+}
+
+static void
+pai_alloc_dalloc_batch(void) {
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	edata_list_active_t list;
+	edata_list_active_init(&list);
+	size_t nsuccess = pai_alloc_batch(tsdn, &shard.pai, PAGE, NALLOCS,
+	    &list);
+	assert_zu_eq(NALLOCS, nsuccess, "Unexpected alloc failure");
+	pai_dalloc_batch(tsdn, &shard.pai, &list);
+}
+
+TEST_BEGIN(test_single_vs_batch) {
+	test_skip_if(!hpa_supported());
+	shard_init();
+	compare_funcs(10 * 1000, 100 * 1000,
+	    "single alloc/dalloc", pai_alloc_dalloc_single,
+	    "batch alloc/dalloc", pai_alloc_dalloc_batch);
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_single_vs_batch);
+}
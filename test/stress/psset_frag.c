@@ -0,0 +1,135 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/psset.h"
+
+/*
+ * Drives a psset through the same randomized workload under each allocation
+ * policy, and reports how fragmented the result is -- in particular, how many
+ * pageslabs end up empty (and so purgeable as a whole).  No memory is actually
+ * mapped; the psset only ever looks at the hpdata metadata.
+ */
+
+#define NSLABS 256
+#define MAX_LIVE (NSLABS * HUGEPAGE_PAGES)
+#define MAX_ALLOC_PAGES 16
+#define YOUNG_WINDOW 1024
+#define YOUNG_PCT 90
+
+typedef struct frag_alloc_s frag_alloc_t;
+struct frag_alloc_s {
+	hpdata_t *ps;
+	void *addr;
+	size_t size;
+};
+
+static hpdata_t slabs[NSLABS];
+static size_t nslabs;
+static frag_alloc_t live[MAX_LIVE];
+static size_t nlive;
+
+static bool
+frag_alloc(psset_t *psset, size_t size) {
+	hpdata_t *ps = psset_pick_alloc(psset, size);
+	if (ps == NULL) {
+		if (nslabs == NSLABS) {
+			return true;
+		}
+		ps = &slabs[nslabs];
+		hpdata_init(ps, (void *)((nslabs + 1) * HUGEPAGE), nslabs);
+		nslabs++;
+		psset_insert(psset, ps);
+	}
+	psset_update_begin(psset, ps);
+	live[nlive].ps = ps;
+	live[nlive].addr = hpdata_reserve_alloc(ps, size);
+	live[nlive].size = size;
+	nlive++;
+	psset_update_end(psset, ps);
+	return false;
+}
+
+static void
+frag_dalloc(psset_t *psset, size_t ind) {
+	frag_alloc_t *alloc = &live[ind];
+	psset_update_begin(psset, alloc->ps);
+	hpdata_unreserve(alloc->ps, alloc->addr, alloc->size);
+	psset_update_end(psset, alloc->ps);
+	/* Keep the live allocations in allocation order. */
+	memmove(&live[ind], &live[ind + 1],
+	    (nlive - ind - 1) * sizeof(frag_alloc_t));
+	nlive--;
+}
+
+/*
+ * Runs ops operations, each an allocation with probability alloc_pct percent
+ * and a free of a random live allocation otherwise.
+ */
+static void
+frag_run(psset_t *psset, uint64_t *prng_state, int ops, unsigned alloc_pct) {
+	for (int i = 0; i < ops; i++) {
+		bool do_alloc = nlive == 0
+		    || prng_range_u64(prng_state, 100) < alloc_pct;
+		if (do_alloc) {
+			size_t npages = (size_t)prng_range_u64(prng_state,
+			    MAX_ALLOC_PAGES) + 1;
+			if (!frag_alloc(psset, npages << LG_PAGE)) {
+				continue;
+			}
+		}
+		if (nlive == 0) {
+			continue;
+		}
+		/*
+		 * Most objects die young; pick among the most recent
+		 * allocations most of the time, to give long-lived ones a
+		 * chance to pin down pageslabs.
+		 */
+		size_t window = nlive;
+		if (nlive > YOUNG_WINDOW && prng_range_u64(prng_state, 100)
+		    < YOUNG_PCT) {
+			window = YOUNG_WINDOW;
+		}
+		frag_dalloc(psset, nlive - 1
+		    - (size_t)prng_range_u64(prng_state, window));
+	}
+}
+
+static void
+frag_report(psset_t *psset, hpa_alloc_policy_t policy) {
+	size_t nempty = psset->stats.empty_slabs[0].npageslabs
+	    + psset->stats.empty_slabs[1].npageslabs;
+	size_t nused = psset_npageslabs(psset) - nempty;
+	size_t nactive = psset_nactive(psset);
+	malloc_printf("%-16s %zu pageslabs: %zu empty (purgeable), %zu in use "
+	    "at %zu%% utilization\n", hpa_alloc_policy_names[policy],
+	    psset_npageslabs(psset), nempty, nused,
+	    nused == 0 ? 0 : 100 * nactive / (nused * HUGEPAGE_PAGES));
+}
+
+TEST_BEGIN(test_frag) {
+	for (int policy = 0; policy < hpa_alloc_policy_limit; policy++) {
+		psset_t psset;
+		psset_init(&psset, (hpa_alloc_policy_t)policy);
+		nslabs = 0;
+		nlive = 0;
+		/* Every policy sees the same sequence of requests. */
+		uint64_t prng_state = 42;
+
+		/* Grow, churn for a while, then shrink by about a third. */
+		frag_run(&psset, &prng_state, 30 * 1000, 60);
+		frag_run(&psset, &prng_state, 100 * 1000, 50);
+		frag_run(&psset, &prng_state, 10 * 1000, 40);
+		frag_report(&psset, (hpa_alloc_policy_t)policy);
+
+		while (nlive > 0) {
+			frag_dalloc(&psset, nlive - 1);
+		}
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_frag);
+}
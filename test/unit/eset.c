@@ -0,0 +1,107 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/eset.h"
+
+/*
+ * The eset only ever looks at the extent metadata, so the addresses here are
+ * made up.
+ */
+#define NEDATAS 64
+
+static edata_t edatas[NEDATAS];
+
+static edata_t *
+test_edata_init(unsigned ind, size_t npages, size_t sn) {
+	assert_u_lt(ind, NEDATAS, "");
+	edata_t *edata = &edatas[ind];
+	edata_init(edata, /* arena_ind */ 0,
+	    (void *)((uintptr_t)(ind + 1) << (LG_PAGE + 10)), npages << LG_PAGE,
+	    /* slab */ false, SC_NSIZES, sn, extent_state_dirty,
+	    /* zeroed */ false, /* committed */ true, EXTENT_PAI_PAC,
+	    EXTENT_NOT_HEAD);
+	return edata;
+}
+
+static edata_t *
+fit(eset_t *eset, size_t npages, unsigned lg_max_fit) {
+	return eset_fit(eset, npages << LG_PAGE, PAGE, /* exact_only */ false,
+	    lg_max_fit);
+}
+
+TEST_BEGIN(test_first_fit) {
+	eset_t eset;
+	eset_init(&eset, extent_state_dirty);
+	expect_ptr_null(fit(&eset, 1, SC_PTR_BITS), "Empty eset");
+
+	edata_t *young_big = test_edata_init(0, 64, 10);
+	edata_t *old_small = test_edata_init(1, 2, 5);
+	edata_t *oldest_huge = test_edata_init(2, 1024, 1);
+	eset_insert(&eset, young_big);
+	eset_insert(&eset, old_small);
+	eset_insert(&eset, oldest_huge);
+
+	/* Oldest first, among the extents that are large enough. */
+	expect_ptr_eq(oldest_huge, fit(&eset, 1, SC_PTR_BITS), "");
+	expect_ptr_eq(oldest_huge, fit(&eset, 3, SC_PTR_BITS), "");
+	/* Unless lg_max_fit rules the oldest one out. */
+	expect_ptr_eq(old_small, fit(&eset, 2, 4), "");
+	expect_ptr_eq(young_big, fit(&eset, 3, 6), "");
+	expect_ptr_null(fit(&eset, 2048, SC_PTR_BITS), "");
+
+	eset_remove(&eset, oldest_huge);
+	expect_ptr_eq(old_small, fit(&eset, 1, SC_PTR_BITS), "");
+	eset_remove(&eset, old_small);
+	expect_ptr_eq(young_big, fit(&eset, 1, SC_PTR_BITS), "");
+	eset_remove(&eset, young_big);
+	expect_ptr_null(fit(&eset, 1, SC_PTR_BITS), "");
+}
+TEST_END
+
+TEST_BEGIN(test_bin_min) {
+	eset_t eset;
+	eset_init(&eset, extent_state_dirty);
+
+	/*
+	 * All in the same bin, inserted in an order that makes the cached
+	 * minimum change on both insertion and removal.  Ties on the serial
+	 * number go to the lower address.
+	 */
+	edata_t *a = test_edata_init(3, 4, 7);
+	edata_t *b = test_edata_init(4, 4, 3);
+	edata_t *c = test_edata_init(2, 4, 3);
+	edata_t *d = test_edata_init(5, 4, 9);
+	eset_insert(&eset, a);
+	expect_ptr_eq(a, fit(&eset, 4, SC_PTR_BITS), "");
+	eset_insert(&eset, b);
+	expect_ptr_eq(b, fit(&eset, 4, SC_PTR_BITS), "");
+	eset_insert(&eset, c);
+	expect_ptr_eq(c, fit(&eset, 4, SC_PTR_BITS), "");
+	eset_insert(&eset, d);
+	expect_ptr_eq(c, fit(&eset, 4, SC_PTR_BITS), "");
+
+	/* Removing something other than the minimum leaves it alone. */
+	eset_remove(&eset, d);
+	expect_ptr_eq(c, fit(&eset, 4, SC_PTR_BITS), "");
+	eset_remove(&eset, c);
+	expect_ptr_eq(b, fit(&eset, 4, SC_PTR_BITS), "");
+	eset_remove(&eset, b);
+	expect_ptr_eq(a, fit(&eset, 4, SC_PTR_BITS), "");
+
+	/* Another bin's older extent wins, once it's large enough. */
+	edata_t *e = test_edata_init(6, 8, 1);
+	eset_insert(&eset, e);
+	expect_ptr_eq(e, fit(&eset, 4, SC_PTR_BITS), "");
+	expect_ptr_eq(a, fit(&eset, 4, 0), "");
+
+	eset_remove(&eset, a);
+	eset_remove(&eset, e);
+	expect_zu_eq(0, eset_npages_get(&eset), "");
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_first_fit,
+	    test_bin_min);
+}
@@ -0,0 +1,98 @@
+#include "test/jemalloc_test.h"
+
+#define ALLOC_SIZE (64 * 1024)
+
+static unsigned
+do_arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void *
+do_alloc(unsigned arena_ind, size_t size) {
+	void *p = mallocx(size, MALLOCX_ARENA(arena_ind)
+	    | MALLOCX_TCACHE_NONE);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	return p;
+}
+
+static ecache_t *
+ecache_dirty_get(unsigned arena_ind) {
+	arena_t *arena = arena_get(tsd_tsdn(tsd_fetch()), arena_ind, false);
+	expect_ptr_not_null(arena, "");
+	return &arena->pa_shard.pac.ecache_dirty;
+}
+
+TEST_BEGIN(test_coalesce_deferred) {
+	test_skip_if(!opt_extent_coalesce_deferred);
+
+	unsigned arena_ind = do_arena_create();
+	ecache_t *ecache = ecache_dirty_get(arena_ind);
+
+	void *a = do_alloc(arena_ind, ALLOC_SIZE);
+	void *b = do_alloc(arena_ind, ALLOC_SIZE);
+	void *a_base = PAGE_ADDR2BASE(a);
+	void *b_base = PAGE_ADDR2BASE(b);
+	/* Fresh arenas carve allocations out of their grown space in order. */
+	test_skip_if((uintptr_t)b_base != (uintptr_t)a_base + ALLOC_SIZE
+	    + sz_large_pad);
+
+	dallocx(a, MALLOCX_TCACHE_NONE);
+	dallocx(b, MALLOCX_TCACHE_NONE);
+	expect_u_eq(2, ecache_ncoalesce_pending_get(ecache),
+	    "Frees should have been queued up rather than coalesced");
+
+	arena_t *arena = arena_get(tsd_tsdn(tsd_fetch()), arena_ind, false);
+	pa_shard_do_deferred_work(tsd_tsdn(tsd_fetch()), &arena->pa_shard);
+	expect_u_eq(0, ecache_ncoalesce_pending_get(ecache), "");
+
+	/* Only the coalesced extent can satisfy this without growing. */
+	void *p = do_alloc(arena_ind, 2 * ALLOC_SIZE);
+	expect_ptr_eq(a_base, PAGE_ADDR2BASE(p),
+	    "Should have reused the coalesced extent");
+	dallocx(p, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+TEST_BEGIN(test_coalesce_deferred_full) {
+	test_skip_if(!opt_extent_coalesce_deferred);
+
+	unsigned arena_ind = do_arena_create();
+	ecache_t *ecache = ecache_dirty_get(arena_ind);
+
+	enum {NALLOCS = ECACHE_COALESCE_PENDING_MAX + 1};
+	void *ptrs[NALLOCS];
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		ptrs[i] = do_alloc(arena_ind, ALLOC_SIZE);
+	}
+	for (unsigned i = 0; i < ECACHE_COALESCE_PENDING_MAX; i++) {
+		dallocx(ptrs[i], MALLOCX_TCACHE_NONE);
+		expect_u_eq(i + 1, ecache_ncoalesce_pending_get(ecache), "");
+	}
+	size_t nextents = 0;
+	for (pszind_t i = 0; i < SC_NPSIZES; i++) {
+		nextents += ecache_nextents_get(ecache, i);
+	}
+	expect_zu_eq(ECACHE_COALESCE_PENDING_MAX, nextents,
+	    "Queued extents should still be available for reuse");
+
+	/* A full queue gets coalesced by whoever is freeing. */
+	dallocx(ptrs[NALLOCS - 1], MALLOCX_TCACHE_NONE);
+	expect_u_eq(1, ecache_ncoalesce_pending_get(ecache), "");
+	nextents = 0;
+	for (pszind_t i = 0; i < SC_NPSIZES; i++) {
+		nextents += ecache_nextents_get(ecache, i);
+	}
+	expect_zu_lt(nextents, NALLOCS, "Neighbors should have coalesced");
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_coalesce_deferred,
+	    test_coalesce_deferred_full);
+}
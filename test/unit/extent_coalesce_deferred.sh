@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="extent_coalesce_deferred:true,dirty_decay_ms:-1"
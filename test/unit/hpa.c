@@ -17,10 +17,42 @@ struct test_data_s {
 	edata_cache_t shard_edata_cache;
 
 	emap_t emap;
+	/* Unless the test supplies one to share, the shard gets its own. */
+	hpa_central_t central;
+};
+
+static const hpa_shard_opts_t test_hpa_shard_opts_default = {
+	/* slab_max_alloc */
+	ALLOC_MAX,
+	/* hugification threshold */
+	HUGEPAGE * 95 / 100,
+	/* dehugification threshold */
+	HUGEPAGE * 20 / 100,
+	/* dirty_mult */
+	FXP_INIT_PERCENT(25),
+	/* dirty_decay_ms */
+	-1,
+	/* muzzy_decay_ms */
+	0,
+	/* empty_max */
+	SIZE_MAX,
+	/* hugify_delay_ms */
+	0,
+	/* dehugify_delay_ms */
+	0,
+	/* hugify_sync */
+	false,
+	/* hugetlb */
+	false,
+	/* alloc_policy */
+	hpa_alloc_policy_oldest,
+	/* deferral_allowed */
+	false
 };
 
 static hpa_shard_t *
-create_test_data() {
+create_test_data_central(const hpa_shard_opts_t *opts,
+    hpa_central_t *central) {
 	bool err;
 	base_t *base = base_new(TSDN_NULL, /* ind */ SHARD_IND,
 	    &ehooks_default_extent_hooks);
@@ -37,17 +69,27 @@ create_test_data() {
 	err = emap_init(&test_data->emap, test_data->base, /* zeroed */ false);
 	assert_false(err, "");
 
-	hpa_shard_opts_t opts = HPA_SHARD_OPTS_DEFAULT;
-	opts.slab_max_alloc = ALLOC_MAX;
+	if (central == NULL) {
+		central = &test_data->central;
+		err = hpa_central_init(central, test_data->base,
+		    /* empty_max */ 0, HPA_CENTRAL_EDEN_SIZE_DEFAULT,
+		    /* pretouch */ false);
+		assert_false(err, "");
+	}
 
-	err = hpa_shard_init(&test_data->shard, &test_data->emap,
+	err = hpa_shard_init(&test_data->shard, central, &test_data->emap,
 	    test_data->base, &test_data->shard_edata_cache, SHARD_IND,
-	    &opts);
+	    opts);
 	assert_false(err, "");
 
 	return (hpa_shard_t *)test_data;
 }
 
+static hpa_shard_t *
+create_test_data(const hpa_shard_opts_t *opts) {
+	return create_test_data_central(opts, NULL);
+}
+
 static void
 destroy_test_data(hpa_shard_t *shard) {
 	test_data_t *test_data = (test_data_t *)shard;
@@ -58,7 +100,7 @@ destroy_test_data(hpa_shard_t *shard) {
 TEST_BEGIN(test_alloc_max) {
 	test_skip_if(!hpa_supported());
 
-	hpa_shard_t *shard = create_test_data();
+	hpa_shard_t *shard = create_test_data(&test_hpa_shard_opts_default);
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 
 	edata_t *edata;
@@ -134,7 +176,7 @@ node_remove(mem_tree_t *tree, edata_t *edata) {
 TEST_BEGIN(test_stress) {
 	test_skip_if(!hpa_supported());
 
-	hpa_shard_t *shard = create_test_data();
+	hpa_shard_t *shard = create_test_data(&test_hpa_shard_opts_default);
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 
@@ -211,6 +253,763 @@ TEST_BEGIN(test_stress) {
 }
 TEST_END
 
+static void
+expect_shard_ndirty(tsdn_t *tsdn, hpa_shard_t *shard, size_t ndirty) {
+	hpa_shard_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	hpa_shard_stats_merge(tsdn, shard, &stats);
+	size_t ndirty_total = 0;
+	for (int huge = 0; huge <= 1; huge++) {
+		ndirty_total += stats.psset_stats.full_slabs[huge].ndirty;
+		ndirty_total += stats.psset_stats.empty_slabs[huge].ndirty;
+		for (pszind_t i = 0; i < PSSET_NPSIZES; i++) {
+			ndirty_total +=
+			    stats.psset_stats.nonfull_slabs[i][huge].ndirty;
+		}
+	}
+	expect_zu_eq(ndirty, ndirty_total, "Unexpected number of dirty pages");
+}
+
+TEST_BEGIN(test_defer) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	enum {NALLOCS = 8};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	/* With deferral allowed, the dalloc calls shouldn't purge anything. */
+	expect_shard_ndirty(tsdn, shard, NALLOCS);
+	expect_u64_eq(0, shard->stats.ndeferred_inline,
+	    "Shouldn't do work inline when deferral is allowed");
+	expect_u64_eq(0, hpa_shard_time_until_deferred_work(tsdn, shard),
+	    "Should have pending work");
+
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_shard_ndirty(tsdn, shard, 0);
+	expect_u64_eq(1, shard->stats.npurge_passes, "");
+	expect_u64_ne(0, shard->stats.ndeferred_background, "");
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    hpa_shard_time_until_deferred_work(tsdn, shard),
+	    "Shouldn't have pending work after doing it");
+
+	/* Once deferral is turned off, we go back to purging inline. */
+	hpa_shard_set_deferral_allowed(tsdn, shard, false);
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	expect_shard_ndirty(tsdn, shard, 0);
+	expect_u64_ne(0, shard->stats.ndeferred_inline, "");
+
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_dirty_decay) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	/* Leave time-based decay as the only purging policy. */
+	opts.dirty_mult = (fxp_t)-1;
+	opts.dirty_decay_ms = 1000 * 1000;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	expect_zd_eq(1000 * 1000, hpa_shard_dirty_decay_ms_get(shard), "");
+	expect_true(hpa_shard_dirty_decay_ms_set(tsdn, shard, -2),
+	    "Invalid decay time should be rejected");
+
+	enum {NALLOCS = 8};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+
+	/* Freshly dirtied pages should survive until their epoch comes. */
+	uint64_t time_until = hpa_shard_time_until_deferred_work(tsdn, shard);
+	expect_u64_ne(0, time_until, "Shouldn't purge young pages yet");
+	expect_u64_ne(BACKGROUND_THREAD_INDEFINITE_SLEEP, time_until,
+	    "Should wake up for the next decay epoch");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_shard_ndirty(tsdn, shard, NALLOCS);
+	expect_u64_eq(0, shard->stats.npurged, "");
+
+	/* A decay time of 0 means we should purge as soon as we can. */
+	expect_false(hpa_shard_dirty_decay_ms_set(tsdn, shard, 0), "");
+	expect_u64_eq(0, hpa_shard_time_until_deferred_work(tsdn, shard),
+	    "Should have pending work");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_shard_ndirty(tsdn, shard, 0);
+	expect_u64_eq(NALLOCS, shard->stats.npurged, "");
+
+	/* And -1 (with no dirty_mult) means we never purge. */
+	expect_false(hpa_shard_dirty_decay_ms_set(tsdn, shard, -1), "");
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    hpa_shard_time_until_deferred_work(tsdn, shard), "");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_shard_ndirty(tsdn, shard, NALLOCS);
+
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_muzzy_decay) {
+	test_skip_if(!hpa_supported() || !pages_can_purge_lazy);
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	/* Purge dirty pages (lazily) as soon as we can. */
+	opts.dirty_mult = (fxp_t)-1;
+	opts.dirty_decay_ms = 0;
+	opts.muzzy_decay_ms = 1000 * 1000;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	enum {NALLOCS = 8};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_shard_ndirty(tsdn, shard, 0);
+	expect_zu_eq(NALLOCS, psset_nmuzzy(&shard->psset),
+	    "Dirty pages should have been purged lazily");
+	expect_u64_eq(NALLOCS, shard->stats.npurged, "");
+
+	/* Young muzzy pages should survive until their epoch comes. */
+	uint64_t time_until = hpa_shard_time_until_deferred_work(tsdn, shard);
+	expect_u64_ne(0, time_until, "Shouldn't purge young muzzy pages yet");
+	expect_u64_ne(BACKGROUND_THREAD_INDEFINITE_SLEEP, time_until,
+	    "Should wake up for the next muzzy decay epoch");
+
+	/* Reallocating muzzy pages makes them active again. */
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	expect_zu_eq(0, psset_nmuzzy(&shard->psset), "");
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(NALLOCS, psset_nmuzzy(&shard->psset), "");
+
+	/* A muzzy decay time of 0 forcibly purges them right away. */
+	nstime_t now;
+	nstime_init_update(&now);
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	decay_reinit(&shard->muzzy_decay, &now, 0);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	expect_u64_eq(0, hpa_shard_time_until_deferred_work(tsdn, shard),
+	    "Should have pending work");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(0, psset_nmuzzy(&shard->psset), "");
+	expect_shard_ndirty(tsdn, shard, 0);
+	expect_u64_eq(3 * NALLOCS, shard->stats.npurged, "");
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    hpa_shard_time_until_deferred_work(tsdn, shard), "");
+
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_hugify_delay) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.hugify_delay_ms = 1000 * 1000;
+	opts.dehugify_delay_ms = 1000 * 1000;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	/* Fill up a pageslab, making it a hugification candidate. */
+	enum {NALLOCS = HUGEPAGE_PAGES};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	uint64_t time_until = hpa_shard_time_until_deferred_work(tsdn, shard);
+	expect_u64_ne(0, time_until, "Shouldn't hugify before the delay");
+	expect_u64_ne(BACKGROUND_THREAD_INDEFINITE_SLEEP, time_until,
+	    "Should wake up when the delay expires");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u64_eq(0, shard->stats.nhugifies, "");
+
+	/* Pretend the delay has passed. */
+	shard->opts.hugify_delay_ms = 0;
+	expect_u64_eq(0, hpa_shard_time_until_deferred_work(tsdn, shard), "");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u64_eq(1, shard->stats.nhugifies, "");
+
+	/*
+	 * Free enough to make the (now huge) pageslab a dehugification
+	 * candidate; the dehugify delay should hold off the purge.
+	 */
+	for (int i = 0; i < NALLOCS / 2; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	expect_u64_ne(0, hpa_shard_time_until_deferred_work(tsdn, shard), "");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u64_eq(0, shard->stats.ndehugifies, "");
+	expect_shard_ndirty(tsdn, shard, NALLOCS / 2);
+
+	shard->opts.dehugify_delay_ms = 0;
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u64_eq(1, shard->stats.ndehugifies, "");
+	expect_u64_eq(1, shard->stats.ndehugifies_early,
+	    "Dehugification right after hugification should count as early");
+	expect_shard_ndirty(tsdn, shard, 0);
+
+	for (int i = NALLOCS / 2; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_hugify_sync) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.hugify_sync = true;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	/* Fill up a pageslab, making it a hugification candidate. */
+	enum {NALLOCS = HUGEPAGE_PAGES};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+		*(char *)edata_addr_get(edatas[i]) = 1;
+	}
+	hpdata_t *ps = edata_ps_get(edatas[0]);
+	hpa_shard_do_deferred_work(tsdn, shard);
+
+	uint64_t nhugifies = shard->stats.nhugifies;
+	uint64_t nhugify_failures = shard->stats.nhugify_failures;
+	if (pages_collapse_supported()) {
+		/* The collapse may fail, if there's no hugepage to be had. */
+		expect_u64_eq(1, nhugifies + nhugify_failures,
+		    "Should have tried collapsing the pageslab once");
+	} else {
+		expect_u64_eq(1, nhugifies, "Should fall back to advising");
+		expect_u64_eq(0, nhugify_failures, "");
+	}
+	expect_b_eq(nhugifies == 1, hpdata_huge_get(ps),
+	    "Only a successful hugification should make the pageslab huge");
+
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+static unsigned ncollapses;
+
+static bool
+collapse_fail(void *addr, size_t size) {
+	ncollapses++;
+	return true;
+}
+
+static bool
+collapse_supported(void) {
+	return true;
+}
+
+TEST_BEGIN(test_hugify_sync_backoff) {
+	test_skip_if(!hpa_supported());
+
+	pages_collapse_t *collapse_orig = pages_collapse;
+	pages_collapse_supported_t *collapse_supported_orig =
+	    pages_collapse_supported;
+	pages_collapse = collapse_fail;
+	pages_collapse_supported = collapse_supported;
+	ncollapses = 0;
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.hugify_sync = true;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	enum {NALLOCS = HUGEPAGE_PAGES};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE, false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	hpdata_t *ps = edata_ps_get(edatas[0]);
+
+	/* A failed collapse shouldn't be retried while nothing changes. */
+	for (int i = 0; i < 10; i++) {
+		hpa_shard_do_deferred_work(tsdn, shard);
+	}
+	expect_u_eq(1, ncollapses, "Should have tried collapsing just once");
+	expect_u64_eq(1, shard->stats.nhugify_failures, "");
+	expect_false(hpdata_huge_get(ps), "");
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    hpa_shard_time_until_deferred_work(tsdn, shard),
+	    "Nothing should be left to do");
+
+	/* Once the pageslab's allocations change, it gets another chance. */
+	pai_dalloc(tsdn, &shard->pai, edatas[NALLOCS - 1]);
+	hpa_shard_do_deferred_work(tsdn, shard);
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u_eq(2, ncollapses, "Should have retried once");
+	expect_u64_eq(2, shard->stats.nhugify_failures, "");
+
+	for (int i = 0; i < NALLOCS - 1; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+
+	pages_collapse = collapse_orig;
+	pages_collapse_supported = collapse_supported_orig;
+}
+TEST_END
+
+TEST_BEGIN(test_purge_batching) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.dirty_mult = FXP_INIT_PERCENT(0);
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	/* Fill several pageslabs, then punch a couple of holes in each. */
+	enum {
+		NSLABS = 4,
+		NALLOCS_PER_SLAB = HUGEPAGE / ALLOC_MAX,
+		NALLOCS = NSLABS * NALLOCS_PER_SLAB
+	};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, ALLOC_MAX, PAGE,
+		    false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	for (int i = 0; i < NALLOCS; i += 2) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	expect_shard_ndirty(tsdn, shard, NALLOCS / 2 * (ALLOC_MAX / PAGE));
+
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_shard_ndirty(tsdn, shard, 0);
+	expect_u64_ge(shard->stats.npurge_passes, NSLABS,
+	    "Every pageslab with holes should have been purged");
+	expect_u64_ge(shard->stats.npurges, shard->stats.npurge_passes, "");
+	uint64_t npurges = shard->stats.npurges;
+	uint64_t npurge_syscalls = shard->stats.npurge_syscalls;
+
+	for (int i = 1; i < NALLOCS; i += 2) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+
+	/* Without process_madvise, there's nothing to batch with. */
+	test_skip_if(!pages_purge_forced_batch_supported());
+	expect_u64_ne(0, npurge_syscalls, "");
+	expect_u64_lt(npurge_syscalls, npurges,
+	    "Purges should have been batched into fewer syscalls");
+}
+TEST_END
+
+TEST_BEGIN(test_alloc_dalloc_batch) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_t *shard = create_test_data(&test_hpa_shard_opts_default);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	enum {NALLOCS = 8};
+
+	edata_t *allocs[NALLOCS];
+	/*
+	 * Allocate a mix of ways; first half from regular alloc, second half
+	 * from alloc_batch.
+	 */
+	for (size_t i = 0; i < NALLOCS / 2; i++) {
+		allocs[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(allocs[i], "Unexpected alloc failure");
+	}
+	edata_list_active_t allocs_list;
+	edata_list_active_init(&allocs_list);
+	size_t nsuccess = pai_alloc_batch(tsdn, &shard->pai, PAGE, NALLOCS / 2,
+	    &allocs_list);
+	expect_zu_eq(NALLOCS / 2, nsuccess, "Unexpected oom");
+	for (size_t i = NALLOCS / 2; i < NALLOCS; i++) {
+		allocs[i] = edata_list_active_first(&allocs_list);
+		edata_list_active_remove(&allocs_list, allocs[i]);
+	}
+
+	/*
+	 * Should have allocated them contiguously, despite the differing
+	 * methods used.
+	 */
+	void *orig_base = edata_base_get(allocs[0]);
+	for (size_t i = 0; i < NALLOCS; i++) {
+		expect_ptr_eq((void *)((uintptr_t)orig_base + i * PAGE),
+		    edata_base_get(allocs[i]),
+		    "Should have allocated contiguously");
+	}
+
+	/*
+	 * Batch dalloc the first half, individually deallocate the second half.
+	 */
+	for (size_t i = 0; i < NALLOCS / 2; i++) {
+		edata_list_active_append(&allocs_list, allocs[i]);
+	}
+	pai_dalloc_batch(tsdn, &shard->pai, &allocs_list);
+	expect_true(edata_list_active_empty(&allocs_list),
+	    "List should be drained");
+	for (size_t i = NALLOCS / 2; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, allocs[i]);
+	}
+
+	/* Reallocate (individually), and ensure reuse and contiguity. */
+	for (size_t i = 0; i < NALLOCS; i++) {
+		allocs[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(allocs[i], "Unexpected alloc failure.");
+	}
+	void *new_base = edata_base_get(allocs[0]);
+	expect_ptr_eq(orig_base, new_base,
+	    "Failed to reuse the allocated memory.");
+	for (size_t i = 0; i < NALLOCS; i++) {
+		expect_ptr_eq((void *)((uintptr_t)new_base + i * PAGE),
+		    edata_base_get(allocs[i]),
+		    "Should have allocated contiguously");
+	}
+	for (size_t i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, allocs[i]);
+	}
+
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_empty_max) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	/* Leave releasing as the only way pages go back to the OS. */
+	opts.dirty_mult = (fxp_t)-1;
+	opts.empty_max = 1;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	bool retain = opt_retain;
+	enum {NSLABS = 3, NALLOCS = NSLABS * HUGEPAGE_PAGES};
+	static edata_t *edatas[NALLOCS];
+	for (int pass = 0; pass < 2; pass++) {
+		/* Retain address space on the first pass only. */
+		opt_retain = (pass == 0);
+		for (int i = 0; i < NALLOCS; i++) {
+			edatas[i] = pai_alloc(tsdn, &shard->pai, PAGE, PAGE,
+			    false);
+			expect_ptr_not_null(edatas[i], "Unexpected null edata");
+		}
+		expect_zu_eq(NSLABS, psset_npageslabs(&shard->psset), "");
+		if (pass == 1) {
+			expect_ptr_null(hpdata_empty_list_first(
+			    &shard->central->retained),
+			    "Growing should reuse retained pageslabs");
+		}
+		for (int i = 0; i < NALLOCS; i++) {
+			pai_dalloc(tsdn, &shard->pai, edatas[i]);
+		}
+		expect_zu_eq(NSLABS, psset_nempty(&shard->psset),
+		    "Releasing should be deferred");
+		expect_u64_eq(0, hpa_shard_time_until_deferred_work(tsdn,
+		    shard), "Should have pending work");
+
+		hpa_shard_do_deferred_work(tsdn, shard);
+		expect_zu_eq(1, psset_npageslabs(&shard->psset),
+		    "Should keep at most empty_max empty pageslabs");
+		expect_u64_eq((uint64_t)(pass + 1) * (NSLABS - 1),
+		    shard->stats.nempty_releases, "");
+		hpdata_empty_list_t *released = (pass == 0
+		    ? &shard->central->retained : &shard->central->unused);
+		size_t nreleased = 0;
+		hpdata_t *ps;
+		ql_foreach(ps, &released->head, ql_link_empty) {
+			nreleased++;
+		}
+		expect_zu_eq(NSLABS - 1, nreleased,
+		    "Released pageslabs went to the wrong list");
+	}
+	opt_retain = retain;
+
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_hugetlb) {
+	test_skip_if(!hpa_supported());
+
+	/* Find out whether the OS has any explicit hugepages for us. */
+	void *probe = pages_map_hugetlb(HUGEPAGE);
+	bool have_hugetlb = (probe != NULL);
+	if (have_hugetlb) {
+		pages_unmap(probe, HUGEPAGE);
+	}
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.hugetlb = true;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data(&opts);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	enum {NALLOCS = 2};
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = pai_alloc(tsdn, &shard->pai, ALLOC_MAX, PAGE,
+		    false);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+		*(char *)edata_addr_get(edatas[i]) = 1;
+	}
+	expect_zu_eq(1, psset_npageslabs(&shard->psset), "");
+	expect_zu_eq(have_hugetlb ? 1 : 0, shard->psset.merged_stats.nhugetlb,
+	    "Should fall back to ordinary pageslabs without hugetlb pages");
+
+	/* No piecemeal purging inside a hugetlb pageslab. */
+	for (int i = 0; i < NALLOCS / 2; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u64_eq(have_hugetlb ? 0 : 1, shard->stats.npurge_passes, "");
+
+	/* But once it's empty, the whole hugepage goes back. */
+	for (int i = NALLOCS / 2; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_do_deferred_work(tsdn, shard);
+	if (!have_hugetlb) {
+		hpa_shard_destroy(tsdn, shard);
+		destroy_test_data(shard);
+	}
+	/* The rest only makes sense with a hugetlb pageslab. */
+	test_skip_if(!have_hugetlb);
+	expect_u64_eq(1, shard->stats.npurge_passes, "");
+	expect_zu_eq(0, psset_npageslabs(&shard->psset),
+	    "Empty hugetlb pageslab should have been released");
+	hpdata_t *released = hpdata_empty_list_first(&shard->central->unused);
+	expect_ptr_not_null(released, "Should keep the metadata around");
+
+	/* Growing again reuses it. */
+	edatas[0] = pai_alloc(tsdn, &shard->pai, ALLOC_MAX, PAGE, false);
+	expect_ptr_not_null(edatas[0], "Unexpected null edata");
+	expect_ptr_eq(released, edata_ps_get(edatas[0]), "");
+	expect_true(hpdata_hugetlb_get(released), "");
+	expect_ptr_null(hpdata_empty_list_first(&shard->central->unused), "");
+	pai_dalloc(tsdn, &shard->pai, edatas[0]);
+
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_central_pool) {
+	test_skip_if(!hpa_supported());
+
+	base_t *base = base_new(TSDN_NULL, /* ind */ SHARD_IND + 1,
+	    &ehooks_default_extent_hooks);
+	assert_ptr_not_null(base, "");
+	hpa_central_t central;
+	assert_false(hpa_central_init(&central, base, /* empty_max */ 1,
+	    HPA_CENTRAL_EDEN_SIZE_DEFAULT, /* pretouch */ false), "");
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.dirty_mult = (fxp_t)-1;
+	opts.empty_max = 0;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard1 = create_test_data_central(&opts, &central);
+	hpa_shard_t *shard2 = create_test_data_central(&opts, &central);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	edata_t *edata = pai_alloc(tsdn, &shard1->pai, ALLOC_MAX, PAGE, false);
+	expect_ptr_not_null(edata, "Unexpected null edata");
+	hpdata_t *ps = edata_ps_get(edata);
+	pai_dalloc(tsdn, &shard1->pai, edata);
+	hpa_shard_do_deferred_work(tsdn, shard1);
+	expect_zu_eq(0, psset_npageslabs(&shard1->psset), "");
+	expect_u64_eq(1, shard1->stats.nempty_pooled, "");
+	expect_zu_eq(1, central.nempty, "");
+	expect_zu_eq(0, hpdata_ntouched_get(ps),
+	    "Pooled pageslabs shouldn't have any dirty pages");
+
+	/* The other shard should pick it up rather than growing. */
+	edata = pai_alloc(tsdn, &shard2->pai, ALLOC_MAX, PAGE, false);
+	expect_ptr_not_null(edata, "Unexpected null edata");
+	expect_ptr_eq(ps, edata_ps_get(edata),
+	    "Should reuse the pooled pageslab");
+	expect_zu_eq(0, central.nempty, "");
+	pai_dalloc(tsdn, &shard2->pai, edata);
+	hpa_shard_do_deferred_work(tsdn, shard2);
+	expect_u64_eq(1, shard2->stats.nempty_pooled, "");
+
+	/* With the pool full, the next one goes back to the OS. */
+	edata = pai_alloc(tsdn, &shard1->pai, ALLOC_MAX, PAGE, false);
+	expect_ptr_not_null(edata, "Unexpected null edata");
+	edata_t *edata2 = pai_alloc(tsdn, &shard2->pai, ALLOC_MAX, PAGE,
+	    false);
+	expect_ptr_not_null(edata2, "Unexpected null edata");
+	pai_dalloc(tsdn, &shard1->pai, edata);
+	pai_dalloc(tsdn, &shard2->pai, edata2);
+	hpa_shard_do_deferred_work(tsdn, shard1);
+	hpa_shard_do_deferred_work(tsdn, shard2);
+	expect_zu_eq(1, central.nempty, "");
+	expect_u64_eq(2 + 2, shard1->stats.nempty_releases
+	    + shard2->stats.nempty_releases, "");
+	expect_u64_eq(1 + 2, shard1->stats.nempty_pooled
+	    + shard2->stats.nempty_pooled, "");
+
+	hpa_shard_destroy(tsdn, shard1);
+	hpa_shard_destroy(tsdn, shard2);
+	while ((ps = hpdata_empty_list_first(&central.empty)) != NULL) {
+		hpdata_empty_list_remove(&central.empty, ps);
+		pages_unmap(hpdata_addr_get(ps), HUGEPAGE);
+	}
+	destroy_test_data(shard1);
+	destroy_test_data(shard2);
+	base_delete(TSDN_NULL, base);
+}
+TEST_END
+
+static bool
+page_resident(void *addr) {
+#ifdef __linux__
+	unsigned char vec;
+	assert_d_eq(0, mincore(addr, PAGE, &vec), "Unexpected mincore failure");
+	return (vec & 1) != 0;
+#else
+	return true;
+#endif
+}
+
+TEST_BEGIN(test_central_pretouch) {
+	test_skip_if(!hpa_supported());
+
+	base_t *base = base_new(TSDN_NULL, /* ind */ SHARD_IND + 1,
+	    &ehooks_default_extent_hooks);
+	assert_ptr_not_null(base, "");
+	hpa_central_t central;
+	assert_false(hpa_central_init(&central, base, /* empty_max */ 0,
+	    HPA_CENTRAL_EDEN_SIZE_DEFAULT, /* pretouch */ true), "");
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	/* Purge every dirty page we're allowed to. */
+	opts.dirty_mult = 0;
+	opts.hugify_delay_ms = 1000 * 1000;
+	opts.deferral_allowed = true;
+	hpa_shard_t *shard = create_test_data_central(&opts, &central);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	/* Growing once has deferred work pretouch the next pageslab. */
+	enum {NALLOCS_MAX = 2 * HUGEPAGE / ALLOC_MAX};
+	edata_t *edatas[NALLOCS_MAX];
+	edatas[0] = pai_alloc(tsdn, &shard->pai, ALLOC_MAX, PAGE, false);
+	expect_ptr_not_null(edatas[0], "Unexpected null edata");
+	expect_true(hpa_central_pretouch_pending(&central), "");
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_false(hpa_central_pretouch_pending(&central), "");
+
+	/* Fill the first pageslab, so that we grow into the pretouched one. */
+	hpdata_t *ps = edata_ps_get(edatas[0]);
+	int nallocs = 1;
+	while (edata_ps_get(edatas[nallocs - 1]) == ps) {
+		assert_d_lt(nallocs, NALLOCS_MAX, "Should have grown");
+		edatas[nallocs] = pai_alloc(tsdn, &shard->pai, ALLOC_MAX, PAGE,
+		    false);
+		expect_ptr_not_null(edatas[nallocs], "Unexpected null edata");
+		nallocs++;
+	}
+	ps = edata_ps_get(edatas[nallocs - 1]);
+	expect_true(hpdata_pretouched_get(ps), "");
+	void *last_page = (void *)((uintptr_t)hpdata_addr_get(ps) + HUGEPAGE
+	    - PAGE);
+	expect_true(page_resident(last_page), "Pretouch should fault it in");
+
+	/*
+	 * Its unused pages should survive until the hugify delay is up (this
+	 * pass also pretouches the pageslab after it).
+	 */
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_u64_eq(0, shard->stats.npurges, "");
+	expect_zu_eq(HUGEPAGE_PAGES, hpdata_ntouched_get(ps), "");
+	expect_true(page_resident(last_page),
+	    "Pretouched pages shouldn't be purged before the hugify delay");
+	uint64_t time_until = hpa_shard_time_until_deferred_work(tsdn, shard);
+	expect_u64_ne(0, time_until, "");
+	expect_u64_ne(BACKGROUND_THREAD_INDEFINITE_SLEEP, time_until,
+	    "Should wake up when the delay expires");
+
+	/*
+	 * Pretend the delay has passed.  The pageslab didn't fill up, so
+	 * rather than being hugified, it loses its unused pages.
+	 */
+	shard->opts.hugify_delay_ms = 0;
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_false(hpdata_pretouched_get(ps), "");
+	expect_false(hpdata_huge_get(ps), "");
+	expect_u64_gt(shard->stats.npurges, 0, "");
+	expect_zu_eq(ALLOC_MAX / PAGE, hpdata_ntouched_get(ps), "");
+
+	for (int i = 0; i < nallocs; i++) {
+		pai_dalloc(tsdn, &shard->pai, edatas[i]);
+	}
+	hpa_shard_destroy(tsdn, shard);
+	destroy_test_data(shard);
+	base_delete(TSDN_NULL, base);
+}
+TEST_END
+
 int
 main(void) {
 	/*
@@ -227,5 +1026,17 @@ main(void) {
 	(void)mem_tree_destroy;
 	return test_no_reentrancy(
 	    test_alloc_max,
-	    test_stress);
+	    test_stress,
+	    test_defer,
+	    test_dirty_decay,
+	    test_muzzy_decay,
+	    test_hugify_delay,
+	    test_hugify_sync,
+	    test_hugify_sync_backoff,
+	    test_purge_batching,
+	    test_empty_max,
+	    test_hugetlb,
+	    test_central_pool,
+	    test_central_pretouch,
+	    test_alloc_dalloc_batch);
 }
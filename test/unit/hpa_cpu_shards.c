@@ -0,0 +1,99 @@
+#include "test/jemalloc_test.h"
+
+/*
+ * The per-CPU HPA shards belong to no arena, so their deferred work is done
+ * by background thread 0 and by arena.<MALLCTL_ARENAS_ALL>.{decay,purge}.
+ */
+
+#define NALLOCS 1024
+
+static hpa_shard_t *
+cpu_shard_get(void) {
+	assert_u_eq(1, arena_hpa_cpu_global.nshards, "");
+	return &arena_hpa_cpu_global.shards[0];
+}
+
+static size_t
+cpu_shard_ndirty(void) {
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	hpa_shard_t *shard = cpu_shard_get();
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	size_t ndirty = psset_ndirty(&shard->psset);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	return ndirty;
+}
+
+/* Fills up some slabs from the per-CPU shard, then empties them again. */
+static void
+cpu_shard_dirty(void) {
+	void *ptrs[NALLOCS];
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		ptrs[i] = mallocx(PAGE, MALLOCX_TCACHE_NONE);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		dallocx(ptrs[i], MALLOCX_TCACHE_NONE);
+	}
+}
+
+static bool
+have_cpu_shards(void) {
+	return hpa_supported() && opt_hpa && arena_hpa_cpu_global.nshards != 0
+	    && opt_hpa_opts.dirty_decay_ms > 0;
+}
+
+TEST_BEGIN(test_cpu_shard_decay_ctl) {
+	test_skip_if(!have_cpu_shards());
+	test_skip_if(background_thread_enabled());
+
+	cpu_shard_dirty();
+	expect_zu_gt(cpu_shard_ndirty(), 0,
+	    "Dirty pages shouldn't be purged before they decay");
+	sleep_ns(2 * opt_hpa_opts.dirty_decay_ms * 1000 * 1000);
+	/* Idle, nothing else would get round to purging them. */
+	expect_zu_gt(cpu_shard_ndirty(), 0, "");
+	expect_d_eq(mallctl("arena." STRINGIFY(MALLCTL_ARENAS_ALL) ".decay",
+	    NULL, NULL, NULL, 0), 0, "Unexpected mallctl() failure");
+	expect_zu_eq(0, cpu_shard_ndirty(),
+	    "Decayed dirty pages should have been purged");
+}
+TEST_END
+
+TEST_BEGIN(test_cpu_shard_background_thread) {
+	test_skip_if(!have_cpu_shards());
+	test_skip_if(!have_background_thread);
+
+	bool enable = true;
+	expect_d_eq(mallctl("background_thread", NULL, NULL, &enable,
+	    sizeof(enable)), 0, "Unexpected mallctl() failure");
+	expect_true(cpu_shard_get()->opts.deferral_allowed,
+	    "The per-CPU shards should leave their work to thread 0");
+
+	cpu_shard_dirty();
+	/*
+	 * The decay time plus the longest the background thread sleeps for,
+	 * with plenty of slack.
+	 */
+	uint64_t timeout_ms = (uint64_t)opt_hpa_opts.dirty_decay_ms
+	    + opt_background_thread_hpa_interval_max_ms + 10 * 1000;
+	uint64_t waited_ms = 0;
+	while (cpu_shard_ndirty() != 0 && waited_ms < timeout_ms) {
+		sleep_ns(10 * 1000 * 1000);
+		waited_ms += 10;
+	}
+	expect_zu_eq(0, cpu_shard_ndirty(),
+	    "Thread 0 should have purged the idle shard's dirty pages");
+
+	enable = false;
+	expect_d_eq(mallctl("background_thread", NULL, NULL, &enable,
+	    sizeof(enable)), 0, "Unexpected mallctl() failure");
+	expect_false(cpu_shard_get()->opts.deferral_allowed, "");
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_cpu_shard_decay_ctl,
+	    test_cpu_shard_background_thread);
+}
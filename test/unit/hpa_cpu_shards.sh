@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="hpa:true,hpa_cpu_shards:1,hpa_dirty_mult:-1,hpa_dirty_decay_ms:200,hpa_empty_max:1000"
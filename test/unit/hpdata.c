@@ -68,7 +68,8 @@ TEST_BEGIN(test_purge_simple) {
 	expect_zu_eq(hpdata_ntouched_get(&hpdata), HUGEPAGE_PAGES / 2, "");
 
 	hpdata_purge_state_t purge_state;
-	size_t to_purge = hpdata_purge_begin(&hpdata, &purge_state);
+	size_t to_purge = hpdata_purge_begin(&hpdata, &purge_state,
+	    hpdata_purge_dirty_forced);
 	expect_zu_eq(HUGEPAGE_PAGES / 4, to_purge, "");
 
 	void *purge_addr;
@@ -113,7 +114,8 @@ TEST_BEGIN(test_purge_intervening_dalloc) {
 	expect_zu_eq(hpdata_ntouched_get(&hpdata), 3 * HUGEPAGE_PAGES / 4, "");
 
 	hpdata_purge_state_t purge_state;
-	size_t to_purge = hpdata_purge_begin(&hpdata, &purge_state);
+	size_t to_purge = hpdata_purge_begin(&hpdata, &purge_state,
+	    hpdata_purge_dirty_forced);
 	expect_zu_eq(HUGEPAGE_PAGES / 2, to_purge, "");
 
 	void *purge_addr;
@@ -150,6 +152,56 @@ TEST_BEGIN(test_purge_intervening_dalloc) {
 }
 TEST_END
 
+TEST_BEGIN(test_purge_lazy) {
+	hpdata_t hpdata;
+	hpdata_init(&hpdata, HPDATA_ADDR, HPDATA_AGE);
+
+	void *alloc = hpdata_reserve_alloc(&hpdata, HUGEPAGE_PAGES / 2 * PAGE);
+	expect_ptr_eq(alloc, HPDATA_ADDR, "");
+	hpdata_unreserve(&hpdata, alloc, HUGEPAGE_PAGES / 4 * PAGE);
+
+	/* A lazy purge leaves the dirty pages muzzy rather than untouched. */
+	hpdata_purge_state_t purge_state;
+	size_t to_purge = hpdata_purge_begin(&hpdata, &purge_state,
+	    hpdata_purge_dirty_lazy);
+	expect_zu_eq(HUGEPAGE_PAGES / 4, to_purge, "");
+	void *purge_addr;
+	size_t purge_size;
+	while (hpdata_purge_next(&hpdata, &purge_state, &purge_addr,
+	    &purge_size)) {
+	}
+	hpdata_purge_end(&hpdata, &purge_state);
+	expect_true(hpdata_consistent(&hpdata), "");
+	expect_zu_eq(HUGEPAGE_PAGES / 4, hpdata_ntouched_get(&hpdata), "");
+	expect_zu_eq(0, hpdata_ndirty_get(&hpdata), "");
+	expect_zu_eq(HUGEPAGE_PAGES / 4, hpdata_nmuzzy_get(&hpdata), "");
+
+	/* Reusing muzzy pages makes them active again. */
+	alloc = hpdata_reserve_alloc(&hpdata, HUGEPAGE_PAGES / 8 * PAGE);
+	expect_ptr_eq(alloc, HPDATA_ADDR, "");
+	expect_true(hpdata_consistent(&hpdata), "");
+	expect_zu_eq(HUGEPAGE_PAGES / 8, hpdata_nmuzzy_get(&hpdata), "");
+	expect_zu_eq(3 * HUGEPAGE_PAGES / 8, hpdata_ntouched_get(&hpdata), "");
+
+	/* A muzzy purge forcibly purges just the remaining muzzy pages. */
+	to_purge = hpdata_purge_begin(&hpdata, &purge_state,
+	    hpdata_purge_muzzy);
+	expect_zu_eq(HUGEPAGE_PAGES / 8, to_purge, "");
+	bool got_result = hpdata_purge_next(&hpdata, &purge_state, &purge_addr,
+	    &purge_size);
+	expect_true(got_result, "");
+	expect_ptr_eq((char *)HPDATA_ADDR + HUGEPAGE_PAGES / 8 * PAGE,
+	    purge_addr, "");
+	expect_zu_eq(HUGEPAGE_PAGES / 8 * PAGE, purge_size, "");
+	expect_false(hpdata_purge_next(&hpdata, &purge_state, &purge_addr,
+	    &purge_size), "");
+	hpdata_purge_end(&hpdata, &purge_state);
+	expect_true(hpdata_consistent(&hpdata), "");
+	expect_zu_eq(0, hpdata_nmuzzy_get(&hpdata), "");
+	expect_zu_eq(3 * HUGEPAGE_PAGES / 8, hpdata_ntouched_get(&hpdata), "");
+}
+TEST_END
+
 TEST_BEGIN(test_hugify) {
 	hpdata_t hpdata;
 	hpdata_init(&hpdata, HPDATA_ADDR, HPDATA_AGE);
@@ -171,5 +223,6 @@ int main(void) {
 	    test_reserve_alloc,
 	    test_purge_simple,
 	    test_purge_intervening_dalloc,
+	    test_purge_lazy,
 	    test_hugify);
 }
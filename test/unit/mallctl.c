@@ -284,15 +284,43 @@ TEST_BEGIN(test_mallctl_opt) {
 	TEST_MALLCTL_OPT(const char *, metadata_thp, always);
 	TEST_MALLCTL_OPT(bool, retain, always);
 	TEST_MALLCTL_OPT(const char *, dss, always);
+	TEST_MALLCTL_OPT(bool, process_madvise, always);
+	TEST_MALLCTL_OPT(bool, numa_bind, always);
 	TEST_MALLCTL_OPT(bool, hpa, always);
 	TEST_MALLCTL_OPT(size_t, hpa_slab_max_alloc, always);
+	TEST_MALLCTL_OPT(ssize_t, hpa_dirty_decay_ms, always);
+	TEST_MALLCTL_OPT(ssize_t, hpa_muzzy_decay_ms, always);
+	TEST_MALLCTL_OPT(size_t, hpa_empty_max, always);
+	TEST_MALLCTL_OPT(size_t, hpa_central_empty_max, always);
+	TEST_MALLCTL_OPT(size_t, hpa_eden_size, always);
+	TEST_MALLCTL_OPT(bool, hpa_eden_pretouch, always);
+	TEST_MALLCTL_OPT(unsigned, hpa_cpu_shards, always);
+	TEST_MALLCTL_OPT(uint64_t, hpa_hugify_delay_ms, always);
+	TEST_MALLCTL_OPT(uint64_t, hpa_dehugify_delay_ms, always);
+	TEST_MALLCTL_OPT(bool, hpa_hugify_sync, always);
+	TEST_MALLCTL_OPT(bool, hpa_hugetlb, always);
+	TEST_MALLCTL_OPT(const char *, hpa_alloc_policy, always);
 	TEST_MALLCTL_OPT(size_t, hpa_sec_max_alloc, always);
 	TEST_MALLCTL_OPT(size_t, hpa_sec_max_bytes, always);
 	TEST_MALLCTL_OPT(size_t, hpa_sec_nshards, always);
+	TEST_MALLCTL_OPT(bool, hpa_sec_shard_by_cpu, always);
+	TEST_MALLCTL_OPT(size_t, hpa_sec_bytes_after_flush, always);
+	TEST_MALLCTL_OPT(size_t, hpa_sec_batch_fill_extra, always);
+	TEST_MALLCTL_OPT(uint64_t, hpa_sec_max_idle_ms, always);
+	TEST_MALLCTL_OPT(bool, pac_sec, always);
+	TEST_MALLCTL_OPT(size_t, pac_sec_nshards, always);
+	TEST_MALLCTL_OPT(bool, pac_sec_shard_by_cpu, always);
+	TEST_MALLCTL_OPT(size_t, pac_sec_max_alloc, always);
+	TEST_MALLCTL_OPT(size_t, pac_sec_max_bytes, always);
+	TEST_MALLCTL_OPT(size_t, pac_sec_bytes_after_flush, always);
+	TEST_MALLCTL_OPT(size_t, pac_sec_batch_fill_extra, always);
+	TEST_MALLCTL_OPT(uint64_t, pac_sec_max_idle_ms, always);
 	TEST_MALLCTL_OPT(unsigned, narenas, always);
 	TEST_MALLCTL_OPT(const char *, percpu_arena, always);
 	TEST_MALLCTL_OPT(size_t, oversize_threshold, always);
+	TEST_MALLCTL_OPT(size_t, ralloc_mremap_min, always);
 	TEST_MALLCTL_OPT(bool, background_thread, always);
+	TEST_MALLCTL_OPT(size_t, background_thread_hpa_interval_max_ms, always);
 	TEST_MALLCTL_OPT(ssize_t, dirty_decay_ms, always);
 	TEST_MALLCTL_OPT(ssize_t, muzzy_decay_ms, always);
 	TEST_MALLCTL_OPT(bool, stats_print, always);
@@ -305,6 +333,9 @@ TEST_BEGIN(test_mallctl_opt) {
 	TEST_MALLCTL_OPT(bool, xmalloc, xmalloc);
 	TEST_MALLCTL_OPT(bool, tcache, always);
 	TEST_MALLCTL_OPT(size_t, lg_extent_max_active_fit, always);
+	TEST_MALLCTL_OPT(bool, extent_coalesce_deferred, always);
+	TEST_MALLCTL_OPT(size_t, retained_limit, always);
+	TEST_MALLCTL_OPT(ssize_t, retained_idle_ms, always);
 	TEST_MALLCTL_OPT(size_t, tcache_max, always);
 	TEST_MALLCTL_OPT(const char *, thp, always);
 	TEST_MALLCTL_OPT(const char *, zero_realloc, always);
@@ -0,0 +1,96 @@
+#include "test/jemalloc_test.h"
+
+TEST_BEGIN(test_numa_topology) {
+	expect_u_ge(pages_numa_nnodes, 1, "Should always see some node");
+	expect_u_le(pages_numa_nnodes, PAGES_NUMA_NODES_MAX, "");
+	for (int cpu = 0; cpu < (int)ncpus; cpu++) {
+		expect_u_lt(pages_numa_cpu_node(cpu), pages_numa_nnodes,
+		    "CPU %d on a nonexistent node", cpu);
+	}
+	expect_u_eq(0, pages_numa_cpu_node(PAGES_NUMA_CPUS_MAX),
+	    "Unknown CPUs should map to node 0");
+	expect_u_eq(0, pages_numa_cpu_node(-1), "");
+}
+TEST_END
+
+TEST_BEGIN(test_numa_bind) {
+	bool numa_bind;
+	size_t sz = sizeof(numa_bind);
+	expect_d_eq(mallctl("opt.numa_bind", &numa_bind, &sz, NULL, 0), 0, "");
+	/* Without mbind support, we fall back to not binding at all. */
+	expect_b_eq(pages_numa_bind_supported(), numa_bind, "");
+
+	bool commit = true;
+	void *pages = pages_map(NULL, 4 * PAGE, PAGE, &commit);
+	expect_ptr_not_null(pages, "Unexpected pages_map() error");
+	expect_true(pages_numa_bind(pages, 4 * PAGE, PAGES_NUMA_NODES_MAX),
+	    "Binding to an impossible node should fail");
+	bool err = pages_numa_bind(pages, 4 * PAGE, 0);
+	pages_unmap(pages, 4 * PAGE);
+
+	test_skip_if(!numa_bind);
+	expect_false(err, "Binding to node 0 should work");
+}
+TEST_END
+
+TEST_BEGIN(test_numa_resident) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind;
+	size_t sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", &arena_ind, &sz, NULL, 0), 0, "");
+	arena_t *arena = arena_get(tsdn_fetch(), arena_ind, false);
+	expect_u_lt(arena->numa_node, pages_numa_nnodes, "");
+
+	void *p = mallocx(4 * HUGEPAGE, MALLOCX_ARENA(arena_ind)
+	    | MALLOCX_TCACHE_NONE);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	memset(p, 1, 4 * HUGEPAGE);
+
+	uint64_t epoch = 1;
+	expect_d_eq(mallctl("epoch", NULL, NULL, &epoch, sizeof(epoch)), 0,
+	    "");
+	unsigned nnodes;
+	sz = sizeof(nnodes);
+	expect_d_eq(mallctl("stats.numa_nnodes", &nnodes, &sz, NULL, 0), 0,
+	    "");
+	expect_u_eq(pages_numa_nnodes, nnodes, "");
+
+	size_t mib[4];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	expect_d_eq(mallctlnametomib("stats.numa_nodes.0.resident", mib,
+	    &miblen), 0, "");
+	size_t total = 0;
+	for (unsigned i = 0; i < nnodes; i++) {
+		size_t resident;
+		sz = sizeof(resident);
+		mib[2] = i;
+		expect_d_eq(mallctlbymib(mib, miblen, &resident, &sz, NULL, 0),
+		    0, "");
+		if (i == arena->numa_node) {
+			expect_zu_ge(resident, 4 * HUGEPAGE,
+			    "The arena's memory should count for its node");
+		}
+		total += resident;
+	}
+	size_t resident;
+	sz = sizeof(resident);
+	mib[2] = nnodes;
+	expect_d_eq(mallctlbymib(mib, miblen, &resident, &sz, NULL, 0), ENOENT,
+	    "Out-of-range node should be rejected");
+
+	expect_d_eq(mallctl("stats.resident", &resident, &sz, NULL, 0), 0,
+	    "");
+	expect_zu_eq(resident, total, "Nodes should account for everything");
+
+	dallocx(p, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_numa_topology,
+	    test_numa_bind,
+	    test_numa_resident);
+}
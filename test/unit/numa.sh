@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="numa_bind:true,abort:false"
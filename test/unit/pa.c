@@ -67,7 +67,7 @@ test_data_t *init_test_data(ssize_t dirty_decay_ms, ssize_t muzzy_decay_ms) {
 	err = pa_shard_init(TSDN_NULL, &test_data->shard, &test_data->emap,
 	    test_data->base, /* ind */ 1, &test_data->stats,
 	    &test_data->stats_mtx, &time, oversize_threshold, dirty_decay_ms,
-	    muzzy_decay_ms);
+	    muzzy_decay_ms, /* pac_sec_opts */ NULL);
 	assert_false(err, "");
 
 	return test_data;
@@ -112,8 +112,61 @@ TEST_BEGIN(test_alloc_free_purge_thds) {
 }
 TEST_END
 
+TEST_BEGIN(test_cpu_hpa) {
+	test_skip_if(!hpa_supported() || !have_percpu_arena
+	    || malloc_getcpu() < 0);
+
+	test_data_t *test_data = init_test_data(-1, -1);
+	base_t *cpu_base = base_new(TSDN_NULL, /* ind */ 2,
+	    &test_data->hooks);
+	assert_ptr_not_null(cpu_base, "");
+
+	hpa_central_t central;
+	assert_false(hpa_central_init(&central, test_data->base,
+	    /* empty_max */ 0, HPA_CENTRAL_EDEN_SIZE_DEFAULT,
+	    /* pretouch */ false), "");
+	pa_cpu_hpa_t cpu_hpa = {0};
+	hpa_shard_opts_t hpa_opts = HPA_SHARD_OPTS_DEFAULT;
+	sec_opts_t sec_opts = SEC_OPTS_DEFAULT;
+	sec_opts.nshards = 0;
+	bool err = pa_shard_enable_hpa(TSDN_NULL, &test_data->shard, &central,
+	    &cpu_hpa, &hpa_opts, &sec_opts);
+	assert_false(err, "");
+	err = pa_cpu_hpa_init(TSDN_NULL, &cpu_hpa, /* nshards */ 1,
+	    /* ncpus */ 1, &central, &test_data->emap, cpu_base, &hpa_opts);
+	assert_false(err, "");
+	hpa_shard_t *cpu_shard = &cpu_hpa.shards[0];
+
+	/* Slabs come from the per-CPU shard, but still belong to the arena. */
+	edata_t *slab = pa_alloc(TSDN_NULL, &test_data->shard, PAGE, PAGE,
+	    /* slab */ true, /* szind */ 0, /* zero */ false);
+	assert_ptr_not_null(slab, "");
+	expect_d_eq(EXTENT_PAI_HPA, edata_pai_get(slab), "");
+	expect_ptr_eq(cpu_shard, hpdata_shard_get(edata_ps_get(slab)), "");
+	expect_u_eq(1, edata_arena_ind_get(slab), "");
+
+	/* Everything else still comes from the arena's own shard. */
+	edata_t *large = pa_alloc(TSDN_NULL, &test_data->shard, PAGE, PAGE,
+	    /* slab */ false, /* szind */ 0, /* zero */ false);
+	assert_ptr_not_null(large, "");
+	expect_ptr_eq(&test_data->shard.hpa_shard,
+	    hpdata_shard_get(edata_ps_get(large)), "");
+
+	bool generated_dirty;
+	pa_dalloc(TSDN_NULL, &test_data->shard, slab, &generated_dirty);
+	expect_zu_eq(0, psset_nactive(&cpu_shard->psset),
+	    "Slab should have gone back to the per-CPU shard");
+	pa_dalloc(TSDN_NULL, &test_data->shard, large, &generated_dirty);
+	expect_zu_eq(0, psset_nactive(&test_data->shard.hpa_shard.psset), "");
+
+	base_delete(TSDN_NULL, cpu_base);
+	destroy_test_data(test_data);
+}
+TEST_END
+
 int
 main(void) {
 	return test(
-	    test_alloc_free_purge_thds);
+	    test_alloc_free_purge_thds,
+	    test_cpu_hpa);
 }
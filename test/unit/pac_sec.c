@@ -0,0 +1,284 @@
+#include "test/jemalloc_test.h"
+
+/*
+ * The arena-level behavior of the small extent cache in front of the PAC
+ * (opt.pac_sec); test/unit/sec.c covers the cache itself.
+ */
+
+static unsigned
+do_arena_create(extent_hooks_t *h) {
+	unsigned arena_ind;
+	size_t sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz,
+	    (void *)(h != NULL ? &h : NULL), (h != NULL ? sizeof(h) : 0)), 0,
+	    "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+do_arena_ctl(const char *name, unsigned arena_ind) {
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.%s", arena_ind, name);
+	expect_d_eq(mallctl(cmd, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+}
+
+static sec_t *
+pac_sec_get(unsigned arena_ind) {
+	arena_t *arena = arena_get(tsd_tsdn(tsd_fetch()), arena_ind, false);
+	expect_ptr_not_null(arena, "");
+	return &arena->pa_shard.pac_sec;
+}
+
+static size_t
+cacheable_size(unsigned arena_ind) {
+	size_t max_alloc = pac_sec_get(arena_ind)->opts.max_alloc;
+	/* What fits, large pad and all. */
+	size_t size = SC_LARGE_MINCLASS;
+	expect_zu_le(size + sz_large_pad, max_alloc,
+	    "The smallest large size class should be cacheable");
+	return size;
+}
+
+static uint64_t
+get_pac_sec_stat(unsigned arena_ind, const char *name) {
+	uint64_t epoch = 1;
+	expect_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.pac_sec.%s",
+	    arena_ind, name);
+	uint64_t val;
+	size_t sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+static size_t
+get_pac_sec_bytes(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	expect_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.pac_sec.bytes",
+	    arena_ind);
+	size_t bytes;
+	size_t sz = sizeof(bytes);
+	expect_d_eq(mallctl(cmd, (void *)&bytes, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return bytes;
+}
+
+/* Allocates and frees n extents of the given size, all at once. */
+static void
+do_alloc_free(unsigned arena_ind, size_t size, unsigned n) {
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void *ptrs[8];
+	assert_u_le(n, sizeof(ptrs) / sizeof(ptrs[0]), "");
+	for (unsigned i = 0; i < n; i++) {
+		ptrs[i] = mallocx(size, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < n; i++) {
+		dallocx(ptrs[i], flags);
+	}
+}
+
+TEST_BEGIN(test_pac_sec_hit_miss) {
+	test_skip_if(!opt_pac_sec);
+	test_skip_if(opt_hpa);
+
+	unsigned arena_ind = do_arena_create(NULL);
+	expect_true(arena_get(tsd_tsdn(tsd_fetch()), arena_ind,
+	    false)->pa_shard.use_pac_sec, "");
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	size_t size = cacheable_size(arena_ind);
+
+	void *p = mallocx(size, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+	/*
+	 * The freed extent should be handed right back (though maybe at
+	 * another offset into its first page, for cache-obliviousness).
+	 */
+	void *q = mallocx(size, flags);
+	expect_ptr_eq(PAGE_ADDR2BASE(p), PAGE_ADDR2BASE(q),
+	    "Expected a cache hit");
+	dallocx(q, flags);
+
+	/* Too large to cache; that goes straight to the PAC. */
+	size_t big_size = pac_sec_get(arena_ind)->opts.max_alloc * 2;
+	do_alloc_free(arena_ind, big_size, 1);
+
+	if (config_stats) {
+		expect_u64_eq(1, get_pac_sec_stat(arena_ind, "nmisses"), "");
+		expect_u64_eq(1, get_pac_sec_stat(arena_ind, "nhits"), "");
+		expect_zu_eq(size + sz_large_pad, get_pac_sec_bytes(arena_ind),
+		    "Only the cacheable extent should be cached");
+	}
+	do_arena_ctl("destroy", arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_pac_sec_flush) {
+	test_skip_if(!opt_pac_sec);
+	test_skip_if(opt_hpa);
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind = do_arena_create(NULL);
+	size_t size = cacheable_size(arena_ind);
+	size_t npages = (size + sz_large_pad) >> LG_PAGE;
+
+	/* Purging everything includes the cache. */
+	do_alloc_free(arena_ind, size, 4);
+	expect_zu_gt(get_pac_sec_bytes(arena_ind), 0, "");
+	do_arena_ctl("purge", arena_ind);
+	expect_zu_eq(0, get_pac_sec_bytes(arena_ind), "");
+	expect_zu_eq(0, ecache_npages_get(
+	    &arena_get(tsd_tsdn(tsd_fetch()), arena_ind, false)->pa_shard.pac
+	    .ecache_dirty), "Flushed extents should have been purged too");
+	uint64_t nflushed = get_pac_sec_stat(arena_ind, "nflushed");
+	expect_u64_gt(nflushed, 0, "");
+
+	/* As does a reset. */
+	do_alloc_free(arena_ind, size, 4);
+	expect_zu_gt(get_pac_sec_bytes(arena_ind), 0, "");
+	do_arena_ctl("reset", arena_ind);
+	expect_zu_eq(0, get_pac_sec_bytes(arena_ind), "");
+	expect_u64_gt(get_pac_sec_stat(arena_ind, "nflushed"), nflushed, "");
+
+	/*
+	 * And a destroy, whose stats get merged into those of destroyed
+	 * arenas, after the flush.
+	 */
+	do_alloc_free(arena_ind, size, 4);
+	expect_zu_ge(get_pac_sec_bytes(arena_ind), npages << LG_PAGE, "");
+	size_t destroyed_bytes = get_pac_sec_bytes(MALLCTL_ARENAS_DESTROYED);
+	do_arena_ctl("destroy", arena_ind);
+	expect_zu_eq(destroyed_bytes,
+	    get_pac_sec_bytes(MALLCTL_ARENAS_DESTROYED),
+	    "Nothing should be left cached in a destroyed arena");
+}
+TEST_END
+
+static extent_hooks_t *default_hooks;
+static extent_hooks_t hooks_custom;
+
+static void *
+extent_alloc_hook(extent_hooks_t *extent_hooks, void *new_addr, size_t size,
+    size_t alignment, bool *zero, bool *commit, unsigned arena_ind) {
+	/* The default hook goes by arena 0, as a new one isn't set up yet. */
+	return default_hooks->alloc(default_hooks, new_addr, size, alignment,
+	    zero, commit, 0);
+}
+
+static extent_hooks_t *
+custom_hooks_get(void) {
+	size_t sz = sizeof(default_hooks);
+	expect_d_eq(mallctl("arena.0.extent_hooks", (void *)&default_hooks,
+	    &sz, NULL, 0), 0, "Unexpected mallctl() failure");
+	hooks_custom = *default_hooks;
+	hooks_custom.alloc = &extent_alloc_hook;
+	return &hooks_custom;
+}
+
+TEST_BEGIN(test_pac_sec_custom_hooks) {
+	test_skip_if(!opt_pac_sec);
+	test_skip_if(opt_hpa);
+
+	/* Arenas created with custom hooks never cache. */
+	extent_hooks_t *hooks = custom_hooks_get();
+	unsigned arena_ind = do_arena_create(hooks);
+	expect_false(arena_get(tsd_tsdn(tsd_fetch()), arena_ind,
+	    false)->pa_shard.use_pac_sec, "");
+	size_t size = SC_LARGE_MINCLASS;
+	do_alloc_free(arena_ind, size, 4);
+	if (config_stats) {
+		expect_zu_eq(0, get_pac_sec_bytes(arena_ind), "");
+		expect_u64_eq(0, get_pac_sec_stat(arena_ind, "nmisses"), "");
+	}
+	do_arena_ctl("destroy", arena_ind);
+
+	/*
+	 * Installing custom hooks on an arena that had been caching flushes
+	 * the cache, and stops further caching.
+	 */
+	arena_ind = do_arena_create(NULL);
+	size = cacheable_size(arena_ind);
+	do_alloc_free(arena_ind, size, 4);
+	if (config_stats) {
+		expect_zu_gt(get_pac_sec_bytes(arena_ind), 0, "");
+	}
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.extent_hooks", arena_ind);
+	expect_d_eq(mallctl(cmd, NULL, NULL, (void *)&hooks, sizeof(hooks)),
+	    0, "Unexpected mallctl() failure");
+	if (config_stats) {
+		expect_zu_eq(0, get_pac_sec_bytes(arena_ind), "");
+	}
+	do_alloc_free(arena_ind, size, 4);
+	if (config_stats) {
+		expect_zu_eq(0, get_pac_sec_bytes(arena_ind), "");
+	}
+	do_arena_ctl("destroy", arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_pac_sec_stats_merge) {
+	test_skip_if(!opt_pac_sec);
+	test_skip_if(opt_hpa);
+	test_skip_if(!config_stats);
+
+	unsigned arena_inds[2];
+	for (unsigned i = 0; i < 2; i++) {
+		arena_inds[i] = do_arena_create(NULL);
+		size_t size = cacheable_size(arena_inds[i]);
+		/* One miss, then hits. */
+		for (unsigned j = 0; j <= i + 1; j++) {
+			do_alloc_free(arena_inds[i], size, 1);
+		}
+		expect_u64_eq(i + 1, get_pac_sec_stat(arena_inds[i], "nhits"),
+		    "");
+	}
+
+	/* The per-size-class stats sum up to the totals. */
+	const char *names[] = {"nhits", "nmisses", "nfills", "nfilled",
+	    "nflushed"};
+	for (unsigned i = 0; i < 2; i++) {
+		for (unsigned k = 0; k < sizeof(names) / sizeof(names[0]);
+		    k++) {
+			uint64_t sum = 0;
+			for (unsigned j = 0; j < SEC_NPSIZES; j++) {
+				char name[64];
+				malloc_snprintf(name, sizeof(name), "bins.%u.%s",
+				    j, names[k]);
+				sum += get_pac_sec_stat(arena_inds[i], name);
+			}
+			expect_u64_eq(get_pac_sec_stat(arena_inds[i],
+			    names[k]), sum, "Mismatch for %s", names[k]);
+		}
+	}
+
+	/* And the arenas' add up into the merged ones. */
+	expect_u64_ge(get_pac_sec_stat(MALLCTL_ARENAS_ALL, "nhits"),
+	    get_pac_sec_stat(arena_inds[0], "nhits")
+	    + get_pac_sec_stat(arena_inds[1], "nhits"), "");
+	expect_zu_ge(get_pac_sec_bytes(MALLCTL_ARENAS_ALL),
+	    get_pac_sec_bytes(arena_inds[0])
+	    + get_pac_sec_bytes(arena_inds[1]), "");
+
+	for (unsigned i = 0; i < 2; i++) {
+		do_arena_ctl("destroy", arena_inds[i]);
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_pac_sec_hit_miss,
+	    test_pac_sec_flush,
+	    test_pac_sec_custom_hooks,
+	    test_pac_sec_stats_merge);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="pac_sec:true"
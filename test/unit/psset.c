@@ -18,7 +18,7 @@ edata_init_test(edata_t *edata) {
 static void
 test_psset_fake_purge(hpdata_t *ps) {
 	hpdata_purge_state_t purge_state;
-	hpdata_purge_begin(ps, &purge_state);
+	hpdata_purge_begin(ps, &purge_state, hpdata_purge_dirty_forced);
 	void *addr;
 	size_t size;
 	while (hpdata_purge_next(ps, &purge_state, &addr, &size)) {
@@ -108,7 +108,7 @@ TEST_BEGIN(test_empty) {
 	edata_init_test(&alloc);
 
 	psset_t psset;
-	psset_init(&psset);
+	psset_init(&psset, hpa_alloc_policy_oldest);
 
 	/* Empty psset should return fail allocations. */
 	err = test_psset_alloc_reuse(&psset, &alloc, PAGE);
@@ -125,7 +125,7 @@ TEST_BEGIN(test_fill) {
 	edata_t alloc[HUGEPAGE_PAGES];
 
 	psset_t psset;
-	psset_init(&psset);
+	psset_init(&psset, hpa_alloc_policy_oldest);
 
 	edata_init_test(&alloc[0]);
 	test_psset_alloc_new(&psset, &pageslab, &alloc[0], PAGE);
@@ -158,7 +158,7 @@ TEST_BEGIN(test_reuse) {
 	edata_t alloc[HUGEPAGE_PAGES];
 
 	psset_t psset;
-	psset_init(&psset);
+	psset_init(&psset, hpa_alloc_policy_oldest);
 
 	edata_init_test(&alloc[0]);
 	test_psset_alloc_new(&psset, &pageslab, &alloc[0], PAGE);
@@ -250,7 +250,7 @@ TEST_BEGIN(test_evict) {
 	edata_t alloc[HUGEPAGE_PAGES];
 
 	psset_t psset;
-	psset_init(&psset);
+	psset_init(&psset, hpa_alloc_policy_oldest);
 
 	/* Alloc the whole slab. */
 	edata_init_test(&alloc[0]);
@@ -287,7 +287,7 @@ TEST_BEGIN(test_multi_pageslab) {
 	edata_t alloc[2][HUGEPAGE_PAGES];
 
 	psset_t psset;
-	psset_init(&psset);
+	psset_init(&psset, hpa_alloc_policy_oldest);
 
 	/* Insert both slabs. */
 	edata_init_test(&alloc[0][0]);
@@ -386,7 +386,7 @@ TEST_BEGIN(test_stats) {
 	edata_t alloc[HUGEPAGE_PAGES];
 
 	psset_t psset;
-	psset_init(&psset);
+	psset_init(&psset, hpa_alloc_policy_oldest);
 	stats_expect(&psset, 0);
 
 	edata_init_test(&alloc[0]);
@@ -416,6 +416,68 @@ TEST_BEGIN(test_stats) {
 }
 TEST_END
 
+static void
+stats_hist_expect(size_t hist[PSSET_NHIST][2], size_t ind, size_t huge) {
+	for (size_t i = 0; i < PSSET_NHIST; i++) {
+		for (size_t j = 0; j <= 1; j++) {
+			expect_zu_eq((i == ind && j == huge) ? 1 : 0,
+			    hist[i][j], "Wrong count in bucket %zu (huge %zu)",
+			    i, j);
+		}
+	}
+}
+
+TEST_BEGIN(test_stats_hist) {
+	expect_zu_eq(0, psset_hist_ind(0), "");
+	expect_zu_eq(0, psset_hist_ind(HUGEPAGE_PAGES / PSSET_NHIST - 1), "");
+	expect_zu_eq(1, psset_hist_ind(HUGEPAGE_PAGES / PSSET_NHIST), "");
+	expect_zu_eq(PSSET_NHIST - 1, psset_hist_ind(HUGEPAGE_PAGES - 1), "");
+	expect_zu_eq(PSSET_NHIST - 1, psset_hist_ind(HUGEPAGE_PAGES),
+	    "Full pageslabs should share the last bucket");
+
+	hpdata_t pageslab;
+	hpdata_init(&pageslab, PAGESLAB_ADDR, PAGESLAB_AGE);
+	psset_t psset;
+	psset_init(&psset, hpa_alloc_policy_oldest);
+
+	edata_t alloc[2];
+	edata_init_test(&alloc[0]);
+	test_psset_alloc_new(&psset, &pageslab, &alloc[0], HUGEPAGE / 2);
+	edata_init_test(&alloc[1]);
+	bool err = test_psset_alloc_reuse(&psset, &alloc[1], HUGEPAGE / 4);
+	expect_false(err, "");
+	stats_hist_expect(psset.stats.nactive_hist,
+	    psset_hist_ind(3 * HUGEPAGE_PAGES / 4), 0);
+	stats_hist_expect(psset.stats.ndirty_hist, 0, 0);
+
+	/* Freed pages move the pageslab down one histogram and up the other. */
+	expect_ptr_null(test_psset_dalloc(&psset, &alloc[0]), "");
+	stats_hist_expect(psset.stats.nactive_hist,
+	    psset_hist_ind(HUGEPAGE_PAGES / 4), 0);
+	stats_hist_expect(psset.stats.ndirty_hist,
+	    psset_hist_ind(HUGEPAGE_PAGES / 2), 0);
+
+	/* Hugifying touches (and so dirties) every inactive page. */
+	psset_update_begin(&psset, &pageslab);
+	hpdata_hugify(&pageslab);
+	psset_update_end(&psset, &pageslab);
+	stats_hist_expect(psset.stats.nactive_hist,
+	    psset_hist_ind(HUGEPAGE_PAGES / 4), 1);
+	stats_hist_expect(psset.stats.ndirty_hist,
+	    psset_hist_ind(3 * HUGEPAGE_PAGES / 4), 1);
+
+	/* Accumulating should carry the histograms along. */
+	psset_stats_t merged;
+	memset(&merged, 0, sizeof(merged));
+	psset_stats_accum(&merged, &psset.stats);
+	psset_stats_accum(&merged, &psset.stats);
+	expect_zu_eq(2, merged.nactive_hist[psset_hist_ind(
+	    HUGEPAGE_PAGES / 4)][1], "");
+	expect_zu_eq(2, merged.ndirty_hist[psset_hist_ind(
+	    3 * HUGEPAGE_PAGES / 4)][1], "");
+}
+TEST_END
+
 /*
  * Fills in and inserts two pageslabs, with the first better than the second,
  * and each fully allocated (into the allocations in allocs and worse_allocs,
@@ -437,7 +499,7 @@ init_test_pageslabs(psset_t *psset, hpdata_t *pageslab,
 	 */
 	hpdata_init(worse_pageslab, (void *)(9 * HUGEPAGE), PAGESLAB_AGE + 1);
 
-	psset_init(psset);
+	psset_init(psset, hpa_alloc_policy_oldest);
 
 	edata_init_test(&alloc[0]);
 	test_psset_alloc_new(psset, pageslab, &alloc[0], PAGE);
@@ -540,6 +602,75 @@ TEST_BEGIN(test_insert_remove) {
 }
 TEST_END
 
+static void
+init_policy_test_pageslab(psset_t *psset, hpdata_t *ps, uintptr_t hugepage,
+    uint64_t age, size_t nsingle_holes) {
+	hpdata_init(ps, (void *)(hugepage * HUGEPAGE), age);
+	test_psset_fake_purge(ps);
+	psset_insert(psset, ps);
+	psset_update_begin(psset, ps);
+	void *addr = hpdata_reserve_alloc(ps, HUGEPAGE);
+	/*
+	 * Every pageslab gets the same 4-page hole at its end, so that they all
+	 * land in the same size class; they only differ in how many extra
+	 * single-page holes they have.
+	 */
+	hpdata_unreserve(ps,
+	    (void *)((uintptr_t)addr + (HUGEPAGE_PAGES - 4) * PAGE), 4 * PAGE);
+	for (size_t i = 0; i < nsingle_holes; i++) {
+		hpdata_unreserve(ps, (void *)((uintptr_t)addr + 2 * i * PAGE),
+		    PAGE);
+	}
+	psset_update_end(psset, ps);
+}
+
+TEST_BEGIN(test_alloc_policies) {
+	for (int policy = 0; policy < hpa_alloc_policy_limit; policy++) {
+		psset_t psset;
+		psset_init(&psset, (hpa_alloc_policy_t)policy);
+
+		/* The oldest, but emptiest, and at the highest address. */
+		hpdata_t oldest;
+		init_policy_test_pageslab(&psset, &oldest, 30, PAGESLAB_AGE, 2);
+		/* The fullest. */
+		hpdata_t fullest;
+		init_policy_test_pageslab(&psset, &fullest, 20,
+		    PAGESLAB_AGE + 1, 0);
+		/* The youngest, but at the lowest address. */
+		hpdata_t lowest;
+		init_policy_test_pageslab(&psset, &lowest, 10,
+		    PAGESLAB_AGE + 2, 1);
+
+		hpdata_t *expected;
+		switch (policy) {
+		case hpa_alloc_policy_oldest:
+			expected = &oldest;
+			break;
+		case hpa_alloc_policy_fullest:
+			expected = &fullest;
+			break;
+		case hpa_alloc_policy_lowest_address:
+			expected = &lowest;
+			break;
+		default:
+			not_reached();
+		}
+		expect_ptr_eq(expected, psset_pick_alloc(&psset, PAGE),
+		    "Wrong pageslab picked under policy %s",
+		    hpa_alloc_policy_names[policy]);
+		/* Updates should reorder the pageslabs accordingly. */
+		if (policy == hpa_alloc_policy_fullest) {
+			psset_update_begin(&psset, &fullest);
+			hpdata_unreserve(&fullest, hpdata_addr_get(&fullest),
+			    4 * PAGE);
+			psset_update_end(&psset, &fullest);
+			expect_ptr_eq(&lowest, psset_pick_alloc(&psset, PAGE),
+			    "Should pick the new fullest pageslab");
+		}
+	}
+}
+TEST_END
+
 int
 main(void) {
 	return test_no_reentrancy(
@@ -549,6 +680,8 @@ main(void) {
 	    test_evict,
 	    test_multi_pageslab,
 	    test_stats,
+	    test_stats_hist,
 	    test_oldest_fit,
-	    test_insert_remove);
+	    test_insert_remove,
+	    test_alloc_policies);
 }
@@ -0,0 +1,247 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/hook.h"
+#include "jemalloc/internal/large_externs.h"
+
+#ifdef JEMALLOC_HAVE_MREMAP
+#  include <sys/mman.h>
+#endif
+
+/*
+ * Each test works in an arena of its own, where the allocation we grow starts
+ * out twice the size, and gets shrunk in place.  The (otherwise empty) arena
+ * then hands out what got trimmed off for the next allocation, which sits
+ * right after ours so that it can't grow in place, and has to move.
+ */
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static bool
+page_mapped(void *ptr) {
+#ifdef JEMALLOC_HAVE_MREMAP
+	unsigned char vec;
+	return mincore(PAGE_ADDR2BASE(ptr), PAGE, &vec) == 0;
+#else
+	return true;
+#endif
+}
+
+static void
+fill(void *ptr, size_t size) {
+	for (size_t i = 0; i < size; i += PAGE) {
+		((uint8_t *)ptr)[i] = (uint8_t)(i >> LG_PAGE);
+	}
+	((uint8_t *)ptr)[size - 1] = 0x5a;
+}
+
+static void
+expect_filled(void *ptr, size_t size) {
+	for (size_t i = 0; i < size; i += PAGE) {
+		expect_u_eq((uint8_t)(i >> LG_PAGE), ((uint8_t *)ptr)[i],
+		    "Contents should survive the move, at offset %zu", i);
+	}
+	expect_u_eq(0x5a, ((uint8_t *)ptr)[size - 1], "");
+}
+
+/*
+ * Grows a size-byte allocation to new_size where it can't grow in place;
+ * returns whether it got moved by remapping (rather than by copying).
+ */
+static bool
+grow_blocked(size_t size, size_t new_size, int flags, void (*prep)(void *),
+    void **r_ptr) {
+	unsigned arena_ind = arena_create();
+	flags |= MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	void *ptr = mallocx(2 * size, flags);
+	expect_ptr_not_null(ptr, "Unexpected mallocx() failure");
+	expect_zu_eq(size, xallocx(ptr, size, 0, flags),
+	    "Unexpected xallocx() failure");
+	void *blocker = mallocx(size / 2, flags);
+	expect_ptr_not_null(blocker, "Unexpected mallocx() failure");
+	expect_ptr_eq((void *)((uintptr_t)PAGE_ADDR2BASE(ptr) + size
+	    + sz_large_pad), PAGE_ADDR2BASE(blocker),
+	    "Blocker should come right after the allocation");
+	fill(ptr, size);
+	if (prep != NULL) {
+		prep(ptr);
+	}
+
+	void *new_ptr = rallocx(ptr, new_size, flags);
+	expect_ptr_not_null(new_ptr, "Unexpected rallocx() failure");
+	expect_ptr_ne(ptr, new_ptr, "Allocation should have moved");
+	expect_filled(new_ptr, size);
+	/* A copied-from extent stays mapped, as dirty memory. */
+	bool remapped = !page_mapped(ptr);
+
+	dallocx(blocker, flags);
+	*r_ptr = new_ptr;
+	return remapped;
+}
+
+TEST_BEGIN(test_ralloc_mremap) {
+	test_skip_if(!pages_can_move);
+	test_skip_if(opt_ralloc_mremap_min == 0);
+
+	size_t size = (opt_ralloc_mremap_min > SC_LARGE_MINCLASS)
+	    ? opt_ralloc_mremap_min : SC_LARGE_MINCLASS;
+	void *ptr;
+	expect_true(grow_blocked(size, 4 * size, 0, NULL, &ptr),
+	    "Allocation should have been remapped");
+	expect_zu_eq(sz_s2u(4 * size), sallocx(ptr, 0), "");
+	/* The rest of it is usable, and goes back on free. */
+	memset(ptr, 0xa5, 4 * size);
+	dallocx(ptr, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+TEST_BEGIN(test_ralloc_mremap_zero) {
+	test_skip_if(!pages_can_move);
+	test_skip_if(opt_ralloc_mremap_min == 0);
+
+	size_t size = (opt_ralloc_mremap_min > SC_LARGE_MINCLASS)
+	    ? opt_ralloc_mremap_min : SC_LARGE_MINCLASS;
+	void *ptr;
+	expect_true(grow_blocked(size, 4 * size, MALLOCX_ZERO, NULL, &ptr),
+	    "Allocation should have been remapped");
+	for (size_t i = size; i < 4 * size; i++) {
+		if (((uint8_t *)ptr)[i] != 0) {
+			expect_u_eq(0, ((uint8_t *)ptr)[i],
+			    "Growth should be zeroed, at offset %zu", i);
+			break;
+		}
+	}
+	dallocx(ptr, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+TEST_BEGIN(test_ralloc_mremap_min) {
+	/* Big enough for the blocker to be large too. */
+	size_t size = 2 * SC_LARGE_MINCLASS;
+	test_skip_if(opt_ralloc_mremap_min <= size);
+
+	void *ptr;
+	expect_false(grow_blocked(size, 4 * size, 0, NULL, &ptr),
+	    "Allocations under the minimum should be copied");
+	dallocx(ptr, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+static unsigned hook_nalloc;
+static unsigned hook_ndalloc;
+static unsigned hook_nexpand;
+static void *hook_expand_address;
+
+static void
+test_alloc_hook(void *extra, hook_alloc_t type, void *result,
+    uintptr_t result_raw, uintptr_t args_raw[3]) {
+	hook_nalloc++;
+}
+
+static void
+test_dalloc_hook(void *extra, hook_dalloc_t type, void *address,
+    uintptr_t args_raw[3]) {
+	hook_ndalloc++;
+}
+
+static void
+test_expand_hook(void *extra, hook_expand_t type, void *address,
+    size_t old_usize, size_t new_usize, uintptr_t result_raw,
+    uintptr_t args_raw[4]) {
+	hook_nexpand++;
+	hook_expand_address = address;
+}
+
+TEST_BEGIN(test_ralloc_mremap_in_place) {
+	test_skip_if(!pages_can_move);
+	test_skip_if(!opt_retain);
+	test_skip_if(opt_ralloc_mremap_min == 0
+	    || opt_ralloc_mremap_min > ((size_t)1 << 20));
+
+	/*
+	 * Have the arena unmap what's left of the reservation the allocation
+	 * came out of, so that nothing of the arena's follows it, and the
+	 * kernel can (usually) grow its mapping in place.
+	 */
+	unsigned arena_ind = arena_create();
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	size_t size = (size_t)1 << 20;
+	void *ptr = mallocx(size, flags);
+	expect_ptr_not_null(ptr, "Unexpected mallocx() failure");
+	fill(ptr, size);
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.retained_limit", arena_ind);
+	size_t limit = PAGE;
+	expect_d_eq(mallctl(cmd, NULL, NULL, (void *)&limit, sizeof(limit)), 0,
+	    "Unexpected mallctl() failure");
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	pa_shard_do_deferred_work(tsdn,
+	    &arena_get(tsdn, arena_ind, false)->pa_shard);
+
+	hooks_t hooks = {&test_alloc_hook, &test_dalloc_hook,
+	    &test_expand_hook, NULL};
+	void *handle = hook_install(TSDN_NULL, &hooks);
+	expect_ptr_not_null(handle, "Hook installation failed");
+	hook_nalloc = hook_ndalloc = hook_nexpand = 0;
+	void *new_ptr = rallocx(ptr, size + size / 2, flags);
+	hook_remove(TSDN_NULL, handle);
+	expect_ptr_not_null(new_ptr, "Unexpected rallocx() failure");
+	expect_filled(new_ptr, size);
+
+	if (new_ptr == ptr) {
+		/* A live allocation mustn't be reported as freed. */
+		expect_u_eq(1, hook_nexpand, "");
+		expect_ptr_eq(ptr, hook_expand_address, "");
+		expect_u_eq(0, hook_nalloc, "");
+		expect_u_eq(0, hook_ndalloc, "");
+	} else {
+		/* Something else got mapped after it in the meantime. */
+		expect_u_eq(0, hook_nexpand, "");
+		expect_u_eq(1, hook_nalloc, "");
+		expect_u_eq(1, hook_ndalloc, "");
+	}
+	dallocx(new_ptr, flags);
+}
+TEST_END
+
+#if defined(JEMALLOC_HAVE_MREMAP) && defined(MADV_DONTFORK)
+static void
+split_mapping(void *ptr) {
+	/* Tags a page, so that the allocation spans three mappings. */
+	void *page = (void *)((uintptr_t)PAGE_ADDR2BASE(ptr) + PAGE);
+	expect_d_eq(0, madvise(page, PAGE, MADV_DONTFORK), "");
+}
+#endif
+
+TEST_BEGIN(test_ralloc_mremap_fallback) {
+	test_skip_if(!pages_can_move);
+	test_skip_if(opt_ralloc_mremap_min == 0);
+#if defined(JEMALLOC_HAVE_MREMAP) && defined(MADV_DONTFORK)
+	size_t size = (opt_ralloc_mremap_min > SC_LARGE_MINCLASS)
+	    ? opt_ralloc_mremap_min : SC_LARGE_MINCLASS;
+	void *ptr;
+	expect_false(grow_blocked(size, 4 * size, 0, split_mapping, &ptr),
+	    "Can't remap across mappings; should have been copied");
+	dallocx(ptr, MALLOCX_TCACHE_NONE);
+#else
+	test_skip_if(true);
+#endif
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_ralloc_mremap,
+	    test_ralloc_mremap_zero,
+	    test_ralloc_mremap_min,
+	    test_ralloc_mremap_in_place,
+	    test_ralloc_mremap_fallback);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="ralloc_mremap_min:1048576"
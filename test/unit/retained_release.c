@@ -0,0 +1,202 @@
+#include "test/jemalloc_test.h"
+
+#define ALLOC_SIZE (1024 * 1024)
+
+static unsigned
+do_arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static pac_t *
+pac_get(unsigned arena_ind) {
+	arena_t *arena = arena_get(tsd_tsdn(tsd_fetch()), arena_ind, false);
+	expect_ptr_not_null(arena, "");
+	return &arena->pa_shard.pac;
+}
+
+static void
+do_deferred_work(unsigned arena_ind) {
+	arena_t *arena = arena_get(tsd_tsdn(tsd_fetch()), arena_ind, false);
+	pa_shard_do_deferred_work(tsd_tsdn(tsd_fetch()), &arena->pa_shard);
+}
+
+/*
+ * With immediate decay, everything freed ends up in the retained ecache, along
+ * with the rest of what the arena grew by.
+ */
+static void
+do_alloc_free(unsigned arena_ind, unsigned nallocs) {
+	void *ptrs[8];
+	assert_u_le(nallocs, sizeof(ptrs) / sizeof(ptrs[0]), "");
+	for (unsigned i = 0; i < nallocs; i++) {
+		ptrs[i] = mallocx(ALLOC_SIZE, MALLOCX_ARENA(arena_ind)
+		    | MALLOCX_TCACHE_NONE);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < nallocs; i++) {
+		dallocx(ptrs[i], MALLOCX_TCACHE_NONE);
+	}
+}
+
+static void
+do_mallctl_set(const char *fmt, unsigned arena_ind, void *val, size_t len) {
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), fmt, arena_ind);
+	expect_d_eq(mallctl(cmd, NULL, NULL, val, len), 0,
+	    "Unexpected mallctl() failure");
+}
+
+static uint64_t
+get_released(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	expect_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.retained_released",
+	    arena_ind);
+	uint64_t released;
+	size_t sz = sizeof(released);
+	expect_d_eq(mallctl(cmd, (void *)&released, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return released;
+}
+
+TEST_BEGIN(test_retained_limit) {
+	test_skip_if(!opt_retain);
+
+	unsigned arena_ind = do_arena_create();
+	pac_t *pac = pac_get(arena_ind);
+	do_alloc_free(arena_ind, 8);
+	size_t npages = ecache_npages_get(&pac->ecache_retained);
+	expect_zu_ge(npages, 8 * (ALLOC_SIZE >> LG_PAGE), "");
+
+	/* No limit by default. */
+	do_deferred_work(arena_ind);
+	expect_zu_eq(npages, ecache_npages_get(&pac->ecache_retained), "");
+
+	size_t limit = 2 * ALLOC_SIZE;
+	do_mallctl_set("arena.%u.retained_limit", arena_ind, (void *)&limit,
+	    sizeof(limit));
+	expect_u64_eq(pac_ns_until_deferred_work(pac), 0,
+	    "Being over the limit should call for deferred work right away");
+	do_deferred_work(arena_ind);
+	size_t npages_left = ecache_npages_get(&pac->ecache_retained);
+	expect_zu_le(npages_left, limit >> LG_PAGE, "");
+	if (config_stats) {
+		expect_u64_eq(npages - npages_left, get_released(arena_ind),
+		    "");
+	}
+
+	/*
+	 * Growing again afterwards shouldn't reserve as much as the last growth
+	 * did, which would take us right back over the limit.
+	 */
+	expect_zu_le(sz_pind2sz(pac->exp_grow.next), limit, "");
+	void *ptr = mallocx(ALLOC_SIZE, MALLOCX_ARENA(arena_ind)
+	    | MALLOCX_TCACHE_NONE);
+	expect_ptr_not_null(ptr, "Unexpected mallocx() failure");
+	expect_zu_le(ecache_npages_get(&pac->ecache_retained), limit >> LG_PAGE,
+	    "Growth should fit in the limit");
+	dallocx(ptr, MALLOCX_TCACHE_NONE);
+
+	/* Still usable afterwards. */
+	do_alloc_free(arena_ind, 8);
+	do_deferred_work(arena_ind);
+	expect_zu_le(ecache_npages_get(&pac->ecache_retained),
+	    limit >> LG_PAGE, "");
+}
+TEST_END
+
+static extent_hooks_t *default_hooks;
+static extent_hooks_t hooks_no_destroy;
+
+static void *
+extent_alloc_hook(extent_hooks_t *extent_hooks, void *new_addr, size_t size,
+    size_t alignment, bool *zero, bool *commit, unsigned arena_ind) {
+	/* The default hook goes by arena 0, as the new one isn't set up yet. */
+	return default_hooks->alloc(default_hooks, new_addr, size, alignment,
+	    zero, commit, 0);
+}
+
+TEST_BEGIN(test_retained_limit_no_destroy) {
+	test_skip_if(!opt_retain);
+
+	/* The default hooks, except that retained memory can't be unmapped. */
+	size_t sz = sizeof(default_hooks);
+	expect_d_eq(mallctl("arena.0.extent_hooks", (void *)&default_hooks,
+	    &sz, NULL, 0), 0, "Unexpected mallctl() failure");
+	hooks_no_destroy = *default_hooks;
+	hooks_no_destroy.alloc = &extent_alloc_hook;
+	hooks_no_destroy.destroy = NULL;
+	extent_hooks_t *hooks = &hooks_no_destroy;
+	unsigned arena_ind;
+	sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz,
+	    (void *)&hooks, sizeof(hooks)), 0, "Unexpected mallctl() failure");
+	pac_t *pac = pac_get(arena_ind);
+
+	size_t limit = PAGE;
+	do_mallctl_set("arena.%u.retained_limit", arena_ind, (void *)&limit,
+	    sizeof(limit));
+	do_alloc_free(arena_ind, 2);
+	size_t npages = ecache_npages_get(&pac->ecache_retained);
+	expect_zu_gt(npages, limit >> LG_PAGE, "");
+	/* Nothing can be done about it, so don't keep waking up for it. */
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    pac_ns_until_deferred_work(pac), "");
+	do_deferred_work(arena_ind);
+	expect_zu_eq(npages, ecache_npages_get(&pac->ecache_retained), "");
+}
+TEST_END
+
+TEST_BEGIN(test_retained_idle) {
+	test_skip_if(!opt_retain);
+
+	unsigned arena_ind = do_arena_create();
+	pac_t *pac = pac_get(arena_ind);
+	do_alloc_free(arena_ind, 4);
+	expect_zu_gt(ecache_npages_get(&pac->ecache_retained), 0, "");
+
+	ssize_t idle_ms = 0;
+	do_mallctl_set("arena.%u.retained_idle_ms", arena_ind,
+	    (void *)&idle_ms, sizeof(idle_ms));
+	/* The first pass only notices that the ecache was used. */
+	do_deferred_work(arena_ind);
+	expect_zu_gt(ecache_npages_get(&pac->ecache_retained), 0, "");
+	/* With no use since, the next releases all of it. */
+	do_deferred_work(arena_ind);
+	expect_zu_eq(0, ecache_npages_get(&pac->ecache_retained), "");
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    pac_ns_until_deferred_work(pac), "Nothing left to release");
+
+	/* A long idle period leaves fresh retained space alone. */
+	idle_ms = 1000 * 1000;
+	do_mallctl_set("arena.%u.retained_idle_ms", arena_ind,
+	    (void *)&idle_ms, sizeof(idle_ms));
+	do_alloc_free(arena_ind, 4);
+	size_t npages = ecache_npages_get(&pac->ecache_retained);
+	expect_zu_gt(npages, 0, "");
+	do_deferred_work(arena_ind);
+	do_deferred_work(arena_ind);
+	expect_zu_eq(npages, ecache_npages_get(&pac->ecache_retained), "");
+
+	idle_ms = -2;
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.retained_idle_ms",
+	    arena_ind);
+	expect_d_eq(mallctl(cmd, NULL, NULL, (void *)&idle_ms,
+	    sizeof(idle_ms)), EFAULT, "Invalid idle time should be rejected");
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_retained_limit,
+	    test_retained_limit_no_destroy,
+	    test_retained_idle);
+}
@@ -8,6 +8,9 @@ struct pai_test_allocator_s {
 	bool alloc_fail;
 	size_t alloc_count;
 	size_t dalloc_count;
+	/* Calls to the batch functions (which also bump the counts above). */
+	size_t alloc_batch_count;
+	size_t dalloc_batch_count;
 	/*
 	 * We use a simple bump allocator as the implementation.  This isn't
 	 * *really* correct, since we may allow expansion into a subsequent
@@ -41,6 +44,22 @@ pai_test_allocator_alloc(tsdn_t *tsdn, pai_t *self, size_t size,
 	return edata;
 }
 
+static inline size_t
+pai_test_allocator_alloc_batch(tsdn_t *tsdn, pai_t *self, size_t size,
+    size_t nallocs, edata_list_active_t *results) {
+	pai_test_allocator_t *ta = (pai_test_allocator_t *)self;
+	ta->alloc_batch_count++;
+	for (size_t i = 0; i < nallocs; i++) {
+		edata_t *edata = pai_test_allocator_alloc(tsdn, self, size,
+		    PAGE, /* zero */ false);
+		if (edata == NULL) {
+			return i;
+		}
+		edata_list_active_append(results, edata);
+	}
+	return nallocs;
+}
+
 static bool
 pai_test_allocator_expand(tsdn_t *tsdn, pai_t *self, edata_t *edata,
     size_t old_size, size_t new_size, bool zero) {
@@ -64,11 +83,25 @@ pai_test_allocator_dalloc(tsdn_t *tsdn, pai_t *self, edata_t *edata) {
 	free(edata);
 }
 
+static void
+pai_test_allocator_dalloc_batch(tsdn_t *tsdn, pai_t *self,
+    edata_list_active_t *list) {
+	pai_test_allocator_t *ta = (pai_test_allocator_t *)self;
+	ta->dalloc_batch_count++;
+	edata_t *edata;
+	while ((edata = edata_list_active_first(list)) != NULL) {
+		edata_list_active_remove(list, edata);
+		pai_test_allocator_dalloc(tsdn, self, edata);
+	}
+}
+
 static inline void
 pai_test_allocator_init(pai_test_allocator_t *ta) {
 	ta->alloc_fail = false;
 	ta->alloc_count = 0;
 	ta->dalloc_count = 0;
+	ta->alloc_batch_count = 0;
+	ta->dalloc_batch_count = 0;
 	/* Just don't start the edata at 0. */
 	ta->next_ptr = 10 * PAGE;
 	ta->expand_count = 0;
@@ -76,9 +109,46 @@ pai_test_allocator_init(pai_test_allocator_t *ta) {
 	ta->shrink_count = 0;
 	ta->shrink_return_value = false;
 	ta->pai.alloc = &pai_test_allocator_alloc;
+	ta->pai.alloc_batch = &pai_test_allocator_alloc_batch;
 	ta->pai.expand = &pai_test_allocator_expand;
 	ta->pai.shrink = &pai_test_allocator_shrink;
 	ta->pai.dalloc = &pai_test_allocator_dalloc;
+	ta->pai.dalloc_batch = &pai_test_allocator_dalloc_batch;
+}
+
+/*
+ * The SEC allocates its shards out of a base, which we share across tests (and
+ * never free; it's only some metadata).
+ */
+static base_t *
+test_base_get(void) {
+	static base_t *base = NULL;
+	if (base == NULL) {
+		base = base_new(TSDN_NULL, /* ind */ 0,
+		    &ehooks_default_extent_hooks);
+		assert_ptr_not_null(base, "");
+	}
+	return base;
+}
+
+static void
+test_sec_init(sec_t *sec, pai_t *fallback, size_t nshards, size_t max_alloc,
+    size_t max_bytes) {
+	sec_opts_t opts;
+	opts.nshards = nshards;
+	opts.shard_by_cpu = false;
+	opts.max_alloc = max_alloc;
+	opts.max_bytes = max_bytes;
+	/*
+	 * Most tests want exact control over what the fallback sees, so
+	 * overflows flush everything, and we never fill or age out.
+	 */
+	opts.bytes_after_flush = 0;
+	opts.batch_fill_extra = 0;
+	opts.max_idle_ms = 0;
+
+	bool err = sec_init(TSDN_NULL, sec, test_base_get(), fallback, &opts);
+	assert_false(err, "Unexpected initialization failure");
 }
 
 TEST_BEGIN(test_reuse) {
@@ -99,8 +169,8 @@ TEST_BEGIN(test_reuse) {
 	enum { NALLOCS = 10 };
 	edata_t *one_page[NALLOCS];
 	edata_t *two_page[NALLOCS];
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ 2 * PAGE,
-	    /* bytes_max */ NALLOCS * PAGE + NALLOCS * 2 * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ 2 * PAGE,
+	    /* max_bytes */ NALLOCS * PAGE + NALLOCS * 2 * PAGE);
 	for (int i = 0; i < NALLOCS; i++) {
 		one_page[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
 		    /* zero */ false);
@@ -162,8 +232,8 @@ TEST_BEGIN(test_auto_flush) {
 	enum { NALLOCS = 10 };
 	edata_t *extra_alloc;
 	edata_t *allocs[NALLOCS];
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ PAGE,
-	    /* bytes_max */ NALLOCS * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ NALLOCS * PAGE);
 	for (int i = 0; i < NALLOCS; i++) {
 		allocs[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
 		    /* zero */ false);
@@ -192,6 +262,8 @@ TEST_BEGIN(test_auto_flush) {
 	    "Incorrect number of allocations");
 	expect_zu_eq(NALLOCS + 1, ta.dalloc_count,
 	    "Incorrect number of deallocations");
+	expect_zu_eq(1, ta.dalloc_batch_count,
+	    "The flush should go to the fallback in a single batch");
 }
 TEST_END
 
@@ -209,8 +281,8 @@ do_disable_flush_test(bool is_disable) {
 
 	enum { NALLOCS = 10 };
 	edata_t *allocs[NALLOCS];
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ PAGE,
-	    /* bytes_max */ NALLOCS * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ NALLOCS * PAGE);
 	for (int i = 0; i < NALLOCS; i++) {
 		allocs[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
 		    /* zero */ false);
@@ -265,11 +337,11 @@ TEST_BEGIN(test_alloc_max_respected) {
 	/* See the note above -- we can't use the real tsd. */
 	tsdn_t *tsdn = TSDN_NULL;
 
-	size_t alloc_max = 2 * PAGE;
+	size_t max_alloc = 2 * PAGE;
 	size_t attempted_alloc = 3 * PAGE;
 
-	sec_init(&sec, &ta.pai, /* nshards */ 1, alloc_max,
-	    /* bytes_max */ 1000 * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, max_alloc,
+	    /* max_bytes */ 1000 * PAGE);
 
 	for (size_t i = 0; i < 100; i++) {
 		expect_zu_eq(i, ta.alloc_count,
@@ -299,8 +371,8 @@ TEST_BEGIN(test_expand_shrink_delegate) {
 	/* See the note above -- we can't use the real tsd. */
 	tsdn_t *tsdn = TSDN_NULL;
 
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ 10 * PAGE,
-	    /* bytes_max */ 1000 * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1,
+	    /* max_alloc */ 10 * PAGE, /* max_bytes */ 1000 * PAGE);
 	edata_t *edata = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
 	    /* zero */ false);
 	expect_ptr_not_null(edata, "Unexpected alloc failure");
@@ -332,8 +404,8 @@ TEST_BEGIN(test_nshards_0) {
 	/* See the note above -- we can't use the real tsd. */
 	tsdn_t *tsdn = TSDN_NULL;
 
-	sec_init(&sec, &ta.pai, /* nshards */ 0, /* alloc_max */ 10 * PAGE,
-	    /* bytes_max */ 1000 * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 0,
+	    /* max_alloc */ 10 * PAGE, /* max_bytes */ 1000 * PAGE);
 
 	edata_t *edata = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
 	    /* zero */ false);
@@ -348,6 +420,7 @@ TEST_END
 static void
 expect_stats_pages(tsdn_t *tsdn, sec_t *sec, size_t npages) {
 	sec_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
 	/*
 	 * Check that the stats merging accumulates rather than overwrites by
 	 * putting some (made up) data there to begin with.
@@ -370,8 +443,8 @@ TEST_BEGIN(test_stats_simple) {
 		FLUSH_PAGES = 10,
 	};
 
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ PAGE,
-	    /* bytes_max */ FLUSH_PAGES * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ FLUSH_PAGES * PAGE);
 
 	edata_t *allocs[FLUSH_PAGES];
 	for (size_t i = 0; i < FLUSH_PAGES; i++) {
@@ -407,8 +480,8 @@ TEST_BEGIN(test_stats_auto_flush) {
 		FLUSH_PAGES = 10,
 	};
 
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ PAGE,
-	    /* bytes_max */ FLUSH_PAGES * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ FLUSH_PAGES * PAGE);
 
 	edata_t *extra_alloc0;
 	edata_t *extra_alloc1;
@@ -455,8 +528,8 @@ TEST_BEGIN(test_stats_manual_flush) {
 		FLUSH_PAGES = 10,
 	};
 
-	sec_init(&sec, &ta.pai, /* nshards */ 1, /* alloc_max */ PAGE,
-	    /* bytes_max */ FLUSH_PAGES * PAGE);
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ FLUSH_PAGES * PAGE);
 
 	edata_t *allocs[FLUSH_PAGES];
 	for (size_t i = 0; i < FLUSH_PAGES; i++) {
@@ -484,6 +557,436 @@ TEST_BEGIN(test_stats_manual_flush) {
 }
 TEST_END
 
+TEST_BEGIN(test_batch) {
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec;
+	/* See the note above -- we can't use the real tsd. */
+	tsdn_t *tsdn = TSDN_NULL;
+
+	enum { NALLOCS = 10 };
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ 1000 * PAGE);
+	edata_list_active_t list;
+	edata_list_active_init(&list);
+
+	size_t nsuccess = pai_alloc_batch(tsdn, &sec.pai, PAGE, NALLOCS,
+	    &list);
+	expect_zu_eq(NALLOCS, nsuccess, "Unexpected alloc failure");
+	expect_zu_eq(NALLOCS, ta.alloc_count, "");
+	expect_zu_eq(1, ta.alloc_batch_count,
+	    "Misses should go to the fallback in a single batch");
+
+	/* Cacheable extents stay in the SEC. */
+	pai_dalloc_batch(tsdn, &sec.pai, &list);
+	expect_true(edata_list_active_empty(&list), "List should be drained");
+	expect_zu_eq(0, ta.dalloc_count, "");
+
+	/* Half from the cache, half from the fallback. */
+	nsuccess = pai_alloc_batch(tsdn, &sec.pai, PAGE, 2 * NALLOCS, &list);
+	expect_zu_eq(2 * NALLOCS, nsuccess, "Unexpected alloc failure");
+	expect_zu_eq(2 * NALLOCS, ta.alloc_count, "");
+	expect_zu_eq(2, ta.alloc_batch_count, "");
+
+	/* Uncacheable extents get forwarded, again in a single batch. */
+	edata_t *big = pai_alloc(tsdn, &sec.pai, 2 * PAGE, PAGE,
+	    /* zero */ false);
+	expect_ptr_not_null(big, "Unexpected alloc failure");
+	edata_list_active_append(&list, big);
+	pai_dalloc_batch(tsdn, &sec.pai, &list);
+	expect_zu_eq(1, ta.dalloc_count, "");
+	expect_zu_eq(1, ta.dalloc_batch_count, "");
+	expect_stats_pages(tsdn, &sec, 2 * NALLOCS);
+
+	sec_flush(tsdn, &sec);
+	expect_zu_eq(2 * NALLOCS + 1, ta.dalloc_count, "");
+	expect_zu_eq(2, ta.dalloc_batch_count, "");
+}
+TEST_END
+
+TEST_BEGIN(test_batch_fill) {
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec;
+	/* See the note above -- we can't use the real tsd. */
+	tsdn_t *tsdn = TSDN_NULL;
+
+	enum {
+		BATCH_FILL_EXTRA = 4,
+		MAX_BYTES_PAGES = 6,
+	};
+	sec_opts_t opts;
+	opts.nshards = 1;
+	opts.shard_by_cpu = false;
+	opts.max_alloc = 2 * PAGE;
+	opts.max_bytes = MAX_BYTES_PAGES * PAGE;
+	opts.bytes_after_flush = 0;
+	opts.batch_fill_extra = BATCH_FILL_EXTRA;
+	opts.max_idle_ms = 0;
+	sec_init(TSDN_NULL, &sec, test_base_get(), &ta.pai, &opts);
+
+	/* A miss should fetch the extras in the same trip to the fallback. */
+	edata_t *edata = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ false);
+	expect_ptr_not_null(edata, "Unexpected alloc failure");
+	expect_zu_eq(1 + BATCH_FILL_EXTRA, ta.alloc_count, "");
+	expect_zu_eq(1, ta.alloc_batch_count, "");
+	expect_stats_pages(tsdn, &sec, BATCH_FILL_EXTRA);
+
+	/* The extras then serve the next allocations. */
+	edata_t *allocs[BATCH_FILL_EXTRA];
+	for (int i = 0; i < BATCH_FILL_EXTRA; i++) {
+		allocs[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(allocs[i], "Unexpected alloc failure");
+	}
+	expect_zu_eq(1 + BATCH_FILL_EXTRA, ta.alloc_count, "");
+	expect_zu_eq(1, ta.alloc_batch_count, "");
+	expect_stats_pages(tsdn, &sec, 0);
+
+	/* Zeroed allocations can't be cached, and so don't fill. */
+	edata_t *zeroed = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ true);
+	expect_ptr_not_null(zeroed, "Unexpected alloc failure");
+	expect_zu_eq(2 + BATCH_FILL_EXTRA, ta.alloc_count, "");
+	expect_zu_eq(1, ta.alloc_batch_count, "");
+	expect_stats_pages(tsdn, &sec, 0);
+
+	/*
+	 * Fills stay within max_bytes: with 3 two-page extents worth of space,
+	 * we can only keep 2 extra beyond the one we return.
+	 */
+	pai_dalloc(tsdn, &sec.pai, edata);
+	pai_dalloc(tsdn, &sec.pai, zeroed);
+	expect_stats_pages(tsdn, &sec, 2);
+	edata_t *two_page = pai_alloc(tsdn, &sec.pai, 2 * PAGE, PAGE,
+	    /* zero */ false);
+	expect_ptr_not_null(two_page, "Unexpected alloc failure");
+	expect_zu_eq(2, ta.alloc_batch_count, "");
+	expect_zu_eq(2 + BATCH_FILL_EXTRA + 3, ta.alloc_count, "");
+	expect_stats_pages(tsdn, &sec, MAX_BYTES_PAGES);
+
+	sec_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	sec_stats_merge(tsdn, &sec, &stats);
+	expect_u64_eq(2, stats.total.nfills, "");
+	expect_u64_eq(BATCH_FILL_EXTRA + 2, stats.total.nfilled, "");
+}
+TEST_END
+
+TEST_BEGIN(test_stats_bins) {
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec;
+	/* See the note above -- we can't use the real tsd. */
+	tsdn_t *tsdn = TSDN_NULL;
+
+	enum { NALLOCS = 10 };
+	test_sec_init(&sec, &ta.pai, /* nshards */ 1, /* max_alloc */ 2 * PAGE,
+	    /* max_bytes */ NALLOCS * PAGE);
+
+	edata_t *allocs[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		allocs[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(allocs[i], "Unexpected alloc failure");
+	}
+	for (int i = 0; i < NALLOCS / 2; i++) {
+		pai_dalloc(tsdn, &sec.pai, allocs[i]);
+	}
+	for (int i = 0; i < NALLOCS / 2 - 1; i++) {
+		allocs[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(allocs[i], "Unexpected alloc failure");
+	}
+	/* Uncacheable requests are neither hits nor misses. */
+	edata_t *big = pai_alloc(tsdn, &sec.pai, 3 * PAGE, PAGE,
+	    /* zero */ false);
+	expect_ptr_not_null(big, "Unexpected alloc failure");
+	edata_t *two_page = pai_alloc(tsdn, &sec.pai, 2 * PAGE, PAGE,
+	    /* zero */ false);
+	expect_ptr_not_null(two_page, "Unexpected alloc failure");
+	pai_dalloc(tsdn, &sec.pai, two_page);
+
+	pszind_t one_ind = sz_psz2ind(PAGE);
+	pszind_t two_ind = sz_psz2ind(2 * PAGE);
+	sec_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	sec_stats_merge(tsdn, &sec, &stats);
+	expect_zu_eq(PAGE, stats.bins[one_ind].bytes, "");
+	expect_u64_eq(NALLOCS / 2 - 1, stats.bins[one_ind].nhits, "");
+	expect_u64_eq(NALLOCS, stats.bins[one_ind].nmisses, "");
+	expect_zu_eq(2 * PAGE, stats.bins[two_ind].bytes, "");
+	expect_u64_eq(0, stats.bins[two_ind].nhits, "");
+	expect_u64_eq(1, stats.bins[two_ind].nmisses, "");
+	expect_u64_eq(NALLOCS / 2 - 1, stats.total.nhits, "");
+	expect_u64_eq(NALLOCS + 1, stats.total.nmisses, "");
+	expect_zu_eq(3 * PAGE, stats.total.bytes, "");
+	expect_u64_eq(0, stats.total.nflushed, "");
+	expect_u64_eq(0, stats.noverflow_flushes, "");
+
+	/*
+	 * Overflowing max_bytes flushes every bin (since bytes_after_flush is
+	 * 0), and counts as such.  The
+	 * extent originally at index NALLOCS / 2 - 1 got handed back out at
+	 * index 0 above, and the last one we save for later.
+	 */
+	for (int i = 0; i < NALLOCS - 1; i++) {
+		if (i != NALLOCS / 2 - 1) {
+			pai_dalloc(tsdn, &sec.pai, allocs[i]);
+		}
+	}
+	memset(&stats, 0, sizeof(stats));
+	sec_stats_merge(tsdn, &sec, &stats);
+	expect_zu_eq(0, stats.bytes, "");
+	expect_u64_eq(1, stats.noverflow_flushes, "");
+	expect_u64_eq(NALLOCS - 1, stats.bins[one_ind].nflushed, "");
+	expect_u64_eq(1, stats.bins[two_ind].nflushed, "");
+
+	/* A manual flush counts flushed extents, but isn't an overflow. */
+	pai_dalloc(tsdn, &sec.pai, allocs[NALLOCS - 1]);
+	sec_flush(tsdn, &sec);
+	memset(&stats, 0, sizeof(stats));
+	sec_stats_merge(tsdn, &sec, &stats);
+	expect_u64_eq(1, stats.noverflow_flushes, "");
+	expect_u64_eq(NALLOCS, stats.bins[one_ind].nflushed, "");
+	expect_u64_eq(NALLOCS + 1, stats.total.nflushed, "");
+}
+TEST_END
+
+TEST_BEGIN(test_overflow_flush_lru) {
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec;
+	/* See the note above -- we can't use the real tsd. */
+	tsdn_t *tsdn = TSDN_NULL;
+
+	sec_opts_t opts;
+	opts.nshards = 1;
+	opts.shard_by_cpu = false;
+	opts.max_alloc = 2 * PAGE;
+	opts.max_bytes = 8 * PAGE;
+	opts.bytes_after_flush = 4 * PAGE;
+	opts.batch_fill_extra = 0;
+	opts.max_idle_ms = 0;
+	sec_init(TSDN_NULL, &sec, test_base_get(), &ta.pai, &opts);
+
+	enum { NONE_PAGE = 4, NTWO_PAGE = 3 };
+	edata_t *one_page[NONE_PAGE];
+	edata_t *two_page[NTWO_PAGE];
+	for (int i = 0; i < NONE_PAGE; i++) {
+		one_page[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(one_page[i], "Unexpected alloc failure");
+	}
+	for (int i = 0; i < NTWO_PAGE; i++) {
+		two_page[i] = pai_alloc(tsdn, &sec.pai, 2 * PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(two_page[i], "Unexpected alloc failure");
+	}
+
+	/* Interleave the sizes, filling the shard up to exactly max_bytes. */
+	pai_dalloc(tsdn, &sec.pai, one_page[0]);
+	pai_dalloc(tsdn, &sec.pai, two_page[0]);
+	pai_dalloc(tsdn, &sec.pai, one_page[1]);
+	pai_dalloc(tsdn, &sec.pai, two_page[1]);
+	pai_dalloc(tsdn, &sec.pai, one_page[2]);
+	pai_dalloc(tsdn, &sec.pai, one_page[3]);
+	expect_stats_pages(tsdn, &sec, 8);
+	expect_zu_eq(0, ta.dalloc_count, "");
+
+	/*
+	 * Going over should evict the four oldest extents, from both bins, in
+	 * a single batch, which gets us down to bytes_after_flush.
+	 */
+	pai_dalloc(tsdn, &sec.pai, two_page[2]);
+	expect_stats_pages(tsdn, &sec, 4);
+	expect_zu_eq(4, ta.dalloc_count, "");
+	expect_zu_eq(1, ta.dalloc_batch_count, "");
+
+	sec_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	sec_stats_merge(tsdn, &sec, &stats);
+	expect_u64_eq(1, stats.noverflow_flushes, "");
+	expect_u64_eq(2, stats.bins[sz_psz2ind(PAGE)].nflushed, "");
+	expect_u64_eq(2, stats.bins[sz_psz2ind(2 * PAGE)].nflushed, "");
+
+	/* The most recently freed extents are still cached. */
+	expect_ptr_eq(one_page[3], pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ false), "");
+	expect_ptr_eq(one_page[2], pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ false), "");
+	expect_ptr_eq(two_page[2], pai_alloc(tsdn, &sec.pai, 2 * PAGE, PAGE,
+	    /* zero */ false), "");
+	expect_stats_pages(tsdn, &sec, 0);
+	expect_zu_eq(NONE_PAGE + NTWO_PAGE, ta.alloc_count, "");
+}
+TEST_END
+
+static nstime_update_t *nstime_update_orig;
+static nstime_t time_mock;
+
+static void
+nstime_update_mock(nstime_t *time) {
+	nstime_copy(time, &time_mock);
+}
+
+TEST_BEGIN(test_max_idle) {
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec;
+	/* See the note above -- we can't use the real tsd. */
+	tsdn_t *tsdn = TSDN_NULL;
+
+	nstime_update_orig = nstime_update;
+	nstime_update = nstime_update_mock;
+	nstime_init(&time_mock, 0);
+
+	sec_opts_t opts;
+	opts.nshards = 1;
+	opts.shard_by_cpu = false;
+	opts.max_alloc = PAGE;
+	opts.max_bytes = 10 * PAGE;
+	opts.bytes_after_flush = 0;
+	opts.batch_fill_extra = 0;
+	opts.max_idle_ms = 1000;
+	sec_init(TSDN_NULL, &sec, test_base_get(), &ta.pai, &opts);
+
+	uint64_t ms = 1000 * 1000;
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    sec_ns_until_deferred_work(tsdn, &sec),
+	    "An empty SEC has nothing to age out");
+
+	edata_t *edata0 = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ false);
+	edata_t *edata1 = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ false);
+	expect_ptr_not_null(edata0, "Unexpected alloc failure");
+	expect_ptr_not_null(edata1, "Unexpected alloc failure");
+
+	pai_dalloc(tsdn, &sec.pai, edata0);
+	nstime_init(&time_mock, 500 * ms);
+	pai_dalloc(tsdn, &sec.pai, edata1);
+	expect_u64_eq(500 * ms, sec_ns_until_deferred_work(tsdn, &sec), "");
+	sec_do_deferred_work(tsdn, &sec);
+	expect_zu_eq(0, ta.dalloc_count, "Aged out an extent too early");
+
+	nstime_init(&time_mock, 1000 * ms);
+	expect_u64_eq(0, sec_ns_until_deferred_work(tsdn, &sec), "");
+	sec_do_deferred_work(tsdn, &sec);
+	expect_zu_eq(1, ta.dalloc_count, "Should have aged out one extent");
+	expect_stats_pages(tsdn, &sec, 1);
+	expect_u64_eq(500 * ms, sec_ns_until_deferred_work(tsdn, &sec), "");
+
+	/* Reallocating the other resets its idle time. */
+	expect_ptr_eq(edata1, pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+	    /* zero */ false), "");
+	expect_u64_eq(BACKGROUND_THREAD_INDEFINITE_SLEEP,
+	    sec_ns_until_deferred_work(tsdn, &sec), "");
+	pai_dalloc(tsdn, &sec.pai, edata1);
+	expect_u64_eq(1000 * ms, sec_ns_until_deferred_work(tsdn, &sec), "");
+
+	/* Age-outs don't count as overflows. */
+	sec_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	sec_stats_merge(tsdn, &sec, &stats);
+	expect_u64_eq(0, stats.noverflow_flushes, "");
+	expect_u64_eq(1, stats.total.nflushed, "");
+
+	nstime_update = nstime_update_orig;
+}
+TEST_END
+
+TEST_BEGIN(test_shard_by_cpu) {
+	test_skip_if(!have_percpu_arena);
+
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec;
+	/* See the note above -- we can't use the real tsd. */
+	tsdn_t *tsdn = TSDN_NULL;
+
+	/* More shards than the old fixed limit of 8. */
+	enum { NSHARDS = 64, NALLOCS = 10 };
+	sec_opts_t opts;
+	opts.nshards = NSHARDS;
+	opts.shard_by_cpu = true;
+	opts.max_alloc = PAGE;
+	opts.max_bytes = NALLOCS * PAGE;
+	opts.bytes_after_flush = 0;
+	opts.batch_fill_extra = 0;
+	opts.max_idle_ms = 0;
+	bool err = sec_init(tsdn, &sec, test_base_get(), &ta.pai, &opts);
+	assert_false(err, "Unexpected initialization failure");
+	expect_zu_eq(NSHARDS, sec.opts.nshards, "");
+
+	/*
+	 * We might migrate between CPUs at any point, so we can't say which
+	 * shards things land in; but wherever they go, they should be cached
+	 * and then flushed correctly.
+	 */
+	edata_t *allocs[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		allocs[i] = pai_alloc(tsdn, &sec.pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(allocs[i], "Unexpected alloc failure");
+	}
+	for (int i = 0; i < NALLOCS; i++) {
+		pai_dalloc(tsdn, &sec.pai, allocs[i]);
+	}
+	expect_zu_eq(0, ta.dalloc_count, "");
+	expect_stats_pages(tsdn, &sec, NALLOCS);
+	sec_flush(tsdn, &sec);
+	expect_zu_eq(NALLOCS, ta.dalloc_count, "");
+	expect_stats_pages(tsdn, &sec, 0);
+}
+TEST_END
+
+TEST_BEGIN(test_shard_index_shared) {
+	/*
+	 * An arena can have two SECs (the HPA's and the PAC's), with different
+	 * numbers of shards, and a thread's shard index is shared between
+	 * them.  Picking a shard out of one mustn't run off the end of the
+	 * other.  This needs the real tsd; the fallback is only called outside
+	 * of the SEC's locks here, so its mallocs are safe.
+	 */
+	tsd_t *tsd = tsd_fetch();
+	tsdn_t *tsdn = tsd_tsdn(tsd);
+
+	pai_test_allocator_t ta;
+	pai_test_allocator_init(&ta);
+	sec_t sec_many;
+	sec_t sec_one;
+	test_sec_init(&sec_many, &ta.pai, /* nshards */ 64, /* max_alloc */ PAGE,
+	    /* max_bytes */ 4 * PAGE);
+	test_sec_init(&sec_one, &ta.pai, /* nshards */ 1, /* max_alloc */ PAGE,
+	    /* max_bytes */ 4 * PAGE);
+
+	for (int i = 0; i < 100; i++) {
+		/* As for a fresh thread. */
+		*tsd_sec_shardp_get(tsd) = (uint16_t)-1;
+		sec_t *first = (i % 2 == 0) ? &sec_many : &sec_one;
+		sec_t *second = (i % 2 == 0) ? &sec_one : &sec_many;
+		edata_t *edata = pai_alloc(tsdn, &first->pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(edata, "Unexpected alloc failure");
+		pai_dalloc(tsdn, &first->pai, edata);
+		edata = pai_alloc(tsdn, &second->pai, PAGE, PAGE,
+		    /* zero */ false);
+		expect_ptr_not_null(edata, "Unexpected alloc failure");
+		pai_dalloc(tsdn, &second->pai, edata);
+
+		expect_stats_pages(tsdn, &sec_many, 1);
+		expect_stats_pages(tsdn, &sec_one, 1);
+		sec_flush(tsdn, &sec_many);
+		sec_flush(tsdn, &sec_one);
+		expect_stats_pages(tsdn, &sec_many, 0);
+		expect_stats_pages(tsdn, &sec_one, 0);
+	}
+	expect_zu_eq(ta.alloc_count, ta.dalloc_count, "");
+}
+TEST_END
+
 int
 main(void) {
 	return test(
@@ -496,5 +999,12 @@ main(void) {
 	    test_nshards_0,
 	    test_stats_simple,
 	    test_stats_auto_flush,
-	    test_stats_manual_flush);
+	    test_stats_manual_flush,
+	    test_batch,
+	    test_batch_fill,
+	    test_stats_bins,
+	    test_overflow_flush_lru,
+	    test_max_idle,
+	    test_shard_by_cpu,
+	    test_shard_index_shared);
 }
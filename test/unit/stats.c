@@ -408,6 +408,36 @@ TEST_BEGIN(test_stats_tcache_bytes_large) {
 }
 TEST_END
 
+TEST_BEGIN(test_stats_hpa_central) {
+	test_skip_if(!config_stats);
+
+	uint64_t epoch = 1;
+	expect_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	size_t nempty, nretained, eden_bytes;
+	size_t sz = sizeof(size_t);
+	expect_d_eq(mallctl("stats.hpa_central.nempty", (void *)&nempty, &sz,
+	    NULL, 0), 0, "Unexpected mallctl() failure");
+	expect_d_eq(mallctl("stats.hpa_central.nretained", (void *)&nretained,
+	    &sz, NULL, 0), 0, "Unexpected mallctl() failure");
+	expect_d_eq(mallctl("stats.hpa_central.eden_bytes",
+	    (void *)&eden_bytes, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+
+	/* Nothing else is running, so these shouldn't have moved. */
+	hpa_central_stats_t stats;
+	hpa_central_stats_read(tsd_tsdn(tsd_fetch()), &arena_hpa_central_global,
+	    &stats);
+	expect_zu_eq(stats.nempty, nempty, "");
+	expect_zu_eq(stats.nretained, nretained, "");
+	expect_zu_eq(stats.eden_bytes, eden_bytes, "");
+	expect_zu_le(nempty, opt_hpa_central_empty_max, "");
+	expect_zu_eq(0, eden_bytes % HUGEPAGE,
+	    "Eden is carved up a hugepage at a time");
+}
+TEST_END
+
 int
 main(void) {
 	return test_no_reentrancy(
@@ -419,5 +449,6 @@ main(void) {
 	    test_stats_arenas_bins,
 	    test_stats_arenas_lextents,
 	    test_stats_tcache_bytes_small,
-	    test_stats_tcache_bytes_large);
+	    test_stats_tcache_bytes_large,
+	    test_stats_hpa_central);
 }